@@ -0,0 +1,1673 @@
+#include "../../library/widget.h"
+#include "../../library/backend.h"
+#include "../../library/canvas.h"
+#include "../../library/image.h"
+
+#include "framebuffer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#if defined(PERSE_STATIC_BACKEND)
+  #define PERSE_API
+#elif defined(_WIN32)
+  #define PERSE_API __declspec(dllexport)
+#else
+  #define PERSE_API __attribute__((visibility("default")))
+#endif
+
+/*
+	FRAMEBUFFER BACKEND
+	
+	Draws the main window into RGBA pixels in memory, with a built-in font,
+	so it needs nothing but the C library. Embedded programs can copy the
+	pixels to whatever screen they have, and tests can check them.
+	
+	Nothing gets drawn when the library calls the backend. Instead, the parts
+	of the framebuffer that a call changes get added to the damage: the area
+	of a widget that was created, destroyed or changed, and both the old and
+	the new area of a widget that moved. Overlapping and touching rectangles
+	get merged, and if there are too many of them, they all become their
+	bounding box. A canvas that got a new draw list only adds the damage of
+	the list, which is just the commands that changed, see library/canvas.c.
+	
+	Images come from the library already decoded and scaled to fit, so they
+	only get blended onto the framebuffer. Until they are ready, there is a
+	sunken frame in their place.
+	
+	perse_impl_BackendProcessEvents() then repaints only the damaged
+	rectangles, by clipping to each one and drawing the widgets that overlap
+	it, back to front, the same way a window system would expose them.
+	
+	The drawing comes down to four loops: filling a span of pixels, copying
+	a span of pixels, blending a span of image pixels and putting a row of a
+	glyph onto a span. They don't
+	branch per pixel, so the compiler can turn them into vector instructions
+	on any target.
+	
+	Input doesn't come from anywhere by itself, the program passes it in with
+	the perse_impl_Framebuffer*() functions in framebuffer.h, from any thread.
+	It is handled in perse_impl_BackendProcessEvents(). If there is no input
+	and nothing to repaint, that waits for input or perse_impl_BackendWake(),
+	but for no longer than INPUT_WAIT, so that a program that reads its input
+	device on the same thread, between frames, still gets to do that.
+	
+	The framebuffer is the size of the main window, unless the
+	PERSE_FRAMEBUFFER_SIZE environment variable says something like
+	"800x600", and then the window gets resized to that. If
+	PERSE_FRAMEBUFFER_OUTPUT is set, each frame that changed something is
+	written to that path as a PAM image. A %i in the path gets the number of
+	the frame, any other % is left as it is.
+*/
+
+static perse_log_t logger = NULL;
+
+static void backend_log(int level, const char* fmt, ...) {
+	if (!logger) return;
+	
+	va_list args;
+	va_start(args, fmt);
+	
+	logger(level, PERSE_LOG_BACKEND, fmt, args);
+	
+	va_end(args);
+}
+
+// messages below PERSE_LOG_LEVEL get compiled out, same as in the library
+#define log(level, ...) \
+	do { \
+		if (PERSE_LOG_ENABLED(level, PERSE_LOG_BACKEND)) \
+			backend_log(level, __VA_ARGS__); \
+	} while (0)
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 9		// seven rows above the baseline, two below
+#define CELL_WIDTH 6		// room that each character takes up
+#define CELL_HEIGHT 12
+
+#define TAB_HEADER 24		// same as in layout.c
+#define TAB_PADDING 8
+#define LIST_PADDING 2
+#define WHEEL_LINE 20
+
+#define MAX_DAMAGE 16
+#define MAX_INPUT 64
+#define INPUT_WAIT 100		// ms that a frame with nothing to do waits for input
+
+enum {
+	COLOR_FACE,
+	COLOR_LIGHT,
+	COLOR_SHADOW,
+	COLOR_TEXT,
+	COLOR_HINT,
+	COLOR_FIELD,
+	COLOR_SELECTION,
+	COLOR_SELECTED_TEXT,
+	
+	COLOR_COUNT
+};
+
+enum {
+	INPUT_POINTER,
+	INPUT_WHEEL,
+	INPUT_KEY,
+	INPUT_RESIZE,
+};
+
+typedef perse_framebuffer_rect_t rect_t;
+
+typedef struct {
+	int type;
+	int x, y;
+	int value;
+} input_t;
+
+typedef struct fb_widget {
+	perse_widget_t* widget;
+	rect_t rect;					//< in framebuffer coordinates
+	
+	char hidden;					//< tab panel that isn't selected
+	char pressed;					//< button being held down
+	
+	char* text;						//< text box contents
+	int length;
+	int capacity;
+	int caret;
+	
+	int selected;					//< list box selection
+	int scroll;						//< first visible list box row
+} fb_widget_t;
+
+static int should_quit = 0;
+
+static uint32_t* pixels = NULL;
+static int width = 0;
+static int height = 0;
+
+static uint32_t colors[COLOR_COUNT];
+
+static rect_t clip;					//< drawing doesn't go outside of this
+
+static rect_t damage[MAX_DAMAGE];
+static int damage_count = 0;
+
+static rect_t painted[MAX_DAMAGE];	//< what the last frame repainted
+static int painted_count = 0;
+
+// the input queue is shared with whatever threads pass in input
+static input_t input[MAX_INPUT];
+static int input_count = 0;
+static char woken = 0;
+
+#ifdef _WIN32
+static SRWLOCK lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE arrived = CONDITION_VARIABLE_INIT;
+
+static void lock_input() { AcquireSRWLockExclusive(&lock); }
+static void unlock_input() { ReleaseSRWLockExclusive(&lock); }
+static void signal_input() { WakeConditionVariable(&arrived); }
+#else
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t arrived = PTHREAD_COND_INITIALIZER;
+
+static void lock_input() { pthread_mutex_lock(&lock); }
+static void unlock_input() { pthread_mutex_unlock(&lock); }
+static void signal_input() { pthread_cond_signal(&arrived); }
+#endif
+
+static perse_widget_t* main_window_widg = NULL;
+static fb_widget_t* focused = NULL;
+static fb_widget_t* pointer_target = NULL;
+
+static char started = 0;
+static int frame = 0;
+
+// ASCII from the space to the tilde, a byte per row, leftmost pixel in the
+// highest bit
+static const unsigned char font[95][GLYPH_HEIGHT] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},	// space
+	{0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x20, 0x00, 0x00},	// !
+	{0x50, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},	// "
+	{0x50, 0x50, 0xF8, 0x50, 0xF8, 0x50, 0x50, 0x00, 0x00},	// #
+	{0x20, 0x78, 0xA0, 0x70, 0x28, 0xF0, 0x20, 0x00, 0x00},	// $
+	{0xC0, 0xC8, 0x10, 0x20, 0x40, 0x98, 0x18, 0x00, 0x00},	// %
+	{0x60, 0x90, 0xA0, 0x40, 0xA8, 0x90, 0x68, 0x00, 0x00},	// &
+	{0x20, 0x20, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},	// '
+	{0x10, 0x20, 0x40, 0x40, 0x40, 0x20, 0x10, 0x00, 0x00},	// (
+	{0x40, 0x20, 0x10, 0x10, 0x10, 0x20, 0x40, 0x00, 0x00},	// )
+	{0x00, 0x20, 0xA8, 0x70, 0xA8, 0x20, 0x00, 0x00, 0x00},	// *
+	{0x00, 0x20, 0x20, 0xF8, 0x20, 0x20, 0x00, 0x00, 0x00},	// +
+	{0x00, 0x00, 0x00, 0x00, 0x60, 0x20, 0x40, 0x00, 0x00},	// ,
+	{0x00, 0x00, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00},	// -
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x60, 0x00, 0x00},	// .
+	{0x00, 0x08, 0x10, 0x20, 0x40, 0x80, 0x00, 0x00, 0x00},	// /
+	{0x70, 0x88, 0x98, 0xA8, 0xC8, 0x88, 0x70, 0x00, 0x00},	// 0
+	{0x20, 0x60, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, 0x00},	// 1
+	{0x70, 0x88, 0x08, 0x10, 0x20, 0x40, 0xF8, 0x00, 0x00},	// 2
+	{0xF8, 0x10, 0x20, 0x10, 0x08, 0x88, 0x70, 0x00, 0x00},	// 3
+	{0x10, 0x30, 0x50, 0x90, 0xF8, 0x10, 0x10, 0x00, 0x00},	// 4
+	{0xF8, 0x80, 0xF0, 0x08, 0x08, 0x88, 0x70, 0x00, 0x00},	// 5
+	{0x30, 0x40, 0x80, 0xF0, 0x88, 0x88, 0x70, 0x00, 0x00},	// 6
+	{0xF8, 0x08, 0x10, 0x20, 0x40, 0x40, 0x40, 0x00, 0x00},	// 7
+	{0x70, 0x88, 0x88, 0x70, 0x88, 0x88, 0x70, 0x00, 0x00},	// 8
+	{0x70, 0x88, 0x88, 0x78, 0x08, 0x10, 0x60, 0x00, 0x00},	// 9
+	{0x00, 0x60, 0x60, 0x00, 0x60, 0x60, 0x00, 0x00, 0x00},	// :
+	{0x00, 0x60, 0x60, 0x00, 0x60, 0x20, 0x40, 0x00, 0x00},	// ;
+	{0x10, 0x20, 0x40, 0x80, 0x40, 0x20, 0x10, 0x00, 0x00},	// <
+	{0x00, 0x00, 0xF8, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00},	// =
+	{0x40, 0x20, 0x10, 0x08, 0x10, 0x20, 0x40, 0x00, 0x00},	// >
+	{0x70, 0x88, 0x08, 0x10, 0x20, 0x00, 0x20, 0x00, 0x00},	// ?
+	{0x70, 0x88, 0x08, 0x68, 0xA8, 0xA8, 0x70, 0x00, 0x00},	// @
+	{0x70, 0x88, 0x88, 0xF8, 0x88, 0x88, 0x88, 0x00, 0x00},	// A
+	{0xF0, 0x88, 0x88, 0xF0, 0x88, 0x88, 0xF0, 0x00, 0x00},	// B
+	{0x70, 0x88, 0x80, 0x80, 0x80, 0x88, 0x70, 0x00, 0x00},	// C
+	{0xE0, 0x90, 0x88, 0x88, 0x88, 0x90, 0xE0, 0x00, 0x00},	// D
+	{0xF8, 0x80, 0x80, 0xF0, 0x80, 0x80, 0xF8, 0x00, 0x00},	// E
+	{0xF8, 0x80, 0x80, 0xF0, 0x80, 0x80, 0x80, 0x00, 0x00},	// F
+	{0x70, 0x88, 0x80, 0xB8, 0x88, 0x88, 0x78, 0x00, 0x00},	// G
+	{0x88, 0x88, 0x88, 0xF8, 0x88, 0x88, 0x88, 0x00, 0x00},	// H
+	{0x70, 0x20, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, 0x00},	// I
+	{0x38, 0x10, 0x10, 0x10, 0x10, 0x90, 0x60, 0x00, 0x00},	// J
+	{0x88, 0x90, 0xA0, 0xC0, 0xA0, 0x90, 0x88, 0x00, 0x00},	// K
+	{0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0xF8, 0x00, 0x00},	// L
+	{0x88, 0xD8, 0xA8, 0xA8, 0x88, 0x88, 0x88, 0x00, 0x00},	// M
+	{0x88, 0x88, 0xC8, 0xA8, 0x98, 0x88, 0x88, 0x00, 0x00},	// N
+	{0x70, 0x88, 0x88, 0x88, 0x88, 0x88, 0x70, 0x00, 0x00},	// O
+	{0xF0, 0x88, 0x88, 0xF0, 0x80, 0x80, 0x80, 0x00, 0x00},	// P
+	{0x70, 0x88, 0x88, 0x88, 0xA8, 0x90, 0x68, 0x00, 0x00},	// Q
+	{0xF0, 0x88, 0x88, 0xF0, 0xA0, 0x90, 0x88, 0x00, 0x00},	// R
+	{0x78, 0x80, 0x80, 0x70, 0x08, 0x08, 0xF0, 0x00, 0x00},	// S
+	{0xF8, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00},	// T
+	{0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x70, 0x00, 0x00},	// U
+	{0x88, 0x88, 0x88, 0x88, 0x88, 0x50, 0x20, 0x00, 0x00},	// V
+	{0x88, 0x88, 0x88, 0xA8, 0xA8, 0xA8, 0x50, 0x00, 0x00},	// W
+	{0x88, 0x88, 0x50, 0x20, 0x50, 0x88, 0x88, 0x00, 0x00},	// X
+	{0x88, 0x88, 0x88, 0x50, 0x20, 0x20, 0x20, 0x00, 0x00},	// Y
+	{0xF8, 0x08, 0x10, 0x20, 0x40, 0x80, 0xF8, 0x00, 0x00},	// Z
+	{0x70, 0x40, 0x40, 0x40, 0x40, 0x40, 0x70, 0x00, 0x00},	// [
+	{0x00, 0x80, 0x40, 0x20, 0x10, 0x08, 0x00, 0x00, 0x00},	// backslash
+	{0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x70, 0x00, 0x00},	// ]
+	{0x20, 0x50, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},	// ^
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x00, 0x00},	// _
+	{0x40, 0x20, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},	// `
+	{0x00, 0x00, 0x70, 0x08, 0x78, 0x88, 0x78, 0x00, 0x00},	// a
+	{0x80, 0x80, 0xB0, 0xC8, 0x88, 0x88, 0xF0, 0x00, 0x00},	// b
+	{0x00, 0x00, 0x70, 0x80, 0x80, 0x88, 0x70, 0x00, 0x00},	// c
+	{0x08, 0x08, 0x68, 0x98, 0x88, 0x88, 0x78, 0x00, 0x00},	// d
+	{0x00, 0x00, 0x70, 0x88, 0xF8, 0x80, 0x70, 0x00, 0x00},	// e
+	{0x30, 0x48, 0x40, 0xE0, 0x40, 0x40, 0x40, 0x00, 0x00},	// f
+	{0x00, 0x00, 0x78, 0x88, 0x88, 0x88, 0x78, 0x08, 0x70},	// g
+	{0x80, 0x80, 0xB0, 0xC8, 0x88, 0x88, 0x88, 0x00, 0x00},	// h
+	{0x20, 0x00, 0x60, 0x20, 0x20, 0x20, 0x70, 0x00, 0x00},	// i
+	{0x10, 0x00, 0x30, 0x10, 0x10, 0x10, 0x10, 0x90, 0x60},	// j
+	{0x80, 0x80, 0x90, 0xA0, 0xC0, 0xA0, 0x90, 0x00, 0x00},	// k
+	{0x60, 0x20, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, 0x00},	// l
+	{0x00, 0x00, 0xD0, 0xA8, 0xA8, 0xA8, 0xA8, 0x00, 0x00},	// m
+	{0x00, 0x00, 0xB0, 0xC8, 0x88, 0x88, 0x88, 0x00, 0x00},	// n
+	{0x00, 0x00, 0x70, 0x88, 0x88, 0x88, 0x70, 0x00, 0x00},	// o
+	{0x00, 0x00, 0xF0, 0x88, 0x88, 0x88, 0xF0, 0x80, 0x80},	// p
+	{0x00, 0x00, 0x78, 0x88, 0x88, 0x88, 0x78, 0x08, 0x08},	// q
+	{0x00, 0x00, 0xB0, 0xC8, 0x80, 0x80, 0x80, 0x00, 0x00},	// r
+	{0x00, 0x00, 0x70, 0x80, 0x70, 0x08, 0xF0, 0x00, 0x00},	// s
+	{0x40, 0x40, 0xE0, 0x40, 0x40, 0x48, 0x30, 0x00, 0x00},	// t
+	{0x00, 0x00, 0x88, 0x88, 0x88, 0x98, 0x68, 0x00, 0x00},	// u
+	{0x00, 0x00, 0x88, 0x88, 0x88, 0x50, 0x20, 0x00, 0x00},	// v
+	{0x00, 0x00, 0x88, 0x88, 0xA8, 0xA8, 0x50, 0x00, 0x00},	// w
+	{0x00, 0x00, 0x88, 0x50, 0x20, 0x50, 0x88, 0x00, 0x00},	// x
+	{0x00, 0x00, 0x88, 0x88, 0x88, 0x88, 0x78, 0x08, 0x70},	// y
+	{0x00, 0x00, 0xF8, 0x10, 0x20, 0x40, 0xF8, 0x00, 0x00},	// z
+	{0x10, 0x20, 0x20, 0x40, 0x20, 0x20, 0x10, 0x00, 0x00},	// {
+	{0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00},	// |
+	{0x40, 0x20, 0x20, 0x10, 0x20, 0x20, 0x40, 0x00, 0x00},	// }
+	{0x00, 0x00, 0x40, 0xA8, 0x10, 0x00, 0x00, 0x00, 0x00},	// ~
+};
+
+// finds the widget whose area a widget's area should be placed in.
+// this has to be the same as in the other backends, since the library
+// positions widgets relative to it
+static perse_widget_t* container(perse_widget_t* widg) {
+	while ((widg = widg->parent)) {
+		if (widg->type == PERSE_WIDGET_WINDOW) break;
+		if (widg->type == PERSE_WIDGET_SCROLL_PANEL) break;
+		if (widg->type == PERSE_WIDGET_TAB_PANEL) break;
+	}
+	return widg;
+}
+
+// finds a given property
+static perse_property_t* prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = widg->property;
+	while (p && p->name != name && (p = p->next));
+	return p;
+}
+
+static const char* string_prop(perse_name_t name, perse_widget_t* widg, const char* otherwise) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_STRING && p->string ? p->string : otherwise;
+}
+
+static int integer_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_INTEGER ? p->integer : 0;
+}
+
+static char boolean_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_BOOLEAN && p->boolean;
+}
+
+// finds an index of a child widget
+static int index_in_parent(perse_widget_t* widg) {
+	int index = 0;
+	for (perse_widget_t* it = widg->parent->child; it; it = it->next) {
+		if (it == widg) return index;
+		index++;
+	}
+	return -1;
+}
+
+// finds a child widget from an index
+static perse_widget_t* child_from_index(perse_widget_t* parent, int index) {
+	perse_widget_t* child = parent->child;
+	for (int i = 0; child && i <= index; i++, child = child->next) {
+		if (i == index) return child;
+	}
+	
+	return NULL;
+}
+
+static fb_widget_t* data(perse_widget_t* widget) {
+	return widget ? widget->data : NULL;
+}
+
+static void call(perse_name_t name, perse_widget_t* widget, perse_property_t* value) {
+	perse_property_t* p = prop(name, widget);
+	if (p && p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "FRAMEBUFFER:: widget type %i callback %i wrong type\n",
+			widget->type, name);
+	} else if (p) {
+		p->callback(widget, value);
+	}
+}
+
+static void call_integer(perse_name_t callback, perse_widget_t* widget, perse_name_t name, int value) {
+	perse_property_t* p = perse_CreatePropertyInteger(value);
+	p->name = name;
+	call(callback, widget, p);
+	perse_DestroyProperty(p);
+}
+
+
+/*
+	DAMAGE
+*/
+
+static rect_t make_rect(int x, int y, int w, int h) {
+	rect_t r = {x, y, x + w, y + h};
+	return r;
+}
+
+static char empty(rect_t r) {
+	return r.left >= r.right || r.top >= r.bottom;
+}
+
+static rect_t intersect(rect_t a, rect_t b) {
+	rect_t r = {
+		a.left > b.left ? a.left : b.left,
+		a.top > b.top ? a.top : b.top,
+		a.right < b.right ? a.right : b.right,
+		a.bottom < b.bottom ? a.bottom : b.bottom,
+	};
+	return r;
+}
+
+static rect_t unite(rect_t a, rect_t b) {
+	rect_t r = {
+		a.left < b.left ? a.left : b.left,
+		a.top < b.top ? a.top : b.top,
+		a.right > b.right ? a.right : b.right,
+		a.bottom > b.bottom ? a.bottom : b.bottom,
+	};
+	return r;
+}
+
+static char touching(rect_t a, rect_t b) {
+	return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+static rect_t screen() {
+	return make_rect(0, 0, width, height);
+}
+
+// adds a region that needs to be repainted
+static void add_damage(rect_t r) {
+	r = intersect(r, screen());
+	if (empty(r)) return;
+	
+	// whatever it touches gets merged into it, which can make it touch more
+	for (int i = 0; i < damage_count; i++) {
+		if (!touching(damage[i], r)) continue;
+		
+		r = unite(r, damage[i]);
+		damage[i] = damage[--damage_count];
+		i = -1;
+	}
+	
+	if (damage_count == MAX_DAMAGE) {
+		for (int i = 0; i < damage_count; i++) r = unite(r, damage[i]);
+		damage_count = 0;
+	}
+	
+	damage[damage_count++] = r;
+}
+
+static void damage_widget(fb_widget_t* f) {
+	if (f) add_damage(f->rect);
+}
+
+/*
+	DRAWING
+*/
+
+static uint32_t rgba(int r, int g, int b) {
+	unsigned char bytes[4] = {r, g, b, 255};
+	uint32_t pixel;
+	memcpy(&pixel, bytes, 4);
+	return pixel;
+}
+
+static void fill_span(uint32_t* restrict dst, uint32_t color, int count) {
+	for (int i = 0; i < count; i++) dst[i] = color;
+}
+
+static void copy_span(uint32_t* restrict dst, const uint32_t* restrict src, int count) {
+	for (int i = 0; i < count; i++) dst[i] = src[i];
+}
+
+// both are RGBA, `src` with straight alpha
+static void blend_span(unsigned char* restrict dst, const unsigned char* restrict src, int count) {
+	for (int i = 0; i < count * 4; i += 4) {
+		unsigned alpha = src[i + 3];
+		dst[i + 0] = (src[i + 0] * alpha + dst[i + 0] * (255 - alpha) + 127) / 255;
+		dst[i + 1] = (src[i + 1] * alpha + dst[i + 1] * (255 - alpha) + 127) / 255;
+		dst[i + 2] = (src[i + 2] * alpha + dst[i + 2] * (255 - alpha) + 127) / 255;
+	}
+}
+
+// pixels from `from` to `to` get the color where their bit in `bits` is set
+static void glyph_span(uint32_t* restrict dst, unsigned bits, uint32_t color, int from, int to) {
+	for (int i = from; i < to; i++) {
+		uint32_t mask = 0u - ((bits >> (7 - i)) & 1);
+		dst[i] = (dst[i] & ~mask) | (color & mask);
+	}
+}
+
+static void fill_pixel(rect_t r, uint32_t pixel) {
+	r = intersect(r, clip);
+	if (empty(r)) return;
+	
+	for (int y = r.top; y < r.bottom; y++) {
+		fill_span(pixels + y * width + r.left, pixel, r.right - r.left);
+	}
+}
+
+static void fill(rect_t r, int color) {
+	fill_pixel(r, colors[color]);
+}
+
+// draws a 3d border, raised or sunken
+static void bevel(rect_t r, char raised) {
+	if (r.right - r.left < 2 || r.bottom - r.top < 2) return;
+	
+	int light = raised ? COLOR_LIGHT : COLOR_SHADOW;
+	int dark = raised ? COLOR_SHADOW : COLOR_LIGHT;
+	
+	fill(make_rect(r.left, r.top, r.right - r.left, 1), light);
+	fill(make_rect(r.left, r.top, 1, r.bottom - r.top), light);
+	fill(make_rect(r.right - 1, r.top, 1, r.bottom - r.top), dark);
+	fill(make_rect(r.left, r.bottom - 1, r.right - r.left, 1), dark);
+}
+
+static void glyph(int x, int y, int character, uint32_t pixel) {
+	// anything outside of ASCII shows up as a question mark
+	if (character < ' ' || character > '~') character = '?';
+	const unsigned char* rows = font[character - ' '];
+	
+	int from = clip.left > x ? clip.left - x : 0;
+	int to = clip.right - x < GLYPH_WIDTH ? clip.right - x : GLYPH_WIDTH;
+	if (from >= to) return;
+	
+	for (int row = 0; row < GLYPH_HEIGHT; row++) {
+		int line = y + row;
+		if (line < clip.top) continue;
+		if (line >= clip.bottom) break;
+		
+		if (rows[row]) glyph_span(pixels + line * width + x, rows[row], pixel, from, to);
+	}
+}
+
+// each character takes up a cell, whatever its length in UTF-8
+static int text_length(const char* text, int bytes) {
+	int count = 0;
+	for (int i = 0; i < bytes; i++) {
+		if (((unsigned char)text[i] & 0xC0) != 0x80) count++;
+	}
+	return count;
+}
+
+static int text_width(const char* text, int bytes) {
+	return text_length(text, bytes) * CELL_WIDTH;
+}
+
+static int text_height() {
+	return CELL_HEIGHT;
+}
+
+// draws text with the top left corner of its cells at x, y
+static void text_pixel(int x, int y, const char* string, int length, uint32_t pixel) {
+	for (int i = 0; i < length && x < clip.right; i++) {
+		unsigned char c = string[i];
+		if ((c & 0xC0) == 0x80) continue;
+		
+		if (x + CELL_WIDTH > clip.left) glyph(x, y + 1, c, pixel);
+		x += CELL_WIDTH;
+	}
+}
+
+static void text(int x, int y, const char* string, int length, int color) {
+	text_pixel(x, y, string, length, colors[color]);
+}
+
+static void text_centered(rect_t r, const char* string, int color) {
+	int length = strlen(string);
+	text(r.left + (r.right - r.left - text_width(string, length)) / 2,
+		r.top + (r.bottom - r.top - text_height()) / 2,
+		string, length, color);
+}
+
+// centers the image in `box`, or draws a frame if it isn't decoded yet
+static void draw_image(rect_t box, const perse_image_t* image) {
+	if (!image || image->state != PERSE_IMAGE_READY) {
+		bevel(box, 0);
+		return;
+	}
+	
+	rect_t r = make_rect(box.left + (box.right - box.left - image->width) / 2,
+		box.top + (box.bottom - box.top - image->height) / 2,
+		image->width, image->height);
+	rect_t visible = intersect(intersect(r, box), clip);
+	if (empty(visible)) return;
+	
+	for (int y = visible.top; y < visible.bottom; y++) {
+		const unsigned char* src = image->pixels +
+			((size_t)(y - r.top) * image->width + visible.left - r.left) * 4;
+		blend_span((unsigned char*)(pixels + y * width + visible.left), src,
+			visible.right - visible.left);
+	}
+}
+
+static const perse_image_t* bitmap_prop(perse_widget_t* widg) {
+	perse_property_t* p = prop(PERSE_NAME_BITMAP, widg);
+	return p && p->type == PERSE_TYPE_IMAGE ? p->image : NULL;
+}
+
+static void draw_button(fb_widget_t* f) {
+	fill(f->rect, COLOR_FACE);
+	bevel(f->rect, !f->pressed);
+	text_centered(f->rect, string_prop(PERSE_NAME_TEXT, f->widget, ""), COLOR_TEXT);
+}
+
+// the image moves with the face of the button when it is pressed
+static void draw_image_button(fb_widget_t* f) {
+	fill(f->rect, COLOR_FACE);
+	bevel(f->rect, !f->pressed);
+	
+	int inset = PERSE_IMAGE_BUTTON_PADDING;
+	rect_t r = f->rect;
+	r.left += inset + f->pressed;
+	r.top += inset + f->pressed;
+	r.right -= inset - f->pressed;
+	r.bottom -= inset - f->pressed;
+	
+	draw_image(r, bitmap_prop(f->widget));
+}
+
+static void draw_label(fb_widget_t* f) {
+	const char* string = string_prop(PERSE_NAME_TEXT, f->widget, "");
+	int h = f->rect.bottom - f->rect.top;
+	
+	fill(f->rect, COLOR_FACE);
+	text(f->rect.left, f->rect.top + (h - text_height()) / 2, string, strlen(string), COLOR_TEXT);
+}
+
+static void draw_text_box(fb_widget_t* f) {
+	rect_t r = f->rect;
+	int w = r.right - r.left;
+	int top = r.top + (r.bottom - r.top - text_height()) / 2;
+	
+	fill(r, COLOR_FIELD);
+	bevel(r, 0);
+	
+	// the text doesn't go over the border
+	rect_t outer = clip;
+	clip = intersect(clip, make_rect(r.left + 2, r.top + 2, w - 4, r.bottom - r.top - 4));
+	
+	if (!f->length && focused != f) {
+		const char* hint = string_prop(PERSE_NAME_HINT, f->widget, "");
+		text(r.left + 4, top, hint, strlen(hint), COLOR_HINT);
+	} else {
+		// keep the caret in view, text boxes scroll horizontally
+		int caret = text_width(f->text, f->caret);
+		int shift = caret > w - 8 ? caret - (w - 8) : 0;
+		
+		text(r.left + 4 - shift, top, f->text, f->length, COLOR_TEXT);
+		
+		if (focused == f) {
+			fill(make_rect(r.left + 4 - shift + caret, top, 1, text_height()), COLOR_TEXT);
+		}
+	}
+	
+	clip = outer;
+}
+
+static int list_row() {
+	return text_height() + LIST_PADDING;
+}
+
+static void draw_list_box(fb_widget_t* f) {
+	rect_t r = f->rect;
+	
+	fill(r, COLOR_FIELD);
+	
+	int row = list_row();
+	int index = 0;
+	for (perse_widget_t* item = f->widget->child; item; item = item->next, index++) {
+		int y = r.top + 2 + (index - f->scroll) * row;
+		if (index < f->scroll) continue;
+		if (y > r.bottom) break;
+		
+		int color = COLOR_TEXT;
+		if (index == f->selected) {
+			fill(make_rect(r.left + 2, y, r.right - r.left - 4, row), COLOR_SELECTION);
+			color = COLOR_SELECTED_TEXT;
+		}
+		
+		const char* title = string_prop(PERSE_NAME_TITLE, item, "");
+		text(r.left + 4, y + LIST_PADDING / 2, title, strlen(title), color);
+	}
+	
+	bevel(r, 0);
+}
+
+// tabs are laid out from the left, each as wide as its text
+static int tab_width(perse_widget_t* panel) {
+	const char* title = string_prop(PERSE_NAME_TEXT, panel, "");
+	return text_width(title, strlen(title)) + 2 * TAB_PADDING;
+}
+
+static void draw_tab_group(fb_widget_t* f) {
+	rect_t r = f->rect;
+	
+	fill(r, COLOR_FACE);
+	bevel(make_rect(r.left, r.top + TAB_HEADER - 2, r.right - r.left,
+		r.bottom - r.top - TAB_HEADER + 2), 1);
+	
+	int selected = integer_prop(PERSE_NAME_SELECTED, f->widget);
+	
+	int left = r.left;
+	int index = 0;
+	for (perse_widget_t* panel = f->widget->child; panel; panel = panel->next, index++) {
+		int w = tab_width(panel);
+		int top = index == selected ? 0 : 2;
+		
+		fill(make_rect(left + 1, r.top + top + 1, w - 2, TAB_HEADER - top), COLOR_FACE);
+		bevel(make_rect(left, r.top + top, w, TAB_HEADER - top), 1);
+		
+		// the selected tab is open to its panel
+		if (index == selected) {
+			fill(make_rect(left + 1, r.top + TAB_HEADER - 2, w - 2, 2), COLOR_FACE);
+		}
+		
+		const char* title = string_prop(PERSE_NAME_TEXT, panel, "");
+		text(left + TAB_PADDING, r.top + top + (TAB_HEADER - top - text_height()) / 2,
+			title, strlen(title), COLOR_TEXT);
+		
+		left += w;
+	}
+}
+
+static void draw_status_bar(fb_widget_t* f) {
+	const char* string = string_prop(PERSE_NAME_TEXT, f->widget, "");
+	rect_t r = f->rect;
+	
+	fill(r, COLOR_FACE);
+	bevel(r, 0);
+	text(r.left + 4, r.top + (r.bottom - r.top - text_height()) / 2,
+		string, strlen(string), COLOR_TEXT);
+}
+
+static void draw_line(int x1, int y1, int x2, int y2, uint32_t pixel) {
+	int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+	int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+	int error = dx + dy;
+	
+	for (;;) {
+		if (x1 >= clip.left && x1 < clip.right && y1 >= clip.top && y1 < clip.bottom) {
+			pixels[y1 * width + x1] = pixel;
+		}
+		
+		if (x1 == x2 && y1 == y2) break;
+		
+		int e2 = 2 * error;
+		if (e2 >= dy) {
+			error += dy;
+			x1 += sx;
+		}
+		if (e2 <= dx) {
+			error += dx;
+			y1 += sy;
+		}
+	}
+}
+
+// replays the draw list, skipping whatever is outside of the clip
+static void draw_canvas(fb_widget_t* f) {
+	fill(f->rect, COLOR_FIELD);
+	
+	perse_property_t* p = prop(PERSE_NAME_DRAW, f->widget);
+	if (!p || p->type != PERSE_TYPE_DRAW_LIST) return;
+	
+	rect_t outer = clip;
+	for (int i = 0; i < p->draw_list->count; i++) {
+		const perse_draw_command_t* c = &p->draw_list->command[i];
+		
+		perse_draw_rect_t b = perse_DrawBounds(c);
+		rect_t r = make_rect(f->rect.left + c->x, f->rect.top + c->y, c->w, c->h);
+		if (empty(intersect(make_rect(f->rect.left + b.x, f->rect.top + b.y, b.w, b.h), outer))) {
+			continue;
+		}
+		
+		uint32_t pixel = rgba(c->color >> 16, (c->color >> 8) & 255, c->color & 255);
+		
+		switch (c->type) {
+			case PERSE_DRAW_LINE:
+				draw_line(r.left, r.top, r.right, r.bottom, pixel);
+				break;
+			case PERSE_DRAW_RECT:
+				fill_pixel(make_rect(r.left, r.top, c->w, 1), pixel);
+				fill_pixel(make_rect(r.left, r.bottom - 1, c->w, 1), pixel);
+				fill_pixel(make_rect(r.left, r.top, 1, c->h), pixel);
+				fill_pixel(make_rect(r.right - 1, r.top, 1, c->h), pixel);
+				break;
+			case PERSE_DRAW_FILL:
+				fill_pixel(r, pixel);
+				break;
+			case PERSE_DRAW_TEXT:
+				clip = intersect(outer, r);
+				text_pixel(r.left, r.top, c->text, strlen(c->text), pixel);
+				clip = outer;
+				break;
+			case PERSE_DRAW_IMAGE:
+				draw_image(r, c->image);
+				break;
+		}
+	}
+}
+
+static void draw(fb_widget_t* f) {
+	switch (f->widget->type) {
+		case PERSE_WIDGET_TEXT_BUTTON: draw_button(f); break;
+		case PERSE_WIDGET_IMAGE_BUTTON: draw_image_button(f); break;
+		case PERSE_WIDGET_IMAGE:
+			fill(f->rect, COLOR_FACE);
+			draw_image(f->rect, bitmap_prop(f->widget));
+			break;
+		case PERSE_WIDGET_LABEL: draw_label(f); break;
+		case PERSE_WIDGET_TEXT_BOX: draw_text_box(f); break;
+		case PERSE_WIDGET_LIST_BOX: draw_list_box(f); break;
+		case PERSE_WIDGET_TAB_GROUP: draw_tab_group(f); break;
+		case PERSE_WIDGET_STATUS_BAR: draw_status_bar(f); break;
+		case PERSE_WIDGET_CANVAS: draw_canvas(f); break;
+		case PERSE_WIDGET_ITEM: break;
+		default: fill(f->rect, COLOR_FACE); break;
+	}
+}
+
+// draws whatever of a widget and its children is in `area`, back to front.
+// children don't go outside of their parents
+static void paint(perse_widget_t* widget, rect_t area) {
+	fb_widget_t* f = data(widget);
+	
+	if (f && widget->type != PERSE_WIDGET_ITEM) {
+		if (f->hidden) return;
+		
+		area = intersect(area, f->rect);
+		if (empty(area)) return;
+		
+		clip = area;
+		draw(f);
+	}
+	
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		paint(c, area);
+	}
+}
+
+// the path comes from outside, so it is never used as a format string
+static void output_path(char* path, size_t size, const char* output) {
+	size_t length = 0;
+	for (const char* c = output; *c && length + 1 < size; c++) {
+		if (c[0] == '%' && c[1] == 'i') {
+			length += snprintf(path + length, size - length, "%i", frame);
+			if (length >= size) length = size - 1;
+			c++;
+		} else {
+			path[length++] = *c;
+		}
+	}
+	path[length] = '\0';
+}
+
+static void write_output() {
+	const char* output = getenv("PERSE_FRAMEBUFFER_OUTPUT");
+	if (!output || !*output) return;
+	
+	char path[4096];
+	output_path(path, sizeof(path), output);
+	
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		log(PERSE_LOG_ERROR, "FRAMEBUFFER:: can't write %s\n", path);
+		return;
+	}
+	
+	fprintf(file, "P7\nWIDTH %i\nHEIGHT %i\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+		width, height);
+	fwrite(pixels, 4, (size_t)width * height, file);
+	fclose(file);
+}
+
+// repaints everything that got damaged since the last frame
+static void repaint() {
+	painted_count = damage_count;
+	memcpy(painted, damage, sizeof(rect_t) * damage_count);
+	
+	if (!damage_count) return;
+	damage_count = 0;
+	
+	for (int i = 0; i < painted_count; i++) {
+		// whatever no widget covers is the background
+		clip = painted[i];
+		fill(painted[i], COLOR_FACE);
+		
+		if (main_window_widg) paint(main_window_widg, painted[i]);
+	}
+	
+	write_output();
+	frame++;
+}
+
+/*
+	EVENTS
+*/
+
+static void resize_framebuffer(int w, int h) {
+	if (w < 0) w = 0;
+	if (h < 0) h = 0;
+	if (w == width && h == height) return;
+	
+	uint32_t* old = pixels;
+	int old_width = width;
+	int old_height = height;
+	
+	pixels = calloc((size_t)(w ? w : 1) * (h ? h : 1), sizeof(uint32_t));
+	width = w;
+	height = h;
+	
+	// what was there stays, only the new part needs painting
+	for (int y = 0; y < h && y < old_height; y++) {
+		copy_span(pixels + y * w, old + y * old_width, w < old_width ? w : old_width);
+	}
+	free(old);
+	
+	add_damage(make_rect(old_width, 0, w, h));
+	add_damage(make_rect(0, old_height, w, h));
+}
+
+static void notify_resize(int w, int h) {
+	perse_widget_t* widget = main_window_widg;
+	if (!widget) return;
+	
+	resize_framebuffer(w, h);
+	
+	if (widget->current_size.w == w && widget->current_size.h == h) return;
+	
+	widget->constraint_size.min.w = w;
+	widget->constraint_size.max.w = w;
+	
+	widget->constraint_size.min.h = h;
+	widget->constraint_size.max.h = h;
+	
+	widget->current_size.w = w;
+	widget->current_size.h = h;
+	widget->actual_size.w = w;
+	widget->actual_size.h = h;
+	
+	data(widget)->rect = screen();
+	
+	perse_property_t* p = prop(PERSE_NAME_ON_RESIZE, widget);
+	if (!p) {
+		log(PERSE_LOG_ERROR, "FRAMEBUFFER:: main window has no ON_RESIZE\n");
+	} else if (p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "FRAMEBUFFER:: main window ON_RESIZE wrong type\n");
+	} else {
+		p->callback(widget, NULL);
+	}
+}
+
+static char inside(rect_t r, int x, int y) {
+	return x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+}
+
+// finds the frontmost widget at a point, same as painting finds it
+static perse_widget_t* hit(perse_widget_t* widget, int x, int y) {
+	fb_widget_t* f = data(widget);
+	
+	if (f && widget->type != PERSE_WIDGET_ITEM) {
+		if (f->hidden || !inside(f->rect, x, y)) return NULL;
+	}
+	
+	perse_widget_t* found = f && widget->type != PERSE_WIDGET_ITEM ? widget : NULL;
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		perse_widget_t* child = hit(c, x, y);
+		if (child) found = child;
+	}
+	
+	return found;
+}
+
+static void focus(fb_widget_t* f) {
+	if (focused == f) return;
+	
+	damage_widget(focused);
+	focused = f;
+	damage_widget(focused);
+}
+
+static void text_changed(fb_widget_t* f) {
+	damage_widget(f);
+	
+	perse_property_t* text = perse_CreatePropertyString(f->text);
+	call(PERSE_NAME_ON_CHANGE, f->widget, text);
+	perse_DestroyProperty(text);
+}
+
+static void set_text(fb_widget_t* f, const char* string) {
+	int length = strlen(string);
+	
+	if (length + 1 > f->capacity) {
+		f->capacity = length + 32;
+		f->text = realloc(f->text, f->capacity);
+	}
+	
+	memcpy(f->text, string, length + 1);
+	f->length = length;
+	if (f->caret > length) f->caret = length;
+}
+
+static void insert_text(fb_widget_t* f, const char* string, int length) {
+	if (f->length + length + 1 > f->capacity) {
+		f->capacity = (f->length + length + 1) * 2;
+		f->text = realloc(f->text, f->capacity);
+	}
+	
+	memmove(f->text + f->caret + length, f->text + f->caret, f->length - f->caret + 1);
+	memcpy(f->text + f->caret, string, length);
+	f->length += length;
+	f->caret += length;
+}
+
+// number of bytes of the character before or after the caret
+static int character_before(fb_widget_t* f) {
+	int i = f->caret;
+	while (i > 0 && ((unsigned char)f->text[--i] & 0xC0) == 0x80);
+	return f->caret - i;
+}
+
+static int character_after(fb_widget_t* f) {
+	int i = f->caret;
+	if (i < f->length) i++;
+	while (i < f->length && ((unsigned char)f->text[i] & 0xC0) == 0x80) i++;
+	return i - f->caret;
+}
+
+static void text_box_key(fb_widget_t* f, int key) {
+	char read_only = boolean_prop(PERSE_NAME_READ_ONLY, f->widget);
+	
+	switch (key) {
+		case PERSE_FRAMEBUFFER_KEY_ENTER:
+		case '\n':
+			call(PERSE_NAME_ON_SUBMIT, f->widget, NULL);
+			return;
+		case PERSE_FRAMEBUFFER_KEY_LEFT:
+			f->caret -= character_before(f);
+			damage_widget(f);
+			return;
+		case PERSE_FRAMEBUFFER_KEY_RIGHT:
+			f->caret += character_after(f);
+			damage_widget(f);
+			return;
+		case PERSE_FRAMEBUFFER_KEY_HOME:
+			f->caret = 0;
+			damage_widget(f);
+			return;
+		case PERSE_FRAMEBUFFER_KEY_END:
+			f->caret = f->length;
+			damage_widget(f);
+			return;
+		case PERSE_FRAMEBUFFER_KEY_BACKSPACE: {
+			int size = character_before(f);
+			if (read_only || !size) return;
+			memmove(f->text + f->caret - size, f->text + f->caret, f->length - f->caret + 1);
+			f->caret -= size;
+			f->length -= size;
+			text_changed(f);
+		} return;
+		case PERSE_FRAMEBUFFER_KEY_DELETE: {
+			int size = character_after(f);
+			if (read_only || !size) return;
+			memmove(f->text + f->caret, f->text + f->caret + size, f->length - f->caret - size + 1);
+			f->length -= size;
+			text_changed(f);
+		} return;
+	}
+	
+	if (read_only || key < ' ' || key > 0x10FFFF) return;
+	
+	// keys are code points, the text is UTF-8
+	char bytes[4];
+	int length;
+	if (key < 0x80) {
+		bytes[0] = key;
+		length = 1;
+	} else if (key < 0x800) {
+		bytes[0] = 0xC0 | key >> 6;
+		bytes[1] = 0x80 | (key & 63);
+		length = 2;
+	} else if (key < 0x10000) {
+		bytes[0] = 0xE0 | key >> 12;
+		bytes[1] = 0x80 | (key >> 6 & 63);
+		bytes[2] = 0x80 | (key & 63);
+		length = 3;
+	} else {
+		bytes[0] = 0xF0 | key >> 18;
+		bytes[1] = 0x80 | (key >> 12 & 63);
+		bytes[2] = 0x80 | (key >> 6 & 63);
+		bytes[3] = 0x80 | (key & 63);
+		length = 4;
+	}
+	
+	insert_text(f, bytes, length);
+	text_changed(f);
+}
+
+static void list_box_click(fb_widget_t* f, int y) {
+	int index = f->scroll + (y - f->rect.top - 2) / list_row();
+	
+	perse_widget_t* item = child_from_index(f->widget, index);
+	if (!item) return;
+	
+	perse_widget_t* widget = f->widget;
+	
+	f->selected = index;
+	damage_widget(f);
+	
+	call_integer(PERSE_NAME_ON_SELECT, widget, PERSE_NAME_SELECTED, index);
+	call(PERSE_NAME_ON_CLICK, item, NULL);
+}
+
+static void list_box_scroll(fb_widget_t* f, int rows) {
+	int count = 0;
+	for (perse_widget_t* item = f->widget->child; item; item = item->next) count++;
+	
+	int visible = (f->rect.bottom - f->rect.top - 4) / list_row();
+	int last = count - visible;
+	
+	f->scroll += rows;
+	if (f->scroll > last) f->scroll = last;
+	if (f->scroll < 0) f->scroll = 0;
+	
+	damage_widget(f);
+}
+
+static void tab_group_click(fb_widget_t* f, int click_x, int click_y) {
+	if (click_y - f->rect.top >= TAB_HEADER) return;
+	
+	int left = f->rect.left;
+	int index = 0;
+	for (perse_widget_t* panel = f->widget->child; panel; panel = panel->next, index++) {
+		left += tab_width(panel);
+		if (click_x >= left) continue;
+		
+		// the library lays out and creates the panel and then sets SELECTED,
+		// which is where the panels get switched
+		call_integer(PERSE_NAME_ON_SELECT, f->widget, PERSE_NAME_SELECTED, index);
+		return;
+	}
+}
+
+static void pointer(int x, int y, int pressed) {
+	if (!main_window_widg) return;
+	
+	if (!pressed) {
+		fb_widget_t* f = pointer_target;
+		pointer_target = NULL;
+		
+		if (!f || !f->pressed) return;
+		
+		f->pressed = 0;
+		damage_widget(f);
+		
+		// only counts as a click if it was let go over the button
+		if (inside(f->rect, x, y)) call(PERSE_NAME_ON_CLICK, f->widget, NULL);
+		return;
+	}
+	
+	perse_widget_t* widget = hit(main_window_widg, x, y);
+	fb_widget_t* f = data(widget);
+	if (!f) return;
+	
+	pointer_target = f;
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_TEXT_BUTTON:
+		case PERSE_WIDGET_IMAGE_BUTTON:
+			f->pressed = 1;
+			damage_widget(f);
+			break;
+		case PERSE_WIDGET_TEXT_BOX:
+			focus(f);
+			break;
+		case PERSE_WIDGET_LIST_BOX:
+			list_box_click(f, y);
+			break;
+		case PERSE_WIDGET_TAB_GROUP:
+			tab_group_click(f, x, y);
+			break;
+		default:
+			break;
+	}
+}
+
+static void wheel(int x, int y, int lines) {
+	if (!main_window_widg) return;
+	
+	perse_widget_t* widget = hit(main_window_widg, x, y);
+	if (!widget) return;
+	
+	if (widget->type == PERSE_WIDGET_LIST_BOX) {
+		list_box_scroll(data(widget), lines);
+		return;
+	}
+	
+	// the wheel scrolls the closest scroll panel
+	perse_widget_t* panel = widget;
+	while (panel && panel->type != PERSE_WIDGET_SCROLL_PANEL) {
+		panel = panel->parent;
+	}
+	if (!panel) return;
+	
+	int pos = integer_prop(PERSE_NAME_SCROLL_Y, panel);
+	call_integer(PERSE_NAME_ON_SCROLL, panel, PERSE_NAME_SCROLL_Y, pos + lines * WHEEL_LINE);
+}
+
+static void queue_input(int type, int x, int y, int value) {
+	lock_input();
+	
+	if (input_count == MAX_INPUT) {
+		unlock_input();
+		log(PERSE_LOG_WARNING, "FRAMEBUFFER:: input queue full\n");
+		return;
+	}
+	
+	input_t* i = &input[input_count++];
+	i->type = type;
+	i->x = x;
+	i->y = y;
+	i->value = value;
+	
+	signal_input();
+	unlock_input();
+}
+
+// waits until there is input, or until perse_impl_BackendWake(), unless
+// there is something to repaint already
+static void wait_for_input() {
+	lock_input();
+	
+#ifdef _WIN32
+	DWORD start = GetTickCount();
+	DWORD waited = 0;
+	while (!input_count && !woken && !damage_count && waited < INPUT_WAIT) {
+		SleepConditionVariableSRW(&arrived, &lock, INPUT_WAIT - waited, 0);
+		waited = GetTickCount() - start;
+	}
+#else
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += INPUT_WAIT * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	
+	while (!input_count && !woken && !damage_count) {
+		if (pthread_cond_timedwait(&arrived, &lock, &deadline)) break;
+	}
+#endif
+
+	woken = 0;
+	unlock_input();
+}
+
+// the widgets can change while the input is being handled, so it gets
+// copied out of the queue first
+static void handle_input() {
+	input_t queued[MAX_INPUT];
+	
+	lock_input();
+	int count = input_count;
+	memcpy(queued, input, sizeof(input_t) * count);
+	input_count = 0;
+	unlock_input();
+	
+	// only the last resize matters
+	int resize = -1;
+	for (int i = 0; i < count; i++) {
+		if (queued[i].type == INPUT_RESIZE) resize = i;
+	}
+	
+	for (int i = 0; i < count; i++) {
+		input_t* e = &queued[i];
+		switch (e->type) {
+			case INPUT_POINTER:
+				pointer(e->x, e->y, e->value);
+				break;
+			case INPUT_WHEEL:
+				wheel(e->x, e->y, e->value);
+				break;
+			case INPUT_KEY:
+				if (focused) text_box_key(focused, e->value);
+				break;
+			case INPUT_RESIZE:
+				if (i == resize) notify_resize(e->x, e->y);
+				break;
+		}
+	}
+}
+
+// the size can be given from outside, for screens of a known size
+static void start() {
+	if (started) return;
+	started = 1;
+	
+	// same as the x11 backend
+	colors[COLOR_FACE] = rgba(0xd4, 0xd0, 0xc8);
+	colors[COLOR_LIGHT] = rgba(0xff, 0xff, 0xff);
+	colors[COLOR_SHADOW] = rgba(0x80, 0x80, 0x80);
+	colors[COLOR_TEXT] = rgba(0x00, 0x00, 0x00);
+	colors[COLOR_HINT] = rgba(0x80, 0x80, 0x80);
+	colors[COLOR_FIELD] = rgba(0xff, 0xff, 0xff);
+	colors[COLOR_SELECTION] = rgba(0x0a, 0x24, 0x6a);
+	colors[COLOR_SELECTED_TEXT] = rgba(0xff, 0xff, 0xff);
+	
+	const char* size = getenv("PERSE_FRAMEBUFFER_SIZE");
+	int w, h;
+	if (size && sscanf(size, "%ix%i", &w, &h) == 2) {
+		queue_input(INPUT_RESIZE, w, h, 0);
+	}
+}
+
+PERSE_API void perse_impl_BackendSetLogger(perse_log_t fn) {
+	logger = fn;
+}
+
+PERSE_API void perse_impl_BackendProcessEvents() {
+	start();
+	
+	wait_for_input();
+	
+	// what the input changes in the backend shows up right away, what the
+	// program changes because of it shows up in the next frame
+	handle_input();
+	
+	repaint();
+}
+
+PERSE_API int perse_impl_BackendShouldQuit() {
+	return should_quit;
+}
+
+// nothing gets allocated per widget, other than its data
+PERSE_API void perse_impl_BackendSetPoolLimit(int limit) {}
+PERSE_API void perse_impl_BackendTrimPool(int keep) {}
+
+// called from the image decoding thread
+PERSE_API void perse_impl_BackendWake() {
+	lock_input();
+	woken = 1;
+	signal_input();
+	unlock_input();
+}
+
+PERSE_API perse_size_t perse_impl_BackendMeasure(perse_widget_t* widget) {
+	perse_size_t size = {-1, -1};
+	
+	const char* string = string_prop(PERSE_NAME_TEXT, widget, "");
+	
+	int w = text_width(string, strlen(string));
+	int h = text_height();
+	
+	// same room for borders as in the win32 backend
+	switch (widget->type) {
+		case PERSE_WIDGET_LABEL:
+			size.w = w;
+			size.h = h;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BUTTON:
+			size.w = w + 16;
+			size.h = h + 10;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			size.h = h + 8;
+			break;
+		
+		default:
+			break;
+	}
+	
+	return size;
+}
+
+/// Gets the framebuffer.
+/// Returns the RGBA pixels, row after row, with no padding. The pointer
+/// changes when the framebuffer is resized.
+PERSE_API const unsigned char* perse_impl_FramebufferPixels(int* w, int* h) {
+	if (w) *w = width;
+	if (h) *h = height;
+	return (const unsigned char*)pixels;
+}
+
+/// Gets what was repainted.
+/// Copies up to `max` of the rectangles that the last frame repainted into
+/// `rects` and returns how many there were, so that only those have to be
+/// copied to the screen.
+PERSE_API int perse_impl_FramebufferDamage(perse_framebuffer_rect_t* rects, int max) {
+	for (int i = 0; i < painted_count && i < max; i++) rects[i] = painted[i];
+	return painted_count;
+}
+
+/// Resizes the framebuffer.
+/// The main window gets resized along with it.
+PERSE_API void perse_impl_FramebufferResize(int w, int h) {
+	queue_input(INPUT_RESIZE, w, h, 0);
+}
+
+/// Presses or releases the pointer at a point.
+PERSE_API void perse_impl_FramebufferPointer(int x, int y, int pressed) {
+	queue_input(INPUT_POINTER, x, y, pressed);
+}
+
+/// Turns the wheel at a point.
+/// Positive `lines` scroll down.
+PERSE_API void perse_impl_FramebufferWheel(int x, int y, int lines) {
+	queue_input(INPUT_WHEEL, x, y, lines);
+}
+
+/// Types a key into the focused text box.
+/// The key is a Unicode code point or one of the PERSE_FRAMEBUFFER_KEY_*.
+PERSE_API void perse_impl_FramebufferKey(int key) {
+	queue_input(INPUT_KEY, 0, 0, key);
+}
+
+/// Makes perse_BackendShouldQuit() return 1.
+PERSE_API void perse_impl_FramebufferQuit() {
+	should_quit = 1;
+	perse_impl_BackendWake();
+}
+
+/*
+	WIDGETS
+*/
+
+// finds where a widget is in the framebuffer, from where the library put it
+// in its container
+static rect_t widget_rect(perse_widget_t* widget) {
+	int x = widget->actual_pos.x;
+	int y = widget->actual_pos.y;
+	
+	perse_widget_t* parent = container(widget);
+	if (data(parent)) {
+		x += data(parent)->rect.left;
+		y += data(parent)->rect.top;
+	}
+	
+	return make_rect(x, y, widget->current_size.w, widget->current_size.h);
+}
+
+static char tab_shown(perse_widget_t* panel) {
+	return index_in_parent(panel) == integer_prop(PERSE_NAME_SELECTED, panel->parent);
+}
+
+static void show_selected_tab(perse_widget_t* group) {
+	for (perse_widget_t* c = group->child; c; c = c->next) {
+		if (data(c)) data(c)->hidden = !tab_shown(c);
+	}
+	
+	// the panels are inside of the group
+	damage_widget(data(group));
+}
+
+PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
+	switch (widget->type) {
+		case PERSE_WIDGET_INVALID:
+			log(PERSE_LOG_ERROR, "FRAMEBUFFER:: BackendCreateWidget passed in an INVALID\n");
+			return;
+		
+		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT:
+		case PERSE_WIDGET_VERTICAL_LAYOUT:
+		case PERSE_WIDGET_GRID_LAYOUT:
+		case PERSE_WIDGET_FLOW_LAYOUT:
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			// layouts don't draw anything
+			return;
+		
+		case PERSE_WIDGET_WINDOW:
+			// only the main window gets drawn
+			if (main_window_widg) {
+				log(PERSE_LOG_DEBUG, "FRAMEBUFFER:: only one window is shown\n");
+				return;
+			}
+			break;
+		
+		case PERSE_WIDGET_ITEM:
+			// items are drawn by their list box
+			if (!widget->parent || widget->parent->type != PERSE_WIDGET_LIST_BOX ||
+				!data(widget->parent)) {
+				log(PERSE_LOG_DEBUG, "FRAMEBUFFER:: items only go in list boxes\n");
+				return;
+			}
+			break;
+		
+		case PERSE_WIDGET_TAB_PANEL:
+			if (!widget->parent || widget->parent->type != PERSE_WIDGET_TAB_GROUP ||
+				!data(widget->parent)) {
+				log(PERSE_LOG_ERROR, "FRAMEBUFFER:: TAB_PANEL not in a TAB_GROUP\n");
+				return;
+			}
+			break;
+		
+		case PERSE_WIDGET_STATUS_BAR:
+		case PERSE_WIDGET_TAB_GROUP:
+		case PERSE_WIDGET_SCROLL_PANEL:
+		case PERSE_WIDGET_TEXT_BUTTON:
+		case PERSE_WIDGET_IMAGE_BUTTON:
+		case PERSE_WIDGET_LIST_BOX:
+		case PERSE_WIDGET_TEXT_BOX:
+		case PERSE_WIDGET_LABEL:
+		case PERSE_WIDGET_IMAGE:
+		case PERSE_WIDGET_CANVAS:
+			break;
+		
+		default:
+			log(PERSE_LOG_DEBUG, "FRAMEBUFFER:: widget type %i not supported\n", widget->type);
+			return;
+	}
+	
+	if (widget->type != PERSE_WIDGET_WINDOW && !data(container(widget))) {
+		log(PERSE_LOG_ERROR, "FRAMEBUFFER:: widget type %i has nothing to go in\n", widget->type);
+		return;
+	}
+	
+	fb_widget_t* f = calloc(1, sizeof(fb_widget_t));
+	f->widget = widget;
+	f->selected = -1;
+	
+	widget->data = f;
+	widget->system = (void*)(long long)1; // dummy value
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_WINDOW:
+			main_window_widg = widget;
+			resize_framebuffer(widget->current_size.w, widget->current_size.h);
+			f->rect = screen();
+			break;
+		
+		case PERSE_WIDGET_ITEM:
+			damage_widget(data(widget->parent));
+			return;
+		
+		case PERSE_WIDGET_TAB_PANEL:
+			f->hidden = !tab_shown(widget);
+			damage_widget(data(widget->parent));
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			set_text(f, string_prop(PERSE_NAME_TEXT, widget, ""));
+			break;
+		
+		default:
+			break;
+	}
+	
+	if (widget->type != PERSE_WIDGET_WINDOW) f->rect = widget_rect(widget);
+	
+	damage_widget(f);
+}
+
+PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
+	fb_widget_t* f = data(widget);
+	
+	if (!f) {
+		widget->system = NULL;
+		return;
+	}
+	
+	if (widget->type == PERSE_WIDGET_ITEM || widget->type == PERSE_WIDGET_TAB_PANEL) {
+		damage_widget(data(widget->parent));
+	}
+	
+	// whatever was behind it shows through
+	if (!f->hidden) damage_widget(f);
+	
+	if (focused == f) focused = NULL;
+	if (pointer_target == f) pointer_target = NULL;
+	if (main_window_widg == widget) main_window_widg = NULL;
+	
+	free(f->text);
+	free(f);
+	
+	widget->data = NULL;
+	widget->system = NULL;
+}
+
+PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_property_t* p) {
+	fb_widget_t* f = data(widget);
+	if (!f) return;
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_WINDOW:
+			// the window has no title bar to draw it in
+			break;
+		
+		case PERSE_WIDGET_ITEM:
+		case PERSE_WIDGET_TAB_PANEL:
+			damage_widget(data(widget->parent));
+			break;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			if (p->name == PERSE_NAME_SELECTED) show_selected_tab(widget);
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			// the text that the user typed comes back, which isn't a change
+			if (p->name == PERSE_NAME_TEXT && p->type == PERSE_TYPE_STRING &&
+				strcmp(f->text ? f->text : "", p->string) != 0) {
+				set_text(f, p->string);
+				damage_widget(f);
+			}
+			if (p->name == PERSE_NAME_HINT) damage_widget(f);
+			break;
+		
+		case PERSE_WIDGET_CANVAS:
+			if (p->name == PERSE_NAME_DRAW && p->type == PERSE_TYPE_DRAW_LIST &&
+				p->draw_list->damage_count >= 0) {
+				perse_draw_list_t* list = p->draw_list;
+				for (int i = 0; i < list->damage_count; i++) {
+					perse_draw_rect_t d = list->damage[i];
+					add_damage(intersect(f->rect, make_rect(f->rect.left + d.x,
+						f->rect.top + d.y, d.w, d.h)));
+				}
+			} else {
+				damage_widget(f);
+			}
+			break;
+		
+		default:
+			damage_widget(f);
+			break;
+	}
+}
+
+PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
+	fb_widget_t* f = data(widget);
+	if (!f) return;
+	
+	switch (widget->type) {
+		// the framebuffer is the main window
+		case PERSE_WIDGET_WINDOW:
+			resize_framebuffer(widget->current_size.w, widget->current_size.h);
+			f->rect = screen();
+			return;
+		
+		case PERSE_WIDGET_ITEM:
+			return;
+		
+		default:
+			break;
+	}
+	
+	rect_t rect = widget_rect(widget);
+	
+	if (!memcmp(&rect, &f->rect, sizeof(rect_t))) return;
+	
+	if (!f->hidden) {
+		add_damage(f->rect);
+		add_damage(rect);
+	}
+	
+	f->rect = rect;
+}
+
+static const perse_backend_t backend = {
+	.version = PERSE_BACKEND_VERSION,
+	.size = sizeof(perse_backend_t),
+	
+	.create_widget = perse_impl_BackendCreateWidget,
+	.destroy_widget = perse_impl_BackendDestroyWidget,
+	.set_property = perse_impl_BackendSetProperty,
+	.set_size_pos = perse_impl_BackendSetSizePos,
+	
+	.process_events = perse_impl_BackendProcessEvents,
+	.should_quit = perse_impl_BackendShouldQuit,
+	
+	.set_logger = perse_impl_BackendSetLogger,
+	
+	.measure = perse_impl_BackendMeasure,
+	
+	.wake = perse_impl_BackendWake,
+};
+
+// the library checks the version, see backend.c
+PERSE_API const perse_backend_t* perse_impl_GetBackend(int version) {
+	return &backend;
+}
+
+// when linked statically, the library's property.c is already in the program
+#ifndef PERSE_STATIC_BACKEND
+#include "../../library/property.c"
+#endif
@@ -0,0 +1,31 @@
+#ifndef PERSE_FRAMEBUFFER_H
+#define PERSE_FRAMEBUFFER_H
+
+// extra entry points of the framebuffer backend, for programs that show the
+// framebuffer somewhere themselves, or feed it input, or test what it drew.
+// a program that loads the backend at runtime has to look these up by name
+
+// keys that aren't characters, for perse_impl_FramebufferKey()
+#define PERSE_FRAMEBUFFER_KEY_ENTER		'\r'
+#define PERSE_FRAMEBUFFER_KEY_BACKSPACE	'\b'
+#define PERSE_FRAMEBUFFER_KEY_DELETE	127
+#define PERSE_FRAMEBUFFER_KEY_LEFT		0x110000
+#define PERSE_FRAMEBUFFER_KEY_RIGHT		0x110001
+#define PERSE_FRAMEBUFFER_KEY_HOME		0x110002
+#define PERSE_FRAMEBUFFER_KEY_END		0x110003
+
+/// Region of the framebuffer, right and bottom edges not included.
+typedef struct {
+	int left, top, right, bottom;
+} perse_framebuffer_rect_t;
+
+const unsigned char* perse_impl_FramebufferPixels(int* width, int* height);
+int perse_impl_FramebufferDamage(perse_framebuffer_rect_t* rects, int max);
+
+void perse_impl_FramebufferResize(int width, int height);
+void perse_impl_FramebufferPointer(int x, int y, int pressed);
+void perse_impl_FramebufferWheel(int x, int y, int lines);
+void perse_impl_FramebufferKey(int key);
+void perse_impl_FramebufferQuit();
+
+#endif // PERSE_FRAMEBUFFER_H
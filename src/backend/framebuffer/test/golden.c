@@ -0,0 +1,239 @@
+#include "../../../library/layout.h"
+#include "../../../library/image.h"
+#include "../../../library/backend.h"
+
+#include "../framebuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	Draws a small window with the framebuffer backend and compares it with
+	the images in the golden directory, pixel for pixel. The window has text,
+	which goes through the glyph loop, bevels and fields, which go through
+	the fill loop, and an image with an alpha ramp, which goes through the
+	blend loop.
+	
+	Then the text of the label changes. Only the label should be repainted,
+	and nothing outside of what was repainted should change.
+	
+	Run with the golden directory, and with --update after a change to the
+	drawing that is on purpose, to write the images again.
+*/
+
+#define WIDTH 120
+#define HEIGHT 90
+
+static const char* directory = ".";
+static int update = 0;
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+// blue to red left to right, transparent to opaque top to bottom
+static unsigned char* decode_ramp(const char* path, int* width, int* height) {
+	*width = 16;
+	*height = 16;
+	
+	unsigned char* pixels = malloc(16 * 16 * 4);
+	for (int y = 0; y < 16; y++) {
+		for (int x = 0; x < 16; x++) {
+			unsigned char* p = pixels + (y * 16 + x) * 4;
+			p[0] = x * 17;
+			p[1] = 0x40;
+			p[2] = 255 - x * 17;
+			p[3] = y * 17;
+		}
+	}
+	
+	return pixels;
+}
+
+static perse_widget_t* widget(perse_widget_type_t type, perse_widget_t* parent) {
+	perse_widget_t* widget = perse_AllocateWidget();
+	widget->type = type;
+	if (parent) perse_AddChild(parent, widget);
+	return widget;
+}
+
+static void string(perse_widget_t* widget, perse_name_t name, const char* value) {
+	perse_property_t* p = perse_CreatePropertyString(value);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static perse_widget_t* build(const char* label) {
+	perse_widget_t* window = widget(PERSE_WIDGET_WINDOW, NULL);
+	window->constraint_size.min.w = window->constraint_size.max.w = WIDTH;
+	window->constraint_size.min.h = window->constraint_size.max.h = HEIGHT;
+	
+	perse_widget_t* column = widget(PERSE_WIDGET_VERTICAL_LAYOUT, window);
+	
+	string(widget(PERSE_WIDGET_LABEL, column), PERSE_NAME_TEXT, label);
+	string(widget(PERSE_WIDGET_TEXT_BUTTON, column), PERSE_NAME_TEXT, "Press");
+	perse_widget_t* box = widget(PERSE_WIDGET_TEXT_BOX, column);
+	box->constraint_size.min.w = 80;
+	string(box, PERSE_NAME_TEXT, "typed {~}");
+	
+	perse_widget_t* image = widget(PERSE_WIDGET_IMAGE, column);
+	image->constraint_size.min.w = image->constraint_size.max.w = 16;
+	image->constraint_size.min.h = image->constraint_size.max.h = 16;
+	string(image, PERSE_NAME_IMAGE, "ramp");
+	
+	return window;
+}
+
+static void frame(perse_widget_t* root) {
+	perse_CalculateLayout(root);
+	perse_ApplyChanges(root);
+	perse_BackendProcessEvents();
+}
+
+static unsigned char* copy_pixels() {
+	const unsigned char* pixels = perse_impl_FramebufferPixels(NULL, NULL);
+	unsigned char* copy = malloc(WIDTH * HEIGHT * 4);
+	memcpy(copy, pixels, WIDTH * HEIGHT * 4);
+	return copy;
+}
+
+static unsigned char* read_pam(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return NULL;
+	
+	int w = 0, h = 0;
+	char header[256];
+	while (fgets(header, sizeof(header), file) && strcmp(header, "ENDHDR\n") != 0) {
+		sscanf(header, "WIDTH %i", &w);
+		sscanf(header, "HEIGHT %i", &h);
+	}
+	
+	unsigned char* pixels = malloc(WIDTH * HEIGHT * 4);
+	if (w != WIDTH || h != HEIGHT ||
+		fread(pixels, 4, WIDTH * HEIGHT, file) != WIDTH * HEIGHT) {
+		free(pixels);
+		pixels = NULL;
+	}
+	
+	fclose(file);
+	return pixels;
+}
+
+static void write_pam(const char* path, const unsigned char* pixels) {
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		printf("can't write %s\n", path);
+		failures++;
+		return;
+	}
+	
+	fprintf(file, "P7\nWIDTH %i\nHEIGHT %i\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+		WIDTH, HEIGHT);
+	fwrite(pixels, 4, WIDTH * HEIGHT, file);
+	fclose(file);
+}
+
+static void compare(const char* name) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s.pam", directory, name);
+	
+	const unsigned char* pixels = perse_impl_FramebufferPixels(NULL, NULL);
+	
+	if (update) {
+		write_pam(path, pixels);
+		return;
+	}
+	
+	unsigned char* golden = read_pam(path);
+	if (!golden) {
+		printf("can't read %s\n", path);
+		failures++;
+		return;
+	}
+	
+	for (int i = 0; i < WIDTH * HEIGHT; i++) {
+		if (memcmp(pixels + i * 4, golden + i * 4, 4) == 0) continue;
+		printf("%s differs first at %i, %i\n", name, i % WIDTH, i / WIDTH);
+		failures++;
+		break;
+	}
+	
+	free(golden);
+}
+
+static int inside(perse_framebuffer_rect_t* rects, int count, int x, int y) {
+	for (int i = 0; i < count; i++) {
+		if (x >= rects[i].left && x < rects[i].right &&
+			y >= rects[i].top && y < rects[i].bottom) return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--update") == 0) {
+			update = 1;
+		} else {
+			directory = argv[i];
+		}
+	}
+	
+	perse_SetImageDecoder(decode_ramp);
+	
+	perse_widget_t* root = build("Golden 0");
+	frame(root);
+	
+	// the image gets decoded on another thread, which wakes up the backend
+	for (int i = 0; i < 20 && root->child->child->next->next->next->loading; i++) {
+		perse_BackendProcessEvents();
+		if (perse_UpdateImages()) perse_ApplyChanges(root);
+	}
+	perse_BackendProcessEvents();
+	
+	CHECK(!root->child->child->next->next->next->loading);
+	
+	compare("window");
+	
+	unsigned char* before = copy_pixels();
+	
+	perse_MergeTree(root, build("Golden 1"));
+	frame(root);
+	
+	perse_widget_t* label = root->child->child;
+	perse_framebuffer_rect_t rects[16];
+	int count = perse_impl_FramebufferDamage(rects, 16);
+	
+	CHECK(count == 1);
+	for (int i = 0; i < count && i < 16; i++) {
+		CHECK(rects[i].left >= label->actual_pos.x);
+		CHECK(rects[i].top >= label->actual_pos.y);
+		CHECK(rects[i].right <= label->actual_pos.x + label->current_size.w);
+		CHECK(rects[i].bottom <= label->actual_pos.y + label->current_size.h);
+	}
+	
+	// the repaint is clipped to the damage
+	const unsigned char* after = perse_impl_FramebufferPixels(NULL, NULL);
+	int outside = 0;
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = 0; x < WIDTH; x++) {
+			if (inside(rects, count, x, y)) continue;
+			if (memcmp(after + (y * WIDTH + x) * 4, before + (y * WIDTH + x) * 4, 4)) outside++;
+		}
+	}
+	CHECK(outside == 0);
+	CHECK(memcmp(after, before, WIDTH * HEIGHT * 4) != 0);
+	
+	compare("label");
+	
+	free(before);
+	perse_DestroyWidget(root);
+	
+	if (failures) printf("%i failures\n", failures);
+	return failures != 0;
+}
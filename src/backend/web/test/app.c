@@ -0,0 +1,119 @@
+#include "../../../library/layout.h"
+#include "../../../library/backend.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+	The program that test/client.mjs talks to. It shows a label with the
+	number of clicks, a button that counts them, a text box, a list box and
+	a button that floods the clients with rows of text that are different
+	every time, which is more than the string table and a stalled client's
+	backlog can hold. The quit button ends it.
+*/
+
+static const int rows = 2000;
+
+static int clicks = 0;
+static int floods = 0;
+static char text[256] = "hello";
+static int quit = 0;
+
+static void count(perse_widget_t* widget, perse_property_t* value) { clicks++; }
+static void flood(perse_widget_t* widget, perse_property_t* value) { floods++; }
+static void stop(perse_widget_t* widget, perse_property_t* value) { quit = 1; }
+
+static void change(perse_widget_t* widget, perse_property_t* value) {
+	snprintf(text, sizeof(text), "%s", value->string);
+}
+
+static void resize(perse_widget_t* widget, perse_property_t* value) {
+	perse_ResizeLayout(widget);
+}
+
+static perse_widget_t* widget(perse_widget_type_t type, perse_widget_t* parent) {
+	perse_widget_t* widget = perse_AllocateWidget();
+	widget->type = type;
+	if (parent) perse_AddChild(parent, widget);
+	return widget;
+}
+
+static void string(perse_widget_t* widget, perse_name_t name, const char* value) {
+	perse_property_t* p = perse_CreatePropertyString(value);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static void callback(perse_widget_t* widget, perse_name_t name,
+	void (*fn)(perse_widget_t*, perse_property_t*)) {
+	perse_property_t* p = perse_CreatePropertyCallback(fn);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static perse_widget_t* build() {
+	char line[160];
+	
+	perse_widget_t* window = widget(PERSE_WIDGET_WINDOW, NULL);
+	window->constraint_size.min.w = window->constraint_size.max.w = 640;
+	window->constraint_size.min.h = window->constraint_size.max.h = 480;
+	string(window, PERSE_NAME_TITLE, "web test");
+	callback(window, PERSE_NAME_ON_RESIZE, resize);
+	
+	perse_widget_t* column = widget(PERSE_WIDGET_VERTICAL_LAYOUT, window);
+	
+	snprintf(line, sizeof(line), "clicks %i", clicks);
+	string(widget(PERSE_WIDGET_LABEL, column), PERSE_NAME_TEXT, line);
+	
+	perse_widget_t* press = widget(PERSE_WIDGET_TEXT_BUTTON, column);
+	string(press, PERSE_NAME_TEXT, "press");
+	callback(press, PERSE_NAME_ON_CLICK, count);
+	
+	perse_widget_t* box = widget(PERSE_WIDGET_TEXT_BOX, column);
+	string(box, PERSE_NAME_TEXT, text);
+	callback(box, PERSE_NAME_ON_CHANGE, change);
+	
+	perse_widget_t* list = widget(PERSE_WIDGET_LIST_BOX, column);
+	for (int i = 0; i < 3; i++) {
+		snprintf(line, sizeof(line), "item %i", i);
+		string(widget(PERSE_WIDGET_ITEM, list), PERSE_NAME_TITLE, line);
+	}
+	
+	perse_widget_t* more = widget(PERSE_WIDGET_TEXT_BUTTON, column);
+	string(more, PERSE_NAME_TEXT, "flood");
+	callback(more, PERSE_NAME_ON_CLICK, flood);
+	
+	perse_widget_t* end = widget(PERSE_WIDGET_TEXT_BUTTON, column);
+	string(end, PERSE_NAME_TEXT, "quit");
+	callback(end, PERSE_NAME_ON_CLICK, stop);
+	
+	// not in a scroll panel, which would only create what is scrolled to
+	for (int i = 0; floods && i < rows; i++) {
+		snprintf(line, sizeof(line), "flood %i row %i "
+			"................................................................................",
+			floods, i);
+		string(widget(PERSE_WIDGET_LABEL, column), PERSE_NAME_TEXT, line);
+	}
+	
+	return window;
+}
+
+int main() {
+	perse_LoadBackend();
+	
+	perse_widget_t* root = build();
+	perse_CalculateLayout(root);
+	perse_ApplyChanges(root);
+	
+	while (!quit && !perse_BackendShouldQuit()) {
+		perse_BackendProcessEvents();
+		
+		perse_MergeTree(root, build());
+		perse_CalculateLayout(root);
+		perse_ApplyChanges(root);
+	}
+	
+	perse_DestroyWidget(root);
+	
+	return 0;
+}
@@ -0,0 +1,260 @@
+// Starts test/app.c and talks to it the way a browser would: it fetches the
+// page and runs the client script from it against a minimal DOM, over a
+// WebSocket made from a plain socket. Exits with 1 if anything is off.
+//
+//     node client.mjs path/to/app
+
+import {spawn} from "child_process";
+import crypto from "crypto";
+import net from "net";
+import vm from "vm";
+
+const port = 20000 + process.pid % 20000;
+const failures = [];
+
+function check(condition, what) {
+	if (!condition) failures.push(what);
+	console.log((condition ? "ok   " : "FAIL ") + what);
+}
+
+const sleep = ms => new Promise(resolve => setTimeout(resolve, ms));
+
+async function until(condition, ms = 5000) {
+	for (let waited = 0; !condition() && waited < ms; waited += 10) await sleep(10);
+	return condition();
+}
+
+// a raw request, so that Host and Origin can be anything. an upgraded
+// connection doesn't get closed, so that is only read up to the headers
+function request(head) {
+	return new Promise(resolve => {
+		const socket = net.connect(port, "127.0.0.1", () => socket.write(head + "\r\n"));
+		let response = "";
+		socket.on("data", data => {
+			response += data.toString("latin1");
+			if (response.startsWith("HTTP/1.1 101") && response.includes("\r\n\r\n")) socket.destroy();
+		});
+		socket.on("close", () => resolve(response));
+		socket.on("error", () => resolve(response));
+	});
+}
+
+const status = response => +response.split(" ")[1];
+
+function upgrade(key, origin, host = `127.0.0.1:${port}`) {
+	return `GET / HTTP/1.1\r\nHost: ${host}\r\n` + (origin ? `Origin: ${origin}\r\n` : "") +
+		`Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: ${key}\r\n` +
+		"Sec-WebSocket-Version: 13\r\n";
+}
+
+class Element {
+	constructor(tag) {
+		this.tagName = tag;
+		this.children = [];
+		this.style = {};
+		this.className = "";
+		this.value = "";
+		this.text = "";
+		this.parent = null;
+	}
+	
+	appendChild(child) {
+		return this.insertBefore(child, null);
+	}
+	
+	insertBefore(child, before) {
+		child.remove();
+		child.parent = this;
+		const index = before ? this.children.indexOf(before) : -1;
+		if (index < 0) this.children.push(child); else this.children.splice(index, 0, child);
+		return child;
+	}
+	
+	remove() {
+		if (!this.parent) return;
+		this.parent.children.splice(this.parent.children.indexOf(this), 1);
+		this.parent = null;
+	}
+	
+	get textContent() {
+		return this.text + this.children.map(c => c.textContent).join("");
+	}
+	
+	set textContent(value) {
+		this.text = value;
+		for (const c of [...this.children]) c.remove();
+	}
+	
+	getElementsByTagName() {
+		const all = [];
+		const walk = e => e.children.forEach(c => { all.push(c); walk(c); });
+		walk(this);
+		return all;
+	}
+}
+
+// runs the client script, with a WebSocket that the test can see the
+// messages of
+function browser(script) {
+	const messages = [];
+	
+	class WebSocket {
+		constructor() {
+			const key = crypto.randomBytes(16).toString("base64");
+			const accept = crypto.createHash("sha1")
+				.update(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11").digest("base64");
+			
+			this.readyState = 0;
+			this.socket = net.connect(port, "127.0.0.1",
+				() => this.socket.write(upgrade(key, `http://127.0.0.1:${port}`) + "\r\n"));
+			
+			let buffer = Buffer.alloc(0);
+			this.socket.on("data", data => {
+				buffer = Buffer.concat([buffer, data]);
+				
+				if (this.readyState == 0) {
+					const end = buffer.indexOf("\r\n\r\n");
+					if (end < 0) return;
+					check(buffer.subarray(0, end).toString().includes(accept), "upgrade accepted");
+					buffer = buffer.subarray(end + 4);
+					this.readyState = 1;
+				}
+				
+				for (;;) {
+					let size = buffer[1] & 127, header = 2;
+					if (buffer.length < 2) return;
+					if (size == 126) {
+						if (buffer.length < 4) return;
+						size = buffer.readUInt16BE(2);
+						header = 4;
+					} else if (size == 127) {
+						if (buffer.length < 10) return;
+						size = Number(buffer.readBigUInt64BE(2));
+						header = 10;
+					}
+					if (buffer.length < header + size) return;
+					
+					const payload = buffer.subarray(header, header + size);
+					buffer = buffer.subarray(header + size);
+					
+					if ((buffer[0] & 15) == 8) continue;
+					messages.push(size);
+					this.onmessage({data: new Uint8Array(payload).buffer});
+				}
+			});
+			this.socket.on("close", () => this.readyState = 3);
+		}
+		
+		send(bytes) {
+			const payload = Buffer.from(bytes);
+			const mask = crypto.randomBytes(4);
+			const header = payload.length < 126 ?
+				Buffer.from([0x82, 0x80 | payload.length]) :
+				Buffer.from([0x82, 0x80 | 126, payload.length >> 8, payload.length & 255]);
+			this.socket.write(Buffer.concat([header, mask, payload.map((b, i) => b ^ mask[i & 3])]));
+		}
+	}
+	
+	const body = new Element("body");
+	const document = {createElement: tag => new Element(tag), body, title: ""};
+	const context = {
+		document, WebSocket, TextEncoder, TextDecoder, setTimeout, console, Math,
+		location: {host: `127.0.0.1:${port}`}, innerWidth: 800, innerHeight: 600,
+		requestAnimationFrame: fn => setTimeout(fn, 0),
+	};
+	context.window = context;
+	
+	vm.createContext(context);
+	vm.runInContext(script, context);
+	
+	const find = test => body.getElementsByTagName().filter(test);
+	const button = text => find(e => e.tagName == "button" && e.textContent == text)[0];
+	const labels = () => find(e => e.className == "label").map(e => e.textContent);
+	
+	return {document, body, messages, find, button, labels};
+}
+
+function dump(body) {
+	return body.getElementsByTagName().map(e => e.tagName + "." + e.className + " " +
+		(e.children.length ? "" : e.textContent) + " " + JSON.stringify(e.style) + " " + e.value)
+		.join("\n");
+}
+
+const app = spawn(process.argv[2], [], {
+	env: {...process.env, PERSE_WEB_PORT: port, PERSE_WEB_ORIGIN: "http://ui.test, https://other.test"},
+	stdio: ["ignore", "inherit", "inherit"],
+});
+let exited = null;
+app.on("exit", code => exited = code);
+
+// waits for the server to listen
+let page = "";
+for (let i = 0; i < 100 && !page; i++) {
+	await sleep(50);
+	page = await request(`GET / HTTP/1.1\r\nHost: 127.0.0.1:${port}\r\n`);
+}
+
+check(status(page) == 200, "page served");
+check(status(await request(`GET /nothing HTTP/1.1\r\nHost: localhost:${port}\r\n`)) == 404,
+	"anything else is not found");
+check(status(await request(`GET / HTTP/1.1\r\nHost: rebound.test:${port}\r\n`)) == 403,
+	"other host refused");
+check(status(await request(`GET / HTTP/1.1\r\nHost: 127.0.0.1:${port + 1}\r\n`)) == 403,
+	"other port refused");
+check(status(await request(`GET / HTTP/1.1\r\n`)) == 403, "no host refused");
+check(status(await request(`GET / HTTP/1.1\r\nHost: ui.test\r\n`)) == 200,
+	"allowed host served");
+
+const key = crypto.randomBytes(16).toString("base64");
+check(status(await request(upgrade(key, "http://evil.test"))) == 403, "other origin refused");
+check(status(await request(upgrade(key, null))) == 403, "no origin refused");
+check(status(await request(upgrade(key, "https://other.test"))) == 101, "allowed origin upgraded");
+check(status(await request(upgrade(key, "http://ui.test", "ui.test"))) == 101,
+	"allowed host upgraded");
+
+const script = page.match(/<script>([\s\S]*)<\/script>/)[1];
+
+const a = browser(script);
+check(await until(() => a.document.title == "web test"), "tree received");
+check(a.labels()[0] == "clicks 0", "label shown");
+
+// the client sends its size first, which gets a patch of its own
+await sleep(200);
+a.messages.length = 0;
+a.button("press").onclick();
+check(await until(() => a.labels()[0] == "clicks 1"), "click applied");
+check(a.messages.length == 1 && a.messages[0] < 32, `click patch is small (${a.messages})`);
+
+// a client that stops reading, the rest shouldn't have to wait for it
+const stalled = net.connect(port, "127.0.0.1",
+	() => stalled.write(upgrade(key, `http://127.0.0.1:${port}`) + "\r\n"));
+let stalled_closed = false;
+stalled.once("data", () => stalled.pause());
+stalled.on("close", () => stalled_closed = true);
+stalled.on("error", () => stalled_closed = true);
+await sleep(200);
+
+// each flood is 2000 strings that weren't sent before, about 200 kB
+const floods = 40;
+let flooded = true;
+for (let i = 1; i <= floods && flooded; i++) {
+	a.button("flood").onclick();
+	flooded = await until(() => a.labels().some(text => text.startsWith(`flood ${i} row 1999 `)));
+}
+check(flooded, "floods arrived while a client is stalled");
+
+stalled.resume();
+check(await until(() => stalled_closed, 10000), "stalled client dropped");
+
+// the string table has been through every slot a few times by now
+const b = browser(script);
+check(await until(() => b.labels().length == a.labels().length), "second client received");
+check(dump(a.body) == dump(b.body), "second client matches the first");
+
+a.button("quit").onclick();
+check(await until(() => exited !== null), "app quit");
+check(exited === 0, "app exited cleanly");
+
+if (exited === null) app.kill();
+console.log(failures.length ? `${failures.length} failed` : "all passed");
+process.exit(failures.length ? 1 : 0);
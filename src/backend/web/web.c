@@ -0,0 +1,2004 @@
+#include "../../library/widget.h"
+#include "../../library/backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+typedef int socket_t;
+#define INVALID_SOCKET -1
+#define close_socket close
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#if defined(PERSE_STATIC_BACKEND)
+  #define PERSE_API
+#elif defined(_WIN32)
+  #define PERSE_API __declspec(dllexport)
+#else
+  #define PERSE_API __attribute__((visibility("default")))
+#endif
+
+/*
+	WEB BACKEND
+	
+	Shows the widgets in a browser. The backend is a small HTTP server, which
+	serves a page with the client script on it, and the script then connects
+	back to the same server with a WebSocket.
+	
+	The script doesn't know anything about the widget tree. What it gets are
+	patches, which are lists of operations on its elements: create, destroy,
+	set a property, move and show or hide. Widgets are referred to by ids that
+	the backend hands out and never reuses, so that events for a widget that
+	has been destroyed in the meantime can be told apart.
+	
+	Each backend call only adds its operation to the patch, and
+	perse_impl_BackendProcessEvents() sends the whole patch as one message,
+	so there is one message per frame and its size depends only on what was
+	changed. Geometry that didn't change isn't sent again and neither is
+	anything that the client script has no use for, like layout properties.
+	
+	Numbers are sent as varints. Strings go through a table with a fixed
+	number of slots, which the client keeps a copy of. A string that is in its
+	slot already is sent as just the slot number, otherwise the string is sent
+	along with the slot that the client should put it in, replacing what was
+	there. So labels and such that keep coming back with the same text only
+	cost a couple of bytes after the first time.
+	
+	A client that connects gets the whole string table and then the whole tree
+	in its first message, after which it gets the same patches as every other
+	client. The tree in that first message only uses the strings that are in
+	the table already, so that the table stays the same for the other clients.
+	
+	Events come back as messages that have the type of the event, the id of
+	the widget and whatever else the event needs.
+	
+	Sockets don't block. What a client's socket doesn't take right away waits
+	in its own buffer until the socket can be written again, so a slow client
+	doesn't hold up the frame. A client that falls behind by more than
+	MAX_BACKLOG bytes gets dropped, it can reconnect and get a fresh tree.
+	
+	The server listens on 127.0.0.1, port 8000, which can be changed with the
+	PERSE_WEB_ADDRESS and PERSE_WEB_PORT environment variables. Any page that
+	is open in the browser can try to connect to it, even one on some other
+	site, and with DNS rebinding its requests can even look like they go to
+	the server's own address. So requests have to have a Host that is the
+	server's address, or localhost, and WebSockets have to come from a page
+	that was served from that same Host. Other hosts and origins can be
+	allowed with PERSE_WEB_ORIGIN, which is a list of origins like
+	"https://example.com:8443", separated with commas.
+*/
+
+static perse_log_t logger = NULL;
+
+static void backend_log(int level, const char* fmt, ...) {
+	if (!logger) return;
+	
+	va_list args;
+	va_start(args, fmt);
+	
+	logger(level, PERSE_LOG_BACKEND, fmt, args);
+	
+	va_end(args);
+}
+
+// messages below PERSE_LOG_LEVEL get compiled out, same as in the library
+#define log(level, ...) \
+	do { \
+		if (PERSE_LOG_ENABLED(level, PERSE_LOG_BACKEND)) \
+			backend_log(level, __VA_ARGS__); \
+	} while (0)
+
+#define WEB_ADDRESS "127.0.0.1"
+#define WEB_PORT 8000
+
+#define STRING_SLOTS 1024		// has to be a power of two
+#define MAX_CLIENTS 16
+#define MAX_REQUEST 8192		// longest HTTP request that gets read
+#define MAX_MESSAGE 65536		// longest message that a client can send
+#define MAX_BACKLOG (4 << 20)	// bytes that a client can fall behind by
+
+#define CHAR_WIDTH 8			// the client uses a 13px monospace font
+#define LINE_HEIGHT 16
+#define TAB_HEADER 24			// same as in layout.c
+#define WHEEL_LINE 20
+
+// operations in the messages that the backend sends
+enum {
+	OP_STRING = 1,			//< slot, string
+	OP_CREATE,				//< id, type, id of the parent element, [index]
+	OP_DESTROY,				//< id
+	OP_PROPERTY,			//< id, name, value
+	OP_MOVE,				//< id, x, y, w, h
+	OP_SHOW,				//< id, byte
+};
+
+// types of property values, each followed by the value
+enum {
+	VALUE_INTEGER = 1,
+	VALUE_BOOLEAN,
+	VALUE_STRING,
+	VALUE_STRING_ARRAY,		//< count, then strings
+};
+
+// events that the client sends, all of them start with the id
+enum {
+	EVENT_CLICK = 1,
+	EVENT_TEXT,				//< string
+	EVENT_SUBMIT,
+	EVENT_SELECT,			//< index
+	EVENT_SCROLL,			//< pixels
+	EVENT_RESIZE,			//< width, height
+};
+
+static int should_quit = 0;
+
+typedef struct {
+	unsigned char* data;
+	int size;
+	int capacity;
+} buffer_t;
+
+typedef struct {
+	char* string;
+	int length;
+	unsigned hash;
+} string_slot_t;
+
+typedef struct web_widget {
+	perse_widget_t* widget;
+	unsigned id;
+	
+	int x, y, w, h;					//< geometry that was last sent
+	
+	char* text;						//< text box contents, as the client has them
+	int selected;					//< list box selection
+	
+	char tabs_dirty;				//< tab group titles need to be sent
+	struct web_widget* next_tabs;
+	
+	struct web_widget* next_root;	//< top-level windows, for new clients
+	
+	char resize_pending;			//< top-level window, resized this frame
+	int resize_w, resize_h;
+	struct web_widget* next_resize;
+} web_widget_t;
+
+typedef struct {
+	socket_t socket;
+	char upgraded;					//< talks WebSocket and gets patches
+	char closing;					//< gets closed once everything is sent
+	
+	unsigned char* in;				//< received, but not handled yet
+	int in_size;
+	int in_capacity;
+	
+	buffer_t out;					//< waiting for the socket to take it
+} client_t;
+
+static buffer_t patch = {0};
+static string_slot_t strings[STRING_SLOTS];
+
+// widgets by their id, open addressing with linear probing
+static web_widget_t** ids = NULL;
+static unsigned id_slots = 0;
+static unsigned id_count = 0;
+static unsigned next_id = 1;
+
+static web_widget_t* roots = NULL;
+static web_widget_t* tabs_list = NULL;
+static perse_widget_t* main_window_widg = NULL;
+
+static socket_t listener = INVALID_SOCKET;
+static int listener_port = 0;
+static client_t clients[MAX_CLIENTS];
+static int client_count = 0;
+
+// resizes are only passed on once per frame, for each window
+static web_widget_t* resize_list = NULL;
+
+// finds the widget whose element a widget's element should be placed in.
+// this has to be the same as in the other backends, since the library
+// positions widgets relative to it
+static perse_widget_t* container(perse_widget_t* widg) {
+	while ((widg = widg->parent)) {
+		if (widg->type == PERSE_WIDGET_WINDOW) break;
+		if (widg->type == PERSE_WIDGET_SCROLL_PANEL) break;
+		if (widg->type == PERSE_WIDGET_TAB_PANEL) break;
+	}
+	return widg;
+}
+
+// finds a given property
+static perse_property_t* prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = widg->property;
+	while (p && p->name != name && (p = p->next));
+	return p;
+}
+
+static const char* string_prop(perse_name_t name, perse_widget_t* widg, const char* otherwise) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_STRING && p->string ? p->string : otherwise;
+}
+
+static int integer_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_INTEGER ? p->integer : 0;
+}
+
+static char boolean_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_BOOLEAN && p->boolean;
+}
+
+// finds an index of a child widget
+static int index_in_parent(perse_widget_t* widg) {
+	int index = 0;
+	for (perse_widget_t* it = widg->parent->child; it; it = it->next) {
+		if (it == widg) return index;
+		index++;
+	}
+	return -1;
+}
+
+// finds a child widget from an index
+static perse_widget_t* child_from_index(perse_widget_t* parent, int index) {
+	perse_widget_t* child = parent->child;
+	for (int i = 0; child && i <= index; i++, child = child->next) {
+		if (i == index) return child;
+	}
+	
+	return NULL;
+}
+
+static web_widget_t* data(perse_widget_t* widget) {
+	return widget ? widget->data : NULL;
+}
+
+static void call(perse_name_t name, perse_widget_t* widget, perse_property_t* value) {
+	perse_property_t* p = prop(name, widget);
+	if (p && p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "WEB:: widget type %i callback %i wrong type\n",
+			widget->type, name);
+	} else if (p) {
+		p->callback(widget, value);
+	}
+}
+
+static void call_integer(perse_name_t callback, perse_widget_t* widget, perse_name_t name, int value) {
+	perse_property_t* p = perse_CreatePropertyInteger(value);
+	p->name = name;
+	call(callback, widget, p);
+	perse_DestroyProperty(p);
+}
+
+/*
+	ENCODING
+*/
+
+static void reserve(buffer_t* b, int size) {
+	if (b->size + size <= b->capacity) return;
+	
+	b->capacity = (b->size + size) * 2;
+	b->data = realloc(b->data, b->capacity);
+}
+
+static void put_byte(buffer_t* b, int value) {
+	reserve(b, 1);
+	b->data[b->size++] = value;
+}
+
+static void put_bytes(buffer_t* b, const void* bytes, int size) {
+	reserve(b, size);
+	memcpy(b->data + b->size, bytes, size);
+	b->size += size;
+}
+
+// seven bits at a time, lowest first, high bit set if there are more
+static void put_varint(buffer_t* b, unsigned value) {
+	reserve(b, 5);
+	while (value >= 128) {
+		b->data[b->size++] = (value & 127) | 128;
+		value >>= 7;
+	}
+	b->data[b->size++] = value;
+}
+
+// zigzag, so that small negative numbers are short too
+static void put_signed(buffer_t* b, int value) {
+	put_varint(b, value < 0 ? ((unsigned)-(value + 1) << 1) | 1 : (unsigned)value << 1);
+}
+
+static unsigned hash_string(const char* string, int length) {
+	unsigned hash = 2166136261u;
+	for (int i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)string[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// puts in a string. if it is in the table, then only its slot is sent. if it
+// isn't and `keep` is set, then it replaces whatever is in its slot, for all
+// clients. otherwise it is sent without touching the table
+static void put_string(buffer_t* b, const char* string, char keep) {
+	if (!string) string = "";
+	
+	int length = strlen(string);
+	unsigned hash = hash_string(string, length);
+	unsigned slot = hash & (STRING_SLOTS - 1);
+	
+	string_slot_t* s = &strings[slot];
+	
+	if (s->string && s->hash == hash && s->length == length &&
+		memcmp(s->string, string, length) == 0) {
+		put_varint(b, slot * 2 + 2);
+		return;
+	}
+	
+	if (keep) {
+		s->string = realloc(s->string, length + 1);
+		memcpy(s->string, string, length + 1);
+		s->length = length;
+		s->hash = hash;
+		
+		put_varint(b, slot * 2 + 1);
+	} else {
+		put_varint(b, 0);
+	}
+	
+	put_varint(b, length);
+	put_bytes(b, string, length);
+}
+
+/*
+	WIDGET IDS
+*/
+
+static web_widget_t* find(unsigned id) {
+	if (!id_slots) return NULL;
+	
+	for (unsigned i = id & (id_slots - 1); ids[i]; i = (i + 1) & (id_slots - 1)) {
+		if (ids[i]->id == id) return ids[i];
+	}
+	
+	return NULL;
+}
+
+static void insert_id(web_widget_t* w) {
+	// kept at most half full
+	if ((id_count + 1) * 2 > id_slots) {
+		unsigned old_slots = id_slots;
+		web_widget_t** old = ids;
+		
+		id_slots = id_slots ? id_slots * 2 : 64;
+		ids = calloc(id_slots, sizeof(web_widget_t*));
+		id_count = 0;
+		
+		for (unsigned i = 0; i < old_slots; i++) {
+			if (old[i]) insert_id(old[i]);
+		}
+		
+		free(old);
+	}
+	
+	unsigned i = w->id & (id_slots - 1);
+	while (ids[i]) i = (i + 1) & (id_slots - 1);
+	
+	ids[i] = w;
+	id_count++;
+}
+
+static void remove_id(web_widget_t* w) {
+	unsigned mask = id_slots - 1;
+	
+	unsigned i = w->id & mask;
+	while (ids[i] != w) i = (i + 1) & mask;
+	
+	// entries after it that couldn't go in their own slot get moved back, so
+	// that searching for them doesn't stop at the gap
+	for (unsigned j = (i + 1) & mask; ids[j]; j = (j + 1) & mask) {
+		unsigned home = ids[j]->id & mask;
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			ids[i] = ids[j];
+			i = j;
+		}
+	}
+	
+	ids[i] = NULL;
+	id_count--;
+}
+
+/*
+	PATCHES
+*/
+
+// only properties that the client does something with get sent
+static char sent(perse_name_t name) {
+	switch (name) {
+		case PERSE_NAME_TITLE:
+		case PERSE_NAME_TEXT:
+		case PERSE_NAME_ENABLED:
+		case PERSE_NAME_SELECTED:
+		case PERSE_NAME_HINT:
+		case PERSE_NAME_READ_ONLY:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static unsigned parent_id(perse_widget_t* widget) {
+	perse_widget_t* parent = widget->type == PERSE_WIDGET_ITEM ?
+		widget->parent : container(widget);
+	return data(parent) ? data(parent)->id : 0;
+}
+
+static void put_create(buffer_t* b, web_widget_t* w) {
+	perse_widget_t* widget = w->widget;
+	
+	put_byte(b, OP_CREATE);
+	put_varint(b, w->id);
+	put_varint(b, widget->type);
+	put_varint(b, parent_id(widget));
+	
+	// items are shown in order, so they need to go in the right place
+	if (widget->type == PERSE_WIDGET_ITEM) {
+		int index = 0;
+		for (perse_widget_t* c = widget->parent->child; c != widget; c = c->next) {
+			if (data(c)) index++;
+		}
+		put_varint(b, index);
+	}
+}
+
+static void put_move(buffer_t* b, web_widget_t* w) {
+	put_byte(b, OP_MOVE);
+	put_varint(b, w->id);
+	put_signed(b, w->x);
+	put_signed(b, w->y);
+	put_signed(b, w->w);
+	put_signed(b, w->h);
+}
+
+static void put_show(buffer_t* b, web_widget_t* w, char shown) {
+	put_byte(b, OP_SHOW);
+	put_varint(b, w->id);
+	put_byte(b, shown);
+}
+
+static void put_integer(buffer_t* b, web_widget_t* w, perse_name_t name, int value) {
+	put_byte(b, OP_PROPERTY);
+	put_varint(b, w->id);
+	put_varint(b, name);
+	put_byte(b, VALUE_INTEGER);
+	put_signed(b, value);
+}
+
+static void put_property(buffer_t* b, web_widget_t* w, perse_property_t* p, char keep) {
+	switch (p->type) {
+		case PERSE_TYPE_INTEGER:
+			put_integer(b, w, p->name, p->integer);
+			break;
+		
+		case PERSE_TYPE_BOOLEAN:
+			put_byte(b, OP_PROPERTY);
+			put_varint(b, w->id);
+			put_varint(b, p->name);
+			put_byte(b, VALUE_BOOLEAN);
+			put_byte(b, p->boolean != 0);
+			break;
+		
+		case PERSE_TYPE_STRING:
+			put_byte(b, OP_PROPERTY);
+			put_varint(b, w->id);
+			put_varint(b, p->name);
+			put_byte(b, VALUE_STRING);
+			put_string(b, p->string, keep);
+			break;
+		
+		default:
+			break;
+	}
+}
+
+// tab group headers are drawn by the client, from the titles of all of its
+// panels, including the ones that aren't in the backend
+static void put_tabs(buffer_t* b, web_widget_t* w, char keep) {
+	int count = 0;
+	for (perse_widget_t* c = w->widget->child; c; c = c->next) count++;
+	
+	put_byte(b, OP_PROPERTY);
+	put_varint(b, w->id);
+	put_varint(b, PERSE_NAME_ITEMS);
+	put_byte(b, VALUE_STRING_ARRAY);
+	put_varint(b, count);
+	
+	for (perse_widget_t* c = w->widget->child; c; c = c->next) {
+		put_string(b, string_prop(PERSE_NAME_TEXT, c, ""), keep);
+	}
+}
+
+static void mark_tabs(web_widget_t* w) {
+	if (!w || w->tabs_dirty) return;
+	w->tabs_dirty = 1;
+	w->next_tabs = tabs_list;
+	tabs_list = w;
+}
+
+static void unmark_tabs(web_widget_t* w) {
+	if (!w->tabs_dirty) return;
+	w->tabs_dirty = 0;
+	
+	web_widget_t** it = &tabs_list;
+	while (*it != w) it = &(*it)->next_tabs;
+	*it = w->next_tabs;
+}
+
+static char tab_shown(perse_widget_t* panel) {
+	return index_in_parent(panel) == integer_prop(PERSE_NAME_SELECTED, panel->parent);
+}
+
+static void show_selected_tab(perse_widget_t* group) {
+	for (perse_widget_t* c = group->child; c; c = c->next) {
+		if (data(c)) put_show(&patch, data(c), tab_shown(c));
+	}
+}
+
+// puts in everything that the client needs to make a widget's element. when
+// `fresh` is set, the widget was just created and the properties that the
+// library has marked as changed are left out, since they get set right after
+static void put_widget(buffer_t* b, web_widget_t* w, char fresh) {
+	perse_widget_t* widget = w->widget;
+	
+	put_create(b, w);
+	
+	if (widget->type != PERSE_WIDGET_ITEM) put_move(b, w);
+	
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (!sent(p->name) || (fresh && p->changed)) continue;
+		
+		if (widget->type == PERSE_WIDGET_TEXT_BOX && p->name == PERSE_NAME_TEXT) {
+			perse_property_t text = *p;
+			text.string = w->text;
+			put_property(b, w, &text, fresh);
+		} else {
+			put_property(b, w, p, fresh);
+		}
+	}
+	
+	if (widget->type == PERSE_WIDGET_LIST_BOX && w->selected >= 0 && !fresh) {
+		put_integer(b, w, PERSE_NAME_SELECTED, w->selected);
+	}
+	
+	if (widget->type == PERSE_WIDGET_TAB_PANEL && !tab_shown(widget)) {
+		put_show(b, w, 0);
+	}
+}
+
+// everything that a new client needs to catch up with the rest
+static void put_tree(buffer_t* b, perse_widget_t* widget) {
+	web_widget_t* w = data(widget);
+	
+	if (w) {
+		put_widget(b, w, 0);
+		if (widget->type == PERSE_WIDGET_TAB_GROUP) put_tabs(b, w, 0);
+	}
+	
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		put_tree(b, c);
+	}
+}
+
+static void put_snapshot(buffer_t* b) {
+	for (int i = 0; i < STRING_SLOTS; i++) {
+		if (!strings[i].string) continue;
+		
+		put_byte(b, OP_STRING);
+		put_varint(b, i);
+		put_varint(b, strings[i].length);
+		put_bytes(b, strings[i].string, strings[i].length);
+	}
+	
+	for (web_widget_t* w = roots; w; w = w->next_root) {
+		put_tree(b, w->widget);
+	}
+}
+
+/*
+	SERVER
+*/
+
+static unsigned rotate(unsigned value, int bits) {
+	return (value << bits) | (value >> (32 - bits));
+}
+
+// only needed for the WebSocket handshake
+static void sha1(const unsigned char* bytes, int length, unsigned char digest[20]) {
+	unsigned h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+	
+	// the message gets padded with a one bit, zeros and its length in bits
+	int total = (length + 9 + 63) / 64 * 64;
+	unsigned char* message = calloc(total, 1);
+	memcpy(message, bytes, length);
+	message[length] = 0x80;
+	
+	unsigned long long bits = (unsigned long long)length * 8;
+	for (int i = 0; i < 8; i++) message[total - 1 - i] = bits >> (i * 8);
+	
+	for (int block = 0; block < total; block += 64) {
+		unsigned w[80];
+		for (int i = 0; i < 16; i++) {
+			const unsigned char* p = message + block + i * 4;
+			w[i] = (unsigned)p[0] << 24 | (unsigned)p[1] << 16 | (unsigned)p[2] << 8 | p[3];
+		}
+		for (int i = 16; i < 80; i++) {
+			w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+		
+		unsigned a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		
+		for (int i = 0; i < 80; i++) {
+			unsigned f, k;
+			if (i < 20) {
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			} else if (i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			} else if (i < 60) {
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+			
+			unsigned temp = rotate(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = rotate(b, 30);
+			b = a;
+			a = temp;
+		}
+		
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+	}
+	
+	free(message);
+	
+	for (int i = 0; i < 20; i++) digest[i] = h[i / 4] >> (24 - i % 4 * 8);
+}
+
+static void base64(const unsigned char* bytes, int length, char* out) {
+	static const char digits[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	
+	for (int i = 0; i < length; i += 3) {
+		unsigned value = bytes[i] << 16;
+		if (i + 1 < length) value |= bytes[i + 1] << 8;
+		if (i + 2 < length) value |= bytes[i + 2];
+		
+		*out++ = digits[value >> 18 & 63];
+		*out++ = digits[value >> 12 & 63];
+		*out++ = i + 1 < length ? digits[value >> 6 & 63] : '=';
+		*out++ = i + 2 < length ? digits[value & 63] : '=';
+	}
+	
+	*out = '\0';
+}
+
+static char would_block() {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static void set_nonblocking(socket_t socket) {
+#ifdef _WIN32
+	u_long on = 1;
+	ioctlsocket(socket, FIONBIO, &on);
+#else
+	fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+// sends as much of the client's buffer as its socket takes. returns 0 if the
+// connection should be closed
+static char send_queued(client_t* c) {
+	int offset = 0;
+	while (offset < c->out.size) {
+		int sent = send(c->socket, (const char*)c->out.data + offset,
+			c->out.size - offset, MSG_NOSIGNAL);
+		if (sent < 0 && would_block()) break;
+		if (sent <= 0) return 0;
+		offset += sent;
+	}
+	
+	memmove(c->out.data, c->out.data + offset, c->out.size - offset);
+	c->out.size -= offset;
+	
+	return 1;
+}
+
+// queues up bytes for a client and sends what its socket takes. returns 0 if
+// the connection should be closed
+static char send_all(client_t* c, const void* bytes, int size) {
+	put_bytes(&c->out, bytes, size);
+	if (!send_queued(c)) return 0;
+	
+	if (c->out.size > MAX_BACKLOG) {
+		log(PERSE_LOG_WARNING, "WEB:: client fell %i bytes behind, dropping it\n", c->out.size);
+		return 0;
+	}
+	
+	return 1;
+}
+
+// answers a request that isn't for the page or a WebSocket
+static void send_status(client_t* c, const char* status) {
+	char response[128];
+	int length = snprintf(response, sizeof(response),
+		"HTTP/1.1 %s\r\n"
+		"Content-Length: 0\r\n"
+		"Connection: close\r\n\r\n", status);
+	
+	send_all(c, response, length);
+}
+
+static char send_frame(client_t* c, int opcode, const void* bytes, int size) {
+	unsigned char header[10];
+	int length = 2;
+	
+	header[0] = 0x80 | opcode;
+	if (size < 126) {
+		header[1] = size;
+	} else if (size < 65536) {
+		header[1] = 126;
+		header[2] = size >> 8;
+		header[3] = size;
+		length = 4;
+	} else {
+		header[1] = 127;
+		for (int i = 0; i < 8; i++) header[2 + i] = (unsigned long long)size >> (56 - i * 8);
+		length = 10;
+	}
+	
+	return send_all(c, header, length) && send_all(c, bytes, size);
+}
+
+static void drop_client(int index) {
+	log(PERSE_LOG_DEBUG, "WEB:: client %i disconnected\n", index);
+	
+	close_socket(clients[index].socket);
+	free(clients[index].in);
+	free(clients[index].out.data);
+	
+	clients[index] = clients[--client_count];
+}
+
+// a client that fell too far behind, or whose connection broke, isn't sent
+// anything more. it is only dropped in perse_impl_BackendProcessEvents(),
+// since flush() can run while a client is being handled
+static void give_up(client_t* c) {
+	c->closing = 1;
+	c->out.size = 0;
+}
+
+// sends out everything that the frame changed, to every client
+static void flush() {
+	while (tabs_list) {
+		web_widget_t* w = tabs_list;
+		tabs_list = w->next_tabs;
+		w->tabs_dirty = 0;
+		
+		put_tabs(&patch, w, 1);
+	}
+	
+	if (!patch.size) return;
+	
+	for (int i = client_count - 1; i >= 0; i--) {
+		if (!clients[i].upgraded || clients[i].closing) continue;
+		if (!send_frame(&clients[i], 2, patch.data, patch.size)) give_up(&clients[i]);
+	}
+	
+	patch.size = 0;
+}
+
+static void open_server() {
+	if (listener != INVALID_SOCKET) return;
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+	const char* address = getenv("PERSE_WEB_ADDRESS");
+	const char* port = getenv("PERSE_WEB_PORT");
+	
+	if (!address || !*address) address = WEB_ADDRESS;
+	
+	struct sockaddr_in local = {0};
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port && *port ? atoi(port) : WEB_PORT);
+	
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+	
+	if (listener == INVALID_SOCKET || inet_pton(AF_INET, address, &local.sin_addr) != 1 ||
+		bind(listener, (struct sockaddr*)&local, sizeof(local)) != 0 ||
+		listen(listener, MAX_CLIENTS) != 0) {
+		log(PERSE_LOG_FATAL, "WEB:: can't listen on %s:%i\n", address, ntohs(local.sin_port));
+		abort();
+	}
+	
+	listener_port = ntohs(local.sin_port);
+	
+	log(PERSE_LOG_INFO, "WEB:: serving on http://%s:%i/\n", address, listener_port);
+}
+
+static void accept_client() {
+	socket_t socket = accept(listener, NULL, NULL);
+	if (socket == INVALID_SOCKET) return;
+	
+	if (client_count == MAX_CLIENTS) {
+		log(PERSE_LOG_WARNING, "WEB:: too many clients\n");
+		close_socket(socket);
+		return;
+	}
+	
+	set_nonblocking(socket);
+	
+	client_t* c = &clients[client_count++];
+	memset(c, 0, sizeof(client_t));
+	c->socket = socket;
+}
+
+static char same_text(const char* a, const char* b, int length) {
+	for (int i = 0; i < length; i++) {
+		char x = a[i] >= 'A' && a[i] <= 'Z' ? a[i] - 'A' + 'a' : a[i];
+		char y = b[i] >= 'A' && b[i] <= 'Z' ? b[i] - 'A' + 'a' : b[i];
+		if (x != y) return 0;
+	}
+	return 1;
+}
+
+// copies out the value of a header from a request that ends with a blank line
+static char header_value(const char* request, const char* name, char* value, int size) {
+	int length = strlen(name);
+	
+	for (const char* line = strstr(request, "\r\n"); line; line = strstr(line + 2, "\r\n")) {
+		if (!same_text(line + 2, name, length) || line[2 + length] != ':') continue;
+		
+		const char* start = line + 3 + length;
+		while (*start == ' ') start++;
+		
+		int count = 0;
+		while (start[count] && start[count] != '\r' && count < size - 1) count++;
+		
+		memcpy(value, start, count);
+		value[count] = '\0';
+		return 1;
+	}
+	
+	return 0;
+}
+
+// goes through the origins in PERSE_WEB_ORIGIN. with `authority` set, only
+// what comes after the scheme is compared
+static char allowed_origin(const char* origin, char authority) {
+	const char* list = getenv("PERSE_WEB_ORIGIN");
+	if (!list) return 0;
+	
+	int length = strlen(origin);
+	
+	while (*list) {
+		while (*list == ',' || *list == ' ') list++;
+		
+		int count = 0;
+		while (list[count] && list[count] != ',' && list[count] != ' ') count++;
+		
+		const char* allowed = list;
+		int allowed_length = count;
+		list += count;
+		
+		if (authority) {
+			for (int i = 0; i + 2 < count; i++) {
+				if (memcmp(allowed + i, "://", 3) != 0) continue;
+				allowed += i + 3;
+				allowed_length -= i + 3;
+				break;
+			}
+		}
+		
+		if (allowed_length == length && same_text(allowed, origin, length)) return 1;
+	}
+	
+	return 0;
+}
+
+// the Host has to be an address, which can't be rebound, or a name that is
+// allowed, and it has to have the port that the server is on
+static char allowed_host(const char* host) {
+	if (allowed_origin(host, 1)) return 1;
+	
+	char name[256];
+	int length = 0;
+	while (host[length] && host[length] != ':' && length < (int)sizeof(name) - 1) {
+		name[length] = host[length];
+		length++;
+	}
+	name[length] = '\0';
+	
+	int port = host[length] == ':' ? atoi(host + length + 1) : 80;
+	if (port != listener_port) return 0;
+	
+	struct in_addr address;
+	return inet_pton(AF_INET, name, &address) == 1 || same_text(name, "localhost", 10);
+}
+
+/*
+	CLIENT
+	
+	The page that the server hands out. The constants that the script needs
+	are put in front of it when it is served, so that they are the same as
+	the ones in the library and in here.
+*/
+
+static const char page_style[] =
+	"<!DOCTYPE html>\n"
+	"<html><head><meta charset=\"utf-8\"><title>libperse</title><style>\n"
+	"body { margin: 0; overflow: hidden; background: #d4d0c8; font: 13px/%ipx monospace; }\n"
+	"div, button, input { position: absolute; box-sizing: border-box; margin: 0; font: inherit; }\n"
+	".window { background: #d4d0c8; overflow: hidden; }\n"
+	".main { left: 0; top: 0; width: 100%%; height: 100%%; }\n"
+	".label, .item, .status, .tab { white-space: pre; overflow: hidden; }\n"
+	".list { background: #fff; border: 1px solid #888; overflow-y: auto; }\n"
+	".item { position: static; padding: 0 2px; cursor: default; }\n"
+	".selected.item { background: #0a246a; color: #fff; }\n"
+	".tabs .header { left: 0; top: 0; right: 0; height: %ipx; }\n"
+	".tabs .page { left: 0; top: %ipx; right: 0; bottom: 0; border: 1px solid #888; }\n"
+	".tab { display: inline-block; height: 100%%; padding: 3px 8px 0 8px; border: 1px solid #888; border-bottom: none; cursor: default; }\n"
+	".selected.tab { background: #e4e0d8; }\n"
+	".scroll { overflow: hidden; }\n"
+	".status { border-top: 1px solid #888; padding: 0 4px; }\n"
+	"</style></head><body><script>\n";
+
+static const char page_constants[] =
+	"var TYPE = {WINDOW: %i, STATUS_BAR: %i, ITEM: %i, TAB_PANEL: %i, TAB_GROUP: %i,\n"
+	"SCROLL_PANEL: %i, TEXT_BUTTON: %i, LIST_BOX: %i, TEXT_BOX: %i, LABEL: %i};\n"
+	"var NAME = {TITLE: %i, TEXT: %i, ENABLED: %i, SELECTED: %i, HINT: %i,\n"
+	"READ_ONLY: %i, ITEMS: %i};\n"
+	"var OP = {STRING: %i, CREATE: %i, DESTROY: %i, PROPERTY: %i, MOVE: %i, SHOW: %i};\n"
+	"var VALUE = {INTEGER: %i, BOOLEAN: %i, STRING: %i, STRING_ARRAY: %i};\n"
+	"var EVENT = {CLICK: %i, TEXT: %i, SUBMIT: %i, SELECT: %i, SCROLL: %i, RESIZE: %i};\n"
+	"var WHEEL_LINE = %i;\n";
+
+static const char client_script[] =
+	"var socket = null, nodes = {}, strings = [], main = null;\n"
+	"var data, at, encoder = new TextEncoder(), decoder = new TextDecoder();\n"
+	"\n"
+	"function varint() {\n"
+		"var value = 0, scale = 1, b;\n"
+		"do {\n"
+			"b = data[at++];\n"
+			"value += (b & 127) * scale;\n"
+			"scale *= 128;\n"
+		"} while (b & 128);\n"
+		"return value;\n"
+	"}\n"
+	"\n"
+	"function signed() {\n"
+		"var v = varint();\n"
+		"return v % 2 ? -(v + 1) / 2 : v / 2;\n"
+	"}\n"
+	"\n"
+	"function raw() {\n"
+		"var length = varint();\n"
+		"var s = decoder.decode(data.subarray(at, at + length));\n"
+		"at += length;\n"
+		"return s;\n"
+	"}\n"
+	"\n"
+	"// 0 is a string that isn't kept, odd numbers are strings that get kept in a\n"
+	"// slot and even numbers are strings that were kept before\n"
+	"function string() {\n"
+		"var v = varint();\n"
+		"if (v == 0) return raw();\n"
+		"if (v % 2) return strings[(v - 1) / 2] = raw();\n"
+		"return strings[v / 2 - 1];\n"
+	"}\n"
+	"\n"
+	"function value() {\n"
+		"switch (data[at++]) {\n"
+			"case VALUE.INTEGER: return signed();\n"
+			"case VALUE.BOOLEAN: return !!data[at++];\n"
+			"case VALUE.STRING: return string();\n"
+			"case VALUE.STRING_ARRAY:\n"
+				"var array = [], count = varint();\n"
+				"for (var i = 0; i < count; i++) array.push(string());\n"
+				"return array;\n"
+		"}\n"
+	"}\n"
+	"\n"
+	"function send(event, id, a, b) {\n"
+		"if (!socket || socket.readyState != 1) return;\n"
+	"\n"
+		"var out = [event];\n"
+		"function put(v) {\n"
+			"for (; v >= 128; v = Math.floor(v / 128)) out.push(v % 128 + 128);\n"
+			"out.push(v);\n"
+		"}\n"
+	"\n"
+		"put(id);\n"
+		"if (typeof a == \"string\") {\n"
+			"var bytes = encoder.encode(a);\n"
+			"put(bytes.length);\n"
+			"for (var i = 0; i < bytes.length; i++) out.push(bytes[i]);\n"
+		"} else {\n"
+			"if (a !== undefined) put(a < 0 ? -a * 2 - 1 : a * 2);\n"
+			"if (b !== undefined) put(b < 0 ? -b * 2 - 1 : b * 2);\n"
+		"}\n"
+	"\n"
+		"socket.send(new Uint8Array(out));\n"
+	"}\n"
+	"\n"
+	"function element(tag, style) {\n"
+		"var e = document.createElement(tag);\n"
+		"e.className = style;\n"
+		"return e;\n"
+	"}\n"
+	"\n"
+	"function resized() {\n"
+		"if (main) send(EVENT.RESIZE, main.id, innerWidth, innerHeight);\n"
+	"}\n"
+	"\n"
+	"function select(node, index) {\n"
+		"node.selected = index;\n"
+	"\n"
+		"if (node.type == TYPE.LIST_BOX) {\n"
+			"for (var i = 0; i < node.items.length; i++) {\n"
+				"node.items[i].element.className = i == index ? \"item selected\" : \"item\";\n"
+			"}\n"
+		"}\n"
+	"\n"
+		"if (node.type == TYPE.TAB_GROUP) tabs(node);\n"
+	"}\n"
+	"\n"
+	"function tabs(node) {\n"
+		"var header = node.header;\n"
+		"header.textContent = \"\";\n"
+	"\n"
+		"(node.titles || []).forEach(function(title, index) {\n"
+			"var tab = element(\"span\", index == node.selected ? \"tab selected\" : \"tab\");\n"
+			"tab.textContent = title;\n"
+			"tab.onclick = function() { send(EVENT.SELECT, node.id, index); };\n"
+			"header.appendChild(tab);\n"
+		"});\n"
+	"}\n"
+	"\n"
+	"function create(id, type, parent) {\n"
+		"var node = {id: id, type: type, items: [], selected: -1};\n"
+		"var index = type == TYPE.ITEM ? varint() : 0;\n"
+		"var owner = nodes[parent];\n"
+		"var e;\n"
+	"\n"
+		"switch (type) {\n"
+			"case TYPE.WINDOW:\n"
+				"e = element(\"div\", main ? \"window\" : \"window main\");\n"
+				"if (!main) main = node;\n"
+				"break;\n"
+			"case TYPE.TEXT_BUTTON:\n"
+				"e = element(\"button\", \"\");\n"
+				"e.onclick = function() { send(EVENT.CLICK, id); };\n"
+				"break;\n"
+			"case TYPE.TEXT_BOX:\n"
+				"e = element(\"input\", \"\");\n"
+				"e.oninput = function() { send(EVENT.TEXT, id, e.value); };\n"
+				"e.onkeydown = function(event) {\n"
+					"if (event.key == \"Enter\") send(EVENT.SUBMIT, id);\n"
+				"};\n"
+				"break;\n"
+			"case TYPE.LIST_BOX:\n"
+				"e = element(\"div\", \"list\");\n"
+				"break;\n"
+			"case TYPE.ITEM:\n"
+				"e = element(\"div\", \"item\");\n"
+				"e.onclick = function() {\n"
+					"var i = owner.items.indexOf(node);\n"
+					"select(owner, i);\n"
+					"send(EVENT.SELECT, parent, i);\n"
+				"};\n"
+				"break;\n"
+			"case TYPE.TAB_GROUP:\n"
+				"e = element(\"div\", \"tabs\");\n"
+				"e.appendChild(node.header = element(\"div\", \"header\"));\n"
+				"e.appendChild(element(\"div\", \"page\"));\n"
+				"break;\n"
+			"case TYPE.SCROLL_PANEL:\n"
+				"e = element(\"div\", \"scroll\");\n"
+				"e.onwheel = function(event) {\n"
+					"event.preventDefault();\n"
+					"event.stopPropagation();\n"
+					"var lines = event.deltaMode ? event.deltaY * WHEEL_LINE : event.deltaY;\n"
+					"send(EVENT.SCROLL, id, Math.round(lines));\n"
+				"};\n"
+				"break;\n"
+			"case TYPE.LABEL:\n"
+				"e = element(\"div\", \"label\");\n"
+				"break;\n"
+			"case TYPE.STATUS_BAR:\n"
+				"e = element(\"div\", \"status\");\n"
+				"break;\n"
+			"default:\n"
+				"e = element(\"div\", \"\");\n"
+		"}\n"
+	"\n"
+		"node.element = e;\n"
+		"e.node = node;\n"
+		"nodes[id] = node;\n"
+	"\n"
+		"if (type == TYPE.ITEM && owner) {\n"
+			"owner.items.splice(index, 0, node);\n"
+			"node.owner = owner;\n"
+			"owner.element.insertBefore(e, owner.element.children[index] || null);\n"
+			"select(owner, owner.selected);\n"
+		"} else {\n"
+			"(owner ? owner.element : document.body).appendChild(e);\n"
+		"}\n"
+	"\n"
+		"if (node == main) resized();\n"
+	"}\n"
+	"\n"
+	"function destroy(node) {\n"
+		"var inside = node.element.getElementsByTagName(\"*\");\n"
+		"for (var i = 0; i < inside.length; i++) {\n"
+			"if (inside[i].node) delete nodes[inside[i].node.id];\n"
+		"}\n"
+	"\n"
+		"if (node.owner) node.owner.items.splice(node.owner.items.indexOf(node), 1);\n"
+		"if (node == main) main = null;\n"
+	"\n"
+		"node.element.remove();\n"
+		"delete nodes[node.id];\n"
+	"}\n"
+	"\n"
+	"function property(node, name, v) {\n"
+		"var e = node.element;\n"
+	"\n"
+		"switch (name) {\n"
+			"case NAME.TITLE:\n"
+				"if (node == main) document.title = v;\n"
+				"if (node.type == TYPE.ITEM) e.textContent = v;\n"
+				"break;\n"
+			"case NAME.TEXT:\n"
+				"if (node.type == TYPE.TEXT_BOX) {\n"
+					"if (e.value != v) e.value = v;\n"
+				"} else if (node.type != TYPE.TAB_PANEL) {\n"
+					"e.textContent = v;\n"
+				"}\n"
+				"break;\n"
+			"case NAME.ENABLED:\n"
+				"e.disabled = !v;\n"
+				"break;\n"
+			"case NAME.HINT:\n"
+				"e.placeholder = v;\n"
+				"break;\n"
+			"case NAME.READ_ONLY:\n"
+				"e.readOnly = v;\n"
+				"break;\n"
+			"case NAME.SELECTED:\n"
+				"select(node, v);\n"
+				"break;\n"
+			"case NAME.ITEMS:\n"
+				"node.titles = v;\n"
+				"tabs(node);\n"
+				"break;\n"
+		"}\n"
+	"}\n"
+	"\n"
+	"function patch(bytes) {\n"
+		"data = bytes;\n"
+		"at = 0;\n"
+	"\n"
+		"while (at < data.length) {\n"
+			"var op = data[at++], node;\n"
+			"switch (op) {\n"
+				"case OP.STRING:\n"
+					"var slot = varint();\n"
+					"strings[slot] = raw();\n"
+					"break;\n"
+				"case OP.CREATE:\n"
+					"var id = varint(), type = varint();\n"
+					"create(id, type, varint());\n"
+					"break;\n"
+				"case OP.DESTROY:\n"
+					"node = nodes[varint()];\n"
+					"if (node) destroy(node);\n"
+					"break;\n"
+				"case OP.PROPERTY:\n"
+					"node = nodes[varint()];\n"
+					"var name = varint(), v = value();\n"
+					"if (node) property(node, name, v);\n"
+					"break;\n"
+				"case OP.MOVE:\n"
+					"node = nodes[varint()];\n"
+					"var x = signed(), y = signed(), w = signed(), h = signed();\n"
+					"if (!node || node == main) break;\n"
+					"var style = node.element.style;\n"
+					"style.left = x + \"px\";\n"
+					"style.top = y + \"px\";\n"
+					"style.width = w + \"px\";\n"
+					"style.height = h + \"px\";\n"
+					"break;\n"
+				"case OP.SHOW:\n"
+					"node = nodes[varint()];\n"
+					"var shown = data[at++];\n"
+					"if (node) node.element.style.display = shown ? \"\" : \"none\";\n"
+					"break;\n"
+				"default:\n"
+					"console.log(\"perse: unknown op \" + op);\n"
+					"return;\n"
+			"}\n"
+		"}\n"
+	"}\n"
+	"\n"
+	"function connect() {\n"
+		"socket = new WebSocket(\"ws://\" + location.host + \"/\");\n"
+		"socket.binaryType = \"arraybuffer\";\n"
+		"socket.onmessage = function(event) { patch(new Uint8Array(event.data)); };\n"
+		"socket.onclose = function() {\n"
+			"document.body.textContent = \"\";\n"
+			"nodes = {};\n"
+			"strings = [];\n"
+			"main = null;\n"
+			"setTimeout(connect, 1000);\n"
+		"};\n"
+	"}\n"
+	"\n"
+	"var pending = false;\n"
+	"onresize = function() {\n"
+		"if (pending) return;\n"
+		"pending = true;\n"
+		"requestAnimationFrame(function() {\n"
+			"pending = false;\n"
+			"resized();\n"
+		"});\n"
+	"};\n"
+	"\n"
+	"connect();\n";
+
+static void serve_page(client_t* c) {
+	char style[sizeof(page_style) + 32];
+	snprintf(style, sizeof(style), page_style, LINE_HEIGHT, TAB_HEADER, TAB_HEADER);
+	
+	char constants[sizeof(page_constants) + 256];
+	snprintf(constants, sizeof(constants), page_constants,
+		PERSE_WIDGET_WINDOW, PERSE_WIDGET_STATUS_BAR, PERSE_WIDGET_ITEM,
+		PERSE_WIDGET_TAB_PANEL, PERSE_WIDGET_TAB_GROUP, PERSE_WIDGET_SCROLL_PANEL,
+		PERSE_WIDGET_TEXT_BUTTON, PERSE_WIDGET_LIST_BOX, PERSE_WIDGET_TEXT_BOX,
+		PERSE_WIDGET_LABEL,
+		PERSE_NAME_TITLE, PERSE_NAME_TEXT, PERSE_NAME_ENABLED, PERSE_NAME_SELECTED,
+		PERSE_NAME_HINT, PERSE_NAME_READ_ONLY, PERSE_NAME_ITEMS,
+		OP_STRING, OP_CREATE, OP_DESTROY, OP_PROPERTY, OP_MOVE, OP_SHOW,
+		VALUE_INTEGER, VALUE_BOOLEAN, VALUE_STRING, VALUE_STRING_ARRAY,
+		EVENT_CLICK, EVENT_TEXT, EVENT_SUBMIT, EVENT_SELECT, EVENT_SCROLL, EVENT_RESIZE,
+		WHEEL_LINE);
+	
+	static const char page_end[] = "</script></body></html>\n";
+	
+	int length = strlen(style) + strlen(constants) + sizeof(client_script) - 1 +
+		sizeof(page_end) - 1;
+	
+	char header[128];
+	snprintf(header, sizeof(header),
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: text/html; charset=utf-8\r\n"
+		"Content-Length: %i\r\n"
+		"Connection: close\r\n\r\n", length);
+	
+	// the connection gets closed after this, so failing halfway is fine
+	if (!send_all(c, header, strlen(header))) return;
+	if (!send_all(c, style, strlen(style))) return;
+	if (!send_all(c, constants, strlen(constants))) return;
+	if (!send_all(c, client_script, sizeof(client_script) - 1)) return;
+	send_all(c, page_end, sizeof(page_end) - 1);
+}
+
+// handles the request that a new connection starts with. returns 0 if the
+// connection should be closed right away
+static char handle_request(client_t* c) {
+	c->in[c->in_size] = '\0';
+	
+	char* end = strstr((char*)c->in, "\r\n\r\n");
+	if (!end) return c->in_size < MAX_REQUEST;
+	
+	// anything but a WebSocket gets closed once the answer is sent
+	c->closing = 1;
+	
+	char host[256] = "";
+	if (!header_value((char*)c->in, "Host", host, sizeof(host)) || !allowed_host(host)) {
+		log(PERSE_LOG_WARNING, "WEB:: refused a request for host %s\n", host);
+		send_status(c, "403 Forbidden");
+		return 1;
+	}
+	
+	char key[64];
+	if (!header_value((char*)c->in, "Sec-WebSocket-Key", key, sizeof(key))) {
+		if (strncmp((char*)c->in, "GET / ", 6) == 0) {
+			serve_page(c);
+		} else {
+			send_status(c, "404 Not Found");
+		}
+		return 1;
+	}
+	
+	// the browser always sends the origin of the page, same origin means
+	// the page came from here
+	char origin[300] = "";
+	char same[300];
+	snprintf(same, sizeof(same), "http://%s", host);
+	if (!header_value((char*)c->in, "Origin", origin, sizeof(origin)) ||
+		(strcmp(origin, same) != 0 && !allowed_origin(origin, 0))) {
+		log(PERSE_LOG_WARNING, "WEB:: refused a WebSocket from %s\n", origin);
+		send_status(c, "403 Forbidden");
+		return 1;
+	}
+	
+	c->closing = 0;
+	
+	char challenge[128];
+	snprintf(challenge, sizeof(challenge), "%s258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key);
+	
+	unsigned char digest[20];
+	char accept[32];
+	sha1((unsigned char*)challenge, strlen(challenge), digest);
+	base64(digest, 20, accept);
+	
+	char response[256];
+	int length = snprintf(response, sizeof(response),
+		"HTTP/1.1 101 Switching Protocols\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+	
+	if (!send_all(c, response, length)) return 0;
+	
+	// whatever came after the request is already WebSocket
+	int used = end + 4 - (char*)c->in;
+	memmove(c->in, c->in + used, c->in_size - used);
+	c->in_size -= used;
+	
+	// the other clients get what the frame has changed first, so that the
+	// string table is the same for everyone. this one only gets the snapshot,
+	// which already has the changes
+	flush();
+	
+	c->upgraded = 1;
+	
+	buffer_t snapshot = {0};
+	put_snapshot(&snapshot);
+	
+	log(PERSE_LOG_DEBUG, "WEB:: client connected, sending %i bytes\n", snapshot.size);
+	
+	char sent = send_frame(c, 2, snapshot.data, snapshot.size);
+	free(snapshot.data);
+	
+	return sent;
+}
+
+static void handle_event(const unsigned char* message, int size);
+
+// handles the WebSocket frames that have arrived. returns 0 if the connection
+// should be closed
+static char handle_frames(client_t* c) {
+	for (;;) {
+		unsigned char* in = c->in;
+		if (c->in_size < 2) return 1;
+		
+		int opcode = in[0] & 15;
+		int header = 2;
+		unsigned long long size = in[1] & 127;
+		
+		// everything that the browser sends is masked
+		if (!(in[1] & 128)) return 0;
+		
+		if (size == 126) {
+			if (c->in_size < 4) return 1;
+			size = in[2] << 8 | in[3];
+			header = 4;
+		} else if (size == 127) {
+			if (c->in_size < 10) return 1;
+			size = 0;
+			for (int i = 0; i < 8; i++) size = size << 8 | in[2 + i];
+			header = 10;
+		}
+		
+		if (size > MAX_MESSAGE) return 0;
+		if (c->in_size < header + 4 + (int)size) return 1;
+		
+		unsigned char* mask = in + header;
+		unsigned char* payload = mask + 4;
+		for (int i = 0; i < (int)size; i++) payload[i] ^= mask[i & 3];
+		
+		switch (opcode) {
+			case 2:
+				handle_event(payload, size);
+				break;
+			case 8:
+				c->closing = 1;
+				return send_frame(c, 8, payload, size < 2 ? size : 2);
+			case 9:
+				if (!send_frame(c, 10, payload, size)) return 0;
+				break;
+			default:
+				break;
+		}
+		
+		int used = header + 4 + size;
+		memmove(c->in, c->in + used, c->in_size - used);
+		c->in_size -= used;
+	}
+}
+
+// reads what a client has sent. returns 0 if the connection should be closed
+static char receive(client_t* c) {
+	if (c->in_capacity - c->in_size < 4096) {
+		c->in_capacity = c->in_capacity ? c->in_capacity * 2 : 8192;
+		c->in = realloc(c->in, c->in_capacity + 1);
+	}
+	
+	int received = recv(c->socket, (char*)c->in + c->in_size, c->in_capacity - c->in_size, 0);
+	if (received < 0 && would_block()) return 1;
+	if (received <= 0) return 0;
+	
+	c->in_size += received;
+	
+	if (!c->upgraded) return handle_request(c);
+	return handle_frames(c);
+}
+
+/*
+	EVENTS
+*/
+
+typedef struct {
+	const unsigned char* at;
+	const unsigned char* end;
+} reader_t;
+
+static unsigned get_varint(reader_t* r) {
+	unsigned value = 0;
+	for (int shift = 0; r->at < r->end && shift < 35; shift += 7) {
+		unsigned char b = *r->at++;
+		value |= (unsigned)(b & 127) << shift;
+		if (!(b & 128)) break;
+	}
+	return value;
+}
+
+static int get_signed(reader_t* r) {
+	unsigned value = get_varint(r);
+	return value & 1 ? -(int)(value >> 1) - 1 : (int)(value >> 1);
+}
+
+static void unmark_resize(web_widget_t* w) {
+	if (!w->resize_pending) return;
+	w->resize_pending = 0;
+	
+	web_widget_t** it = &resize_list;
+	while (*it != w) it = &(*it)->next_resize;
+	*it = w->next_resize;
+}
+
+static void notify_resize(web_widget_t* w) {
+	perse_widget_t* widget = w->widget;
+	int resize_w = w->resize_w;
+	int resize_h = w->resize_h;
+	
+	if (widget->current_size.w == resize_w && widget->current_size.h == resize_h) {
+		return;
+	}
+	
+	widget->constraint_size.min.w = resize_w;
+	widget->constraint_size.max.w = resize_w;
+	
+	widget->constraint_size.min.h = resize_h;
+	widget->constraint_size.max.h = resize_h;
+	
+	widget->current_size.w = resize_w;
+	widget->current_size.h = resize_h;
+	widget->actual_size.w = resize_w;
+	widget->actual_size.h = resize_h;
+	
+	w->w = resize_w;
+	w->h = resize_h;
+	
+	perse_property_t* p = prop(PERSE_NAME_ON_RESIZE, widget);
+	if (!p) {
+		log(PERSE_LOG_ERROR, "WEB:: window has no ON_RESIZE\n");
+	} else if (p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "WEB:: window ON_RESIZE wrong type\n");
+	} else {
+		p->callback(widget, NULL);
+	}
+}
+
+// each window that was resized gets laid out on its own
+static void notify_resizes() {
+	while (resize_list) {
+		web_widget_t* w = resize_list;
+		resize_list = w->next_resize;
+		w->resize_pending = 0;
+		
+		notify_resize(w);
+	}
+}
+
+static void text_changed(web_widget_t* w, const unsigned char* text, int length) {
+	if (boolean_prop(PERSE_NAME_READ_ONLY, w->widget)) return;
+	
+	w->text = realloc(w->text, length + 1);
+	memcpy(w->text, text, length);
+	w->text[length] = '\0';
+	
+	perse_property_t* p = perse_CreatePropertyString(w->text);
+	call(PERSE_NAME_ON_CHANGE, w->widget, p);
+	perse_DestroyProperty(p);
+}
+
+static void list_box_select(web_widget_t* w, int index) {
+	perse_widget_t* item = child_from_index(w->widget, index);
+	if (!item) return;
+	
+	// the other clients show the same selection
+	w->selected = index;
+	put_integer(&patch, w, PERSE_NAME_SELECTED, index);
+	
+	call_integer(PERSE_NAME_ON_SELECT, w->widget, PERSE_NAME_SELECTED, index);
+	call(PERSE_NAME_ON_CLICK, item, NULL);
+}
+
+static void scroll_by(perse_widget_t* panel, int pixels) {
+	int pos = integer_prop(PERSE_NAME_SCROLL_Y, panel);
+	call_integer(PERSE_NAME_ON_SCROLL, panel, PERSE_NAME_SCROLL_Y, pos + pixels);
+}
+
+static void handle_event(const unsigned char* message, int size) {
+	reader_t r = {message + 1, message + size};
+	if (size < 2) return;
+	
+	// events for widgets that are gone already are dropped
+	web_widget_t* w = find(get_varint(&r));
+	if (!w) return;
+	
+	perse_widget_t* widget = w->widget;
+	
+	switch (message[0]) {
+		case EVENT_CLICK:
+			if (widget->type == PERSE_WIDGET_TEXT_BUTTON) {
+				call(PERSE_NAME_ON_CLICK, widget, NULL);
+			}
+			break;
+		
+		case EVENT_TEXT: {
+			unsigned length = get_varint(&r);
+			if (widget->type != PERSE_WIDGET_TEXT_BOX || length > (unsigned)(r.end - r.at)) break;
+			text_changed(w, r.at, length);
+		} break;
+		
+		case EVENT_SUBMIT:
+			if (widget->type == PERSE_WIDGET_TEXT_BOX) {
+				call(PERSE_NAME_ON_SUBMIT, widget, NULL);
+			}
+			break;
+		
+		case EVENT_SELECT: {
+			int index = get_signed(&r);
+			if (widget->type == PERSE_WIDGET_LIST_BOX) {
+				list_box_select(w, index);
+			} else if (widget->type == PERSE_WIDGET_TAB_GROUP) {
+				// the library lays out and creates the panel and then sets
+				// SELECTED, which is where the panels get switched
+				call_integer(PERSE_NAME_ON_SELECT, widget, PERSE_NAME_SELECTED, index);
+			}
+		} break;
+		
+		case EVENT_SCROLL:
+			if (widget->type == PERSE_WIDGET_SCROLL_PANEL) {
+				scroll_by(widget, get_signed(&r));
+			}
+			break;
+		
+		case EVENT_RESIZE:
+			if (widget->type != PERSE_WIDGET_WINDOW) break;
+			w->resize_w = get_signed(&r);
+			w->resize_h = get_signed(&r);
+			if (!w->resize_pending) {
+				w->resize_pending = 1;
+				w->next_resize = resize_list;
+				resize_list = w;
+			}
+			break;
+		
+		default:
+			log(PERSE_LOG_DEBUG, "WEB:: unknown event %i\n", message[0]);
+			break;
+	}
+}
+
+PERSE_API void perse_impl_BackendSetLogger(perse_log_t fn) {
+	logger = fn;
+}
+
+PERSE_API void perse_impl_BackendProcessEvents() {
+	open_server();
+	
+	// the only message of the frame, everything before this was collected
+	flush();
+	
+	// clients that were given up on, or that have taken all that was left
+	for (int i = client_count - 1; i >= 0; i--) {
+		if (clients[i].closing && !clients[i].out.size) drop_client(i);
+	}
+	
+	fd_set readable, writable;
+	FD_ZERO(&readable);
+	FD_ZERO(&writable);
+	FD_SET(listener, &readable);
+	
+	// clients that are being closed are only waited on to take what is left
+	socket_t highest = listener;
+	for (int i = 0; i < client_count; i++) {
+		client_t* c = &clients[i];
+		if (!c->closing) FD_SET(c->socket, &readable);
+		if (c->out.size) FD_SET(c->socket, &writable);
+		if (c->socket > highest) highest = c->socket;
+	}
+	
+	if (select((int)highest + 1, &readable, &writable, NULL, NULL) <= 0) return;
+	
+	for (int i = client_count - 1; i >= 0; i--) {
+		client_t* c = &clients[i];
+		
+		char open = 1;
+		if (FD_ISSET(c->socket, &writable)) open = send_queued(c);
+		if (open && FD_ISSET(c->socket, &readable)) open = receive(c);
+		if (open && c->closing && !c->out.size) open = 0;
+		
+		if (!open) drop_client(i);
+	}
+	
+	if (FD_ISSET(listener, &readable)) accept_client();
+	
+	notify_resizes();
+}
+
+PERSE_API int perse_impl_BackendShouldQuit() {
+	return should_quit;
+}
+
+// elements are cheap to make, so there is nothing to pool
+PERSE_API void perse_impl_BackendSetPoolLimit(int limit) {}
+PERSE_API void perse_impl_BackendTrimPool(int keep) {}
+
+// images aren't shown, so nothing is waiting on them to be decoded
+PERSE_API void perse_impl_BackendWake() {}
+
+// the client draws all text in a monospace font, so text can be measured here
+// without asking it
+static int text_width(const char* text) {
+	int count = 0;
+	for (; *text; text++) {
+		if (((unsigned char)*text & 0xC0) != 0x80) count++;
+	}
+	return count * CHAR_WIDTH;
+}
+
+PERSE_API perse_size_t perse_impl_BackendMeasure(perse_widget_t* widget) {
+	perse_size_t size = {-1, -1};
+	
+	int w = text_width(string_prop(PERSE_NAME_TEXT, widget, ""));
+	int h = LINE_HEIGHT;
+	
+	// same room for borders as in the win32 backend
+	switch (widget->type) {
+		case PERSE_WIDGET_LABEL:
+			size.w = w;
+			size.h = h;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BUTTON:
+			size.w = w + 16;
+			size.h = h + 10;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			size.h = h + 8;
+			break;
+		
+		default:
+			break;
+	}
+	
+	return size;
+}
+
+/*
+	WIDGETS
+*/
+
+static web_widget_t* allocate(perse_widget_t* widget) {
+	web_widget_t* w = calloc(1, sizeof(web_widget_t));
+	w->widget = widget;
+	w->id = next_id++;
+	w->x = widget->actual_pos.x;
+	w->y = widget->actual_pos.y;
+	w->w = widget->current_size.w;
+	w->h = widget->current_size.h;
+	w->selected = -1;
+	
+	widget->data = w;
+	widget->system = (void*)(long long)w->id;
+	
+	insert_id(w);
+	
+	return w;
+}
+
+PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
+	open_server();
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_INVALID:
+			log(PERSE_LOG_ERROR, "WEB:: BackendCreateWidget passed in an INVALID\n");
+			return;
+		
+		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT:
+		case PERSE_WIDGET_VERTICAL_LAYOUT:
+		case PERSE_WIDGET_GRID_LAYOUT:
+		case PERSE_WIDGET_FLOW_LAYOUT:
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			// layouts don't have elements
+			return;
+		
+		case PERSE_WIDGET_WINDOW:
+			break;
+		
+		case PERSE_WIDGET_ITEM:
+			if (!widget->parent || !data(widget->parent) ||
+				widget->parent->type != PERSE_WIDGET_LIST_BOX) {
+				log(PERSE_LOG_DEBUG, "WEB:: items only go in list boxes\n");
+				return;
+			}
+			break;
+		
+		case PERSE_WIDGET_TAB_PANEL:
+			if (!widget->parent || widget->parent->type != PERSE_WIDGET_TAB_GROUP ||
+				!data(widget->parent)) {
+				log(PERSE_LOG_ERROR, "WEB:: TAB_PANEL not in a TAB_GROUP\n");
+				return;
+			}
+			break;
+		
+		case PERSE_WIDGET_STATUS_BAR:
+		case PERSE_WIDGET_TAB_GROUP:
+		case PERSE_WIDGET_SCROLL_PANEL:
+		case PERSE_WIDGET_TEXT_BUTTON:
+		case PERSE_WIDGET_LIST_BOX:
+		case PERSE_WIDGET_TEXT_BOX:
+		case PERSE_WIDGET_LABEL:
+			break;
+		
+		default:
+			log(PERSE_LOG_DEBUG, "WEB:: widget type %i not supported\n", widget->type);
+			return;
+	}
+	
+	if (widget->type != PERSE_WIDGET_WINDOW && !data(container(widget))) {
+		log(PERSE_LOG_ERROR, "WEB:: widget type %i has nothing to go in\n", widget->type);
+		return;
+	}
+	
+	web_widget_t* w = allocate(widget);
+	
+	if (widget->type == PERSE_WIDGET_TEXT_BOX) {
+		// a changed text gets compared with this when it is set
+		perse_property_t* p = prop(PERSE_NAME_TEXT, widget);
+		const char* text = p && !p->changed ? string_prop(PERSE_NAME_TEXT, widget, "") : "";
+		w->text = malloc(strlen(text) + 1);
+		strcpy(w->text, text);
+	}
+	
+	put_widget(&patch, w, 1);
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_WINDOW:
+			if (!main_window_widg) main_window_widg = widget;
+			w->next_root = roots;
+			roots = w;
+			break;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			mark_tabs(w);
+			break;
+		
+		case PERSE_WIDGET_TAB_PANEL:
+			mark_tabs(data(widget->parent));
+			break;
+		
+		default:
+			break;
+	}
+}
+
+// lets go of everything that we have for a widget, without telling the client
+static void forget(perse_widget_t* widget) {
+	web_widget_t* w = data(widget);
+	
+	if (w) {
+		remove_id(w);
+		unmark_tabs(w);
+		unmark_resize(w);
+		
+		if (main_window_widg == widget) main_window_widg = NULL;
+		
+		web_widget_t** it = &roots;
+		while (*it && *it != w) it = &(*it)->next_root;
+		if (*it) *it = w->next_root;
+		
+		free(w->text);
+		free(w);
+	}
+	
+	widget->data = NULL;
+	widget->system = NULL;
+}
+
+// the client takes out everything that is inside of an element along with
+// it, so the children of a widget that gets destroyed are only forgotten
+static void forget_children(perse_widget_t* widget) {
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		forget_children(c);
+		forget(c);
+	}
+}
+
+PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
+	web_widget_t* w = data(widget);
+	
+	if (!w) {
+		widget->system = NULL;
+		return;
+	}
+	
+	put_byte(&patch, OP_DESTROY);
+	put_varint(&patch, w->id);
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_WINDOW:
+		case PERSE_WIDGET_SCROLL_PANEL:
+		case PERSE_WIDGET_TAB_PANEL:
+		case PERSE_WIDGET_LIST_BOX:
+			forget_children(widget);
+			break;
+		default:
+			break;
+	}
+	
+	if (widget->type == PERSE_WIDGET_TAB_PANEL && widget->parent) {
+		mark_tabs(data(widget->parent));
+	}
+	
+	forget(widget);
+}
+
+PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_property_t* p) {
+	web_widget_t* w = data(widget);
+	if (!w) return;
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_TAB_PANEL:
+			if (p->name == PERSE_NAME_TEXT) mark_tabs(data(widget->parent));
+			return;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			if (p->name == PERSE_NAME_SELECTED) show_selected_tab(widget);
+			break;
+		
+		case PERSE_WIDGET_LIST_BOX:
+			if (p->name == PERSE_NAME_SELECTED && p->type == PERSE_TYPE_INTEGER) {
+				w->selected = p->integer;
+			}
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			// the text that the user typed comes back, which isn't a change
+			if (p->name == PERSE_NAME_TEXT && p->type == PERSE_TYPE_STRING) {
+				if (strcmp(w->text, p->string) == 0) return;
+				
+				w->text = realloc(w->text, strlen(p->string) + 1);
+				strcpy(w->text, p->string);
+			}
+			break;
+		
+		default:
+			break;
+	}
+	
+	if (sent(p->name)) put_property(&patch, w, p, 1);
+}
+
+PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
+	web_widget_t* w = data(widget);
+	if (!w || widget->type == PERSE_WIDGET_ITEM) return;
+	
+	// nothing gets sent if nothing moved
+	if (w->x == widget->actual_pos.x && w->y == widget->actual_pos.y &&
+		w->w == widget->current_size.w && w->h == widget->current_size.h) {
+		return;
+	}
+	
+	w->x = widget->actual_pos.x;
+	w->y = widget->actual_pos.y;
+	w->w = widget->current_size.w;
+	w->h = widget->current_size.h;
+	
+	put_move(&patch, w);
+}
+
+static const perse_backend_t backend = {
+	.version = PERSE_BACKEND_VERSION,
+	.size = sizeof(perse_backend_t),
+	
+	.create_widget = perse_impl_BackendCreateWidget,
+	.destroy_widget = perse_impl_BackendDestroyWidget,
+	.set_property = perse_impl_BackendSetProperty,
+	.set_size_pos = perse_impl_BackendSetSizePos,
+	
+	.process_events = perse_impl_BackendProcessEvents,
+	.should_quit = perse_impl_BackendShouldQuit,
+	
+	.set_logger = perse_impl_BackendSetLogger,
+	
+	.measure = perse_impl_BackendMeasure,
+	
+	.wake = perse_impl_BackendWake,
+};
+
+// the library checks the version, see backend.c
+PERSE_API const perse_backend_t* perse_impl_GetBackend(int version) {
+	return &backend;
+}
+
+// when linked statically, the library's property.c is already in the program
+#ifndef PERSE_STATIC_BACKEND
+#include "../../library/property.c"
+#endif
@@ -1,4 +1,7 @@
 #include "../../library/widget.h"
+#include "../../library/backend.h"
+#include "../../library/canvas.h"
+#include "../../library/image.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -8,21 +11,48 @@
 name='Microsoft.Windows.Common-Controls' version='6.0.0.0' \
 processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 
-#ifdef _WIN32
+#if defined(PERSE_STATIC_BACKEND)
+  #define PERSE_API
+#elif defined(_WIN32)
   #define PERSE_API __declspec(dllexport)
 #else
   #define PERSE_API __attribute__((visibility("default")))
 #endif
 
-static void (*log)(const char* fmt, ...) = NULL;
+static perse_log_t logger = NULL;
+
+static void backend_log(int level, const char* fmt, ...) {
+	if (!logger) return;
+	
+	va_list args;
+	va_start(args, fmt);
+	
+	logger(level, PERSE_LOG_BACKEND, fmt, args);
+	
+	va_end(args);
+}
+
+// messages below PERSE_LOG_LEVEL get compiled out, same as in the library
+#define log(level, ...) \
+	do { \
+		if (PERSE_LOG_ENABLED(level, PERSE_LOG_BACKEND)) \
+			backend_log(level, __VA_ARGS__); \
+	} while (0)
 
 static int should_quit = 0;
 
+// the first top-level window, closing it closes the program
 static HWND main_window = NULL;
-static perse_widget_t* main_window_widg = NULL;
 
-PERSE_API void perse_impl_BackendSetLogger(void(*fn)(const char* fmt, ...)) {
-	log = fn;
+// while the user drags the window border, windows runs its own event loop and
+// sends a WM_SIZE for every mouse move. we only pass on the latest one, once
+// per display refresh. only one window can be dragged at a time
+#define RESIZE_TIMER 1
+static perse_widget_t* resize_pending = NULL;
+static char in_size_move = 0;
+
+PERSE_API void perse_impl_BackendSetLogger(perse_log_t fn) {
+	logger = fn;
 }
 
 PERSE_API void perse_impl_BackendProcessEvents() {
@@ -43,10 +73,27 @@ PERSE_API int perse_impl_BackendShouldQuit() {
 	return should_quit;
 }
 
+// GetMessage() sleeps until there is a message, so the image decoding thread
+// sends an empty one when it has finished something
+PERSE_API void perse_impl_BackendWake() {
+	if (main_window) PostMessage(main_window, WM_NULL, 0, 0);
+}
+
 // finds widget's window
 static perse_widget_t* window(perse_widget_t* widg) {
-	// TODO: instead of finding root widget, find one that is a WINDOW type
-	while (widg->parent) widg = widg->parent;
+	while (widg->type != PERSE_WIDGET_WINDOW && widg->parent) widg = widg->parent;
+	return widg;
+}
+
+// finds the widget whose hwnd a widget's control should be placed in. scroll
+// panels get their own hwnd, so that they can clip and scroll their content,
+// and tab panels get one so that switching tabs only hides a single window
+static perse_widget_t* container(perse_widget_t* widg) {
+	while ((widg = widg->parent)) {
+		if (widg->type == PERSE_WIDGET_WINDOW) break;
+		if (widg->type == PERSE_WIDGET_SCROLL_PANEL) break;
+		if (widg->type == PERSE_WIDGET_TAB_PANEL) break;
+	}
 	return widg;
 }
 
@@ -111,7 +158,7 @@ int AllocateIndex(perse_widget_t* widget) {
 	}
 	
 	if (index == -1) {
-		log("ERROR WIN32:: ran out of WIN32_WIDGET_SIZE\n");
+		log(PERSE_LOG_ERROR, "WIN32:: ran out of WIN32_WIDGET_SIZE\n");
 		abort();
 	}
 	
@@ -128,7 +175,7 @@ int AllocateIndex(perse_widget_t* widget) {
 
 void FreeIndex(int index) {
 	if (index < 1000 || index >= 1000 + WIN32_WIDGET_SIZE) {
-		log("ERROR WIN32:: windows index %i out of bounds\n", index);
+		log(PERSE_LOG_ERROR, "WIN32:: windows index %i out of bounds\n", index);
 		abort();
 	}
 	
@@ -138,7 +185,7 @@ void FreeIndex(int index) {
 
 perse_widget_t* LookupWidget(int index) {
 	if (index < 1000 || index >= 1000 + WIN32_WIDGET_SIZE) {
-		log("ERROR WIN32:: windows index %i out of bounds\n", index);
+		log(PERSE_LOG_ERROR, "WIN32:: windows index %i out of bounds\n", index);
 		abort();
 	}
 	
@@ -146,22 +193,147 @@ perse_widget_t* LookupWidget(int index) {
 	return win32_widgets[index].widget;
 }
 
-void recursive_show(perse_widget_t* w) {
-	if (w->system) ShowWindow(w->system, SW_SHOW);
-	for (perse_widget_t* c = w->child; c; c = c->next){
-		recursive_show(c);
-	} 
+// finds how long a single frame is on the display that the window is on
+static int frame_interval(HWND hwnd) {
+	HDC dc = GetDC(hwnd);
+	int refresh = GetDeviceCaps(dc, VREFRESH);
+	ReleaseDC(hwnd, dc);
+	
+	// 0 and 1 mean that the hardware default is used
+	if (refresh <= 1) refresh = 60;
+	
+	return 1000 / refresh;
+}
+
+static void notify_resize(perse_widget_t* widget) {
+	resize_pending = NULL;
+	
+	perse_property_t* p = prop(PERSE_NAME_ON_RESIZE, widget);
+	if (!p) {
+		log(PERSE_LOG_ERROR, "WIN32:: window has no ON_RESIZE\n");
+	} else if (p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "WIN32:: window ON_RESIZE wrong type\n");
+	} else {
+		p->callback(widget, NULL);
+	}
+}
+
+/*
+	CONTROL POOL
+	
+	Creating and destroying win32 controls is slow, compared to everything else
+	that we do, and widgets that get toggled on and off would do it every time.
+	So instead of destroying the simple controls, we hide them, reset them and
+	park them in a hidden window, and take them back out when a widget of the
+	same type gets created.
+	
+	Each type keeps at most `pool_limit` controls. The frontend can change the
+	limit and trim the pools through perse_impl_BackendSetPoolLimit() and
+	perse_impl_BackendTrimPool().
+*/
+
+#define POOL_TYPES (PERSE_WIDGET_TREE_VIEW + 1)
+
+typedef struct {
+	int count;
+	int capacity;
+	HWND* hwnd;
+} win32_pool_t;
+
+static win32_pool_t pools[POOL_TYPES];
+static int pool_limit = 32;
+static HWND parking = NULL;
+
+static char poolable(perse_widget_type_t type) {
+	switch (type) {
+		case PERSE_WIDGET_TEXT_BUTTON:
+		case PERSE_WIDGET_LABEL:
+		case PERSE_WIDGET_TEXT_BOX:
+		case PERSE_WIDGET_LIST_BOX:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// takes a control for a widget out of the pool, if there is one
+static HWND pool_take(perse_widget_t* widget, perse_widget_t* container, const char* text) {
+	win32_pool_t* pool = &pools[widget->type];
+	if (!pool->count) return NULL;
+	
+	HWND hwnd = pool->hwnd[--pool->count];
+	
+	SetParent(hwnd, container->system);
+	SetWindowLongPtr(hwnd, GWLP_ID, AllocateIndex(widget));
+	
+	// widget->system is still NULL, so the notifications from this are ignored
+	if (text) SetWindowText(hwnd, text);
+	
+	MoveWindow(hwnd,
+		widget->actual_pos.x, widget->actual_pos.y,
+		widget->current_size.w, widget->current_size.h,
+		FALSE);
+	ShowWindow(hwnd, SW_SHOW);
+	
+	return hwnd;
+}
+
+// puts a control of a widget that is being destroyed into the pool. returns 0
+// if the pool is full and the control should be destroyed instead
+static char pool_put(perse_widget_t* widget) {
+	win32_pool_t* pool = &pools[widget->type];
+	if (!poolable(widget->type) || pool->count >= pool_limit) return 0;
+	
+	if (!parking) {
+		parking = CreateWindowEx(0, "STATIC", NULL, WS_POPUP, 0, 0, 0, 0,
+			NULL, NULL, GetModuleHandle(NULL), NULL);
+		if (!parking) return 0;
+	}
+	
+	if (pool->count == pool->capacity) {
+		pool->capacity = pool->capacity ? pool->capacity * 2 : 8;
+		pool->hwnd = realloc(pool->hwnd, sizeof(HWND) * pool->capacity);
+	}
+	
+	HWND hwnd = widget->system;
+	
+	// move it out first, so that resetting it doesn't notify anyone
+	ShowWindow(hwnd, SW_HIDE);
+	SetParent(hwnd, parking);
+	
+	SetWindowText(hwnd, "");
+	EnableWindow(hwnd, TRUE);
+	if (widget->type == PERSE_WIDGET_LIST_BOX) {
+		SendMessage(hwnd, LB_RESETCONTENT, 0, 0);
+	}
+	
+	pool->hwnd[pool->count++] = hwnd;
+	
+	return 1;
+}
+
+// destroys pooled controls until there are at most `keep` of each type
+static void pool_trim(int keep) {
+	if (keep < 0) keep = 0;
+	
+	for (int i = 0; i < POOL_TYPES; i++) {
+		while (pools[i].count > keep) {
+			DestroyWindow(pools[i].hwnd[--pools[i].count]);
+		}
+	}
+}
+
+PERSE_API void perse_impl_BackendSetPoolLimit(int limit) {
+	pool_limit = limit < 0 ? 0 : limit;
+	pool_trim(pool_limit);
 }
 
-void recursive_hide(perse_widget_t* w) {
-	if (w->system) ShowWindow(w->system, SW_HIDE);
-	for (perse_widget_t* c = w->child; c; c = c->next){
-		recursive_hide(c);
-	} 
+PERSE_API void perse_impl_BackendTrimPool(int keep) {
+	pool_trim(keep);
 }
 
 static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
-	//log("WIN32:: received %hx\n", uMsg);
+	//log(PERSE_LOG_DEBUG, "WIN32:: received %hx\n", uMsg);
 	
     switch (uMsg) {
 	case WM_COMMAND: {
@@ -170,20 +342,21 @@ static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 		
 		perse_widget_t* widget = LookupWidget(wmId);
 		
-		// ignore messages for uninitialized widgets
-		if (!widget->system) break;
+		// ignore messages for uninitialized or destroyed widgets
+		if (!widget || !widget->system) break;
 		
 		switch (widget->type) {
 			
 			// button events
 			case PERSE_WIDGET_TEXT_BUTTON:
+			case PERSE_WIDGET_IMAGE_BUTTON:
 			switch (wmEvent) {
 				case BN_CLICKED: {
 					perse_property_t* p = prop(PERSE_NAME_ON_CLICK, widget);
 					if (!p) {
-						log("ERROR WIN32:: perse_WindowProc button on click missing\n");
+						log(PERSE_LOG_ERROR, "WIN32:: perse_WindowProc button on click missing\n");
 					} else if (p->type != PERSE_TYPE_CALLBACK) {
-						log("ERROR WIN32:: perse_WindowProc button on click wrong type\n");
+						log(PERSE_LOG_ERROR, "WIN32:: perse_WindowProc button on click wrong type\n");
 					} else {
 						p->callback(widget, NULL);
 					}
@@ -198,16 +371,14 @@ static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 					int index = SendMessage(widget->system, LB_GETCURSEL, 0, 0);
 					
 					
-					perse_property_t* p = prop(PERSE_NAME_ON_CLICK, widget);
+					perse_property_t* p = prop(PERSE_NAME_ON_SELECT, widget);
 					if (p && p->type != PERSE_TYPE_CALLBACK) {
-						log("ERROR WIN32:: perse_WindowProc listbox on click wrong type\n");
+						log(PERSE_LOG_ERROR, "WIN32:: perse_WindowProc listbox on select wrong type\n");
 					} else if (p) {
-						// TODO: implement
-						//p->callback(widget);
-						// actually we could call the callback on the LIST with
-						// the widget parameter being the ITEM...
-						// buut then we need to make up a new name for the
-						// callback property!
+						perse_property_t* selected = perse_CreatePropertyInteger(index);
+						selected->name = PERSE_NAME_SELECTED;
+						p->callback(widget, selected);
+						perse_DestroyProperty(selected);
 					}
 					
 					if (index < 0) break;
@@ -216,7 +387,7 @@ static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 					
 					p = prop(PERSE_NAME_ON_CLICK, child);
 					if (p && p->type != PERSE_TYPE_CALLBACK) {
-						log("ERROR WIN32:: perse_WindowProc listbox on click wrong type\n");
+						log(PERSE_LOG_ERROR, "WIN32:: perse_WindowProc listbox on click wrong type\n");
 					} else if (p) {
 						p->callback(child, NULL);
 					}
@@ -234,7 +405,7 @@ static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 
 						perse_property_t* p = prop(PERSE_NAME_ON_CHANGE, widget);
 						if (p && p->type != PERSE_TYPE_CALLBACK) {
-							log("ERROR WIN32:: perse_WindowProc textbox on change wrong type\n");
+							log(PERSE_LOG_ERROR, "WIN32:: perse_WindowProc textbox on change wrong type\n");
 						} else if (p) {
 							p->callback(widget, text);
 						}
@@ -248,27 +419,29 @@ static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 	} break;
 
 	case WM_NOTIFY: {
-		int wmId = LOWORD(wParam);
-		int wmEvent = HIWORD(wParam);
+		NMHDR* header = (NMHDR*)lParam;
 		
-		perse_widget_t* widget = LookupWidget(wmId);
+		perse_widget_t* widget = LookupWidget(header->idFrom);
 		
-		// ignore messages for uninitialized widgets
-		if (!widget->system) break;
+		// ignore messages for uninitialized or destroyed widgets
+		if (!widget || !widget->system) break;
 		
 		switch (widget->type) {
 			case PERSE_WIDGET_TAB_GROUP: {
+				if (header->code != TCN_SELCHANGE) break;
+				
 				int selection = TabCtrl_GetCurSel(widget->system);
-				log("cliclked on tab groop : %i \n", selection);
 				
-				int child = 0;
-				for (perse_widget_t* c = widget->child; c; c = c->next){
-					if (child == selection) {
-						recursive_show(c);
-					} else {
-						recursive_hide(c);
-					}
-					child++;
+				// the library will lay out and create the selected panel and
+				// then set SELECTED, which is where the panels get switched
+				perse_property_t* p = prop(PERSE_NAME_ON_SELECT, widget);
+				if (p && p->type != PERSE_TYPE_CALLBACK) {
+					log(PERSE_LOG_ERROR, "WIN32:: tab group on select wrong type\n");
+				} else if (p) {
+					perse_property_t* selected = perse_CreatePropertyInteger(selection);
+					selected->name = PERSE_NAME_SELECTED;
+					p->callback(widget, selected);
+					perse_DestroyProperty(selected);
 				}
 			} break;
 		}
@@ -279,54 +452,100 @@ static LRESULT CALLBACK perse_WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 		int new_width = LOWORD(lParam);
 		int new_height = HIWORD(lParam);
 		
-		//log("it is %i by %i\n", new_width, new_height);
-		//log("and was %i by %i\n", main_window_widg->current_size.w, main_window_widg->current_size.h);
+		//log(PERSE_LOG_DEBUG, "it is %i by %i\n", new_width, new_height);
 		
-		if (main_window != hwnd) {
-			log("ERROR WIN32:: resize generated by not main window\n");
+		// each top-level window has its widget, see perse_impl_BackendCreateWidget()
+		perse_widget_t* widget = (perse_widget_t*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+		
+		if (!widget) {
+			log(PERSE_LOG_DEBUG, "WIN32:: resize before window was created\n");
 			break;
 		}
 		
-		if (main_window_widg->current_size.w == new_width) {
-			if (main_window_widg->current_size.h == new_height) {
+		if (widget->current_size.w == new_width) {
+			if (widget->current_size.h == new_height) {
 				break;
 			}
 		}
 		
-		main_window_widg->constraint_size.min.w = new_width;
-		main_window_widg->constraint_size.max.w = new_width;
+		widget->constraint_size.min.w = new_width;
+		widget->constraint_size.max.w = new_width;
 		
-		main_window_widg->constraint_size.min.h = new_height;
-		main_window_widg->constraint_size.max.h = new_height;
+		widget->constraint_size.min.h = new_height;
+		widget->constraint_size.max.h = new_height;
 		
-		main_window_widg->current_size.w = new_width;
-		main_window_widg->current_size.h = new_height;
-		main_window_widg->actual_size.w = new_width;
-		main_window_widg->actual_size.h = new_height;
+		widget->current_size.w = new_width;
+		widget->current_size.h = new_height;
+		widget->actual_size.w = new_width;
+		widget->actual_size.h = new_height;
 		
-		perse_property_t* p = prop(PERSE_NAME_ON_RESIZE, main_window_widg);
-		if (!p) {
-			log("ERROR WIN32:: main window has no ON_RESIZE\n");
-		} else if (p->type != PERSE_TYPE_CALLBACK) {
-			log("ERROR WIN32:: main window ON_RESIZE wrong type\n");
+		if (in_size_move) {
+			resize_pending = widget;
 		} else {
-			p->callback(main_window_widg, NULL);
+			notify_resize(widget);
 		}
 		
 	} break;
 	
-	case WM_CLOSE:
-		DestroyWindow(hwnd);
-		log("WIN32:: received WM_CLOSE\n");
+	case WM_ENTERSIZEMOVE:
+		if (!GetWindowLongPtr(hwnd, GWLP_USERDATA)) break;
+		in_size_move = 1;
+		SetTimer(hwnd, RESIZE_TIMER, frame_interval(hwnd), NULL);
+		break;
+	
+	case WM_EXITSIZEMOVE:
+		if (!GetWindowLongPtr(hwnd, GWLP_USERDATA)) break;
+		KillTimer(hwnd, RESIZE_TIMER);
+		in_size_move = 0;
+		if (resize_pending) notify_resize(resize_pending);
+		break;
+	
+	case WM_TIMER:
+		if (wParam == RESIZE_TIMER && resize_pending) notify_resize(resize_pending);
 		break;
+	
+	case WM_CLOSE: {
+		log(PERSE_LOG_DEBUG, "WIN32:: received WM_CLOSE\n");
+		
+		// a window with ON_CLOSE is left to the program, which can take it
+		// out of the tree or keep it
+		perse_widget_t* widget = (perse_widget_t*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+		perse_property_t* p = widget ? prop(PERSE_NAME_ON_CLOSE, widget) : NULL;
+		if (p && p->type != PERSE_TYPE_CALLBACK) {
+			log(PERSE_LOG_ERROR, "WIN32:: window ON_CLOSE wrong type\n");
+		} else if (p) {
+			p->callback(widget, NULL);
+			return 0;
+		}
+		
+		// the other windows are still in the tree, so they are only hidden,
+		// until the program takes them out
+		if (hwnd == main_window) {
+			DestroyWindow(hwnd);
+		} else {
+			ShowWindow(hwnd, SW_HIDE);
+		}
+		return 0;
+	}
 	case WM_DESTROY:
+		log(PERSE_LOG_DEBUG, "WIN32:: received WM_DESTROY\n");
+		
+		// the library destroys the other windows when they are taken out of
+		// the tree, which isn't a reason to quit
+		if (hwnd != main_window) {
+			if (resize_pending == (perse_widget_t*)GetWindowLongPtr(hwnd, GWLP_USERDATA)) {
+				resize_pending = NULL;
+			}
+			SetWindowLongPtr(hwnd, GWLP_USERDATA, 0);
+			return 0;
+		}
+		
 		should_quit = 1;
 		PostQuitMessage(0);
-		log("WIN32:: received WM_DESTROY\n");
 		return 0;
 	case WM_QUIT:
 		should_quit = 1;
-		log("WIN32:: received WM_QUIT\n");
+		log(PERSE_LOG_DEBUG, "WIN32:: received WM_QUIT\n");
 		break;
 		
 	case WM_PAINT: {
@@ -350,7 +569,7 @@ LRESULT CALLBACK textbox_subclass_handler(HWND hwnd, UINT msg, WPARAM wParam, LP
             if (wParam == VK_RETURN) {
 				perse_property_t* p = prop(PERSE_NAME_ON_SUBMIT, widget);
 				if (p && p->type != PERSE_TYPE_CALLBACK) {
-					log("ERROR WIN32:: textbox_subclass_handler textbox on submit wrong type\n");
+					log(PERSE_LOG_ERROR, "WIN32:: textbox_subclass_handler textbox on submit wrong type\n");
 				} else if (p) {
 					p->callback(widget, NULL);
 				}
@@ -373,10 +592,443 @@ LRESULT CALLBACK textbox_subclass_handler(HWND hwnd, UINT msg, WPARAM wParam, LP
 	return DefSubclassProc(hwnd, msg, wParam, lParam);
 }
 
+// splitter layouts have no hwnd of their own, only the dividers between panes
+typedef struct {
+	int count;
+	HWND* divider;
+} win32_splitter_t;
+
+static char splitter_vertical(perse_widget_t* splitter) {
+	perse_property_t* p = prop(PERSE_NAME_VERTICAL, splitter);
+	return p && p->type == PERSE_TYPE_BOOLEAN && p->boolean;
+}
+
+static LRESULT CALLBACK splitter_divider_proc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	perse_widget_t* splitter = (perse_widget_t*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+	if (!splitter) return DefWindowProc(hwnd, msg, wParam, lParam);
+
+	switch (msg) {
+		case WM_SETCURSOR:
+			SetCursor(LoadCursor(NULL, splitter_vertical(splitter) ? IDC_SIZENS : IDC_SIZEWE));
+			return TRUE;
+
+		case WM_LBUTTONDOWN:
+			SetCapture(hwnd);
+			return 0;
+
+		case WM_LBUTTONUP:
+			if (GetCapture() == hwnd) ReleaseCapture();
+			return 0;
+
+		case WM_MOUSEMOVE: {
+			if (GetCapture() != hwnd) break;
+
+			// find out which divider this is
+			win32_splitter_t* data = splitter->data;
+			int index = -1;
+			for (int i = 0; i < data->count; i++) {
+				if (data->divider[i] == hwnd) index = i;
+			}
+
+			perse_widget_t* pane = child_from_index(splitter, index);
+			if (!pane) break;
+
+			POINT cursor;
+			GetCursorPos(&cursor);
+			ScreenToClient(GetParent(hwnd), &cursor);
+
+			int offset = splitter_vertical(splitter) ? cursor.y - splitter->actual_pos.y
+			                                         : cursor.x - splitter->actual_pos.x;
+
+			perse_property_t* p = prop(PERSE_NAME_ON_DRAG, splitter);
+			if (p && p->type != PERSE_TYPE_CALLBACK) {
+				log(PERSE_LOG_ERROR, "WIN32:: splitter on drag wrong type\n");
+			} else if (p) {
+				perse_property_t* position = perse_CreatePropertyInteger(offset);
+				p->callback(pane, position);
+				perse_DestroyProperty(position);
+			}
+		} return 0;
+	}
+
+	return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// makes sure that there is a divider in between each pair of panes
+static void sync_dividers(perse_widget_t* splitter) {
+	win32_splitter_t* data = splitter->data;
+	perse_widget_t* w = container(splitter);
+
+	int count = -1;
+	for (perse_widget_t* c = splitter->child; c; c = c->next) count++;
+	if (count < 0) count = 0;
+
+	for (int i = count; i < data->count; i++) {
+		DestroyWindow(data->divider[i]);
+	}
+
+	if (count > data->count) {
+		data->divider = realloc(data->divider, sizeof(HWND) * count);
+
+		for (int i = data->count; i < count; i++) {
+			data->divider[i] = CreateWindow(
+				"libperse Splitter Divider",
+				NULL,
+				WS_CHILD | WS_VISIBLE,
+				0, 0, 0, 0,
+				w->system,
+				NULL,
+				(HINSTANCE)GetWindowLongPtr(w->system, GWLP_HINSTANCE),
+				NULL
+			);
+
+			SetWindowLongPtr(data->divider[i], GWLP_USERDATA, (LONG_PTR)splitter);
+		}
+	}
+
+	data->count = count;
+
+	// dividers fill the gaps between the panes
+	char vertical = splitter_vertical(splitter);
+	perse_widget_t* pane = splitter->child;
+	for (int i = 0; i < count; i++, pane = pane->next) {
+		perse_widget_t* next = pane->next;
+
+		if (vertical) {
+			int start = pane->absolute.y + pane->current_size.h;
+			MoveWindow(data->divider[i],
+				splitter->absolute.x, start,
+				splitter->current_size.w, next->absolute.y - start,
+				TRUE);
+		} else {
+			int start = pane->absolute.x + pane->current_size.w;
+			MoveWindow(data->divider[i],
+				start, splitter->absolute.y,
+				next->absolute.x - start, splitter->current_size.h,
+				TRUE);
+		}
+	}
+}
+
+// scroll panels are a window with scroll bars. the content is laid out and
+// culled by the library, we only pass on where the user has scrolled to
+static int integer_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_INTEGER ? p->integer : 0;
+}
+
+static void update_scroll_bars(perse_widget_t* widget) {
+	SCROLLINFO si = {0};
+	si.cbSize = sizeof(si);
+	si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+	
+	si.nMax = integer_prop(PERSE_NAME_SCROLL_HEIGHT, widget) - 1;
+	si.nPage = widget->current_size.h;
+	si.nPos = integer_prop(PERSE_NAME_SCROLL_Y, widget);
+	SetScrollInfo(widget->system, SB_VERT, &si, TRUE);
+	
+	si.nMax = integer_prop(PERSE_NAME_SCROLL_WIDTH, widget) - 1;
+	si.nPage = widget->current_size.w;
+	si.nPos = integer_prop(PERSE_NAME_SCROLL_X, widget);
+	SetScrollInfo(widget->system, SB_HORZ, &si, TRUE);
+}
+
+static void scroll_to(perse_widget_t* widget, perse_name_t name, int offset) {
+	perse_property_t* p = prop(PERSE_NAME_ON_SCROLL, widget);
+	if (p && p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "WIN32:: scroll panel on scroll wrong type\n");
+	} else if (p) {
+		perse_property_t* position = perse_CreatePropertyInteger(offset);
+		position->name = name;
+		p->callback(widget, position);
+		perse_DestroyProperty(position);
+	}
+}
+
+static LRESULT CALLBACK scroll_panel_proc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	const int line = 20;
+	
+	switch (msg) {
+		// controls inside of the panel notify the panel and not the window
+		case WM_COMMAND:
+		case WM_NOTIFY:
+			return perse_WindowProc(hwnd, msg, wParam, lParam);
+		
+		case WM_VSCROLL:
+		case WM_HSCROLL: {
+			perse_widget_t* widget = LookupWidget(GetDlgCtrlID(hwnd));
+			if (!widget) break;
+			
+			SCROLLINFO si = {0};
+			si.cbSize = sizeof(si);
+			si.fMask = SIF_ALL;
+			GetScrollInfo(hwnd, msg == WM_VSCROLL ? SB_VERT : SB_HORZ, &si);
+			
+			int pos = si.nPos;
+			switch (LOWORD(wParam)) {
+				case SB_LINEUP: pos -= line; break;
+				case SB_LINEDOWN: pos += line; break;
+				case SB_PAGEUP: pos -= si.nPage; break;
+				case SB_PAGEDOWN: pos += si.nPage; break;
+				case SB_THUMBTRACK: pos = si.nTrackPos; break;
+				case SB_TOP: pos = si.nMin; break;
+				case SB_BOTTOM: pos = si.nMax; break;
+			}
+			
+			// the library clamps the offset and sends it back to us
+			scroll_to(widget, msg == WM_VSCROLL ? PERSE_NAME_SCROLL_Y : PERSE_NAME_SCROLL_X, pos);
+		} return 0;
+		
+		case WM_MOUSEWHEEL: {
+			perse_widget_t* widget = LookupWidget(GetDlgCtrlID(hwnd));
+			if (!widget) break;
+			
+			int pos = integer_prop(PERSE_NAME_SCROLL_Y, widget);
+			pos -= GET_WHEEL_DELTA_WPARAM(wParam) * 3 * line / WHEEL_DELTA;
+			
+			scroll_to(widget, PERSE_NAME_SCROLL_Y, pos);
+		} return 0;
+	}
+	
+	return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// tab panels are a plain window on top of the tab control. only the selected
+// one is visible, the rest are hidden along with everything inside of them
+static LRESULT CALLBACK tab_panel_proc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	switch (msg) {
+		// controls inside of the panel notify the panel and not the window
+		case WM_COMMAND:
+		case WM_NOTIFY:
+			return perse_WindowProc(hwnd, msg, wParam, lParam);
+	}
+	
+	return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// images get turned into a bitmap once, which every control that shows the
+// image then shares. the controls can't blend, so the alpha gets blended
+// against the face color here
+static void free_bitmap(void* bitmap) {
+	DeleteObject((HBITMAP)bitmap);
+}
+
+static HBITMAP image_bitmap(perse_image_t* image) {
+	if (!image || image->state != PERSE_IMAGE_READY) return NULL;
+	if (image->system) return (HBITMAP)image->system;
+	
+	BITMAPINFO info = {0};
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = image->width;
+	info.bmiHeader.biHeight = -image->height;	// top to bottom, like the pixels
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+	
+	void* bits = NULL;
+	HBITMAP bitmap = CreateDIBSection(NULL, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+	if (!bitmap) {
+		log(PERSE_LOG_ERROR, "WIN32:: CreateDIBSection failed for %s\n", image->path);
+		return NULL;
+	}
+	
+	COLORREF face = GetSysColor(COLOR_BTNFACE);
+	const unsigned char* in = image->pixels;
+	unsigned char* out = bits;
+	
+	for (int i = 0; i < image->width * image->height; i++, in += 4, out += 4) {
+		int a = in[3];
+		out[0] = (in[2] * a + GetBValue(face) * (255 - a)) / 255;
+		out[1] = (in[1] * a + GetGValue(face) * (255 - a)) / 255;
+		out[2] = (in[0] * a + GetRValue(face) * (255 - a)) / 255;
+		out[3] = 0;		// otherwise comctl32 v6 makes its own copy of it
+	}
+	
+	GdiFlush();
+	
+	image->system = bitmap;
+	image->destroy_system = free_bitmap;
+	
+	return bitmap;
+}
+
+static perse_image_t* bitmap_prop(perse_widget_t* widg) {
+	perse_property_t* p = prop(PERSE_NAME_BITMAP, widg);
+	return p && p->type == PERSE_TYPE_IMAGE ? p->image : NULL;
+}
+
+// images that aren't decoded yet only get a frame
+static void draw_image(HDC dc, RECT r, perse_image_t* image) {
+	HBITMAP bitmap = image_bitmap(image);
+	if (!bitmap) {
+		DrawEdge(dc, &r, BDR_SUNKENOUTER, BF_RECT);
+		return;
+	}
+	
+	HDC source = CreateCompatibleDC(dc);
+	HGDIOBJ old_bitmap = SelectObject(source, bitmap);
+	
+	int x = r.left + (r.right - r.left - image->width) / 2;
+	int y = r.top + (r.bottom - r.top - image->height) / 2;
+	BitBlt(dc, x, y, image->width, image->height, source, 0, 0, SRCCOPY);
+	
+	SelectObject(source, old_bitmap);
+	DeleteDC(source);
+}
+
+// replays the commands of the draw list that are in the area to be painted.
+// the library only invalidates what changed, see SetProperty below
+static void paint_canvas(HDC dc, perse_widget_t* widget, RECT area) {
+	HBRUSH brush = (HBRUSH)GetStockObject(DC_BRUSH);
+	
+	SetDCBrushColor(dc, GetSysColor(COLOR_WINDOW));
+	FillRect(dc, &area, brush);
+	
+	perse_property_t* p = prop(PERSE_NAME_DRAW, widget);
+	if (!p || p->type != PERSE_TYPE_DRAW_LIST) return;
+	
+	SelectObject(dc, GetStockObject(DC_PEN));
+	SelectObject(dc, GetStockObject(DEFAULT_GUI_FONT));
+	SetBkMode(dc, TRANSPARENT);
+	
+	for (int i = 0; i < p->draw_list->count; i++) {
+		const perse_draw_command_t* c = &p->draw_list->command[i];
+		
+		perse_draw_rect_t b = perse_DrawBounds(c);
+		if (b.x >= area.right || b.y >= area.bottom ||
+			b.x + b.w <= area.left || b.y + b.h <= area.top) continue;
+		
+		COLORREF color = RGB(c->color >> 16, (c->color >> 8) & 255, c->color & 255);
+		RECT r = {c->x, c->y, c->x + c->w, c->y + c->h};
+		
+		switch (c->type) {
+			case PERSE_DRAW_LINE:
+				SetDCPenColor(dc, color);
+				MoveToEx(dc, c->x, c->y, NULL);
+				LineTo(dc, c->x + c->w, c->y + c->h);
+				SetPixel(dc, c->x + c->w, c->y + c->h, color);	// LineTo stops short
+				break;
+			case PERSE_DRAW_RECT:
+				SetDCBrushColor(dc, color);
+				FrameRect(dc, &r, brush);
+				break;
+			case PERSE_DRAW_FILL:
+				SetDCBrushColor(dc, color);
+				FillRect(dc, &r, brush);
+				break;
+			case PERSE_DRAW_TEXT:
+				SetTextColor(dc, color);
+				DrawText(dc, c->text, -1, &r, DT_LEFT | DT_TOP | DT_NOPREFIX | DT_SINGLELINE);
+				break;
+			case PERSE_DRAW_IMAGE:
+				draw_image(dc, r, c->image);
+				break;
+		}
+	}
+}
+
+static LRESULT CALLBACK canvas_proc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	switch (msg) {
+		// everything gets painted in WM_PAINT, otherwise it would flicker
+		case WM_ERASEBKGND:
+			return 1;
+		
+		case WM_PAINT: {
+			PAINTSTRUCT ps;
+			HDC dc = BeginPaint(hwnd, &ps);
+			
+			RECT area = ps.rcPaint;
+			int w = area.right - area.left;
+			int h = area.bottom - area.top;
+			perse_widget_t* widget = LookupWidget(GetDlgCtrlID(hwnd));
+			
+			// drawn off screen and then copied over in one go
+			if (widget && w > 0 && h > 0) {
+				HDC buffer = CreateCompatibleDC(dc);
+				HBITMAP bitmap = CreateCompatibleBitmap(dc, w, h);
+				HGDIOBJ old_bitmap = SelectObject(buffer, bitmap);
+				
+				SetViewportOrgEx(buffer, -area.left, -area.top, NULL);
+				paint_canvas(buffer, widget, area);
+				SetViewportOrgEx(buffer, 0, 0, NULL);
+				
+				BitBlt(dc, area.left, area.top, w, h, buffer, 0, 0, SRCCOPY);
+				
+				SelectObject(buffer, old_bitmap);
+				DeleteObject(bitmap);
+				DeleteDC(buffer);
+			}
+			
+			EndPaint(hwnd, &ps);
+		} return 0;
+	}
+	
+	return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+static void show_selected_tab(perse_widget_t* widget) {
+	int selected = integer_prop(PERSE_NAME_SELECTED, widget);
+	
+	if (TabCtrl_GetCurSel(widget->system) != selected) {
+		TabCtrl_SetCurSel(widget->system, selected);
+	}
+	
+	int index = 0;
+	for (perse_widget_t* c = widget->child; c; c = c->next, index++) {
+		if (!c->system) continue;
+		ShowWindow(c->system, index == selected ? SW_SHOW : SW_HIDE);
+	}
+}
+
+// widgets get measured before they are created, so we can't use the dc of the
+// control itself, instead we use the screen's with the same font selected
+PERSE_API perse_size_t perse_impl_BackendMeasure(perse_widget_t* widget) {
+	perse_size_t size = {-1, -1};
+	
+	const char* text = "";
+	perse_property_t* p = prop(PERSE_NAME_TEXT, widget);
+	if (p && p->type == PERSE_TYPE_STRING) text = p->string;
+	
+	// empty string still has a height
+	if (!*text) text = " ";
+	
+	HDC dc = GetDC(NULL);
+	HGDIOBJ old_font = SelectObject(dc, GetStockObject(DEFAULT_GUI_FONT));
+	
+	RECT rect = {0};
+	DrawText(dc, text, -1, &rect, DT_CALCRECT);
+	
+	SelectObject(dc, old_font);
+	ReleaseDC(NULL, dc);
+	
+	int w = rect.right - rect.left;
+	int h = rect.bottom - rect.top;
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_LABEL:
+			size.w = w;
+			size.h = h;
+			break;
+		
+		// room for the button border, around the same as dialog editors use
+		case PERSE_WIDGET_TEXT_BUTTON:
+			size.w = w + 16;
+			size.h = h + 10;
+			break;
+		
+		// text boxes are as wide as the layout makes them
+		case PERSE_WIDGET_TEXT_BOX:
+			size.h = h + 8;
+			break;
+	}
+	
+	return size;
+}
+
 PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 	switch (widget->type) {
 		case PERSE_WIDGET_INVALID:
-			log("ERROR WIN32:: BackendCreateWidget passed in an INVALID\n");
+			log(PERSE_LOG_ERROR, "WIN32:: BackendCreateWidget passed in an INVALID\n");
 		break;
 	
 		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
@@ -384,11 +1036,27 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 		case PERSE_WIDGET_VERTICAL_LAYOUT:
 		case PERSE_WIDGET_GRID_LAYOUT:
 		case PERSE_WIDGET_FLOW_LAYOUT:
-		case PERSE_WIDGET_SPLITTER_LAYOUT:
 		case PERSE_WIDGET_FLEX_LAYOUT:
 			// layouts don't need anything!!! fake widgets
 			break;
 		
+		case PERSE_WIDGET_SPLITTER_LAYOUT: {
+			WNDCLASS wc = {};
+			
+			wc.lpfnWndProc   = splitter_divider_proc;
+			wc.hInstance     = GetModuleHandle(NULL);
+			wc.hCursor       = LoadCursor(NULL, IDC_ARROW);
+			wc.hbrBackground = (HBRUSH)(COLOR_3DFACE + 1);
+			wc.lpszClassName = "libperse Splitter Divider";
+			
+			RegisterClass(&wc);
+			
+			widget->data = calloc(1, sizeof(win32_splitter_t));
+			widget->system = (void*)(long long)1; // dummy value
+			
+			sync_dividers(widget);
+		} break;
+		
 		case PERSE_WIDGET_WINDOW: {
 			
 			// TODO: check if this actually works
@@ -403,7 +1071,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			const char* title = "libperse window";
 			if (p = prop(PERSE_NAME_TITLE, widget)) {
 				if (p->type != PERSE_TYPE_STRING) {
-					log("ERROR WIN32:: WIDGET_WINDOW property TITLE not string");
+					log(PERSE_LOG_ERROR, "WIN32:: WIDGET_WINDOW property TITLE not string");
 				} else {
 					title = p->string;
 					p->changed = 0;
@@ -456,15 +1124,15 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: WIDGET_WINDOW CreateWindowEx failed");
+				log(PERSE_LOG_ERROR, "WIN32:: WIDGET_WINDOW CreateWindowEx failed");
 				return;
 			}
 			
-			// this means that this is the main window
-			if (!widget->parent) {
-				main_window = hwnd;
-				main_window_widg = widget;
-			}
+			// the first one is the main window, the rest only get added
+			// next to it
+			if (!main_window) main_window = hwnd;
+			
+			SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)widget);
 
 			widget->system = hwnd;
 			
@@ -473,7 +1141,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 		case PERSE_WIDGET_MENU_BAR: {
 			
 			if (widget->parent->type != PERSE_WIDGET_WINDOW) {
-				log("ERROR WIN32:: menubar not attach to window?\n");
+				log(PERSE_LOG_ERROR, "WIN32:: menubar not attach to window?\n");
 			}
 			
 			
@@ -499,7 +1167,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 			
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: TAB_GROUP CreateWindow failed");
+				log(PERSE_LOG_ERROR, "WIN32:: TAB_GROUP CreateWindow failed");
 				return;
 			}
 
@@ -514,12 +1182,12 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 		
 		
 		case PERSE_WIDGET_ITEM: {
-			if (!widget->parent) log("ERROR WIN32:: item has no parent");
+			if (!widget->parent) log(PERSE_LOG_ERROR, "WIN32:: item has no parent");
 			
 			// !! insertion bug? debug!
 			/*for (perse_widget_t* c = widget->parent->child; c; c = c->next){
 				perse_property_t* p = prop(PERSE_NAME_TITLE, c);
-				log("child: %s\n", p->string);
+				log(PERSE_LOG_DEBUG, "child: %s\n", p->string);
 			}*/
 			
 			perse_widget_t* parent = ancestor_of_type(widget, PERSE_WIDGET_MENU_BAR);
@@ -529,7 +1197,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 				const char* title = "list item";
 				if (p = prop(PERSE_NAME_TITLE, widget)) {
 					if (p->type != PERSE_TYPE_STRING) {
-						log("ERROR WIN32:: WIDGET_ITEM property TITLE not string");
+						log(PERSE_LOG_ERROR, "WIN32:: WIDGET_ITEM property TITLE not string");
 					} else {
 						title = p->string;
 						p->changed = 0;
@@ -558,7 +1226,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 				const char* title = "list item";
 				if (p = prop(PERSE_NAME_TITLE, widget)) {
 					if (p->type != PERSE_TYPE_STRING) {
-						log("ERROR WIN32:: WIDGET_ITEM property TITLE not string");
+						log(PERSE_LOG_ERROR, "WIN32:: WIDGET_ITEM property TITLE not string");
 					} else {
 						title = p->string;
 						p->changed = 0;
@@ -606,7 +1274,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 					const char* title = "status item";
 					if (p = prop(PERSE_NAME_TITLE, status)) {
 						if (p->type != PERSE_TYPE_STRING) {
-							log("ERROR WIN32:: WIDGET_ITEM property TITLE not string");
+							log(PERSE_LOG_ERROR, "WIN32:: WIDGET_ITEM property TITLE not string");
 						} else {
 							title = p->string;
 							p->changed = 0;
@@ -620,13 +1288,13 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 				widget->system = (void*)(long long)1;
 			} break;
 			default:
-				log("ERROR WIN32:: item parent unsupported type '%i'\n",
+				log(PERSE_LOG_ERROR, "WIN32:: item parent unsupported type '%i'\n",
 					widget->parent->type);
 			}
 		} break;
 		
 		case PERSE_WIDGET_TAB_GROUP : {			
-			perse_widget_t* w = window(widget);
+			perse_widget_t* w = container(widget);
 			
 			HWND hwnd = CreateWindow( 
 				WC_TABCONTROL,
@@ -641,18 +1309,14 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 			
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: TAB_GROUP CreateWindow failed");
+				log(PERSE_LOG_ERROR, "WIN32:: TAB_GROUP CreateWindow failed");
 				return;
 			}
 
 			HFONT font = (HFONT)GetStockObject(DEFAULT_GUI_FONT);
 			SendMessage(hwnd, WM_SETFONT, (WPARAM)font, TRUE);
 			
-			// sets selected tab to default (hardcoded to zero)
-			TabCtrl_SetCurSel(hwnd, 0);
-			PostMessage(w->system, WM_NOTIFY, (long long)widget->data, 
-				(LPARAM)&(NMHDR){.hwndFrom = hwnd, .idFrom = (long long)widget->data, .code = TCN_SELCHANGE});
-			
+			// selected tab comes in with the SELECTED property
 			widget->system = hwnd;
 		} break;
 		
@@ -661,7 +1325,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			const char* title = "libperse tab";
 			if (p = prop(PERSE_NAME_TEXT, widget)) {
 				if (p->type != PERSE_TYPE_STRING) {
-					log("ERROR WIN32:: TAB_PANEL property TEXT not string");
+					log(PERSE_LOG_ERROR, "WIN32:: TAB_PANEL property TEXT not string");
 				} else {
 					title = p->string;
 					p->changed = 0;
@@ -669,15 +1333,56 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			}
 			
 			
-			// TODO: do a check for parent type
-
+			perse_widget_t* group = widget->parent;
+			if (!group || group->type != PERSE_WIDGET_TAB_GROUP || !group->system) {
+				log(PERSE_LOG_ERROR, "WIN32:: TAB_PANEL not in a TAB_GROUP");
+				return;
+			}
+			
+			int index = index_in_parent(widget);
+			
 			TCITEM tie;
-            tie.mask = TCIF_TEXT;
-            
-            tie.pszText = (char*)title; // this should be read only???
-            TabCtrl_InsertItem(widget->parent->system, index_in_parent(widget), &tie);
+			tie.mask = TCIF_TEXT;
+			tie.pszText = (char*)title;
+			TabCtrl_InsertItem(group->system, index, &tie);
 			
-			widget->system = (void*)(long long)1; // dummy value
+			perse_widget_t* w = container(widget);
+			
+			WNDCLASS wc = {};
+			
+			wc.lpfnWndProc   = tab_panel_proc;
+			wc.hInstance     = GetModuleHandle(NULL);
+			wc.hCursor       = LoadCursor(NULL, IDC_ARROW);
+			wc.hbrBackground = (HBRUSH)(COLOR_3DFACE + 1);
+			wc.lpszClassName = "libperse Tab Panel";
+			
+			RegisterClass(&wc);
+			
+			// only the selected panel gets to be visible
+			DWORD visible = index == integer_prop(PERSE_NAME_SELECTED, group) ? WS_VISIBLE : 0;
+			
+			HWND hwnd = CreateWindowEx(
+				WS_EX_CONTROLPARENT,
+				"libperse Tab Panel",
+				NULL,
+				WS_CHILD | WS_CLIPCHILDREN | WS_CLIPSIBLINGS | visible,
+				widget->actual_pos.x, widget->actual_pos.y,
+				widget->current_size.w, widget->current_size.h,
+				w->system,
+				(HMENU)(long long)AllocateIndex(widget),
+				(HINSTANCE)GetWindowLongPtr(w->system, GWLP_HINSTANCE),
+				NULL
+			);
+			
+			if (hwnd == NULL) {
+				log(PERSE_LOG_ERROR, "WIN32:: TAB_PANEL CreateWindow failed");
+				return;
+			}
+			
+			// has to be on top of the tab control, otherwise it won't be seen
+			SetWindowPos(hwnd, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
+			
+			widget->system = hwnd;
 		} break;
 		
 		case PERSE_WIDGET_GROUP_PANEL: {
@@ -689,12 +1394,39 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			
 		} break;
 		case PERSE_WIDGET_SCROLL_PANEL: {
-			// TODO: implement
+			perse_widget_t* w = container(widget);
 			
-			/*
-				no idea, maybe properties to determine which way to scroll?
-			*/
+			WNDCLASS wc = {};
+			
+			wc.lpfnWndProc   = scroll_panel_proc;
+			wc.hInstance     = GetModuleHandle(NULL);
+			wc.hCursor       = LoadCursor(NULL, IDC_ARROW);
+			wc.hbrBackground = (HBRUSH)(COLOR_3DFACE + 1);
+			wc.lpszClassName = "libperse Scroll Panel";
+			
+			RegisterClass(&wc);
+			
+			HWND hwnd = CreateWindowEx(
+				0,
+				"libperse Scroll Panel",
+				NULL,
+				WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | WS_CLIPCHILDREN,
+				widget->actual_pos.x, widget->actual_pos.y,
+				widget->current_size.w, widget->current_size.h,
+				w->system,
+				(HMENU)(long long)AllocateIndex(widget),
+				(HINSTANCE)GetWindowLongPtr(w->system, GWLP_HINSTANCE),
+				NULL
+			);
+			
+			if (hwnd == NULL) {
+				log(PERSE_LOG_ERROR, "WIN32:: SCROLL_PANEL CreateWindow failed");
+				return;
+			}
 			
+			widget->system = hwnd;
+			
+			update_scroll_bars(widget);
 		} break;
 		
 		case PERSE_WIDGET_ARROW_BUTTON: {
@@ -711,16 +1443,17 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			const char* title = "libperse button";
 			if (p = prop(PERSE_NAME_TEXT, widget)) {
 				if (p->type != PERSE_TYPE_STRING) {
-					log("ERROR WIN32:: TEXT_BUTTON property TITLE not string");
+					log(PERSE_LOG_ERROR, "WIN32:: TEXT_BUTTON property TITLE not string");
 				} else {
 					title = p->string;
 					p->changed = 0;
 				}
 			}
 			
-			perse_widget_t* w = window(widget);
+			perse_widget_t* w = container(widget);
 			
-			HWND hwnd = CreateWindow( 
+			HWND hwnd = pool_take(widget, w, title);
+			if (!hwnd) hwnd = CreateWindow( 
 				"BUTTON",
 				title,
 				WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
@@ -733,7 +1466,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 			
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: TEXT_BUTTON CreateWindow failed");
+				log(PERSE_LOG_ERROR, "WIN32:: TEXT_BUTTON CreateWindow failed");
 				return;
 			}
 
@@ -743,12 +1476,28 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			widget->system = hwnd;
 		} break;
 		case PERSE_WIDGET_IMAGE_BUTTON: {
-			// TODO: implement
+			perse_widget_t* w = container(widget);
 			
-			/*
+			HWND hwnd = CreateWindow( 
+				"BUTTON",
+				NULL,
+				WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON | BS_BITMAP,
+				widget->actual_pos.x, widget->actual_pos.y,
+				widget->current_size.w, widget->current_size.h,
+				w->system,
+				(HMENU)(long long)AllocateIndex(widget),
+				(HINSTANCE)GetWindowLongPtr(w->system, GWLP_HINSTANCE), 
+				NULL
+			);
 			
-			*/
+			if (hwnd == NULL) {
+				log(PERSE_LOG_ERROR, "WIN32:: IMAGE_BUTTON CreateWindow failed");
+				return;
+			}
 			
+			SendMessage(hwnd, BM_SETIMAGE, IMAGE_BITMAP, (LPARAM)image_bitmap(bitmap_prop(widget)));
+			
+			widget->system = hwnd;
 		} break;
 		case PERSE_WIDGET_COMBO_BOX: {
 			// TODO: implement
@@ -759,9 +1508,10 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			
 		} break;
 		case PERSE_WIDGET_LIST_BOX: {			
-			perse_widget_t* w = window(widget);
+			perse_widget_t* w = container(widget);
 			
-			HWND hwnd = CreateWindowEx(
+			HWND hwnd = pool_take(widget, w, NULL);
+			if (!hwnd) hwnd = CreateWindowEx(
 				WS_EX_CLIENTEDGE,
 				"LISTBOX",
 				"",
@@ -775,7 +1525,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 			
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: LIST_BOX CreateWindow failed");
+				log(PERSE_LOG_ERROR, "WIN32:: LIST_BOX CreateWindow failed");
 				return;
 			}
 
@@ -788,22 +1538,23 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 		
 		case PERSE_WIDGET_TEXT_BOX: {
 			
-			log ("creating text box\n");
+			log(PERSE_LOG_DEBUG, "creating text box\n");
 			
 			perse_property_t* p = NULL;
 			const char* text = "libperse textbox";
 			if (p = prop(PERSE_NAME_TEXT, widget)) {
 				if (p->type != PERSE_TYPE_STRING) {
-					log("ERROR WIN32:: TEXT_BUTTON property TEXT not string");
+					log(PERSE_LOG_ERROR, "WIN32:: TEXT_BUTTON property TEXT not string");
 				} else {
 					text = p->string;
 					p->changed = 0;
 				}
 			}
 			
-			perse_widget_t* w = window(widget);
+			perse_widget_t* w = container(widget);
 			
-			HWND hwnd = CreateWindowEx( 
+			HWND hwnd = pool_take(widget, w, text);
+			if (!hwnd) hwnd = CreateWindowEx( 
 				WS_EX_CLIENTEDGE,
 				"EDIT",
 				text,
@@ -817,7 +1568,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 			
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: TEXT_BUTTON CreateWindow failed");
+				log(PERSE_LOG_ERROR, "WIN32:: TEXT_BUTTON CreateWindow failed");
 				return;
 			}
 
@@ -828,7 +1579,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			
 			widget->system = hwnd;
 			
-			log ("finished text box\n");
+			log(PERSE_LOG_DEBUG, "finished text box\n");
 			
 		} break;
 		
@@ -837,16 +1588,17 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			const char* title = "libperse button";
 			if (p = prop(PERSE_NAME_TEXT, widget)) {
 				if (p->type != PERSE_TYPE_STRING) {
-					log("ERROR WIN32:: TEXT_BUTTON property TITLE not string");
+					log(PERSE_LOG_ERROR, "WIN32:: TEXT_BUTTON property TITLE not string");
 				} else {
 					title = p->string;
 					p->changed = 0;
 				}
 			}
 			
-			perse_widget_t* w = window(widget);
+			perse_widget_t* w = container(widget);
 			
-			HWND hwnd = CreateWindow( 
+			HWND hwnd = pool_take(widget, w, title);
+			if (!hwnd) hwnd = CreateWindow( 
 				"STATIC",
 				title,
 				WS_CHILD | WS_VISIBLE,
@@ -859,7 +1611,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 			);
 			
 			if (hwnd == NULL) {
-				log("ERROR WIN32:: LABEL CreateWindow failed");
+				log(PERSE_LOG_ERROR, "WIN32:: LABEL CreateWindow failed");
 				return;
 			}
 
@@ -887,20 +1639,62 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 		} break;
 		
 		case PERSE_WIDGET_IMAGE: {
-			// TODO: implement
+			perse_widget_t* w = container(widget);
 			
-			/*
+			// centered, so that the control doesn't get resized to the bitmap
+			HWND hwnd = CreateWindow( 
+				"STATIC",
+				NULL,
+				WS_VISIBLE | WS_CHILD | SS_BITMAP | SS_CENTERIMAGE,
+				widget->actual_pos.x, widget->actual_pos.y,
+				widget->current_size.w, widget->current_size.h,
+				w->system,
+				(HMENU)(long long)AllocateIndex(widget),
+				(HINSTANCE)GetWindowLongPtr(w->system, GWLP_HINSTANCE), 
+				NULL
+			);
 			
-			*/
+			if (hwnd == NULL) {
+				log(PERSE_LOG_ERROR, "WIN32:: IMAGE CreateWindow failed");
+				return;
+			}
+			
+			SendMessage(hwnd, STM_SETIMAGE, IMAGE_BITMAP, (LPARAM)image_bitmap(bitmap_prop(widget)));
 			
+			widget->system = hwnd;
 		} break;
 		case PERSE_WIDGET_CANVAS: {
-			// TODO: implement
+			perse_widget_t* w = container(widget);
 			
-			/*
+			WNDCLASS wc = {};
 			
-			*/
+			wc.lpfnWndProc   = canvas_proc;
+			wc.hInstance     = GetModuleHandle(NULL);
+			wc.hCursor       = LoadCursor(NULL, IDC_ARROW);
+			wc.hbrBackground = NULL;
+			wc.lpszClassName = "libperse Canvas";
 			
+			RegisterClass(&wc);
+			
+			HWND hwnd = CreateWindowEx(
+				0,
+				"libperse Canvas",
+				NULL,
+				WS_CHILD | WS_VISIBLE,
+				widget->actual_pos.x, widget->actual_pos.y,
+				widget->current_size.w, widget->current_size.h,
+				w->system,
+				(HMENU)(long long)AllocateIndex(widget),
+				(HINSTANCE)GetWindowLongPtr(w->system, GWLP_HINSTANCE),
+				NULL
+			);
+			
+			if (hwnd == NULL) {
+				log(PERSE_LOG_ERROR, "WIN32:: CANVAS CreateWindow failed");
+				return;
+			}
+			
+			widget->system = hwnd;
 		} break;
 		
 		case PERSE_WIDGET_PROGRESS_BAR: {
@@ -936,7 +1730,7 @@ PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
 PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
 	switch (widget->type) {
 		case PERSE_WIDGET_INVALID:
-			log("ERROR WIN32:: BackendDestroyWidget passed in an INVALID");
+			log(PERSE_LOG_ERROR, "WIN32:: BackendDestroyWidget passed in an INVALID");
 		break;
 	
 		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
@@ -944,20 +1738,31 @@ PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
 		case PERSE_WIDGET_VERTICAL_LAYOUT:
 		case PERSE_WIDGET_GRID_LAYOUT:
 		case PERSE_WIDGET_FLOW_LAYOUT:
-		case PERSE_WIDGET_SPLITTER_LAYOUT:
 		case PERSE_WIDGET_FLEX_LAYOUT:
 			// layouts don't need anything!!! fake widgets
 			break;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT: {
+			win32_splitter_t* data = widget->data;
+			for (int i = 0; i < data->count; i++) {
+				DestroyWindow(data->divider[i]);
+			}
+			free(data->divider);
+			free(data);
+			
+			widget->data = NULL;
+			widget->system = NULL;
+		} break;
 				
 		case PERSE_WIDGET_ITEM: {
-			if (!widget->parent) log("ERROR WIN32:: item has no parent when destroy");
+			if (!widget->parent) log(PERSE_LOG_ERROR, "WIN32:: item has no parent when destroy");
 			
 			switch (widget->parent->type) {
 			case PERSE_WIDGET_LIST_BOX: {
 				void* listbox = widget->parent->system;
 					
 				int count = (int)SendMessage(listbox, LB_GETCOUNT, 0, 0);
-				if (count == LB_ERR) log("ERROR WIN32:: LB_GETCOUNT return LB_ERR");
+				if (count == LB_ERR) log(PERSE_LOG_ERROR, "WIN32:: LB_GETCOUNT return LB_ERR");
 				
 				int index = -1;
 				for (int i = 0; i < count; i++) {
@@ -971,13 +1776,21 @@ PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
 				widget->system = NULL;
 			} break;
 			default:
-				log("ERROR WIN32:: item parent unsupported type '%i'\n",
+				log(PERSE_LOG_ERROR, "WIN32:: item parent unsupported type '%i'\n",
 					widget->parent->type);
 			}
 		} break;
 		
 		case PERSE_WIDGET_TAB_PANEL:
-			// doesn't have a win32 control attached
+			if (widget->parent && widget->parent->system) {
+				TabCtrl_DeleteItem(widget->parent->system, index_in_parent(widget));
+			}
+			
+			DestroyWindow(widget->system);
+			widget->system = NULL;
+			
+			FreeIndex((int)(long long)widget->data);
+			widget->data = NULL;
 			break;
 		
 		case PERSE_WIDGET_WINDOW:
@@ -1010,9 +1823,16 @@ PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
 		
 		case PERSE_WIDGET_TREE_VIEW:
 		default:
-			if (!widget->system) log("ERROR WIN32:: widg t %i no system??\n", widget->type);
-			DestroyWindow(widget->system);
+			if (!widget->system) log(PERSE_LOG_ERROR, "WIN32:: widg t %i no system??\n", widget->type);
+			if (!pool_put(widget)) DestroyWindow(widget->system);
 			widget->system = NULL;
+			
+			// scroll panels create and destroy a lot of controls, so the
+			// indices need to go back
+			if (widget->data) {
+				FreeIndex((int)(long long)widget->data);
+				widget->data = NULL;
+			}
 			break;
 	}
 }
@@ -1020,7 +1840,7 @@ PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
 PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_property_t* p) {
 	switch (widget->type) {
 		case PERSE_WIDGET_INVALID:
-			log("ERROR WIN32:: BackendSetProperty passed in an INVALID");
+			log(PERSE_LOG_ERROR, "WIN32:: BackendSetProperty passed in an INVALID");
 		break;
 	
 		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
@@ -1039,12 +1859,13 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 		case PERSE_WIDGET_STATUS_BAR:
 		
 		case PERSE_WIDGET_TAB_PANEL: switch (p->name) {
+			case PERSE_NAME_TEXT:
 			case PERSE_NAME_TITLE: {
 				
 				
 				const char* title = "perse tab";
 				if (p->type != PERSE_TYPE_STRING) {
-					log("ERROR WIN32:: TAB_PANEL property TEXT not string");
+					log(PERSE_LOG_ERROR, "WIN32:: TAB_PANEL property TEXT not string");
 				} else {
 					title = p->string;
 					p->changed = 0;
@@ -1063,7 +1884,7 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 		
 		
 		case PERSE_WIDGET_ITEM: {
-			if (!widget->parent) log("ERROR WIN32:: item has no parent");
+			if (!widget->parent) log(PERSE_LOG_ERROR, "WIN32:: item has no parent");
 			
 			switch (widget->parent->type) {
 			case PERSE_WIDGET_LIST_BOX: switch (p->name) {
@@ -1073,7 +1894,7 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 					const char* title = "list item";
 					if (p = prop(PERSE_NAME_TITLE, widget)) {
 						if (p->type != PERSE_TYPE_STRING) {
-							log("ERROR WIN32:: WIDGET_ITEM property TITLE not string");
+							log(PERSE_LOG_ERROR, "WIN32:: WIDGET_ITEM property TITLE not string");
 						} else {
 							title = p->string;
 							p->changed = 0;
@@ -1085,7 +1906,7 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 					void* listbox = widget->parent->system;
 					
 					int count = (int)SendMessage(listbox, LB_GETCOUNT, 0, 0);
-					if (count == LB_ERR) log("ERROR WIN32:: LB_GETCOUNT return LB_ERR");
+					if (count == LB_ERR) log(PERSE_LOG_ERROR, "WIN32:: LB_GETCOUNT return LB_ERR");
 					
 					int index = -1;
 					for (int i = 0; i < count; i++) {
@@ -1096,7 +1917,7 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 						}
 					}
 					
-					if (index == -1) log("ERROR WIN32:: listbox item title update not found");
+					if (index == -1) log(PERSE_LOG_ERROR, "WIN32:: listbox item title update not found");
 					
 				
 				
@@ -1130,14 +1951,23 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 			}
 			break;
 			default:
-				log("ERROR WIN32:: item parent unsupported type '%i'\n",
+				log(PERSE_LOG_ERROR, "WIN32:: item parent unsupported type '%i'\n",
 					widget->parent->type);
 			}
 		
 		} break;
 		
+		case PERSE_WIDGET_TAB_GROUP:
+			if (p->name == PERSE_NAME_SELECTED) {
+				show_selected_tab(widget);
+			}
+			break;
+		
 		case PERSE_WIDGET_GROUP_PANEL:
+			break;
+		
 		case PERSE_WIDGET_SCROLL_PANEL:
+			update_scroll_bars(widget);
 			break;
 		
 		case PERSE_WIDGET_ARROW_BUTTON:
@@ -1147,6 +1977,16 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 			}
 			break;
 		case PERSE_WIDGET_IMAGE_BUTTON:
+			// the bitmaps belong to the image cache, so the old one isn't freed
+			if (p->name == PERSE_NAME_BITMAP && p->type == PERSE_TYPE_IMAGE) {
+				SendMessage(widget->system, BM_SETIMAGE, IMAGE_BITMAP, (LPARAM)image_bitmap(p->image));
+			}
+			break;
+		case PERSE_WIDGET_IMAGE:
+			if (p->name == PERSE_NAME_BITMAP && p->type == PERSE_TYPE_IMAGE) {
+				SendMessage(widget->system, STM_SETIMAGE, IMAGE_BITMAP, (LPARAM)image_bitmap(p->image));
+			}
+			break;
 		case PERSE_WIDGET_COMBO_BOX:
 		
 		case PERSE_WIDGET_TEXT_BOX: {
@@ -1167,12 +2007,24 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 			}
 			break;
 		
+		case PERSE_WIDGET_CANVAS:
+			// only what the draw list says has changed gets painted again
+			if (p->name == PERSE_NAME_DRAW && p->type == PERSE_TYPE_DRAW_LIST &&
+				p->draw_list->damage_count >= 0) {
+				perse_draw_list_t* list = p->draw_list;
+				for (int i = 0; i < list->damage_count; i++) {
+					perse_draw_rect_t d = list->damage[i];
+					RECT r = {d.x, d.y, d.x + d.w, d.y + d.h};
+					InvalidateRect(widget->system, &r, FALSE);
+				}
+			} else {
+				InvalidateRect(widget->system, NULL, FALSE);
+			}
+			break;
+		
 		case PERSE_WIDGET_DATE_PICKER:
 		case PERSE_WIDGET_IP_ADDRESS_PICKER:
 		
-		case PERSE_WIDGET_IMAGE:
-		case PERSE_WIDGET_CANVAS:
-		
 		case PERSE_WIDGET_PROGRESS_BAR:
 		case PERSE_WIDGET_PROPERTY_LIST:
 		
@@ -1183,7 +2035,7 @@ PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_prope
 PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
 	switch (widget->type) {
 		case PERSE_WIDGET_INVALID:
-			log("ERROR WIN32:: BackendSetSizePos passed in an INVALID");
+			log(PERSE_LOG_ERROR, "WIN32:: BackendSetSizePos passed in an INVALID");
 		break;
 	
 		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
@@ -1191,13 +2043,15 @@ PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
 		case PERSE_WIDGET_VERTICAL_LAYOUT:
 		case PERSE_WIDGET_GRID_LAYOUT:
 		case PERSE_WIDGET_FLOW_LAYOUT:
-		case PERSE_WIDGET_SPLITTER_LAYOUT:
 		case PERSE_WIDGET_FLEX_LAYOUT:
 			// layouts don't need anything!!! fake widgets
 			break;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			sync_dividers(widget);
+			break;
 			
 		case PERSE_WIDGET_ITEM:
-		case PERSE_WIDGET_TAB_PANEL:
 			// also fake items
 			break;
 		
@@ -1207,21 +2061,34 @@ PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
 		// because in windows all windows are windows
 		
 		case PERSE_WIDGET_WINDOW:
-			log("-- setting window sizepos");
+			log(PERSE_LOG_DEBUG, "-- setting window sizepos");
 			break;
 		case PERSE_WIDGET_MENU_BAR:
 		case PERSE_WIDGET_STATUS_BAR:
 		
 		
 		
-		case PERSE_WIDGET_GROUP_PANEL:
 		case PERSE_WIDGET_SCROLL_PANEL:
+			MoveWindow(
+				widget->system, 
+				widget->actual_pos.x, widget->actual_pos.y,
+				widget->current_size.w, widget->current_size.h,
+				TRUE
+			);
+			update_scroll_bars(widget);
+			break;
+		
+		case PERSE_WIDGET_GROUP_PANEL:
 		
 		case PERSE_WIDGET_LIST_BOX:
 		case PERSE_WIDGET_ARROW_BUTTON:
 		case PERSE_WIDGET_TEXT_BUTTON:
 		case PERSE_WIDGET_TEXT_BOX:
 		case PERSE_WIDGET_TAB_GROUP:
+		case PERSE_WIDGET_TAB_PANEL:
+		case PERSE_WIDGET_CANVAS:
+		case PERSE_WIDGET_IMAGE_BUTTON:
+		case PERSE_WIDGET_IMAGE:
 			MoveWindow(
 				widget->system, 
 				widget->actual_pos.x, widget->actual_pos.y,
@@ -1229,15 +2096,11 @@ PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
 				TRUE
 			);
 			break;
-		case PERSE_WIDGET_IMAGE_BUTTON:
 		case PERSE_WIDGET_COMBO_BOX:
 		
 		case PERSE_WIDGET_DATE_PICKER:
 		case PERSE_WIDGET_IP_ADDRESS_PICKER:
 		
-		case PERSE_WIDGET_IMAGE:
-		case PERSE_WIDGET_CANVAS:
-		
 		case PERSE_WIDGET_PROGRESS_BAR:
 		case PERSE_WIDGET_PROPERTY_LIST:
 		
@@ -1245,6 +2108,36 @@ PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
 	}
 }
 
+static const perse_backend_t backend = {
+	.version = PERSE_BACKEND_VERSION,
+	.size = sizeof(perse_backend_t),
+	
+	.create_widget = perse_impl_BackendCreateWidget,
+	.destroy_widget = perse_impl_BackendDestroyWidget,
+	.set_property = perse_impl_BackendSetProperty,
+	.set_size_pos = perse_impl_BackendSetSizePos,
+	
+	.process_events = perse_impl_BackendProcessEvents,
+	.should_quit = perse_impl_BackendShouldQuit,
+	
+	.set_logger = perse_impl_BackendSetLogger,
+	
+	.measure = perse_impl_BackendMeasure,
+	.set_pool_limit = perse_impl_BackendSetPoolLimit,
+	.trim_pool = perse_impl_BackendTrimPool,
+	
+	.wake = perse_impl_BackendWake,
+};
+
+// the library asks for the version that it was built with, but we only have
+// the one that we were built with, so it's up to the library to check
+PERSE_API const perse_backend_t* perse_impl_GetBackend(int version) {
+	return &backend;
+}
+
 // evil hack..
 // TODO: fix
+// when linked statically, the library's property.c is already in the program
+#ifndef PERSE_STATIC_BACKEND
 #include "../../library/property.c"
+#endif
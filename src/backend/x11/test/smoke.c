@@ -0,0 +1,202 @@
+#include "../../../library/layout.h"
+#include "../../../library/backend.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+	Runs the X11 backend against a real X server, which test/xvfb.sh starts,
+	and pokes at it from a second connection, the way a window manager and
+	the user would.
+	
+	It checks that the windows get mapped with their titles and sizes, that a
+	click on a button reaches ON_CLICK, that a resize reaches ON_RESIZE, that
+	closing a window with ON_CLOSE calls it and that closing the main window
+	quits.
+*/
+
+#define FRAMES 50
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%i: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+static int clicks = 0;
+static int resizes = 0;
+static int closes = 0;
+
+static void count(perse_widget_t* widget, perse_property_t* value) { clicks++; }
+static void close_tool(perse_widget_t* widget, perse_property_t* value) { closes++; }
+
+static void resize(perse_widget_t* widget, perse_property_t* value) {
+	resizes++;
+	perse_ResizeLayout(widget);
+}
+
+static perse_widget_t* widget(perse_widget_type_t type, perse_widget_t* parent) {
+	perse_widget_t* widget = perse_AllocateWidget();
+	widget->type = type;
+	if (parent) perse_AddChild(parent, widget);
+	return widget;
+}
+
+static void string(perse_widget_t* widget, perse_name_t name, const char* value) {
+	perse_property_t* p = perse_CreatePropertyString(value);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static void callback(perse_widget_t* widget, perse_name_t name,
+	void (*fn)(perse_widget_t*, perse_property_t*)) {
+	perse_property_t* p = perse_CreatePropertyCallback(fn);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static perse_widget_t* window(const char* title, int w, int h) {
+	perse_widget_t* window = widget(PERSE_WIDGET_WINDOW, NULL);
+	window->constraint_size.min.w = window->constraint_size.max.w = w;
+	window->constraint_size.min.h = window->constraint_size.max.h = h;
+	string(window, PERSE_NAME_TITLE, title);
+	callback(window, PERSE_NAME_ON_RESIZE, resize);
+	return window;
+}
+
+static void frame(perse_widget_t* root) {
+	// never blocks, the events that were sent are already there
+	perse_BackendWake();
+	perse_BackendProcessEvents();
+	
+	perse_CalculateLayout(root);
+	perse_ApplyChanges(root);
+}
+
+static void frames(perse_widget_t* main, perse_widget_t* tool) {
+	for (int i = 0; i < FRAMES && !perse_BackendShouldQuit(); i++) {
+		frame(main);
+		frame(tool);
+	}
+}
+
+static Window window_of(perse_widget_t* widget) {
+	return (Window)widget->system;
+}
+
+static int viewable(Display* display, Window window) {
+	XWindowAttributes attributes;
+	if (!XGetWindowAttributes(display, window, &attributes)) return 0;
+	return attributes.map_state == IsViewable;
+}
+
+static void click(Display* display, Window window) {
+	XEvent event = {0};
+	event.xbutton.display = display;
+	event.xbutton.window = window;
+	event.xbutton.button = Button1;
+	event.xbutton.x = 4;
+	event.xbutton.y = 4;
+	event.xbutton.same_screen = True;
+	
+	event.type = ButtonPress;
+	XSendEvent(display, window, False, ButtonPressMask, &event);
+	event.type = ButtonRelease;
+	XSendEvent(display, window, False, ButtonReleaseMask, &event);
+	XSync(display, False);
+}
+
+static void close_window(Display* display, Window window) {
+	XEvent event = {0};
+	event.xclient.type = ClientMessage;
+	event.xclient.window = window;
+	event.xclient.message_type = XInternAtom(display, "WM_PROTOCOLS", False);
+	event.xclient.format = 32;
+	event.xclient.data.l[0] = XInternAtom(display, "WM_DELETE_WINDOW", False);
+	event.xclient.data.l[1] = CurrentTime;
+	
+	XSendEvent(display, window, False, NoEventMask, &event);
+	XSync(display, False);
+}
+
+int main() {
+	Display* display = XOpenDisplay(NULL);
+	if (!display) {
+		printf("can't open the display, run this with test/xvfb.sh\n");
+		return 1;
+	}
+	
+	perse_LoadBackend();
+	
+	perse_widget_t* main = window("x11 smoke", 200, 120);
+	perse_widget_t* column = widget(PERSE_WIDGET_VERTICAL_LAYOUT, main);
+	string(widget(PERSE_WIDGET_LABEL, column), PERSE_NAME_TEXT, "label");
+	perse_widget_t* button = widget(PERSE_WIDGET_TEXT_BUTTON, column);
+	string(button, PERSE_NAME_TEXT, "press");
+	callback(button, PERSE_NAME_ON_CLICK, count);
+	string(widget(PERSE_WIDGET_TEXT_BOX, column), PERSE_NAME_TEXT, "text");
+	
+	perse_widget_t* tool = window("x11 smoke tool", 100, 60);
+	callback(tool, PERSE_NAME_ON_CLOSE, close_tool);
+	string(widget(PERSE_WIDGET_LABEL, tool), PERSE_NAME_TEXT, "tool");
+	
+	perse_CalculateLayout(main);
+	perse_ApplyChanges(main);
+	perse_CalculateLayout(tool);
+	perse_ApplyChanges(tool);
+	
+	frames(main, tool);
+	XSync(display, False);
+	
+	// mapped, with the title and size from the tree
+	CHECK(viewable(display, window_of(main)));
+	CHECK(viewable(display, window_of(tool)));
+	CHECK(viewable(display, window_of(button)));
+	
+	char* title = NULL;
+	CHECK(XFetchName(display, window_of(main), &title) && strcmp(title, "x11 smoke") == 0);
+	if (title) XFree(title);
+	
+	XWindowAttributes attributes;
+	CHECK(XGetWindowAttributes(display, window_of(main), &attributes));
+	CHECK(attributes.width == 200 && attributes.height == 120);
+	
+	// pressed and let go over the button
+	click(display, window_of(button));
+	frames(main, tool);
+	CHECK(clicks == 1);
+	
+	// the window manager makes the window bigger
+	int before = resizes;
+	XResizeWindow(display, window_of(main), 300, 200);
+	XSync(display, False);
+	frames(main, tool);
+	CHECK(resizes > before);
+	CHECK(main->current_size.w == 300 && main->current_size.h == 200);
+	
+	// ON_CLOSE is left to the program, the window stays
+	close_window(display, window_of(tool));
+	frames(main, tool);
+	CHECK(closes == 1);
+	CHECK(!perse_BackendShouldQuit());
+	CHECK(viewable(display, window_of(tool)));
+	
+	// the main window has no ON_CLOSE, so closing it quits
+	close_window(display, window_of(main));
+	frames(main, tool);
+	CHECK(perse_BackendShouldQuit());
+	
+	perse_DestroyWidget(tool);
+	perse_DestroyWidget(main);
+	XCloseDisplay(display);
+	
+	if (failures) printf("%i failures\n", failures);
+	return failures != 0;
+}
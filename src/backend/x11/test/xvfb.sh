@@ -0,0 +1,35 @@
+#!/bin/sh
+# Runs a program under a virtual X server, so that the X11 backend can be
+# tested without a display. Usage: xvfb.sh program [arguments]
+#
+# Exits with 77 when Xvfb isn't installed, which CTest reports as skipped.
+
+if ! command -v Xvfb > /dev/null 2>&1; then
+	echo "Xvfb not found"
+	exit 77
+fi
+
+# the first display that nothing is listening on
+number=99
+while [ -e "/tmp/.X11-unix/X$number" ] || [ -e "/tmp/.X$number-lock" ]; do
+	number=$((number + 1))
+done
+
+Xvfb ":$number" -screen 0 1024x768x24 -nolisten tcp > /dev/null 2>&1 &
+server=$!
+# also when CTest kills the script after its timeout
+trap 'kill $server 2> /dev/null; wait $server 2> /dev/null' EXIT
+trap 'exit 1' HUP INT TERM
+
+# the socket shows up once the server takes connections
+tries=0
+while [ ! -e "/tmp/.X11-unix/X$number" ]; do
+	if ! kill -0 $server 2> /dev/null || [ $tries -ge 100 ]; then
+		echo "Xvfb didn't start on :$number"
+		exit 1
+	fi
+	tries=$((tries + 1))
+	sleep 0.1
+done
+
+DISPLAY=":$number" "$@"
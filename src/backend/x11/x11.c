@@ -0,0 +1,1670 @@
+#include "../../library/widget.h"
+#include "../../library/backend.h"
+#include "../../library/canvas.h"
+#include "../../library/image.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xresource.h>
+#include <X11/keysym.h>
+#include <X11/cursorfont.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#if defined(PERSE_STATIC_BACKEND)
+  #define PERSE_API
+#else
+  #define PERSE_API __attribute__((visibility("default")))
+#endif
+
+/*
+	X11 BACKEND
+	
+	Every widget that is drawn gets an X window of its own, placed in the
+	window of its container, same as the win32 backend does with its controls.
+	X doesn't have any controls, so we draw the widgets ourselves.
+	
+	The X server can be on the other side of a network, so anything that waits
+	for a reply from it costs a round trip, which can be longer than all of the
+	rest of the frame. So the rule here is that nothing after connecting ever
+	waits for the server:
+	
+	- window ids are picked by Xlib, so creating, configuring and mapping
+	windows are only requests that go into the output buffer.
+	- the font is loaded once, when connecting, after which text gets measured
+	with the metrics that Xlib keeps, instead of asking the server.
+	- colors are computed from the visual's masks, instead of being allocated.
+	- atoms are interned all at once, when connecting.
+	- windows are found from events with an XContext, which is kept by Xlib.
+	
+	Geometry that hasn't changed since the last frame isn't sent again.
+	Widgets aren't drawn when they change, instead they get marked dirty and
+	Expose events only mark them dirty as well, so each widget gets drawn once
+	per frame, however many times it was exposed. A canvas also keeps the
+	rectangles that were exposed or that its draw list says have changed, and
+	only draws those, since it can have any number of commands. Pointer motion and resizes
+	are also only handled once per frame, with their latest position.
+	
+	Each decoded image gets uploaded into a pixmap once, which is kept in the
+	image and shared by every widget that shows it, so drawing it is a single
+	XCopyArea. X has no alpha, so the pixels are blended with the face color
+	before they are uploaded.
+	
+	perse_impl_BackendProcessEvents() draws the dirty widgets, maps new
+	top-level windows and then flushes everything that the last frame did, so
+	there is a single flush per frame. Reading events that have already
+	arrived doesn't flush. When there are none, it waits for the connection,
+	or for perse_impl_BackendWake() to write to a pipe, which is how images
+	that were decoded on another thread get shown without any input.
+*/
+
+static perse_log_t logger = NULL;
+
+static void backend_log(int level, const char* fmt, ...) {
+	if (!logger) return;
+	
+	va_list args;
+	va_start(args, fmt);
+	
+	logger(level, PERSE_LOG_BACKEND, fmt, args);
+	
+	va_end(args);
+}
+
+// messages below PERSE_LOG_LEVEL get compiled out, same as in the library
+#define log(level, ...) \
+	do { \
+		if (PERSE_LOG_ENABLED(level, PERSE_LOG_BACKEND)) \
+			backend_log(level, __VA_ARGS__); \
+	} while (0)
+
+#define TAB_HEADER 24		// same as in layout.c
+#define TAB_PADDING 8
+#define LIST_PADDING 2
+#define WHEEL_LINE 20
+
+enum {
+	COLOR_FACE,
+	COLOR_LIGHT,
+	COLOR_SHADOW,
+	COLOR_TEXT,
+	COLOR_HINT,
+	COLOR_FIELD,
+	COLOR_SELECTION,
+	COLOR_SELECTED_TEXT,
+	
+	COLOR_COUNT
+};
+
+static Display* display = NULL;
+static int screen = 0;
+static XContext context = 0;
+static XFontStruct* font = NULL;
+static GC gc = NULL;
+static Cursor cursor_we = None;
+static Cursor cursor_ns = None;
+
+static Atom wm_protocols = None;
+static Atom wm_delete_window = None;
+
+static unsigned long colors[COLOR_COUNT];
+
+static int wake_pipe[2] = {-1, -1};
+
+static int should_quit = 0;
+
+// the first top-level window, closing it closes the program
+static perse_widget_t* main_window_widg = NULL;
+
+// resizes and splitter drags are only passed on once per frame
+
+static perse_widget_t* drag_splitter = NULL;
+static int drag_index = -1;
+static int drag_offset = 0;
+static char drag_pending = 0;
+
+typedef struct x11_widget {
+	perse_widget_t* widget;
+	Window window;
+	
+	int x, y, w, h;					//< geometry that was last sent
+	
+	char dirty;						//< needs to be drawn
+	struct x11_widget* next_dirty;
+	
+	char map_pending;				//< top-level window, mapped at end of frame
+	
+	char resize_pending;			//< top-level window, resized this frame
+	int resize_w, resize_h;
+	struct x11_widget* next_resize;
+	
+	char pressed;					//< button being held down
+	
+	char* text;						//< text box contents
+	int length;
+	int capacity;
+	int caret;
+	
+	int selected;					//< list box selection
+	int scroll;						//< first visible list box row
+	
+	int dividers;					//< splitter dividers
+	Window* divider;
+	
+	XRectangle damage[PERSE_DRAW_DAMAGE];	//< canvas areas to be drawn
+	int damage_count;				//< -1 for all of the canvas
+} x11_widget_t;
+
+static x11_widget_t* dirty_list = NULL;
+static x11_widget_t* resize_list = NULL;
+static x11_widget_t* focused = NULL;
+
+// finds the widget whose window a widget's window should be placed in. this
+// has to be the same as in the win32 backend, since the library positions
+// widgets relative to it
+static perse_widget_t* container(perse_widget_t* widg) {
+	while ((widg = widg->parent)) {
+		if (widg->type == PERSE_WIDGET_WINDOW) break;
+		if (widg->type == PERSE_WIDGET_SCROLL_PANEL) break;
+		if (widg->type == PERSE_WIDGET_TAB_PANEL) break;
+	}
+	return widg;
+}
+
+// finds a given property
+static perse_property_t* prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = widg->property;
+	while (p && p->name != name && (p = p->next));
+	return p;
+}
+
+static const char* string_prop(perse_name_t name, perse_widget_t* widg, const char* otherwise) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_STRING && p->string ? p->string : otherwise;
+}
+
+static int integer_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_INTEGER ? p->integer : 0;
+}
+
+static char boolean_prop(perse_name_t name, perse_widget_t* widg) {
+	perse_property_t* p = prop(name, widg);
+	return p && p->type == PERSE_TYPE_BOOLEAN && p->boolean;
+}
+
+// finds an index of a child widget
+static int index_in_parent(perse_widget_t* widg) {
+	int index = 0;
+	for (perse_widget_t* it = widg->parent->child; it; it = it->next) {
+		if (it == widg) return index;
+		index++;
+	}
+	return -1;
+}
+
+// finds a child widget from an index
+static perse_widget_t* child_from_index(perse_widget_t* parent, int index) {
+	perse_widget_t* child = parent->child;
+	for (int i = 0; child && i <= index; i++, child = child->next) {
+		if (i == index) return child;
+	}
+	
+	return NULL;
+}
+
+static x11_widget_t* data(perse_widget_t* widget) {
+	return widget ? widget->data : NULL;
+}
+
+static void call(perse_name_t name, perse_widget_t* widget, perse_property_t* value) {
+	perse_property_t* p = prop(name, widget);
+	if (p && p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "X11:: widget type %i callback %i wrong type\n",
+			widget->type, name);
+	} else if (p) {
+		p->callback(widget, value);
+	}
+}
+
+static void call_integer(perse_name_t callback, perse_widget_t* widget, perse_name_t name, int value) {
+	perse_property_t* p = perse_CreatePropertyInteger(value);
+	p->name = name;
+	call(callback, widget, p);
+	perse_DestroyProperty(p);
+}
+
+/*
+	CONNECTION
+*/
+
+// scales an 8 bit color channel into the bits of a visual's mask
+static unsigned long channel(int value, unsigned long mask) {
+	int shift = 0;
+	while (mask && !(mask & 1)) {
+		mask >>= 1;
+		shift++;
+	}
+	
+	return ((unsigned long)value * mask / 255) << shift;
+}
+
+static unsigned long rgb(int r, int g, int b) {
+	Visual* visual = DefaultVisual(display, screen);
+	
+	// anything else would need a colormap, and allocating colors round trips
+	if (visual->class != TrueColor && visual->class != DirectColor) {
+		return r + g + b > 384 ? WhitePixel(display, screen) : BlackPixel(display, screen);
+	}
+	
+	return channel(r, visual->red_mask)
+		| channel(g, visual->green_mask)
+		| channel(b, visual->blue_mask);
+}
+
+// errors arrive long after the request that caused them, so all we can do
+// is to log them, instead of letting Xlib exit
+static int error_handler(Display* display, XErrorEvent* error) {
+	char text[128];
+	XGetErrorText(display, error->error_code, text, sizeof(text));
+	log(PERSE_LOG_ERROR, "X11:: request %i failed: %s\n", error->request_code, text);
+	return 0;
+}
+
+// everything that needs a reply from the server is done here, once
+static char open_display() {
+	if (display) return 1;
+	
+	display = XOpenDisplay(NULL);
+	if (!display) {
+		log(PERSE_LOG_FATAL, "X11:: can't open display '%s'\n", XDisplayName(NULL));
+		abort();
+	}
+	
+	XSetErrorHandler(error_handler);
+	
+	screen = DefaultScreen(display);
+	context = XUniqueContext();
+	
+	char* names[] = {"WM_PROTOCOLS", "WM_DELETE_WINDOW"};
+	Atom atoms[2];
+	XInternAtoms(display, names, 2, False, atoms);
+	wm_protocols = atoms[0];
+	wm_delete_window = atoms[1];
+	
+	font = XLoadQueryFont(display, "-misc-fixed-medium-r-semicondensed--13-*-*-*-*-*-iso8859-1");
+	if (!font) font = XLoadQueryFont(display, "fixed");
+	if (!font) {
+		log(PERSE_LOG_FATAL, "X11:: can't load a font\n");
+		abort();
+	}
+	
+	colors[COLOR_FACE] = rgb(0xd4, 0xd0, 0xc8);
+	colors[COLOR_LIGHT] = rgb(0xff, 0xff, 0xff);
+	colors[COLOR_SHADOW] = rgb(0x80, 0x80, 0x80);
+	colors[COLOR_TEXT] = rgb(0x00, 0x00, 0x00);
+	colors[COLOR_HINT] = rgb(0x80, 0x80, 0x80);
+	colors[COLOR_FIELD] = rgb(0xff, 0xff, 0xff);
+	colors[COLOR_SELECTION] = rgb(0x0a, 0x24, 0x6a);
+	colors[COLOR_SELECTED_TEXT] = rgb(0xff, 0xff, 0xff);
+	
+	XGCValues values;
+	values.font = font->fid;
+	values.foreground = colors[COLOR_TEXT];
+	values.graphics_exposures = False;	// images are copied from pixmaps
+	gc = XCreateGC(display, RootWindow(display, screen),
+		GCFont | GCForeground | GCGraphicsExposures, &values);
+	
+	// Xlib only fetches the keyboard mapping when the first key is looked up
+	XKeysymToKeycode(display, XK_Return);
+	
+	cursor_we = XCreateFontCursor(display, XC_sb_h_double_arrow);
+	cursor_ns = XCreateFontCursor(display, XC_sb_v_double_arrow);
+	
+	// both ends of the pipe can't block, the read end is drained and the
+	// write end can be full, which is as good as written to
+	if (pipe(wake_pipe) == 0) {
+		fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+	} else {
+		log(PERSE_LOG_WARNING, "X11:: no pipe, images will show up with the next event\n");
+		wake_pipe[0] = wake_pipe[1] = -1;
+	}
+	
+	return 1;
+}
+
+static int text_width(const char* text, int length) {
+	return XTextWidth(font, text, length);
+}
+
+static int text_height() {
+	return font->ascent + font->descent;
+}
+
+/*
+	DRAWING
+*/
+
+static void mark_dirty(x11_widget_t* x) {
+	if (!x || x->dirty) return;
+	
+	x->dirty = 1;
+	x->next_dirty = dirty_list;
+	dirty_list = x;
+}
+
+static void unmark_dirty(x11_widget_t* x) {
+	if (!x->dirty) return;
+	
+	for (x11_widget_t** it = &dirty_list; *it; it = &(*it)->next_dirty) {
+		if (*it != x) continue;
+		*it = x->next_dirty;
+		break;
+	}
+	
+	x->dirty = 0;
+}
+
+static void unmark_resize(x11_widget_t* x) {
+	if (!x->resize_pending) return;
+	
+	for (x11_widget_t** it = &resize_list; *it; it = &(*it)->next_resize) {
+		if (*it != x) continue;
+		*it = x->next_resize;
+		break;
+	}
+	
+	x->resize_pending = 0;
+}
+
+static void color(int index) {
+	XSetForeground(display, gc, colors[index]);
+}
+
+static void fill(Window window, int x, int y, int w, int h) {
+	if (w > 0 && h > 0) XFillRectangle(display, window, gc, x, y, w, h);
+}
+
+// draws a 3d border, raised or sunken
+static void bevel(Window window, int x, int y, int w, int h, char raised) {
+	if (w < 2 || h < 2) return;
+	
+	color(raised ? COLOR_LIGHT : COLOR_SHADOW);
+	XDrawLine(display, window, gc, x, y, x + w - 1, y);
+	XDrawLine(display, window, gc, x, y, x, y + h - 1);
+	
+	color(raised ? COLOR_SHADOW : COLOR_LIGHT);
+	XDrawLine(display, window, gc, x + w - 1, y, x + w - 1, y + h - 1);
+	XDrawLine(display, window, gc, x, y + h - 1, x + w - 1, y + h - 1);
+}
+
+// draws text with its top left corner at x, y
+static void text(Window window, int x, int y, const char* string, int length) {
+	XDrawString(display, window, gc, x, y + font->ascent, string, length);
+}
+
+static void text_centered(Window window, int w, int h, const char* string) {
+	int length = strlen(string);
+	text(window,
+		(w - text_width(string, length)) / 2,
+		(h - text_height()) / 2,
+		string, length);
+}
+
+static void free_pixmap(void* pixmap) {
+	if (display) XFreePixmap(display, (Pixmap)(uintptr_t)pixmap);
+}
+
+// uploads the image, the first time that anything draws it
+static Pixmap image_pixmap(perse_image_t* image) {
+	if (!image || image->state != PERSE_IMAGE_READY) return None;
+	if (image->system) return (Pixmap)(uintptr_t)image->system;
+	
+	int depth = DefaultDepth(display, screen);
+	XImage* pixels = XCreateImage(display, DefaultVisual(display, screen), depth,
+		ZPixmap, 0, NULL, image->width, image->height, 32, 0);
+	if (!pixels) return None;
+	
+	pixels->data = malloc((size_t)pixels->bytes_per_line * image->height);
+	
+	unsigned char face[3] = {0xd4, 0xd0, 0xc8};	// same as COLOR_FACE
+	const unsigned char* src = image->pixels;
+	for (int y = 0; y < image->height; y++) {
+		for (int x = 0; x < image->width; x++, src += 4) {
+			int c[3];
+			for (int i = 0; i < 3; i++) {
+				c[i] = (src[i] * src[3] + face[i] * (255 - src[3]) + 127) / 255;
+			}
+			XPutPixel(pixels, x, y, rgb(c[0], c[1], c[2]));
+		}
+	}
+	
+	Pixmap pixmap = XCreatePixmap(display, RootWindow(display, screen),
+		image->width, image->height, depth);
+	XPutImage(display, pixmap, gc, pixels, 0, 0, 0, 0, image->width, image->height);
+	XDestroyImage(pixels);
+	
+	image->system = (void*)(uintptr_t)pixmap;
+	image->destroy_system = free_pixmap;
+	
+	return pixmap;
+}
+
+// centers the image in the box, or draws a frame if it isn't decoded yet
+static void draw_image(Window window, int x, int y, int w, int h, perse_image_t* image) {
+	Pixmap pixmap = image_pixmap(image);
+	if (!pixmap) {
+		bevel(window, x, y, w, h, 0);
+		return;
+	}
+	
+	int left = x + (w - image->width) / 2;
+	int top = y + (h - image->height) / 2;
+	
+	// cut down to the box, in case the image got bigger than it
+	int src_x = left < x ? x - left : 0;
+	int src_y = top < y ? y - top : 0;
+	int copy_w = image->width - src_x < w ? image->width - src_x : w;
+	int copy_h = image->height - src_y < h ? image->height - src_y : h;
+	
+	if (copy_w > 0 && copy_h > 0) {
+		XCopyArea(display, pixmap, window, gc, src_x, src_y, copy_w, copy_h,
+			left + src_x, top + src_y);
+	}
+}
+
+static perse_image_t* bitmap_prop(perse_widget_t* widg) {
+	perse_property_t* p = prop(PERSE_NAME_BITMAP, widg);
+	return p && p->type == PERSE_TYPE_IMAGE ? p->image : NULL;
+}
+
+static void draw_button(x11_widget_t* x) {
+	color(COLOR_FACE);
+	fill(x->window, 0, 0, x->w, x->h);
+	bevel(x->window, 0, 0, x->w, x->h, !x->pressed);
+	
+	color(COLOR_TEXT);
+	text_centered(x->window, x->w, x->h, string_prop(PERSE_NAME_TEXT, x->widget, ""));
+}
+
+// the image moves with the face of the button when it is pressed
+static void draw_image_button(x11_widget_t* x) {
+	color(COLOR_FACE);
+	fill(x->window, 0, 0, x->w, x->h);
+	bevel(x->window, 0, 0, x->w, x->h, !x->pressed);
+	
+	int inset = PERSE_IMAGE_BUTTON_PADDING;
+	draw_image(x->window, inset + x->pressed, inset + x->pressed,
+		x->w - inset * 2, x->h - inset * 2, bitmap_prop(x->widget));
+}
+
+static void draw_label(x11_widget_t* x) {
+	const char* string = string_prop(PERSE_NAME_TEXT, x->widget, "");
+	
+	XClearWindow(display, x->window);
+	color(COLOR_TEXT);
+	text(x->window, 0, (x->h - text_height()) / 2, string, strlen(string));
+}
+
+static void draw_text_box(x11_widget_t* x) {
+	color(COLOR_FIELD);
+	fill(x->window, 0, 0, x->w, x->h);
+	bevel(x->window, 0, 0, x->w, x->h, 0);
+	
+	int top = (x->h - text_height()) / 2;
+	
+	if (!x->length && focused != x) {
+		const char* hint = string_prop(PERSE_NAME_HINT, x->widget, "");
+		color(COLOR_HINT);
+		text(x->window, 4, top, hint, strlen(hint));
+		return;
+	}
+	
+	// keep the caret in view, text boxes scroll horizontally
+	int caret = text_width(x->text, x->caret);
+	int shift = caret > x->w - 8 ? caret - (x->w - 8) : 0;
+	
+	color(COLOR_TEXT);
+	text(x->window, 4 - shift, top, x->text, x->length);
+	
+	if (focused == x) {
+		XDrawLine(display, x->window, gc,
+			4 - shift + caret, top, 4 - shift + caret, top + text_height() - 1);
+	}
+}
+
+static int list_row() {
+	return text_height() + LIST_PADDING;
+}
+
+static void draw_list_box(x11_widget_t* x) {
+	color(COLOR_FIELD);
+	fill(x->window, 0, 0, x->w, x->h);
+	
+	int row = list_row();
+	int index = 0;
+	for (perse_widget_t* item = x->widget->child; item; item = item->next, index++) {
+		int y = 2 + (index - x->scroll) * row;
+		if (index < x->scroll) continue;
+		if (y > x->h) break;
+		
+		if (index == x->selected) {
+			color(COLOR_SELECTION);
+			fill(x->window, 2, y, x->w - 4, row);
+			color(COLOR_SELECTED_TEXT);
+		} else {
+			color(COLOR_TEXT);
+		}
+		
+		const char* title = string_prop(PERSE_NAME_TITLE, item, "");
+		text(x->window, 4, y + LIST_PADDING / 2, title, strlen(title));
+	}
+	
+	bevel(x->window, 0, 0, x->w, x->h, 0);
+}
+
+// tabs are laid out from the left, each as wide as its text
+static int tab_width(perse_widget_t* panel) {
+	const char* title = string_prop(PERSE_NAME_TEXT, panel, "");
+	return text_width(title, strlen(title)) + 2 * TAB_PADDING;
+}
+
+static void draw_tab_group(x11_widget_t* x) {
+	XClearWindow(display, x->window);
+	
+	int selected = integer_prop(PERSE_NAME_SELECTED, x->widget);
+	
+	bevel(x->window, 0, TAB_HEADER - 2, x->w, x->h - TAB_HEADER + 2, 1);
+	
+	int left = 0;
+	int index = 0;
+	for (perse_widget_t* panel = x->widget->child; panel; panel = panel->next, index++) {
+		int w = tab_width(panel);
+		int top = index == selected ? 0 : 2;
+		
+		color(COLOR_FACE);
+		fill(x->window, left + 1, top + 1, w - 2, TAB_HEADER - top);
+		bevel(x->window, left, top, w, TAB_HEADER - top, 1);
+		
+		// the selected tab is open to its panel
+		if (index == selected) {
+			color(COLOR_FACE);
+			fill(x->window, left + 1, TAB_HEADER - 2, w - 2, 2);
+		}
+		
+		const char* title = string_prop(PERSE_NAME_TEXT, panel, "");
+		color(COLOR_TEXT);
+		text(x->window, left + TAB_PADDING, top + (TAB_HEADER - top - text_height()) / 2,
+			title, strlen(title));
+		
+		left += w;
+	}
+}
+
+static void draw_status_bar(x11_widget_t* x) {
+	const char* string = string_prop(PERSE_NAME_TEXT, x->widget, "");
+	
+	XClearWindow(display, x->window);
+	bevel(x->window, 0, 0, x->w, x->h, 0);
+	color(COLOR_TEXT);
+	text(x->window, 4, (x->h - text_height()) / 2, string, strlen(string));
+}
+
+// a `w` below zero damages all of the canvas
+static void damage_canvas(x11_widget_t* x, int left, int top, int w, int h) {
+	if (!x) return;
+	
+	// rectangles that X gets are 16 bit, so they can't go far outside
+	int right = left + w < x->w ? left + w : x->w;
+	int bottom = top + h < x->h ? top + h : x->h;
+	if (left < 0) left = 0;
+	if (top < 0) top = 0;
+	
+	if (w < 0 || x->damage_count == PERSE_DRAW_DAMAGE) {
+		x->damage_count = -1;
+	} else if (x->damage_count >= 0 && right > left && bottom > top) {
+		XRectangle r = {left, top, right - left, bottom - top};
+		x->damage[x->damage_count++] = r;
+	}
+	
+	mark_dirty(x);
+}
+
+static char damaged(x11_widget_t* x, perse_draw_rect_t r) {
+	if (x->damage_count < 0) return 1;
+	
+	for (int i = 0; i < x->damage_count; i++) {
+		XRectangle d = x->damage[i];
+		if (r.x < d.x + d.width && d.x < r.x + r.w && r.y < d.y + d.height && d.y < r.y + r.h) {
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+// clips to the damage, and also to `within`, if there is one
+static void clip_canvas(x11_widget_t* x, const perse_draw_rect_t* within) {
+	XRectangle all = {0, 0, x->w, x->h};
+	XRectangle* damage = x->damage_count < 0 ? &all : x->damage;
+	int count = x->damage_count < 0 ? 1 : x->damage_count;
+	
+	XRectangle clip[PERSE_DRAW_DAMAGE];
+	for (int i = 0; i < count; i++) {
+		clip[i] = damage[i];
+		if (!within) continue;
+		
+		int left = within->x > clip[i].x ? within->x : clip[i].x;
+		int top = within->y > clip[i].y ? within->y : clip[i].y;
+		int right = within->x + within->w < clip[i].x + clip[i].width ?
+			within->x + within->w : clip[i].x + clip[i].width;
+		int bottom = within->y + within->h < clip[i].y + clip[i].height ?
+			within->y + within->h : clip[i].y + clip[i].height;
+		
+		XRectangle r = {left, top, right > left ? right - left : 0, bottom > top ? bottom - top : 0};
+		clip[i] = r;
+	}
+	
+	XSetClipRectangles(display, gc, 0, 0, clip, count, Unsorted);
+}
+
+// replays the commands that overlap the damage, clipped to it
+static void draw_canvas(x11_widget_t* x) {
+	if (!x->damage_count) return;
+	
+	clip_canvas(x, NULL);
+	
+	color(COLOR_FIELD);
+	fill(x->window, 0, 0, x->w, x->h);
+	
+	perse_property_t* p = prop(PERSE_NAME_DRAW, x->widget);
+	for (int i = 0; p && p->type == PERSE_TYPE_DRAW_LIST && i < p->draw_list->count; i++) {
+		const perse_draw_command_t* c = &p->draw_list->command[i];
+		
+		perse_draw_rect_t r = perse_DrawBounds(c);
+		if (!damaged(x, r)) continue;
+		
+		XSetForeground(display, gc, rgb(c->color >> 16, (c->color >> 8) & 255, c->color & 255));
+		
+		switch (c->type) {
+			case PERSE_DRAW_LINE:
+				XDrawLine(display, x->window, gc, c->x, c->y, c->x + c->w, c->y + c->h);
+				break;
+			case PERSE_DRAW_RECT:
+				if (c->w > 0 && c->h > 0) {
+					XDrawRectangle(display, x->window, gc, c->x, c->y, c->w - 1, c->h - 1);
+				}
+				break;
+			case PERSE_DRAW_FILL:
+				fill(x->window, c->x, c->y, c->w, c->h);
+				break;
+			case PERSE_DRAW_TEXT:
+				clip_canvas(x, &r);
+				text(x->window, c->x, c->y, c->text, strlen(c->text));
+				clip_canvas(x, NULL);
+				break;
+			case PERSE_DRAW_IMAGE:
+				clip_canvas(x, &r);
+				draw_image(x->window, c->x, c->y, c->w, c->h, c->image);
+				clip_canvas(x, NULL);
+				break;
+		}
+	}
+	
+	XSetClipMask(display, gc, None);
+	x->damage_count = 0;
+}
+
+static void draw(x11_widget_t* x) {
+	switch (x->widget->type) {
+		case PERSE_WIDGET_TEXT_BUTTON: draw_button(x); break;
+		case PERSE_WIDGET_IMAGE_BUTTON: draw_image_button(x); break;
+		case PERSE_WIDGET_LABEL: draw_label(x); break;
+		case PERSE_WIDGET_TEXT_BOX: draw_text_box(x); break;
+		case PERSE_WIDGET_LIST_BOX: draw_list_box(x); break;
+		case PERSE_WIDGET_TAB_GROUP: draw_tab_group(x); break;
+		case PERSE_WIDGET_STATUS_BAR: draw_status_bar(x); break;
+		case PERSE_WIDGET_CANVAS: draw_canvas(x); break;
+		case PERSE_WIDGET_IMAGE:
+			XClearWindow(display, x->window);
+			draw_image(x->window, 0, 0, x->w, x->h, bitmap_prop(x->widget));
+			break;
+		default: break;
+	}
+}
+
+// draws everything that changed or was exposed since the last frame
+static void draw_dirty() {
+	while (dirty_list) {
+		x11_widget_t* x = dirty_list;
+		dirty_list = x->next_dirty;
+		x->dirty = 0;
+		
+		if (x->map_pending) {
+			XMapWindow(display, x->window);
+			x->map_pending = 0;
+		}
+		
+		draw(x);
+	}
+}
+
+/*
+	EVENTS
+*/
+
+static void notify_resize(x11_widget_t* x) {
+	perse_widget_t* widget = x->widget;
+	int resize_w = x->resize_w;
+	int resize_h = x->resize_h;
+	
+	if (widget->current_size.w == resize_w && widget->current_size.h == resize_h) {
+		return;
+	}
+	
+	widget->constraint_size.min.w = resize_w;
+	widget->constraint_size.max.w = resize_w;
+	
+	widget->constraint_size.min.h = resize_h;
+	widget->constraint_size.max.h = resize_h;
+	
+	widget->current_size.w = resize_w;
+	widget->current_size.h = resize_h;
+	widget->actual_size.w = resize_w;
+	widget->actual_size.h = resize_h;
+	
+	x->w = resize_w;
+	x->h = resize_h;
+	
+	perse_property_t* p = prop(PERSE_NAME_ON_RESIZE, widget);
+	if (!p) {
+		log(PERSE_LOG_ERROR, "X11:: window has no ON_RESIZE\n");
+	} else if (p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "X11:: window ON_RESIZE wrong type\n");
+	} else {
+		p->callback(widget, NULL);
+	}
+}
+
+// each window that was resized gets laid out on its own
+static void notify_resizes() {
+	while (resize_list) {
+		x11_widget_t* x = resize_list;
+		resize_list = x->next_resize;
+		x->resize_pending = 0;
+		
+		notify_resize(x);
+	}
+}
+
+static void notify_drag() {
+	drag_pending = 0;
+	
+	perse_widget_t* pane = child_from_index(drag_splitter, drag_index);
+	if (!pane) return;
+	
+	perse_property_t* p = prop(PERSE_NAME_ON_DRAG, drag_splitter);
+	if (p && p->type != PERSE_TYPE_CALLBACK) {
+		log(PERSE_LOG_ERROR, "X11:: splitter on drag wrong type\n");
+	} else if (p) {
+		perse_property_t* position = perse_CreatePropertyInteger(drag_offset);
+		p->callback(pane, position);
+		perse_DestroyProperty(position);
+	}
+}
+
+static void focus(x11_widget_t* x) {
+	if (focused == x) return;
+	
+	mark_dirty(focused);
+	focused = x;
+	mark_dirty(focused);
+	
+	if (x) XSetInputFocus(display, x->window, RevertToParent, CurrentTime);
+}
+
+static void text_changed(x11_widget_t* x) {
+	mark_dirty(x);
+	
+	perse_property_t* text = perse_CreatePropertyString(x->text);
+	call(PERSE_NAME_ON_CHANGE, x->widget, text);
+	perse_DestroyProperty(text);
+}
+
+static void set_text(x11_widget_t* x, const char* string) {
+	int length = strlen(string);
+	
+	if (length + 1 > x->capacity) {
+		x->capacity = length + 32;
+		x->text = realloc(x->text, x->capacity);
+	}
+	
+	memcpy(x->text, string, length + 1);
+	x->length = length;
+	if (x->caret > length) x->caret = length;
+}
+
+static void insert_text(x11_widget_t* x, const char* string, int length) {
+	if (x->length + length + 1 > x->capacity) {
+		x->capacity = (x->length + length + 1) * 2;
+		x->text = realloc(x->text, x->capacity);
+	}
+	
+	memmove(x->text + x->caret + length, x->text + x->caret, x->length - x->caret + 1);
+	memcpy(x->text + x->caret, string, length);
+	x->length += length;
+	x->caret += length;
+}
+
+static void text_box_key(x11_widget_t* x, XKeyEvent* event) {
+	char buffer[32];
+	KeySym key;
+	int length = XLookupString(event, buffer, sizeof(buffer), &key, NULL);
+	
+	char read_only = boolean_prop(PERSE_NAME_READ_ONLY, x->widget);
+	
+	switch (key) {
+		case XK_Return:
+		case XK_KP_Enter:
+			call(PERSE_NAME_ON_SUBMIT, x->widget, NULL);
+			return;
+		case XK_Left:
+			if (x->caret > 0) x->caret--;
+			mark_dirty(x);
+			return;
+		case XK_Right:
+			if (x->caret < x->length) x->caret++;
+			mark_dirty(x);
+			return;
+		case XK_Home:
+			x->caret = 0;
+			mark_dirty(x);
+			return;
+		case XK_End:
+			x->caret = x->length;
+			mark_dirty(x);
+			return;
+		case XK_BackSpace:
+			if (read_only || !x->caret) return;
+			memmove(x->text + x->caret - 1, x->text + x->caret, x->length - x->caret + 1);
+			x->caret--;
+			x->length--;
+			text_changed(x);
+			return;
+		case XK_Delete:
+			if (read_only || x->caret == x->length) return;
+			memmove(x->text + x->caret, x->text + x->caret + 1, x->length - x->caret);
+			x->length--;
+			text_changed(x);
+			return;
+	}
+	
+	if (read_only || length <= 0 || (unsigned char)buffer[0] < ' ' || buffer[0] == 127) {
+		return;
+	}
+	
+	insert_text(x, buffer, length);
+	text_changed(x);
+}
+
+static void list_box_click(x11_widget_t* x, int y) {
+	int index = x->scroll + (y - 2) / list_row();
+	
+	perse_widget_t* item = child_from_index(x->widget, index);
+	if (!item) return;
+	
+	perse_widget_t* widget = x->widget;
+	
+	x->selected = index;
+	mark_dirty(x);
+	
+	call_integer(PERSE_NAME_ON_SELECT, widget, PERSE_NAME_SELECTED, index);
+	call(PERSE_NAME_ON_CLICK, item, NULL);
+}
+
+static void list_box_scroll(x11_widget_t* x, int rows) {
+	int count = 0;
+	for (perse_widget_t* item = x->widget->child; item; item = item->next) count++;
+	
+	int visible = (x->h - 4) / list_row();
+	int last = count - visible;
+	
+	x->scroll += rows;
+	if (x->scroll > last) x->scroll = last;
+	if (x->scroll < 0) x->scroll = 0;
+	
+	mark_dirty(x);
+}
+
+static void tab_group_click(x11_widget_t* x, int click_x, int click_y) {
+	if (click_y >= TAB_HEADER) return;
+	
+	int left = 0;
+	int index = 0;
+	for (perse_widget_t* panel = x->widget->child; panel; panel = panel->next, index++) {
+		left += tab_width(panel);
+		if (click_x >= left) continue;
+		
+		// the library lays out and creates the panel and then sets SELECTED,
+		// which is where the panels get switched
+		call_integer(PERSE_NAME_ON_SELECT, x->widget, PERSE_NAME_SELECTED, index);
+		return;
+	}
+}
+
+static void scroll_to(perse_widget_t* widget, perse_name_t name, int offset) {
+	call_integer(PERSE_NAME_ON_SCROLL, widget, name, offset);
+}
+
+// finds which of the splitter's dividers a window is
+static int divider_index(x11_widget_t* x, Window window) {
+	for (int i = 0; i < x->dividers; i++) {
+		if (x->divider[i] == window) return i;
+	}
+	return -1;
+}
+
+static char splitter_vertical(perse_widget_t* splitter) {
+	return boolean_prop(PERSE_NAME_VERTICAL, splitter);
+}
+
+static void splitter_motion(perse_widget_t* splitter, Window window, XMotionEvent* event) {
+	x11_widget_t* x = data(splitter);
+	
+	int index = divider_index(x, window);
+	if (index < 0) return;
+	
+	// dividers are placed in the container's window, same as the win32 ones
+	int divider_x, divider_y;
+	perse_widget_t* pane = child_from_index(splitter, index);
+	if (!pane) return;
+	
+	if (splitter_vertical(splitter)) {
+		divider_y = pane->absolute.y + pane->current_size.h;
+		drag_offset = divider_y + event->y - splitter->actual_pos.y;
+	} else {
+		divider_x = pane->absolute.x + pane->current_size.w;
+		drag_offset = divider_x + event->x - splitter->actual_pos.x;
+	}
+	
+	drag_splitter = splitter;
+	drag_index = index;
+	drag_pending = 1;
+}
+
+static void handle_event(XEvent* event) {
+	perse_widget_t* widget = NULL;
+	if (XFindContext(display, event->xany.window, context, (XPointer*)&widget)) {
+		return;
+	}
+	
+	// ignore events for widgets that are being taken apart
+	x11_widget_t* x = data(widget);
+	if (!x || !widget->system) return;
+	
+	switch (event->type) {
+		case Expose:
+			if (widget->type == PERSE_WIDGET_CANVAS) {
+				damage_canvas(x, event->xexpose.x, event->xexpose.y,
+					event->xexpose.width, event->xexpose.height);
+				break;
+			}
+			mark_dirty(x);
+			break;
+		
+		case ConfigureNotify:
+			if (widget->type != PERSE_WIDGET_WINDOW) break;
+			x->resize_w = event->xconfigure.width;
+			x->resize_h = event->xconfigure.height;
+			if (!x->resize_pending) {
+				x->resize_pending = 1;
+				x->next_resize = resize_list;
+				resize_list = x;
+			}
+			break;
+		
+		case ClientMessage:
+			if (event->xclient.message_type == wm_protocols &&
+				(Atom)event->xclient.data.l[0] == wm_delete_window) {
+				log(PERSE_LOG_DEBUG, "X11:: received WM_DELETE_WINDOW\n");
+				
+				// a window with ON_CLOSE is left to the program, which can
+				// take it out of the tree or keep it. the other windows are
+				// still in the tree, so they are only hidden, until the
+				// program takes them out
+				if (prop(PERSE_NAME_ON_CLOSE, widget)) {
+					call(PERSE_NAME_ON_CLOSE, widget, NULL);
+				} else if (widget == main_window_widg) {
+					should_quit = 1;
+				} else {
+					XUnmapWindow(display, x->window);
+				}
+			}
+			break;
+		
+		case ButtonPress:
+			switch (event->xbutton.button) {
+				// wheel
+				case Button4:
+				case Button5: {
+					int direction = event->xbutton.button == Button4 ? -1 : 1;
+					
+					if (widget->type == PERSE_WIDGET_LIST_BOX) {
+						list_box_scroll(x, direction * 3);
+						break;
+					}
+					
+					// the wheel scrolls the closest scroll panel
+					perse_widget_t* panel = widget;
+					while (panel && panel->type != PERSE_WIDGET_SCROLL_PANEL) {
+						panel = panel->parent;
+					}
+					if (!panel) break;
+					
+					int pos = integer_prop(PERSE_NAME_SCROLL_Y, panel);
+					scroll_to(panel, PERSE_NAME_SCROLL_Y, pos + direction * 3 * WHEEL_LINE);
+				} break;
+				
+				case Button1:
+					switch (widget->type) {
+						case PERSE_WIDGET_TEXT_BUTTON:
+						case PERSE_WIDGET_IMAGE_BUTTON:
+							x->pressed = 1;
+							mark_dirty(x);
+							break;
+						case PERSE_WIDGET_TEXT_BOX:
+							focus(x);
+							break;
+						case PERSE_WIDGET_LIST_BOX:
+							list_box_click(x, event->xbutton.y);
+							break;
+						case PERSE_WIDGET_TAB_GROUP:
+							tab_group_click(x, event->xbutton.x, event->xbutton.y);
+							break;
+						default:
+							break;
+					}
+					break;
+			}
+			break;
+		
+		case ButtonRelease:
+			if (event->xbutton.button != Button1) break;
+			
+			if ((widget->type == PERSE_WIDGET_TEXT_BUTTON ||
+				widget->type == PERSE_WIDGET_IMAGE_BUTTON) && x->pressed) {
+				x->pressed = 0;
+				mark_dirty(x);
+				
+				// only counts as a click if it was let go over the button
+				if (event->xbutton.x >= 0 && event->xbutton.x < x->w &&
+					event->xbutton.y >= 0 && event->xbutton.y < x->h) {
+					perse_property_t* p = prop(PERSE_NAME_ON_CLICK, widget);
+					if (!p) {
+						log(PERSE_LOG_ERROR, "X11:: button on click missing\n");
+					} else {
+						call(PERSE_NAME_ON_CLICK, widget, NULL);
+					}
+				}
+			}
+			
+			if (widget->type == PERSE_WIDGET_SPLITTER_LAYOUT && drag_pending) {
+				notify_drag();
+			}
+			break;
+		
+		case MotionNotify:
+			if (widget->type == PERSE_WIDGET_SPLITTER_LAYOUT) {
+				splitter_motion(widget, event->xmotion.window, &event->xmotion);
+			}
+			break;
+		
+		case KeyPress:
+			if (widget->type == PERSE_WIDGET_TEXT_BOX) {
+				text_box_key(x, &event->xkey);
+			}
+			break;
+	}
+}
+
+PERSE_API void perse_impl_BackendSetLogger(perse_log_t fn) {
+	logger = fn;
+}
+
+// waits until there are events, or until perse_impl_BackendWake()
+static void wait_for_events() {
+	if (XEventsQueued(display, QueuedAfterReading)) return;
+	
+	int connection = ConnectionNumber(display);
+	
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(connection, &readable);
+	if (wake_pipe[0] >= 0) FD_SET(wake_pipe[0], &readable);
+	
+	int highest = connection > wake_pipe[0] ? connection : wake_pipe[0];
+	if (select(highest + 1, &readable, NULL, NULL, NULL) <= 0) return;
+	
+	if (wake_pipe[0] >= 0 && FD_ISSET(wake_pipe[0], &readable)) {
+		char drained[64];
+		while (read(wake_pipe[0], drained, sizeof(drained)) > 0);
+	}
+}
+
+PERSE_API void perse_impl_BackendProcessEvents() {
+	open_display();
+	
+	draw_dirty();
+	
+	// the only flush of the frame, everything before this was buffered
+	XFlush(display);
+	
+	wait_for_events();
+	
+	// handle everything that has arrived, without flushing
+	XEvent event;
+	while (XEventsQueued(display, QueuedAfterReading)) {
+		XNextEvent(display, &event);
+		handle_event(&event);
+	}
+	
+	if (drag_pending) notify_drag();
+	notify_resizes();
+}
+
+PERSE_API int perse_impl_BackendShouldQuit() {
+	return should_quit;
+}
+
+// creating X windows is cheap, so there is nothing to pool
+PERSE_API void perse_impl_BackendSetPoolLimit(int limit) {}
+PERSE_API void perse_impl_BackendTrimPool(int keep) {}
+
+// called from the image decoding thread, so this only writes to the pipe
+PERSE_API void perse_impl_BackendWake() {
+	if (wake_pipe[1] < 0) return;
+	
+	// if the pipe is full, it is going to wake up anyway
+	char wake = 1;
+	ssize_t written = write(wake_pipe[1], &wake, 1);
+	(void)written;
+}
+
+PERSE_API perse_size_t perse_impl_BackendMeasure(perse_widget_t* widget) {
+	perse_size_t size = {-1, -1};
+	
+	open_display();
+	
+	const char* string = string_prop(PERSE_NAME_TEXT, widget, "");
+	
+	int w = text_width(string, strlen(string));
+	int h = text_height();
+	
+	// same room for borders as in the win32 backend
+	switch (widget->type) {
+		case PERSE_WIDGET_LABEL:
+			size.w = w;
+			size.h = h;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BUTTON:
+			size.w = w + 16;
+			size.h = h + 10;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			size.h = h + 8;
+			break;
+		
+		default:
+			break;
+	}
+	
+	return size;
+}
+
+/*
+	WIDGETS
+*/
+
+static x11_widget_t* allocate(perse_widget_t* widget) {
+	x11_widget_t* x = calloc(1, sizeof(x11_widget_t));
+	x->widget = widget;
+	x->x = widget->actual_pos.x;
+	x->y = widget->actual_pos.y;
+	x->w = widget->current_size.w > 0 ? widget->current_size.w : 1;
+	x->h = widget->current_size.h > 0 ? widget->current_size.h : 1;
+	widget->data = x;
+	return x;
+}
+
+// creates a window for a widget in the window of another widget
+static Window create_window(x11_widget_t* x, Window parent, long events, Cursor cursor, char map) {
+	XSetWindowAttributes attributes;
+	attributes.background_pixel = colors[COLOR_FACE];
+	attributes.event_mask = events | ExposureMask;
+	attributes.cursor = cursor;
+	
+	unsigned long mask = CWBackPixel | CWEventMask;
+	if (cursor != None) mask |= CWCursor;
+	
+	Window window = XCreateWindow(display, parent,
+		x->x, x->y, x->w, x->h,
+		0, CopyFromParent, InputOutput, CopyFromParent,
+		mask, &attributes);
+	
+	XSaveContext(display, window, context, (XPointer)x->widget);
+	
+	if (map) XMapWindow(display, window);
+	
+	return window;
+}
+
+static void create_child(perse_widget_t* widget, long events, char map) {
+	perse_widget_t* parent = container(widget);
+	if (!parent || !data(parent)) {
+		log(PERSE_LOG_ERROR, "X11:: widget type %i has no window to go in\n", widget->type);
+		return;
+	}
+	
+	x11_widget_t* x = allocate(widget);
+	x->window = create_window(x, data(parent)->window, events, None, map);
+	widget->system = (void*)x->window;
+	
+	// nothing is drawn yet, what gets drawn into a window that isn't visible
+	// is lost. the server sends an Expose once it is
+}
+
+static void create_top_level(perse_widget_t* widget) {
+	x11_widget_t* x = allocate(widget);
+	
+	// positions below zero are left to the window manager
+	if (x->x < 0) x->x = 0;
+	if (x->y < 0) x->y = 0;
+	
+	x->window = create_window(x, RootWindow(display, screen),
+		StructureNotifyMask, None, 0);
+	widget->system = (void*)x->window;
+	
+	XStoreName(display, x->window, string_prop(PERSE_NAME_TITLE, widget, "libperse window"));
+	XSetWMProtocols(display, x->window, &wm_delete_window, 1);
+	
+	if (widget->actual_pos.x >= 0 && widget->actual_pos.y >= 0) {
+		XSizeHints hints = {0};
+		hints.flags = USPosition;
+		hints.x = x->x;
+		hints.y = x->y;
+		XSetWMNormalHints(display, x->window, &hints);
+	}
+	
+	// the first one is the main window, the rest only get added next to it
+	if (!main_window_widg) main_window_widg = widget;
+	
+	// gets mapped after its children are created, so that it shows up with
+	// everything already in it
+	x->map_pending = 1;
+	mark_dirty(x);
+}
+
+// makes sure that there is a divider in between each pair of panes
+static void sync_dividers(perse_widget_t* splitter) {
+	x11_widget_t* x = data(splitter);
+	perse_widget_t* parent = container(splitter);
+	if (!parent || !data(parent)) return;
+	
+	int count = -1;
+	for (perse_widget_t* c = splitter->child; c; c = c->next) count++;
+	if (count < 0) count = 0;
+	
+	for (int i = count; i < x->dividers; i++) {
+		XDeleteContext(display, x->divider[i], context);
+		XDestroyWindow(display, x->divider[i]);
+	}
+	
+	char vertical = splitter_vertical(splitter);
+	
+	if (count > x->dividers) {
+		x->divider = realloc(x->divider, sizeof(Window) * count);
+		
+		for (int i = x->dividers; i < count; i++) {
+			XSetWindowAttributes attributes;
+			attributes.background_pixel = colors[COLOR_FACE];
+			attributes.event_mask = ButtonPressMask | ButtonReleaseMask | Button1MotionMask;
+			attributes.cursor = vertical ? cursor_ns : cursor_we;
+			
+			x->divider[i] = XCreateWindow(display, data(parent)->window,
+				0, 0, 1, 1, 0, CopyFromParent, InputOutput, CopyFromParent,
+				CWBackPixel | CWEventMask | CWCursor, &attributes);
+			
+			XSaveContext(display, x->divider[i], context, (XPointer)splitter);
+			XMapWindow(display, x->divider[i]);
+		}
+	}
+	
+	x->dividers = count;
+	
+	// dividers fill the gaps between the panes
+	perse_widget_t* pane = splitter->child;
+	for (int i = 0; i < count; i++, pane = pane->next) {
+		perse_widget_t* next = pane->next;
+		int dx, dy, dw, dh;
+		
+		if (vertical) {
+			dx = splitter->absolute.x;
+			dy = pane->absolute.y + pane->current_size.h;
+			dw = splitter->current_size.w;
+			dh = next->absolute.y - dy;
+		} else {
+			dx = pane->absolute.x + pane->current_size.w;
+			dy = splitter->absolute.y;
+			dw = next->absolute.x - dx;
+			dh = splitter->current_size.h;
+		}
+		
+		XMoveResizeWindow(display, x->divider[i], dx, dy,
+			dw > 0 ? dw : 1, dh > 0 ? dh : 1);
+	}
+}
+
+static void show_selected_tab(perse_widget_t* widget) {
+	int selected = integer_prop(PERSE_NAME_SELECTED, widget);
+	
+	int index = 0;
+	for (perse_widget_t* c = widget->child; c; c = c->next, index++) {
+		if (!data(c)) continue;
+		
+		if (index == selected) {
+			XMapWindow(display, data(c)->window);
+		} else {
+			XUnmapWindow(display, data(c)->window);
+		}
+	}
+	
+	mark_dirty(data(widget));
+}
+
+PERSE_API void perse_impl_BackendCreateWidget(perse_widget_t* widget) {
+	open_display();
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_INVALID:
+			log(PERSE_LOG_ERROR, "X11:: BackendCreateWidget passed in an INVALID\n");
+			break;
+		
+		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT:
+		case PERSE_WIDGET_VERTICAL_LAYOUT:
+		case PERSE_WIDGET_GRID_LAYOUT:
+		case PERSE_WIDGET_FLOW_LAYOUT:
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			// layouts don't have windows
+			break;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			allocate(widget);
+			widget->system = (void*)(long long)1; // dummy value
+			sync_dividers(widget);
+			break;
+		
+		case PERSE_WIDGET_WINDOW:
+			create_top_level(widget);
+			break;
+		
+		case PERSE_WIDGET_ITEM:
+			// items are drawn by their list box
+			if (widget->parent && widget->parent->type == PERSE_WIDGET_LIST_BOX) {
+				mark_dirty(data(widget->parent));
+				widget->system = (void*)(long long)1; // dummy value
+			} else {
+				log(PERSE_LOG_DEBUG, "X11:: items only go in list boxes\n");
+			}
+			break;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			create_child(widget, ButtonPressMask, 1);
+			break;
+		
+		case PERSE_WIDGET_TAB_PANEL: {
+			perse_widget_t* group = widget->parent;
+			if (!group || group->type != PERSE_WIDGET_TAB_GROUP || !data(group)) {
+				log(PERSE_LOG_ERROR, "X11:: TAB_PANEL not in a TAB_GROUP\n");
+				break;
+			}
+			
+			// only the selected panel gets to be visible. panels are created
+			// after the group, so they stack on top of it
+			char selected = index_in_parent(widget) == integer_prop(PERSE_NAME_SELECTED, group);
+			create_child(widget, ButtonPressMask, selected);
+			mark_dirty(data(group));
+		} break;
+		
+		case PERSE_WIDGET_SCROLL_PANEL:
+			create_child(widget, ButtonPressMask, 1);
+			break;
+		
+		case PERSE_WIDGET_STATUS_BAR:
+		case PERSE_WIDGET_LABEL:
+			create_child(widget, 0, 1);
+			break;
+		
+		case PERSE_WIDGET_TEXT_BUTTON:
+		case PERSE_WIDGET_IMAGE_BUTTON:
+			create_child(widget, ButtonPressMask | ButtonReleaseMask, 1);
+			break;
+		
+		case PERSE_WIDGET_LIST_BOX:
+			create_child(widget, ButtonPressMask, 1);
+			if (data(widget)) data(widget)->selected = -1;
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			create_child(widget, ButtonPressMask | KeyPressMask, 1);
+			if (data(widget)) set_text(data(widget), string_prop(PERSE_NAME_TEXT, widget, ""));
+			break;
+		
+		case PERSE_WIDGET_IMAGE:
+		case PERSE_WIDGET_CANVAS:
+			create_child(widget, 0, 1);
+			break;
+		
+		default:
+			log(PERSE_LOG_DEBUG, "X11:: widget type %i not supported\n", widget->type);
+			break;
+	}
+}
+
+// lets go of everything that we have for a widget, without telling the server
+static void forget(perse_widget_t* widget) {
+	x11_widget_t* x = data(widget);
+	
+	if (x) {
+		unmark_dirty(x);
+		unmark_resize(x);
+		if (focused == x) focused = NULL;
+		if (drag_splitter == widget) drag_pending = 0;
+		if (main_window_widg == widget) main_window_widg = NULL;
+		
+		for (int i = 0; i < x->dividers; i++) {
+			XDeleteContext(display, x->divider[i], context);
+		}
+		if (x->window) XDeleteContext(display, x->window, context);
+		
+		free(x->divider);
+		free(x->text);
+		free(x);
+	}
+	
+	widget->data = NULL;
+	widget->system = NULL;
+}
+
+// the library usually destroys children first, but a widget that gets
+// replaced goes before its children. the windows of everything inside of it
+// go away along with its window, so its children are only forgotten
+static void forget_children(perse_widget_t* widget) {
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		forget_children(c);
+		if (c->type != PERSE_WIDGET_ITEM) forget(c);
+	}
+}
+
+PERSE_API void perse_impl_BackendDestroyWidget(perse_widget_t* widget) {
+	x11_widget_t* x = data(widget);
+	
+	if (widget->type == PERSE_WIDGET_ITEM) {
+		if (widget->parent) mark_dirty(data(widget->parent));
+		widget->system = NULL;
+		return;
+	}
+	
+	if (!x) {
+		widget->system = NULL;
+		return;
+	}
+	
+	if (widget->type == PERSE_WIDGET_TAB_PANEL && widget->parent) {
+		mark_dirty(data(widget->parent));
+	}
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_WINDOW:
+		case PERSE_WIDGET_SCROLL_PANEL:
+		case PERSE_WIDGET_TAB_PANEL:
+			forget_children(widget);
+			break;
+		default:
+			break;
+	}
+	
+	for (int i = 0; i < x->dividers; i++) {
+		XDestroyWindow(display, x->divider[i]);
+	}
+	
+	if (x->window) XDestroyWindow(display, x->window);
+	
+	forget(widget);
+}
+
+PERSE_API void perse_impl_BackendSetProperty(perse_widget_t* widget, perse_property_t* p) {
+	x11_widget_t* x = data(widget);
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_WINDOW:
+			if (x && p->name == PERSE_NAME_TITLE && p->type == PERSE_TYPE_STRING) {
+				XStoreName(display, x->window, p->string);
+			}
+			break;
+		
+		case PERSE_WIDGET_ITEM:
+			if (widget->parent) mark_dirty(data(widget->parent));
+			break;
+		
+		case PERSE_WIDGET_TAB_PANEL:
+			if (widget->parent) mark_dirty(data(widget->parent));
+			break;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			if (x && p->name == PERSE_NAME_SELECTED) show_selected_tab(widget);
+			break;
+		
+		case PERSE_WIDGET_TEXT_BOX:
+			// the text that the user typed comes back, which isn't a change
+			if (x && p->name == PERSE_NAME_TEXT && p->type == PERSE_TYPE_STRING &&
+				strcmp(x->text ? x->text : "", p->string) != 0) {
+				set_text(x, p->string);
+				mark_dirty(x);
+			}
+			if (p->name == PERSE_NAME_HINT) mark_dirty(x);
+			break;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			if (x && p->name == PERSE_NAME_VERTICAL) sync_dividers(widget);
+			break;
+		
+		case PERSE_WIDGET_CANVAS:
+			if (p->name == PERSE_NAME_DRAW && p->type == PERSE_TYPE_DRAW_LIST &&
+				p->draw_list->damage_count >= 0) {
+				perse_draw_list_t* list = p->draw_list;
+				for (int i = 0; i < list->damage_count; i++) {
+					perse_draw_rect_t d = list->damage[i];
+					damage_canvas(x, d.x, d.y, d.w, d.h);
+				}
+			} else {
+				damage_canvas(x, 0, 0, -1, -1);
+			}
+			break;
+		
+		default:
+			mark_dirty(x);
+			break;
+	}
+}
+
+PERSE_API void perse_impl_BackendSetSizePos(perse_widget_t* widget) {
+	x11_widget_t* x = data(widget);
+	if (!x) return;
+	
+	switch (widget->type) {
+		// the user sizes top-level windows
+		case PERSE_WIDGET_WINDOW:
+			return;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			sync_dividers(widget);
+			return;
+		
+		default:
+			break;
+	}
+	
+	int w = widget->current_size.w > 0 ? widget->current_size.w : 1;
+	int h = widget->current_size.h > 0 ? widget->current_size.h : 1;
+	
+	// nothing gets sent if nothing moved, the server exposes what needs it
+	if (x->x == widget->actual_pos.x && x->y == widget->actual_pos.y &&
+		x->w == w && x->h == h) {
+		return;
+	}
+	
+	x->x = widget->actual_pos.x;
+	x->y = widget->actual_pos.y;
+	x->w = w;
+	x->h = h;
+	
+	XMoveResizeWindow(display, x->window, x->x, x->y, x->w, x->h);
+}
+
+static const perse_backend_t backend = {
+	.version = PERSE_BACKEND_VERSION,
+	.size = sizeof(perse_backend_t),
+	
+	.create_widget = perse_impl_BackendCreateWidget,
+	.destroy_widget = perse_impl_BackendDestroyWidget,
+	.set_property = perse_impl_BackendSetProperty,
+	.set_size_pos = perse_impl_BackendSetSizePos,
+	
+	.process_events = perse_impl_BackendProcessEvents,
+	.should_quit = perse_impl_BackendShouldQuit,
+	
+	.set_logger = perse_impl_BackendSetLogger,
+	
+	.measure = perse_impl_BackendMeasure,
+	
+	.wake = perse_impl_BackendWake,
+};
+
+// the library checks the version, see backend.c
+PERSE_API const perse_backend_t* perse_impl_GetBackend(int version) {
+	return &backend;
+}
+
+// when linked statically, the library's property.c is already in the program
+#ifndef PERSE_STATIC_BACKEND
+#include "../../library/property.c"
+#endif
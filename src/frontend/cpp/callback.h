@@ -0,0 +1,142 @@
+#ifndef PERSE_CPP_CALLBACK
+#define PERSE_CPP_CALLBACK
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace perse {
+
+/*
+	Callback is like std::function, except that the callable is kept inside of
+	the Callback itself, as long as it fits in CALLBACK_BUFFER bytes. Lambdas
+	that capture a few values and setters from UseState() fit, so building a
+	widget tree doesn't allocate for each callback.
+
+	Anything bigger is still accepted, but gets put on the heap.
+*/
+
+constexpr std::size_t CALLBACK_BUFFER = 64;
+
+template<typename Signature>
+class Callback;
+
+template<typename R, typename... A>
+class Callback<R(A...)> {
+public:
+	Callback() = default;
+
+	template<typename F, typename = std::enable_if_t<
+		!std::is_same_v<std::decay_t<F>, Callback> &&
+		std::is_invocable_r_v<R, std::decay_t<F>&, A...>>>
+	Callback(F&& f) {
+		using T = std::decay_t<F>;
+		if constexpr (fits<T>) {
+			new (buffer) T(std::forward<F>(f));
+			ops = &local_ops<T>;
+		} else {
+			*(T**)buffer = new T(std::forward<F>(f));
+			ops = &heap_ops<T>;
+		}
+	}
+
+	Callback(const Callback& other) {
+		if (other.ops) other.ops->copy(buffer, other.buffer);
+		ops = other.ops;
+	}
+
+	Callback(Callback&& other) noexcept {
+		if (other.ops) other.ops->move(buffer, other.buffer);
+		ops = other.ops;
+		other.ops = nullptr;
+	}
+
+	Callback& operator=(const Callback& other) {
+		if (this != &other) {
+			reset();
+			if (other.ops) other.ops->copy(buffer, other.buffer);
+			ops = other.ops;
+		}
+		return *this;
+	}
+
+	Callback& operator=(Callback&& other) noexcept {
+		if (this != &other) {
+			reset();
+			if (other.ops) other.ops->move(buffer, other.buffer);
+			ops = other.ops;
+			other.ops = nullptr;
+		}
+		return *this;
+	}
+
+	~Callback() {
+		reset();
+	}
+
+	R operator()(A... args) const {
+		return ops->invoke((void*)buffer, std::forward<A>(args)...);
+	}
+
+	explicit operator bool() const {
+		return ops;
+	}
+
+	void reset() {
+		if (ops) ops->destroy(buffer);
+		ops = nullptr;
+	}
+private:
+	struct Ops {
+		R (*invoke)(void*, A&&...);
+		void (*copy)(void* dst, const void* src);
+		void (*move)(void* dst, void* src);	// also destroys src
+		void (*destroy)(void*);
+	};
+
+	template<typename T>
+	static constexpr bool fits = sizeof(T) <= CALLBACK_BUFFER
+		&& alignof(T) <= alignof(std::max_align_t)
+		&& std::is_nothrow_move_constructible_v<T>;
+
+	template<typename T>
+	static constexpr Ops local_ops = {
+		[](void* b, A&&... args) -> R {
+			return (*(T*)b)(std::forward<A>(args)...);
+		},
+		[](void* dst, const void* src) {
+			new (dst) T(*(const T*)src);
+		},
+		[](void* dst, void* src) {
+			new (dst) T(std::move(*(T*)src));
+			((T*)src)->~T();
+		},
+		[](void* b) {
+			((T*)b)->~T();
+		}
+	};
+
+	template<typename T>
+	static constexpr Ops heap_ops = {
+		[](void* b, A&&... args) -> R {
+			return (**(T**)b)(std::forward<A>(args)...);
+		},
+		[](void* dst, const void* src) {
+			*(T**)dst = new T(**(T* const*)src);
+		},
+		[](void* dst, void* src) {
+			*(T**)dst = *(T**)src;
+		},
+		[](void* b) {
+			delete *(T**)b;
+		}
+	};
+
+	alignas(std::max_align_t) unsigned char buffer[CALLBACK_BUFFER];
+	const Ops* ops = nullptr;
+};
+
+}
+
+#endif // PERSE_CPP_CALLBACK
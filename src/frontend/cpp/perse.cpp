@@ -1,8 +1,12 @@
 #include "perse.h"
+#include "ref.h"
 
 extern "C" {
 #include "../../library/backend.h"
 #include "../../library/layout.h"
+#include "../../library/stats.h"
+#include "../../library/record.h"
+#include "../../library/snapshot.h"
 }
 
 #include <iostream>
@@ -12,9 +16,19 @@ namespace perse {
 static Widget(*root_func)() = nullptr;
 static perse_widget* current_root = nullptr;
 
-void temp_resize_callback(perse_widget* widget, perse_property*) {
-	std::cout << "resize callback called" << std::endl;
-	if (widget == current_root) Reflow();
+// nothing but the window size has changed, so the want sizes are still good
+// and we can skip straight to sizing and positioning. this is done right away
+// instead of in Wait(), since while the user is dragging the window border
+// the backend can be stuck in its own event loop. the backend throttles these
+// calls to the display rate. with more than one window in an Application, only
+// the window that was resized gets laid out again
+void temp_resize_callback(perse_widget* widget, perse_property* p) {
+	if (widget != current_root && widget->parent != current_root) return;
+	
+	perse_RecordEvent(widget, p);
+	
+	perse_ResizeLayout(widget);
+	perse_ApplyChanges(current_root);
 }
 
 void Init() {
@@ -27,6 +41,8 @@ void SetRoot(Widget(*root)()) {
 
 static bool need_render = false;
 static bool need_reflow = false;
+static bool need_layout = false;
+static bool need_apply = false;
 
 void Render() {
 	need_render = true;
@@ -36,6 +52,15 @@ void Reflow() {
 	need_reflow = true;
 }
 
+// the widget is already changed in the tree, it only has to get to the backend
+void Ref::Changed(bool relayout) {
+	if (relayout) {
+		need_layout = true;
+	} else {
+		need_apply = true;
+	}
+}
+
 // leaving this debug code here until we implement a better tree debug printing
 // function in the C part of the library
 void recurse(perse_widget_t* widg) {
@@ -57,15 +82,57 @@ void recurse(perse_widget_t* widg) {
 	}
 }
 
+void SetWidgetPoolLimit(int limit) {
+	perse_BackendSetPoolLimit(limit);
+}
+
+void TrimWidgetPool(int keep) {
+	perse_BackendTrimPool(keep);
+}
+
+const perse_frame_stats_t& GetFrameStats() {
+	return *perse_GetFrameStats();
+}
+
+bool StartTrace(const char* path) {
+	return perse_StartTrace(path);
+}
+
+void StopTrace() {
+	perse_StopTrace();
+}
+
+bool LoadSnapshot(const char* path) {
+	if (current_root) return false;
+	
+	current_root = perse_LoadSnapshot(path);
+	if (!current_root) return false;
+	
+	// the snapshot has no callbacks, and the user's state might differ from
+	// what it was when the snapshot was saved, so render right away
+	perse_ApplyChanges(current_root);
+	perse_EndFrame();
+	need_render = true;
+	
+	return true;
+}
+
+bool SaveSnapshot(const char* path) {
+	return current_root && perse_SaveSnapshot(current_root, path);
+}
+
 bool Wait() {
 	if (!current_root) {
+		PERSE_STATS_BEGIN(PERSE_PHASE_BUILD);
 		auto root_widg = root_func();
 		current_root = (perse_widget*)root_widg.ptr;
+		PERSE_STATS_END(PERSE_PHASE_BUILD);
 		
 		//recurse(current_root);
 		
 		perse_CalculateLayout(current_root);
 		perse_ApplyChanges(current_root);
+		perse_EndFrame();
 	}
 	
 	perse_BackendProcessEvents();
@@ -74,9 +141,14 @@ bool Wait() {
 		return false;
 	}
 	
+	// decoded images only need their widgets applied again, see layout.c
+	bool images = perse_UpdateImages();
+	
 	if (need_render) {
+		PERSE_STATS_BEGIN(PERSE_PHASE_BUILD);
 		auto root_widg = root_func();
 		perse_widget* new_root = (perse_widget*)root_widg.ptr;
+		PERSE_STATS_END(PERSE_PHASE_BUILD);
 
 		//std::cout << "\nprev:" << std::endl;
 		//recurse(current_root);
@@ -87,13 +159,27 @@ bool Wait() {
 		//std::cout << "\nmerged:" << std::endl;
 	}
 	
-	if (need_render || need_reflow) {
+	// an application only lays out the windows that have changed, so for a
+	// reflow all of them have to be changed
+	if (need_reflow && current_root->type == PERSE_WIDGET_APPLICATION) {
+		for (perse_widget* w = current_root->child; w; w = w->next) {
+			w->changed = 1;
+		}
+	}
+	
+	if (need_render || need_reflow || need_layout) {
 		perse_CalculateLayout(current_root);
 		perse_ApplyChanges(current_root);
+		perse_EndFrame();
+	} else if (images || need_apply) {
+		perse_ApplyChanges(current_root);
+		perse_EndFrame();
 	}
 	
 	need_render = false;
 	need_reflow = false;
+	need_layout = false;
+	need_apply = false;
 	
 	return true;
 }
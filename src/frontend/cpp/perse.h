@@ -2,6 +2,11 @@
 #define PERSE_CPP_PERSE
 
 #include "widget.h"
+#include "ref.h"
+
+extern "C" {
+#include "../../library/stats.h"
+}
 
 namespace perse {
 
@@ -14,6 +19,23 @@ void Reflow();
 
 bool Wait();
 
+// the backend keeps destroyed controls around to reuse them, this many at most
+// for each widget type
+void SetWidgetPoolLimit(int limit);
+void TrimWidgetPool(int keep = 0);
+
+// counts for the last frame, all zero unless built with PERSE_STATS
+const perse_frame_stats_t& GetFrameStats();
+
+// call before the first Wait() to show the tree from the last SaveSnapshot()
+// right away, instead of waiting for the first render
+bool LoadSnapshot(const char* path);
+bool SaveSnapshot(const char* path);
+
+// writes frames to a file that can be opened in chrome://tracing
+bool StartTrace(const char* path);
+void StopTrace();
+
 }
 
 #endif // PERSE_CPP_PERSE
\ No newline at end of file
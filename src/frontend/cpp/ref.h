@@ -0,0 +1,57 @@
+#ifndef PERSE_CPP_REF
+#define PERSE_CPP_REF
+
+#include "widget.h"
+#include "schema.h"
+
+namespace perse {
+
+/*
+	A Ref is a handle to a widget that is in the tree, for values that change
+	too often to render the whole tree again for each change, like a progress
+	bar or a counter in the status bar. Bind() it to a widget while building
+	and then Set() any of the fields of its props, e.g.
+	
+		Label({.text = "0 items"}).Bind(status);
+		...
+		status.Set(&LabelProps::text, "1 item");
+	
+	The new value gets to the backend on the next Wait(), without building,
+	merging or, unless the widget gets moved or resized by it, calculating
+	the layout. The next render still overwrites it, so whatever is in the
+	props should be kept up to date as well, if the tree gets rendered again.
+	
+	A Ref follows its widget through merges and goes empty when the widget is
+	destroyed. It is only ever bound to one widget, the last one.
+*/
+
+class Ref {
+public:
+	Ref() = default;
+	~Ref();
+	
+	Ref(const Ref&) = delete;
+	Ref& operator=(const Ref&) = delete;
+	
+	// returns false if the widget isn't in the tree
+	template<typename Props, typename T, typename V>
+	bool Set(Property<T> Props::* field, V&& value) {
+		if (!widget) return false;
+		
+		Changed(schema::Update(widget, field, T(std::forward<V>(value))));
+		return true;
+	}
+	
+	bool Bound() const {
+		return widget;
+	}
+private:
+	static void Changed(bool relayout);
+	
+	perse_widget_t* widget = nullptr;
+	friend class Widget;
+};
+
+}
+
+#endif // PERSE_CPP_REF
\ No newline at end of file
@@ -0,0 +1,532 @@
+#ifndef PERSE_CPP_SCHEMA
+#define PERSE_CPP_SCHEMA
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "widget.h"
+
+extern "C" {
+#include "../../library/widget.h"
+#include "../../library/layout.h"
+#include "../../library/perse.h"
+#include "../../library/record.h"
+#include "../../library/canvas.h"
+}
+
+/*
+	PROPERTY SCHEMA
+	
+	Every *Props struct has a Schema, which lists each of its fields together
+	with where it ends up in the library widget -- either one of the size and
+	position constraints (Geom) or a property with some perse_name_t (Prop).
+	
+	The storage type of a property follows from the C++ type of its field:
+	int and enums become integers, bool becomes boolean, std::string becomes
+	string and std::vector<std::string> becomes a string array. Callbacks are
+	kept in the UserInfo of the widget and the property gets a trampoline that
+	is picked by the name, so each name has a single function pointer and the
+	merge sees them as unchanged.
+	
+	Emit() expands the schema into one store per field at compile time, so a
+	builder is just a sequence of `if (set) store` and nothing is looked up at
+	runtime. A field that is missing from the schema, or a callback name that
+	has no slot, will not compile, instead of being silently dropped.
+	
+	Update() goes through the same schema to set a single field of a widget
+	that is already in the tree, for Ref::Set(). Only the fields of the same
+	type as the value get compared with the field that is being set.
+*/
+
+namespace perse::schema {
+
+enum Geometry {
+	MIN_WIDTH,
+	MIN_HEIGHT,
+	MAX_WIDTH,
+	MAX_HEIGHT,
+	WIDTH,		// sets both min and max
+	HEIGHT,		// ditto
+	X,
+	Y
+};
+
+// where the callbacks of each name are kept in UserInfo
+constexpr int callback_slot(perse_name_t name) {
+	switch (name) {
+		case PERSE_NAME_ON_CLICK:	return 0;
+		case PERSE_NAME_ON_SUBMIT:	return 1;
+		case PERSE_NAME_ON_CHANGE:	return 2;
+		case PERSE_NAME_ON_SELECT:	return 3;
+		case PERSE_NAME_ON_CLOSE:	return 4;
+		default:					return -1;
+	}
+}
+
+constexpr int CALLBACK_SLOTS = 5;
+
+// unpacks the value that the backend passed to the callback
+inline void call(const OnClickCallback& cb, perse_property_t*) {
+	cb();
+}
+
+inline void call(const OnChangeBoolCallback& cb, perse_property_t* v) {
+	if (!v || (v->type != PERSE_TYPE_BOOLEAN && v->type != PERSE_TYPE_INTEGER)) {
+		PERSE_ERROR(PERSE_LOG_FRONTEND, "CPP:: bool callback got non-boolean value\n");
+		return;
+	}
+	cb(v->type == PERSE_TYPE_BOOLEAN ? v->boolean : v->integer);
+}
+
+inline void call(const OnChangeIntCallback& cb, perse_property_t* v) {
+	if (!v || v->type != PERSE_TYPE_INTEGER) {
+		PERSE_ERROR(PERSE_LOG_FRONTEND, "CPP:: int callback got non-integer value\n");
+		return;
+	}
+	cb(v->integer);
+}
+
+inline void call(const OnChangeStringCallback& cb, perse_property_t* v) {
+	if (!v || v->type != PERSE_TYPE_STRING) {
+		PERSE_ERROR(PERSE_LOG_FRONTEND, "CPP:: string callback got non-string value\n");
+		return;
+	}
+	cb(v->string);
+}
+
+inline void call(const std::monostate&, perse_property_t*) {}
+
+typedef std::variant<std::monostate,
+                     OnClickCallback,
+                     OnChangeBoolCallback,
+                     OnChangeIntCallback,
+                     OnChangeStringCallback> AnyCallback;
+
+struct UserInfo {
+	AnyCallback callbacks[CALLBACK_SLOTS];
+};
+
+/*
+	A new tree is built for every frame and every widget in it that has a
+	callback gets a UserInfo. During the merge, the callbacks are moved into
+	the UserInfo that the widget already has, and the new UserInfo goes back
+	on the free list when the new tree is destroyed, so after the first frame
+	they are just reused.
+*/
+
+inline std::vector<std::unique_ptr<UserInfo>> free_userinfo;
+
+inline void destroy_userinfo(void* user) {
+	UserInfo* info = (UserInfo*)user;
+	for (auto& cb : info->callbacks) cb = std::monostate();
+	free_userinfo.emplace_back(info);
+}
+
+inline void merge_userinfo(void* dst, void* src) {
+	UserInfo* old_info = (UserInfo*)dst;
+	UserInfo* new_info = (UserInfo*)src;
+	for (int i = 0; i < CALLBACK_SLOTS; i++) {
+		old_info->callbacks[i] = std::move(new_info->callbacks[i]);
+	}
+}
+
+inline UserInfo* get_userinfo(perse_widget_t* widget) {
+	if (!widget->user) {
+		if (free_userinfo.empty()) {
+			widget->user = new UserInfo;
+		} else {
+			widget->user = free_userinfo.back().release();
+			free_userinfo.pop_back();
+		}
+		widget->destroy = destroy_userinfo;
+		widget->merge_user = merge_userinfo;
+	}
+	
+	return (UserInfo*)widget->user;
+}
+
+template<perse_name_t Name>
+void trampoline(perse_widget_t* widget, perse_property_t* value) {
+	perse_RecordEvent(widget, value);
+	std::visit([value](const auto& cb){ call(cb, value); },
+		((UserInfo*)widget->user)->callbacks[callback_slot(Name)]);
+}
+
+template<typename T> struct is_callback : std::false_type {};
+template<typename S> struct is_callback<Callback<S>> : std::true_type {};
+
+template<typename T> struct dependent_false : std::false_type {};
+
+template<perse_name_t Name, typename T>
+perse_property_t* create(perse_widget_t* widget, const T& value) {
+	if constexpr (std::is_same_v<T, bool>) {
+		return perse_CreatePropertyBoolean(value);
+	} else if constexpr (std::is_same_v<T, int> || std::is_enum_v<T>) {
+		return perse_CreatePropertyInteger((int)value);
+	} else if constexpr (std::is_same_v<T, std::string>) {
+		return perse_CreatePropertyString(value.c_str());
+	} else if constexpr (std::is_same_v<T, std::vector<std::string>>) {
+		std::vector<const char*> strings;
+		strings.reserve(value.size() + 1);
+		for (const auto& s : value) strings.push_back(s.c_str());
+		strings.push_back(nullptr);
+		return perse_CreatePropertyStringArray(strings.data());
+	} else if constexpr (std::is_same_v<T, DrawCallback>) {
+		// also a Callback, but called right away instead of being kept
+		perse_property_t* p = perse_CreatePropertyDrawList();
+		Painter painter(p->draw_list);
+		if (value) value(painter);
+		return p;
+	} else if constexpr (is_callback<T>::value) {
+		static_assert(callback_slot(Name) >= 0, "no UserInfo slot for this callback name");
+		get_userinfo(widget)->callbacks[callback_slot(Name)] = value;
+		return perse_CreatePropertyCallback(trampoline<Name>);
+	} else {
+		static_assert(dependent_false<T>::value, "no property type for this field");
+	}
+}
+
+template<auto Member, perse_name_t Name>
+struct Prop {
+	template<typename Props>
+	static void store(perse_widget_t* widget, const Props& props) {
+		const auto& field = props.*Member;
+		if (!field.set()) return;
+		
+		perse_property_t* p = create<Name>(widget, field.get());
+		p->name = Name;
+		perse_AddProperty(widget, p);
+	}
+	
+	// returns 1 if the layout has to be calculated again, -1 if `field` is
+	// some other field
+	template<typename Props, typename T>
+	static int update(perse_widget_t* widget, Property<T> Props::* field, const T& value) {
+		if constexpr (std::is_same_v<decltype(Member), Property<T> Props::*>) {
+			if (field != Member) return -1;
+			
+			perse_property_t* p = create<Name>(widget, value);
+			p->name = Name;
+			return perse_UpdateProperty(widget, p);
+		} else {
+			return -1;
+		}
+	}
+};
+
+template<auto Member, Geometry Target>
+struct Geom {
+	static void put(perse_range_t& c, perse_position_t& position, int value) {
+		if constexpr (Target == MIN_WIDTH)	c.min.w = value;
+		if constexpr (Target == MIN_HEIGHT)	c.min.h = value;
+		if constexpr (Target == MAX_WIDTH)	c.max.w = value;
+		if constexpr (Target == MAX_HEIGHT)	c.max.h = value;
+		if constexpr (Target == WIDTH)		c.min.w = c.max.w = value;
+		if constexpr (Target == HEIGHT)		c.min.h = c.max.h = value;
+		if constexpr (Target == X)			position.x = value;
+		if constexpr (Target == Y)			position.y = value;
+	}
+	
+	template<typename Props>
+	static void store(perse_widget_t* widget, const Props& props) {
+		const auto& field = props.*Member;
+		if (!field.set()) return;
+		
+		put(widget->constraint_size, widget->position, field.get());
+	}
+	
+	template<typename Props, typename T>
+	static int update(perse_widget_t* widget, Property<T> Props::* field, const T& value) {
+		if constexpr (std::is_same_v<decltype(Member), Property<T> Props::*>) {
+			if (field != Member) return -1;
+			
+			perse_range_t c = widget->constraint_size;
+			perse_position_t position = widget->position;
+			put(c, position, value);
+			
+			return perse_UpdateGeometry(widget, c, position);
+		} else {
+			return -1;
+		}
+	}
+};
+
+template<typename... F>
+struct Fields {
+	static constexpr std::size_t count = sizeof...(F);
+	
+	template<typename Props>
+	static void emit(perse_widget_t* widget, const Props& props) {
+		(F::store(widget, props), ...);
+	}
+	
+	// stops at the first field that matches
+	template<typename Props, typename T>
+	static bool update(perse_widget_t* widget, Property<T> Props::* field, const T& value) {
+		int relayout = -1;
+		(((relayout = F::update(widget, field, value)) != -1) || ...);
+		return relayout == 1;
+	}
+};
+
+template<typename A, typename B> struct Join;
+template<typename... A, typename... B>
+struct Join<Fields<A...>, Fields<B...>> {
+	using type = Fields<A..., B...>;
+};
+
+// number of fields in an aggregate, by trying to brace initialize it with
+// more and more arguments
+struct any_field {
+	template<typename T> operator Property<T>() const;
+};
+
+template<typename Props, typename... A>
+constexpr std::size_t field_count() {
+	if constexpr (requires { Props{A{}..., any_field{}}; }) {
+		return field_count<Props, A..., any_field>();
+	} else {
+		return sizeof...(A);
+	}
+}
+
+// fields shared by all of the widgets that go into layouts
+template<typename P>
+using Layout = Fields<
+	Geom<&P::min_width, MIN_WIDTH>,
+	Geom<&P::min_height, MIN_HEIGHT>,
+	Geom<&P::max_width, MAX_WIDTH>,
+	Geom<&P::max_height, MAX_HEIGHT>,
+	Geom<&P::width, WIDTH>,
+	Geom<&P::height, HEIGHT>,
+	Geom<&P::x, X>,
+	Geom<&P::y, Y>,
+	Prop<&P::stretch, PERSE_NAME_STRETCH>,
+	Prop<&P::shrink, PERSE_NAME_SHRINK>,
+	Prop<&P::basis, PERSE_NAME_BASIS>,
+	Prop<&P::row, PERSE_NAME_ROW>,
+	Prop<&P::col, PERSE_NAME_COLUMN>,
+	Prop<&P::row_span, PERSE_NAME_ROW_SPAN>,
+	Prop<&P::col_span, PERSE_NAME_COLUMN_SPAN>
+>;
+
+template<typename P, typename... F>
+using LayoutAnd = typename Join<Layout<P>, Fields<F...>>::type;
+
+template<typename Props> struct Schema;
+
+template<> struct Schema<ArrowButtonProps> {
+	using P = ArrowButtonProps;
+	using type = LayoutAnd<P,
+		Prop<&P::dir, PERSE_NAME_DIRECTION>,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::onclick, PERSE_NAME_ON_CLICK>
+	>;
+};
+
+template<> struct Schema<ButtonProps> {
+	using P = ButtonProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::onclick, PERSE_NAME_ON_CLICK>
+	>;
+};
+
+template<> struct Schema<ImageButtonProps> {
+	using P = ImageButtonProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::image, PERSE_NAME_IMAGE>,
+		Prop<&P::onclick, PERSE_NAME_ON_CLICK>
+	>;
+};
+
+template<> struct Schema<TextFieldProps> {
+	using P = TextFieldProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::hint, PERSE_NAME_HINT>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::readonly, PERSE_NAME_READ_ONLY>,
+		Prop<&P::onchange, PERSE_NAME_ON_CHANGE>,
+		Prop<&P::onsubmit, PERSE_NAME_ON_SUBMIT>
+	>;
+};
+
+template<> struct Schema<TextAreaProps> {
+	using P = TextAreaProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::hint, PERSE_NAME_HINT>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::readonly, PERSE_NAME_READ_ONLY>,
+		Prop<&P::onchange, PERSE_NAME_ON_CHANGE>,
+		Prop<&P::onsubmit, PERSE_NAME_ON_SUBMIT>
+	>;
+};
+
+template<> struct Schema<LabelProps> {
+	using P = LabelProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>
+	>;
+};
+
+template<> struct Schema<CheckBoxProps> {
+	using P = CheckBoxProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::value, PERSE_NAME_VALUE>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::onclick, PERSE_NAME_ON_CLICK>
+	>;
+};
+
+template<> struct Schema<RadioButtonProps> {
+	using P = RadioButtonProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>,
+		Prop<&P::value, PERSE_NAME_VALUE>,
+		Prop<&P::enabled, PERSE_NAME_ENABLED>,
+		Prop<&P::index, PERSE_NAME_INDEX>,
+		Prop<&P::group, PERSE_NAME_GROUP>,
+		Prop<&P::onclick, PERSE_NAME_ON_CLICK>
+	>;
+};
+
+template<> struct Schema<ComboBoxProps> {
+	using P = ComboBoxProps;
+	using type = LayoutAnd<P,
+		Prop<&P::items, PERSE_NAME_ITEMS>,
+		Prop<&P::value, PERSE_NAME_SELECTED>,
+		Prop<&P::onselect, PERSE_NAME_ON_SELECT>
+	>;
+};
+
+template<> struct Schema<ListBoxProps> {
+	using P = ListBoxProps;
+	using type = LayoutAnd<P,
+		Prop<&P::onselect, PERSE_NAME_ON_SELECT>
+	>;
+};
+
+template<> struct Schema<ImageProps> {
+	using P = ImageProps;
+	using type = LayoutAnd<P,
+		Prop<&P::image, PERSE_NAME_IMAGE>
+	>;
+};
+
+template<> struct Schema<CanvasProps> {
+	using P = CanvasProps;
+	using type = LayoutAnd<P,
+		Prop<&P::draw, PERSE_NAME_DRAW>
+	>;
+};
+
+template<> struct Schema<TabGroupProps> {
+	using P = TabGroupProps;
+	using type = LayoutAnd<P,
+		Prop<&P::unmount_after, PERSE_NAME_UNMOUNT_AFTER>
+	>;
+};
+
+// tab panels have no dimensions, since their dimensions are set by the parent
+// tab group
+template<> struct Schema<TabPanelProps> {
+	using P = TabPanelProps;
+	using type = Fields<
+		Prop<&P::text, PERSE_NAME_TEXT>
+	>;
+};
+
+template<> struct Schema<GroupPanelProps> {
+	using P = GroupPanelProps;
+	using type = LayoutAnd<P,
+		Prop<&P::text, PERSE_NAME_TEXT>
+	>;
+};
+
+template<> struct Schema<ItemProps> {
+	using P = ItemProps;
+	using type = Fields<
+		Prop<&P::title, PERSE_NAME_TITLE>,
+		Geom<&P::width, WIDTH>,
+		Prop<&P::onclick, PERSE_NAME_ON_CLICK>
+	>;
+};
+
+template<> struct Schema<AbsoluteLayoutProps> {
+	using type = Layout<AbsoluteLayoutProps>;
+};
+
+template<> struct Schema<GridLayoutProps> {
+	using P = GridLayoutProps;
+	using type = LayoutAnd<P,
+		Prop<&P::rows, PERSE_NAME_ROWS>,
+		Prop<&P::columns, PERSE_NAME_COLUMNS>
+	>;
+};
+
+template<> struct Schema<SplitterLayoutProps> {
+	using P = SplitterLayoutProps;
+	using type = LayoutAnd<P,
+		Prop<&P::vertical, PERSE_NAME_VERTICAL>
+	>;
+};
+
+template<> struct Schema<FlexLayoutProps> {
+	using P = FlexLayoutProps;
+	using type = LayoutAnd<P,
+		Prop<&P::vertical, PERSE_NAME_VERTICAL>,
+		Prop<&P::wrap, PERSE_NAME_WRAP>,
+		Prop<&P::justify, PERSE_NAME_JUSTIFY>,
+		Prop<&P::align, PERSE_NAME_ALIGN>
+	>;
+};
+
+// windows are always the size that is set
+template<> struct Schema<WindowProps> {
+	using P = WindowProps;
+	using type = Fields<
+		Geom<&P::width, WIDTH>,
+		Geom<&P::height, HEIGHT>,
+		Geom<&P::x, X>,
+		Geom<&P::y, Y>,
+		Prop<&P::title, PERSE_NAME_TITLE>,
+		Prop<&P::onclose, PERSE_NAME_ON_CLOSE>
+	>;
+};
+
+/// Allocates a widget and stores the set fields of `props` in it.
+template<typename Props>
+perse_widget_t* Emit(perse_widget_type_t type, const Props& props) {
+	using fields = typename Schema<Props>::type;
+	static_assert(fields::count == field_count<Props>(),
+		"every field of the props has to be in its schema");
+	
+	perse_widget_t* widget = perse_AllocateWidget();
+	widget->type = type;
+	
+	fields::emit(widget, props);
+	
+	return widget;
+}
+
+/// Sets one field of the props of a widget that is already in the tree.
+/// @return true if the layout has to be calculated again.
+template<typename Props, typename T>
+bool Update(perse_widget_t* widget, Property<T> Props::* field, const T& value) {
+	return Schema<Props>::type::update(widget, field, value);
+}
+
+}
+
+#endif // PERSE_CPP_SCHEMA
@@ -1,41 +1,20 @@
 
-#include <map>
-
 #include "widget.h"
+#include "schema.h"
+#include "ref.h"
 
 extern "C" {
 #include "../../library/widget.h"
-#include "../../library/perse.h"
+#include "../../library/layout.h"
+#include "../../library/canvas.h"
 }
 
 namespace perse {
 
-Widget::Widget(Property<int>& min_w, Property<int>& min_h,
-	           Property<int>& max_w, Property<int>& max_h,
-		       Property<int>& w, Property<int>& h,
-		       Property<int>& x, Property<int>& y, void** ptr) {
-	perse_widget* widget = perse_AllocateWidget();
-	
-	if (min_w.set()) widget->constraint_size.min.w = min_w;
-	if (min_h.set()) widget->constraint_size.min.h = min_h;
-	if (max_w.set()) widget->constraint_size.max.w = max_w;
-	if (max_h.set()) widget->constraint_size.max.h = max_h;
-	
-	if (w.set()) {
-		widget->constraint_size.min.w = w;
-		widget->constraint_size.max.w = w;
-	}
-	
-	if (h.set()) {
-		widget->constraint_size.min.h = h;
-		widget->constraint_size.max.h = h;
-	}
-	
-	if (x.set()) widget->position.x = x;
-	if (y.set()) widget->position.y = y;
-	
-	this->ptr = widget;
-	*ptr = widget;
+using schema::Emit;
+
+Widget::Widget(void* widget) {
+	ptr = widget;
 }
 
 Widget::Widget() {
@@ -72,292 +51,196 @@ Widget& Widget::operator<<(std::vector<Widget> children) {
 	return *this;
 }
 
-#define INIT_WIDGET(WIDGTYPE) \
-	perse_widget* widget; \
-	Widget widget_class(props.min_width, props.min_height, \
-	                    props.max_width, props.max_height, \
-	                    props.width, props.height, props.x, props.y, (void**)&widget); \
-	widget->type = WIDGTYPE;
-
-static void add_prop(perse_widget* widget, perse_name_t name,
-                     Property<int> value) {
-	if (!value.set()) return;
-	perse_property_t* p = perse_CreatePropertyInteger(value);
-	p->name = name;
-	perse_AddProperty(widget, p);
+Widget& Widget::Bind(Ref& ref) {
+	if (!ptr) return *this;
+	
+	// a ref is only ever bound to one widget, see layout.c
+	if (ref.widget && ref.widget->ref == &ref.widget) {
+		ref.widget->ref = nullptr;
+	}
+	
+	ref.widget = (perse_widget*)ptr;
+	ref.widget->ref = &ref.widget;
+	
+	return *this;
 }
 
-static void add_prop(perse_widget* widget, perse_name_t name,
-                     Property<bool> value) {
-	if (!value.set()) return;
-	perse_property_t* p = perse_CreatePropertyBoolean(value);
-	p->name = name;
-	perse_AddProperty(widget, p);
+Ref::~Ref() {
+	if (widget && widget->ref == &widget) widget->ref = nullptr;
 }
 
-static void add_prop(perse_widget* widget, perse_name_t name,
-                     Property<std::string> value) {
-	if (!value.set()) return;
-	perse_property_t* p = perse_CreatePropertyString(value.get().c_str());
-	p->name = name;
-	perse_AddProperty(widget, p);
+Painter::Painter(void* list) {
+	this->list = list;
 }
 
-/*
-	TODO: use type safe union (std::variant) to roll all add_prop() into one
-	also change all the UserInfo callbacks into that type safe union type
-*/
+void Painter::Line(int x1, int y1, int x2, int y2, unsigned color) {
+	perse_DrawLine((perse_draw_list_t*)list, x1, y1, x2, y2, color);
+}
 
-struct UserInfo {
-	OnClickCallback onclick;
-	OnClickCallback onsubmit;
-	
-	OnChangeStringCallback onchange_str;
-};
-
-static UserInfo* get_userinfo(perse_widget* widget) {
-	UserInfo* info;
-	if (widget->user) {
-		info = (UserInfo*)widget->user;
-	} else {
-		info = new UserInfo;
-		widget->user = info;
-		widget->destroy = [](void* user){
-			delete (UserInfo*)user;
-		};
-	}
-	
-	return info;
+void Painter::Rect(int x, int y, int w, int h, unsigned color) {
+	perse_DrawRect((perse_draw_list_t*)list, x, y, w, h, color);
 }
 
-static void add_prop(perse_widget* widget, perse_name_t name,
-                     Property<OnClickCallback> value) {
-	if (!value.set()) return;
-	
-	UserInfo* info = get_userinfo(widget);
-	
-	perse_property_t* p;
-	switch (name) {
-		case PERSE_NAME_ON_CLICK:
-			info->onclick = value;
-			p = perse_CreatePropertyCallback([](perse_widget_t* w, perse_property_t*){
-				((UserInfo*)w->user)->onclick();
-			});
-		case PERSE_NAME_ON_SUBMIT:
-			info->onsubmit = value;
-			p = perse_CreatePropertyCallback([](perse_widget_t* w, perse_property_t*){
-				((UserInfo*)w->user)->onsubmit();
-			});
-		break;
-		default:
-			perse_Log("CPP:: unknwn CALLBACK enum for OnClickCallback: %i\n", name);
-			abort();
-	}
-	
-	p->name = name;
-	perse_AddProperty(widget, p);
+void Painter::Fill(int x, int y, int w, int h, unsigned color) {
+	perse_FillRect((perse_draw_list_t*)list, x, y, w, h, color);
 }
 
-static void add_prop(perse_widget* widget, perse_name_t name,
-                     Property<OnChangeStringCallback> value) {
-	if (!value.set()) return;
-	
-	UserInfo* info = get_userinfo(widget);
-	
-	perse_property_t* p;
-	switch (name) {
-		case PERSE_NAME_ON_CHANGE:
-			info->onchange_str = value;
-			p = perse_CreatePropertyCallback([](perse_widget_t* w, perse_property_t* v){
-				if (v->type != PERSE_TYPE_STRING) {
-					perse_Log("CPP:: property change callback got non-string for"
-					"add_prop(..., Property<OnChangeStringCallback>) function");
-					abort();
-				}
-				((UserInfo*)w->user)->onchange_str(v->string);
-			});
-		break;
-		default:
-			perse_Log("CPP:: unknwn CALLBACK enum for OnChangeStringCallback: %i\n", name);
-			abort();
-	}
-	
-	p->name = name;
-	perse_AddProperty(widget, p);
+void Painter::Text(int x, int y, int w, int h, const std::string& text, unsigned color) {
+	perse_DrawText((perse_draw_list_t*)list, x, y, w, h, color, text.c_str());
 }
 
+void Painter::Image(int x, int y, int w, int h, const std::string& path) {
+	perse_DrawImage((perse_draw_list_t*)list, x, y, w, h, path.c_str());
+}
 
 Widget ArrowButton(ArrowButtonProps props) {
-	INIT_WIDGET(PERSE_WIDGET_ARROW_BUTTON)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_ARROW_BUTTON, props));
 }
 
 Widget Button(ButtonProps props) {
-	INIT_WIDGET(PERSE_WIDGET_TEXT_BUTTON)
-	
-	add_prop(widget, PERSE_NAME_TEXT, props.text);
-	add_prop(widget, PERSE_NAME_ENABLED, props.enabled);
-	add_prop(widget, PERSE_NAME_ON_CLICK, props.onclick);
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_TEXT_BUTTON, props));
 }
 
 Widget ImageButton(ImageButtonProps props) {
-	INIT_WIDGET(PERSE_WIDGET_IMAGE_BUTTON)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_IMAGE_BUTTON, props));
 }
 
 Widget TextField(TextFieldProps props) {
-	INIT_WIDGET(PERSE_WIDGET_TEXT_BOX)
-	
-	add_prop(widget, PERSE_NAME_TEXT, props.text);
-	add_prop(widget, PERSE_NAME_ON_CHANGE, props.onchange);
-	add_prop(widget, PERSE_NAME_ON_SUBMIT, props.onsubmit);
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_TEXT_BOX, props));
 }
 
 Widget TextArea(TextAreaProps props) {
-	INIT_WIDGET(PERSE_WIDGET_TEXT_AREA)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_TEXT_AREA, props));
 }
 
 Widget Label(LabelProps props) {
-	INIT_WIDGET(PERSE_WIDGET_LABEL)
-	add_prop(widget, PERSE_NAME_TEXT, props.text);
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_LABEL, props));
 }
 
 Widget CheckBox(CheckBoxProps props) {
-	INIT_WIDGET(PERSE_WIDGET_CHECK_BOX)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_CHECK_BOX, props));
 }
 
 Widget RadioButton(RadioButtonProps props) {
-	INIT_WIDGET(PERSE_WIDGET_RADIO_BUTTON)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_RADIO_BUTTON, props));
 }
 
 Widget ComboBox(ComboBoxProps props) {
-	INIT_WIDGET(PERSE_WIDGET_COMBO_BOX)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_COMBO_BOX, props));
 }
 
 Widget ListBox(ListBoxProps props) {
-	INIT_WIDGET(PERSE_WIDGET_LIST_BOX)
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_LIST_BOX, props));
+}
+
+Widget Image(ImageProps props) {
+	return Widget(Emit(PERSE_WIDGET_IMAGE, props));
+}
+
+Widget Canvas(CanvasProps props) {
+	return Widget(Emit(PERSE_WIDGET_CANVAS, props));
 }
 
 Widget TabGroup(TabGroupProps props) {
-	INIT_WIDGET(PERSE_WIDGET_TAB_GROUP)
+	perse_widget* widget = Emit(PERSE_WIDGET_TAB_GROUP, props);
 	
-	return widget_class;
+	// hidden tabs are created when they are first selected, so the library
+	// has to know when that happens
+	perse_property_t* p = perse_CreatePropertyCallback(perse_TabGroupSelect);
+	p->name = PERSE_NAME_ON_SELECT;
+	perse_AddProperty(widget, p);
+	
+	return Widget(widget);
 }
 
 Widget TabPanel(TabPanelProps props) {
-	perse_widget* widget;
-	Property<int> unset;
-	Widget widget_class(unset, unset, unset, unset,
-	                    unset, unset, unset, unset,
-	                    (void**)&widget);
-	widget->type = PERSE_WIDGET_TAB_PANEL;
-	
-	// tab panels have no dimensions, since their dimensions are set by the
-	// parent tab group
-	
-	add_prop(widget, PERSE_NAME_TEXT, props.text);
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_TAB_PANEL, props));
 }
 
 Widget GroupPanel(GroupPanelProps props) {
-	INIT_WIDGET(PERSE_WIDGET_GROUP_PANEL)
+	return Widget(Emit(PERSE_WIDGET_GROUP_PANEL, props));
+}
+
+Widget ScrollPanel(AbsoluteLayoutProps props) {
+	perse_widget* widget = Emit(PERSE_WIDGET_SCROLL_PANEL, props);
+	
+	// scrolling is handled entirely in the library, same as splitter dragging
+	perse_property_t* p = perse_CreatePropertyCallback(perse_ScrollPanelScroll);
+	p->name = PERSE_NAME_ON_SCROLL;
+	perse_AddProperty(widget, p);
 	
-	return widget_class;
+	return Widget(widget);
 }
 
 
 Widget Item(ItemProps props) {
-	Property<int> d;
-	
-	perse_widget* widget;
-	
-	// didn't really think this one through..
-	Widget widget_class(d, d, d, d, props.width, d, d, d, (void**)&widget);
-	widget->type = PERSE_WIDGET_ITEM;
-	
-	add_prop(widget, PERSE_NAME_TITLE, props.title);
-	add_prop(widget, PERSE_NAME_ON_CLICK, props.onclick);
-	
 	// we'll also add icons, etc. later
 	
 	// also some kind of data pointer??
 	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_ITEM, props));
 }
 
+// TODO: menu and status bars don't use any of the item props yet
 Widget MenuBar(ItemProps) {
-	Property<int> d;
-	
-	perse_widget* widget;
-	
-	Widget widget_class(d, d, d, d, d, d, d, d, (void**)&widget);
-	widget->type = PERSE_WIDGET_MENU_BAR;
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_MENU_BAR, ItemProps{}));
 }
 
 Widget StatusBar(ItemProps) {
-	Property<int> d;
-	
-	perse_widget* widget;
-	
-	Widget widget_class(d, d, d, d, d, d, d, d, (void**)&widget);
-	widget->type = PERSE_WIDGET_STATUS_BAR;
-	
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_STATUS_BAR, ItemProps{}));
 }
 
 
 Widget AbsoluteLayout(AbsoluteLayoutProps props) {
-	INIT_WIDGET(PERSE_WIDGET_ABSOLUTE_LAYOUT)
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_ABSOLUTE_LAYOUT, props));
 }
 
 Widget HorizontalLayout(AbsoluteLayoutProps props) {
-	INIT_WIDGET(PERSE_WIDGET_HORIZONTAL_LAYOUT)
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_HORIZONTAL_LAYOUT, props));
 }
 Widget VerticalLayout(AbsoluteLayoutProps props) {
-	INIT_WIDGET(PERSE_WIDGET_VERTICAL_LAYOUT)
-	return widget_class;
+	return Widget(Emit(PERSE_WIDGET_VERTICAL_LAYOUT, props));
+}
+
+Widget GridLayout(GridLayoutProps props) {
+	return Widget(Emit(PERSE_WIDGET_GRID_LAYOUT, props));
+}
+
+Widget FlowLayout(AbsoluteLayoutProps props) {
+	return Widget(Emit(PERSE_WIDGET_FLOW_LAYOUT, props));
+}
+
+Widget SplitterLayout(SplitterLayoutProps props) {
+	perse_widget* widget = Emit(PERSE_WIDGET_SPLITTER_LAYOUT, props);
+	
+	// dragging is handled entirely in the library, so that the panes can be
+	// resized without re-rendering
+	perse_property_t* p = perse_CreatePropertyCallback(perse_SplitterDrag);
+	p->name = PERSE_NAME_ON_DRAG;
+	perse_AddProperty(widget, p);
+	
+	return Widget(widget);
+}
+
+Widget FlexLayout(FlexLayoutProps props) {
+	return Widget(Emit(PERSE_WIDGET_FLEX_LAYOUT, props));
 }
 
 void temp_resize_callback(perse_widget*, perse_property*);
 
 Widget Window(WindowProps props) {
-	perse_widget* widget;
-	Widget widget_class(props.width, props.height, props.width, props.height,
-	                    props.width, props.height, props.x, props.y,
-	                    (void**)&widget);
-	widget->type = PERSE_WIDGET_WINDOW;
-	
-	add_prop(widget, PERSE_NAME_TITLE, props.title);
+	perse_widget* widget = Emit(PERSE_WIDGET_WINDOW, props);
 	
 	// for now we'll try this approach 
 	perse_property_t* p = perse_CreatePropertyCallback(temp_resize_callback);
 	p->name = PERSE_NAME_ON_RESIZE;
 	perse_AddProperty(widget, p);
 	
-	return widget_class;
+	return Widget(widget);
+}
+
+Widget Application(ItemProps) {
+	return Widget(Emit(PERSE_WIDGET_APPLICATION, ItemProps{}));
 }
 
 
@@ -6,17 +6,20 @@
 #include <functional>
 
 #include "property.h"
+#include "callback.h"
 
 namespace perse {
 
 bool Wait();
 
+class Ref;
+
 class Widget {
 public:
-	Widget(Property<int>&, Property<int>&, Property<int>&, Property<int>&,
-		   Property<int>&, Property<int>&, Property<int>&, Property<int>&, void**);
+	explicit Widget(void* widget);	// made by one of the builders below
 	Widget& operator<<(std::initializer_list<Widget> children);
 	Widget& operator<<(std::vector<Widget> children);
+	Widget& Bind(Ref& ref);			// see ref.h
 	static Widget Null();
 protected:
 	Widget();
@@ -29,14 +32,31 @@ inline std::vector<Widget> Inside(std::vector<Widget> children) {
     return children;
 }
 
-typedef std::function<void()> OnClickCallback;
-typedef std::function<void()> OnSubmitCallback;
-typedef std::function<void(bool)> OnChangeBoolCallback;
-typedef std::function<void(int)> OnChangeIntCallback;
-typedef std::function<void(std::string)> OnChangeStringCallback;
+typedef Callback<void()> OnClickCallback;
+typedef Callback<void()> OnSubmitCallback;
+typedef Callback<void(bool)> OnChangeBoolCallback;
+typedef Callback<void(int)> OnChangeIntCallback;
+typedef Callback<void(std::string)> OnChangeStringCallback;
 
 extern Widget Null;
 
+// what a Canvas draws is recorded into a Painter each time that the tree is
+// built. colors are 0xRRGGBB, positions are relative to the canvas
+class Painter {
+public:
+	explicit Painter(void* list);
+	
+	void Line(int x1, int y1, int x2, int y2, unsigned color);
+	void Rect(int x, int y, int w, int h, unsigned color);
+	void Fill(int x, int y, int w, int h, unsigned color);
+	void Text(int x, int y, int w, int h, const std::string& text, unsigned color);
+	void Image(int x, int y, int w, int h, const std::string& path);
+private:
+	void* list;
+};
+
+typedef Callback<void(Painter&)> DrawCallback;
+
 enum Direction {
 	LEFT,
 	RIGHT,
@@ -44,6 +64,16 @@ enum Direction {
 	DOWN
 };
 
+// same order as perse_align_t
+enum Align {
+	START,
+	CENTER,
+	END,
+	STRETCH,
+	SPACE_BETWEEN,
+	SPACE_AROUND
+};
+
 struct ArrowButtonProps {
 	Property<int> min_width;
 	Property<int> min_height;
@@ -57,6 +87,15 @@ struct ArrowButtonProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<Direction> dir;
 	
 	Property<std::string> text;
@@ -77,6 +116,15 @@ struct ButtonProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 	Property<bool> enabled;
 	Property<OnClickCallback> onclick;
@@ -95,6 +143,15 @@ struct ImageButtonProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 	Property<bool> enabled;
 	Property<std::string> image;
@@ -114,6 +171,15 @@ struct TextFieldProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 	Property<std::string> hint;
 	
@@ -137,6 +203,15 @@ struct TextAreaProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 	Property<std::string> hint;
 	
@@ -160,6 +235,15 @@ struct LabelProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 };
 
@@ -176,6 +260,15 @@ struct CheckBoxProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 	Property<bool> value;
 	Property<bool> enabled;
@@ -195,6 +288,15 @@ struct RadioButtonProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 	Property<bool> value;
 	Property<bool> enabled;
@@ -216,9 +318,18 @@ struct ComboBoxProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::vector<std::string>> items;
-	Property<std::vector<void*>> value;
-	Property<std::vector<OnClickCallback>> onselect;
+	Property<int> value;	// index of the selected item
+	Property<OnChangeIntCallback> onselect;
 };
 
 struct ListBoxProps {
@@ -234,7 +345,16 @@ struct ListBoxProps {
 	Property<int> x;
 	Property<int> y;
 	
-	Property<std::vector<OnClickCallback>> onselect; // wait why a vector???
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<OnChangeIntCallback> onselect;	// index of the selected item
 };
 
 struct TabGroupProps {
@@ -249,6 +369,17 @@ struct TabGroupProps {
 	
 	Property<int> x;
 	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<int> unmount_after; // switches before hidden tab is unmounted
 };
 
 
@@ -269,6 +400,15 @@ struct GroupPanelProps {
 	Property<int> x;
 	Property<int> y;
 	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
 	Property<std::string> text;
 };
 
@@ -294,10 +434,146 @@ struct AbsoluteLayoutProps {
 	
 	Property<int> x;
 	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
 };
 
 
+struct GridLayoutProps {
+	Property<int> min_width;
+	Property<int> min_height;
+	
+	Property<int> max_width;
+	Property<int> max_height;
+	
+	Property<int> width;
+	Property<int> height;
+	
+	Property<int> x;
+	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<std::string> rows;		// e.g. "auto 1fr 24"
+	Property<std::string> columns;	// e.g. "120 auto 2fr 1fr"
+};
 
+struct SplitterLayoutProps {
+	Property<int> min_width;
+	Property<int> min_height;
+	
+	Property<int> max_width;
+	Property<int> max_height;
+	
+	Property<int> width;
+	Property<int> height;
+	
+	Property<int> x;
+	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<bool> vertical;	// stack panes top to bottom
+};
+
+struct FlexLayoutProps {
+	Property<int> min_width;
+	Property<int> min_height;
+	
+	Property<int> max_width;
+	Property<int> max_height;
+	
+	Property<int> width;
+	Property<int> height;
+	
+	Property<int> x;
+	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<bool> vertical;	// main axis goes top to bottom
+	Property<bool> wrap;		// break items into several lines
+	Property<Align> justify;	// along the main axis
+	Property<Align> align;		// along the cross axis
+};
+
+struct ImageProps {
+	Property<int> min_width;
+	Property<int> min_height;
+	
+	Property<int> max_width;
+	Property<int> max_height;
+	
+	Property<int> width;
+	Property<int> height;
+	
+	Property<int> x;
+	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<std::string> image;	// path, scaled to fit the widget
+};
+
+struct CanvasProps {
+	Property<int> min_width;
+	Property<int> min_height;
+	
+	Property<int> max_width;
+	Property<int> max_height;
+	
+	Property<int> width;
+	Property<int> height;
+	
+	Property<int> x;
+	Property<int> y;
+	
+	Property<int> stretch;
+	Property<int> shrink;
+	Property<int> basis;
+	
+	Property<int> row;
+	Property<int> col;
+	Property<int> row_span;
+	Property<int> col_span;
+	
+	Property<DrawCallback> draw;	// called while building, not when painting
+};
 
 struct WindowProps {
 	Property<int> width;
@@ -307,6 +583,10 @@ struct WindowProps {
 	Property<int> y;
 	
 	Property<std::string> title;
+	
+	// without it, closing the main window quits and closing any other
+	// window only hides it
+	Property<OnClickCallback> onclose;
 };
 
 Widget ArrowButton(ArrowButtonProps);
@@ -319,11 +599,14 @@ Widget CheckBox(CheckBoxProps);
 Widget RadioButton(RadioButtonProps);
 Widget ComboBox(ComboBoxProps);
 Widget ListBox(ListBoxProps);
+Widget Image(ImageProps);
+Widget Canvas(CanvasProps);
 
 Widget TabGroup(TabGroupProps);
 Widget TabPanel(TabPanelProps);
 
 Widget GroupPanel(GroupPanelProps);
+Widget ScrollPanel(AbsoluteLayoutProps);
 
 Widget Item(ItemProps);
 
@@ -333,8 +616,13 @@ Widget StatusBar(ItemProps);
 Widget AbsoluteLayout(AbsoluteLayoutProps);
 Widget HorizontalLayout(AbsoluteLayoutProps);
 Widget VerticalLayout(AbsoluteLayoutProps);
+Widget GridLayout(GridLayoutProps);
+Widget FlowLayout(AbsoluteLayoutProps);
+Widget SplitterLayout(SplitterLayoutProps);
+Widget FlexLayout(FlexLayoutProps);
 
 Widget Window(WindowProps);
+Widget Application(ItemProps);	// top-level windows go in it
 
 }
 
@@ -1,11 +1,55 @@
 #include "backend.h"
 
 #include "perse.h"
+#include "stats.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	BACKEND LOADING
+	
+	There are two ways of getting a backend.
+	
+	If the library is built with PERSE_STATIC_BACKEND, then the backend is
+	linked into the program and backend.h turns every perse_Backend* call into
+	a direct call to the perse_impl_Backend* function, which the linker can
+	inline. perse_LoadBackend() then only has to hand the backend the logger.
+	
+	Otherwise the backend is a shared library, which is looked for next to the
+	executable, as backend.dll or backend.so, unless the PERSE_BACKEND
+	environment variable has the path to some other one. Loading goes through
+	a full path, so nothing gets searched for.
+	
+	The backend exports perse_impl_GetBackend(), which returns a table with
+	all of its entry points. The table starts with the version and the size
+	that the backend was built with. A different version means that the table
+	doesn't fit at all, but a smaller size only means that the backend was
+	built before the entries at the end were added, and those are treated as
+	missing. Missing optional entries get defaults.
+	
+	Backends that don't have perse_impl_GetBackend() get their entry points
+	looked up one by one, by name.
+*/
+
+#ifdef PERSE_STATIC_BACKEND
+
+void perse_LoadBackend() {
+	perse_impl_BackendSetLogger(perse_LogV);
+}
+
+#else
+
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#define BACKEND_FILE "backend.dll"
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#define BACKEND_FILE "backend.so"
+#endif
 
-// TODO: add unix .so loading code
 // TODO: add emscripten bypass
 
 void (*perse_BackendCreateWidget)(perse_widget_t*) = NULL;
@@ -17,52 +61,248 @@ void (*perse_BackendSetSizePos)(perse_widget_t*) = NULL;
 void (*perse_BackendProcessEvents)() = NULL;
 int (*perse_BackendShouldQuit)() = NULL;
 
-void (*perse_BackendSetLogger)(void(*)(const char* fmt, ...)) = NULL;
+// optional, backends that can't measure text leave sizing to the layout
+static perse_size_t no_measure(perse_widget_t* widget) {
+	(void)widget;
+	return (perse_size_t){-1, -1};
+}
+perse_size_t (*perse_BackendMeasure)(perse_widget_t*) = no_measure;
+
+// optional, backends without a control pool don't need to implement these
+static void no_pool(int limit) {
+	(void)limit;
+}
+void (*perse_BackendSetPoolLimit)(int) = no_pool;
+void (*perse_BackendTrimPool)(int) = no_pool;
+
+// optional, backends that never sleep in perse_BackendProcessEvents() don't
+// have to be woken up
+static void no_wake() {}
+void (*perse_BackendWake)() = no_wake;
+
+void (*perse_BackendSetLogger)(perse_log_t) = NULL;
+
+// backends from before version 2 of the table get a logger without levels
+static void (*legacy_set_logger)(void(*)(const char* fmt, ...)) = NULL;
+
+#ifdef PERSE_STATS
+// backend calls are counted by putting these in front of the loaded functions
+static void (*real_create_widget)(perse_widget_t*);
+static void (*real_destroy_widget)(perse_widget_t*);
+static void (*real_set_property)(perse_widget_t*, perse_property_t*);
+static void (*real_set_size_pos)(perse_widget_t*);
+static perse_size_t (*real_measure)(perse_widget_t*);
+
+static void counted_create_widget(perse_widget_t* widget) {
+	PERSE_STATS_COUNT(backend_create, 1);
+	real_create_widget(widget);
+}
+
+static void counted_destroy_widget(perse_widget_t* widget) {
+	PERSE_STATS_COUNT(backend_destroy, 1);
+	real_destroy_widget(widget);
+}
+
+static void counted_set_property(perse_widget_t* widget, perse_property_t* p) {
+	PERSE_STATS_COUNT(backend_set_property, 1);
+	real_set_property(widget, p);
+}
+
+static void counted_set_size_pos(perse_widget_t* widget) {
+	PERSE_STATS_COUNT(backend_set_size_pos, 1);
+	real_set_size_pos(widget);
+}
+
+static perse_size_t counted_measure(perse_widget_t* widget) {
+	PERSE_STATS_COUNT(backend_measure, 1);
+	return real_measure(widget);
+}
+
+static void count_backend_calls() {
+	real_create_widget = perse_BackendCreateWidget;
+	real_destroy_widget = perse_BackendDestroyWidget;
+	real_set_property = perse_BackendSetProperty;
+	real_set_size_pos = perse_BackendSetSizePos;
+	real_measure = perse_BackendMeasure;
+	
+	perse_BackendCreateWidget = counted_create_widget;
+	perse_BackendDestroyWidget = counted_destroy_widget;
+	perse_BackendSetProperty = counted_set_property;
+	perse_BackendSetSizePos = counted_set_size_pos;
+	perse_BackendMeasure = counted_measure;
+}
+#endif // PERSE_STATS
 
 #define CHECK_FUNC(FUNC_NAME) \
 	if (!FUNC_NAME) { \
-		perse_Log(#FUNC_NAME " not loaded from BACKEND.DLL"); \
+		PERSE_FATAL(PERSE_LOG_BACKEND, \
+			#FUNC_NAME " not loaded from " BACKEND_FILE "\n"); \
 		abort(); \
 	}
 
-void perse_LoadBackend() {
-	perse_Log("loading library\n");
+// finds the backend next to the executable, unless told otherwise
+static void backend_path(char* path, size_t size) {
+	const char* override = getenv("PERSE_BACKEND");
+	if (override && *override) {
+		strncpy(path, override, size - 1);
+		path[size - 1] = '\0';
+		return;
+	}
 	
-	HMODULE backend_lib = LoadLibrary("backend.dll");
+	size_t length = 0;
+#ifdef _WIN32
+	length = GetModuleFileName(NULL, path, (DWORD)size);
+	if (length >= size) length = 0;
+#else
+	ssize_t read = readlink("/proc/self/exe", path, size - 1);
+	if (read > 0) length = read;
+#endif
+	path[length] = '\0';
 	
-	if (backend_lib == NULL) {
-		perse_Log("FATAL ERROR: FAILED TO LOAD BACKEND.DLL\n");
+	// cut off the executable name, keeping the separator
+	while (length > 0 && path[length - 1] != '/' && path[length - 1] != '\\') {
+		length--;
+	}
+	
+	if (length + sizeof(BACKEND_FILE) > size) length = 0;
+	strcpy(path + length, BACKEND_FILE);
+}
+
+static void* open_backend(const char* path) {
+#ifdef _WIN32
+	return LoadLibraryEx(path, NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+#else
+	return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void* backend_symbol(void* backend_lib, const char* name) {
+#ifdef _WIN32
+	return (void*)GetProcAddress(backend_lib, name);
+#else
+	return dlsym(backend_lib, name);
+#endif
+}
+
+// takes the entry points from the table that the backend gives us
+static int load_table(void* backend_lib) {
+	const perse_backend_t* (*get_backend)(int) =
+		(const perse_backend_t* (*)(int))backend_symbol(backend_lib,
+			"perse_impl_GetBackend");
+	
+	if (!get_backend) return 0;
+	
+	const perse_backend_t* table = get_backend(PERSE_BACKEND_VERSION);
+	
+	if (!table || table->version != PERSE_BACKEND_VERSION) {
+		PERSE_FATAL(PERSE_LOG_BACKEND, BACKEND_FILE " is version %i, need %i\n",
+			table ? table->version : 0, PERSE_BACKEND_VERSION);
 		abort();
 	}
 	
-	perse_Log("getting funcs\n");
+	// entries past what the backend knows about are left as they are
+	perse_backend_t entries = {0};
+	memcpy(&entries, table, table->size < (int)sizeof(entries) ?
+		table->size : (int)sizeof(entries));
+	
+	perse_BackendCreateWidget = entries.create_widget;
+	perse_BackendDestroyWidget = entries.destroy_widget;
+	perse_BackendSetProperty = entries.set_property;
+	perse_BackendSetSizePos = entries.set_size_pos;
+	
+	perse_BackendProcessEvents = entries.process_events;
+	perse_BackendShouldQuit = entries.should_quit;
+	
+	perse_BackendSetLogger = entries.set_logger;
+	
+	if (entries.measure) perse_BackendMeasure = entries.measure;
+	if (entries.set_pool_limit) perse_BackendSetPoolLimit = entries.set_pool_limit;
+	if (entries.trim_pool) perse_BackendTrimPool = entries.trim_pool;
+	if (entries.wake) perse_BackendWake = entries.wake;
+	
+	return 1;
+}
+
+// for backends from before perse_impl_GetBackend()
+static void load_symbols(void* backend_lib) {
 	// load widget functions
 	perse_BackendCreateWidget =
-		(void (*)(perse_widget_t*))GetProcAddress(backend_lib,
+		(void (*)(perse_widget_t*))backend_symbol(backend_lib,
 			"perse_impl_BackendCreateWidget");
 	perse_BackendDestroyWidget =
-		(void (*)(perse_widget_t*))GetProcAddress(backend_lib,
+		(void (*)(perse_widget_t*))backend_symbol(backend_lib,
 			"perse_impl_BackendDestroyWidget");
 	perse_BackendSetProperty =
-	   (void (*)(perse_widget_t*, perse_property_t*))GetProcAddress(backend_lib,
+	   (void (*)(perse_widget_t*, perse_property_t*))backend_symbol(backend_lib,
 			"perse_impl_BackendSetProperty");
 	perse_BackendSetSizePos =
-		(void (*)(perse_widget_t*))GetProcAddress(backend_lib,
+		(void (*)(perse_widget_t*))backend_symbol(backend_lib,
 			"perse_impl_BackendSetSizePos");
 	
 	// load command functions
 	perse_BackendProcessEvents =
-		(void (*)())GetProcAddress(backend_lib,
+		(void (*)())backend_symbol(backend_lib,
 			"perse_impl_BackendProcessEvents");
 	perse_BackendShouldQuit =
-		(int (*)())GetProcAddress(backend_lib,
+		(int (*)())backend_symbol(backend_lib,
 			"perse_impl_BackendShouldQuit");
 	
 	// set up logging callback
-	perse_BackendSetLogger =
-		(void (*)(void(*)(const char* fmt, ...)))GetProcAddress(backend_lib,
+	legacy_set_logger =
+		(void (*)(void(*)(const char* fmt, ...)))backend_symbol(backend_lib,
 			"perse_impl_BackendSetLogger");
+	
+	// load measuring function
+	perse_size_t (*measure)(perse_widget_t*) =
+		(perse_size_t (*)(perse_widget_t*))backend_symbol(backend_lib,
+			"perse_impl_BackendMeasure");
+	
+	if (measure) perse_BackendMeasure = measure;
+	
+	// load pool functions
+	void (*set_pool_limit)(int) =
+		(void (*)(int))backend_symbol(backend_lib,
+			"perse_impl_BackendSetPoolLimit");
+	void (*trim_pool)(int) =
+		(void (*)(int))backend_symbol(backend_lib,
+			"perse_impl_BackendTrimPool");
+	
+	if (set_pool_limit) perse_BackendSetPoolLimit = set_pool_limit;
+	if (trim_pool) perse_BackendTrimPool = trim_pool;
+	
+	// load waking function
+	void (*wake)() =
+		(void (*)())backend_symbol(backend_lib,
+			"perse_impl_BackendWake");
+	
+	if (wake) perse_BackendWake = wake;
+}
 
+void perse_LoadBackend() {
+	char path[4096];
+	backend_path(path, sizeof(path));
+	
+	PERSE_INFO(PERSE_LOG_BACKEND, "loading %s\n", path);
+	
+	void* backend_lib = open_backend(path);
+	
+	if (backend_lib == NULL) {
+		PERSE_FATAL(PERSE_LOG_BACKEND, "failed to load %s\n", path);
+		abort();
+	}
+	
+	if (!load_table(backend_lib)) {
+		load_symbols(backend_lib);
+		
+		CHECK_FUNC(legacy_set_logger)
+		
+		legacy_set_logger(perse_Log);
+	} else {
+		CHECK_FUNC(perse_BackendSetLogger)
+		
+		perse_BackendSetLogger(perse_LogV);
+	}
+	
 	CHECK_FUNC(perse_BackendCreateWidget)
 	CHECK_FUNC(perse_BackendDestroyWidget)
 	CHECK_FUNC(perse_BackendSetProperty)
@@ -70,8 +310,10 @@ void perse_LoadBackend() {
 	
 	CHECK_FUNC(perse_BackendProcessEvents)
 	CHECK_FUNC(perse_BackendShouldQuit)
-	
-	CHECK_FUNC(perse_BackendSetLogger)
 
-	perse_BackendSetLogger(perse_Log);
-}
\ No newline at end of file
+#ifdef PERSE_STATS
+	count_backend_calls();
+#endif
+}
+
+#endif // PERSE_STATIC_BACKEND
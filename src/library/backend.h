@@ -2,16 +2,97 @@
 #define PERSE_BACKEND_H
 
 #include "widget.h"
+#include "stats.h"
+#include "perse.h"
+
+// bumped whenever the table below changes in a way that isn't just adding
+// entries at the end, see backend.c
+#define PERSE_BACKEND_VERSION 2
+
+/// Entry points of a backend.
+/// Returned by perse_impl_GetBackend(), which is the only function that a
+/// loadable backend has to export. Optional entries can be left NULL.
+typedef struct {
+	int version;				//< PERSE_BACKEND_VERSION of the backend
+	int size;					//< sizeof(perse_backend_t) of the backend
+
+	void (*create_widget)(perse_widget_t*);
+	void (*destroy_widget)(perse_widget_t*);
+	void (*set_property)(perse_widget_t*, perse_property_t*);
+	void (*set_size_pos)(perse_widget_t*);
+
+	void (*process_events)();
+	int (*should_quit)();
+
+	void (*set_logger)(perse_log_t);
+
+	perse_size_t (*measure)(perse_widget_t*);	//< optional
+	void (*set_pool_limit)(int);				//< optional
+	void (*trim_pool)(int);						//< ditto
+
+	void (*wake)();								//< optional, from any thread
+} perse_backend_t;
+
+#ifdef PERSE_STATIC_BACKEND
+
+// the backend is linked into the program, so it gets called directly and all
+// of its entry points have to be there, including the optional ones
+void perse_impl_BackendCreateWidget(perse_widget_t*);
+void perse_impl_BackendDestroyWidget(perse_widget_t*);
+
+void perse_impl_BackendSetProperty(perse_widget_t*, perse_property_t*);
+void perse_impl_BackendSetSizePos(perse_widget_t*);
+perse_size_t perse_impl_BackendMeasure(perse_widget_t*);
+
+void perse_impl_BackendProcessEvents();
+int perse_impl_BackendShouldQuit();
+
+void perse_impl_BackendSetPoolLimit(int);
+void perse_impl_BackendTrimPool(int);
+
+void perse_impl_BackendWake();
+
+void perse_impl_BackendSetLogger(perse_log_t);
+
+#define perse_BackendCreateWidget(w) \
+	(PERSE_STATS_COUNT(backend_create, 1), perse_impl_BackendCreateWidget(w))
+#define perse_BackendDestroyWidget(w) \
+	(PERSE_STATS_COUNT(backend_destroy, 1), perse_impl_BackendDestroyWidget(w))
+
+#define perse_BackendSetProperty(w, p) \
+	(PERSE_STATS_COUNT(backend_set_property, 1), perse_impl_BackendSetProperty(w, p))
+#define perse_BackendSetSizePos(w) \
+	(PERSE_STATS_COUNT(backend_set_size_pos, 1), perse_impl_BackendSetSizePos(w))
+#define perse_BackendMeasure(w) \
+	(PERSE_STATS_COUNT(backend_measure, 1), perse_impl_BackendMeasure(w))
+
+#define perse_BackendProcessEvents perse_impl_BackendProcessEvents
+#define perse_BackendShouldQuit perse_impl_BackendShouldQuit
+
+#define perse_BackendSetPoolLimit perse_impl_BackendSetPoolLimit
+#define perse_BackendTrimPool perse_impl_BackendTrimPool
+
+#define perse_BackendWake perse_impl_BackendWake
+
+#else
 
 extern void (*perse_BackendCreateWidget)(perse_widget_t*);
 extern void (*perse_BackendDestroyWidget)(perse_widget_t*);
 
 extern void (*perse_BackendSetProperty)(perse_widget_t*, perse_property_t*);
 extern void (*perse_BackendSetSizePos)(perse_widget_t*);
+extern perse_size_t (*perse_BackendMeasure)(perse_widget_t*);
 
 extern void (*perse_BackendProcessEvents)();
 extern int (*perse_BackendShouldQuit)();
 
+extern void (*perse_BackendSetPoolLimit)(int);
+extern void (*perse_BackendTrimPool)(int);
+
+extern void (*perse_BackendWake)();
+
+#endif // PERSE_STATIC_BACKEND
+
 void perse_LoadBackend();
 
-#endif // PERSE_BACKEND_H
\ No newline at end of file
+#endif // PERSE_BACKEND_H
@@ -0,0 +1,282 @@
+#include "canvas.h"
+
+#include "perse.h"
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	CANVAS DRAW LISTS
+	
+	A canvas doesn't draw anything by itself, the frontend gives it a list of
+	commands as its PERSE_NAME_DRAW property, which the backend replays in
+	order over the background of the canvas. The list is built again for every
+	frame, the same as the rest of the tree.
+	
+	When perse_MergeTree() finds that the list of a canvas has changed, it
+	diffs the new list against the old one before replacing it. Commands that
+	are the same at the start and at the end of both lists are skipped, and
+	the rest are matched up in order by their hashes. Whatever doesn't get
+	matched, either an old command that is gone or a new one that wasn't
+	there, goes into the `damage` of the new list as its bounding box.
+	
+	Commands that got matched come in the same order in both lists, so
+	anywhere outside of the damage, the same commands get drawn in the same
+	order as before and nothing has changed. The backend then only has to
+	draw the commands that overlap the damage, clipped to it.
+	
+	If the list changes more than once before it is applied, the damage of
+	the list that never made it to the backend is carried over.
+	
+	Changing a list doesn't change the layout, so the canvas only gets its
+	property set again.
+*/
+
+static unsigned hash_command(const perse_draw_command_t* c) {
+	int values[6] = {c->type, c->x, c->y, c->w, c->h, (int)c->color};
+	
+	// FNV-1a, same as everywhere else
+	unsigned hash = 2166136261u;
+	const unsigned char* bytes = (const unsigned char*)values;
+	for (size_t i = 0; i < sizeof(values); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	
+	if (c->text) {
+		for (const char* t = c->text; *t; t++) {
+			hash = (hash ^ (unsigned char)*t) * 16777619u;
+		}
+	}
+	
+	return hash;
+}
+
+static void add_command(perse_draw_list_t* list, perse_draw_type_t type,
+	int x, int y, int w, int h, unsigned color, const char* text) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 16;
+		list->command = realloc(list->command,
+			sizeof(perse_draw_command_t) * list->capacity);
+	}
+	
+	perse_draw_command_t* c = &list->command[list->count++];
+	
+	c->type = type;
+	c->x = x;
+	c->y = y;
+	c->w = w;
+	c->h = h;
+	c->color = color & 0xFFFFFF;
+	c->text = NULL;
+	c->image = NULL;
+	
+	if (text) {
+		c->text = malloc(strlen(text) + 1);
+		strcpy(c->text, text);
+	}
+	
+	c->hash = hash_command(c);
+}
+
+/// Adds a line to a draw list.
+/// The line goes from `x1`, `y1` to `x2`, `y2`, including both ends.
+void perse_DrawLine(perse_draw_list_t* list, int x1, int y1, int x2, int y2, unsigned color) {
+	add_command(list, PERSE_DRAW_LINE, x1, y1, x2 - x1, y2 - y1, color, NULL);
+}
+
+/// Adds a rectangle outline to a draw list.
+/// The outline is one pixel wide, on the inside of the rectangle.
+void perse_DrawRect(perse_draw_list_t* list, int x, int y, int w, int h, unsigned color) {
+	add_command(list, PERSE_DRAW_RECT, x, y, w, h, color, NULL);
+}
+
+/// Adds a filled rectangle to a draw list.
+void perse_FillRect(perse_draw_list_t* list, int x, int y, int w, int h, unsigned color) {
+	add_command(list, PERSE_DRAW_FILL, x, y, w, h, color, NULL);
+}
+
+/// Adds text to a draw list.
+/// The text is drawn with the font of the backend, from the top left corner of
+/// the rectangle, and whatever doesn't fit in the rectangle is cut off. The
+/// string is copied.
+void perse_DrawText(perse_draw_list_t* list, int x, int y, int w, int h, unsigned color, const char* text) {
+	add_command(list, PERSE_DRAW_TEXT, x, y, w, h, color, text ? text : "");
+}
+
+/// Adds an image to a draw list.
+/// The image file at `path` is scaled to fill the rectangle. The path is
+/// copied.
+void perse_DrawImage(perse_draw_list_t* list, int x, int y, int w, int h, const char* path) {
+	add_command(list, PERSE_DRAW_IMAGE, x, y, w, h, 0, path ? path : "");
+}
+
+static int overlapping(perse_draw_rect_t a, perse_draw_rect_t b) {
+	return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+static perse_draw_rect_t bounding(perse_draw_rect_t a, perse_draw_rect_t b) {
+	int left = a.x < b.x ? a.x : b.x;
+	int top = a.y < b.y ? a.y : b.y;
+	int right = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+	int bottom = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+	
+	perse_draw_rect_t r = {left, top, right - left, bottom - top};
+	return r;
+}
+
+// rectangles that overlap or touch get merged, and if there are too many,
+// they all become their bounding box
+static void add_damage(perse_draw_list_t* list, perse_draw_rect_t r) {
+	if (list->damage_count < 0 || r.w <= 0 || r.h <= 0) return;
+	
+	for (int i = 0; i < list->damage_count; i++) {
+		if (!overlapping(list->damage[i], r)) continue;
+		
+		r = bounding(r, list->damage[i]);
+		list->damage[i] = list->damage[--list->damage_count];
+		i = -1;
+	}
+	
+	if (list->damage_count == PERSE_DRAW_DAMAGE) {
+		for (int i = 0; i < list->damage_count; i++) {
+			r = bounding(r, list->damage[i]);
+		}
+		list->damage_count = 0;
+	}
+	
+	list->damage[list->damage_count++] = r;
+}
+
+/// Adds to the damage of a draw list.
+/// For when something other than the commands changes what the canvas shows,
+/// such as an image that has finished decoding.
+void perse_DamageDrawList(perse_draw_list_t* list, perse_draw_rect_t rect) {
+	add_damage(list, rect);
+}
+
+static void damage_command(perse_draw_list_t* list, const perse_draw_command_t* c) {
+	PERSE_STATS_COUNT(draw_commands_changed, 1);
+	add_damage(list, perse_DrawBounds(c));
+}
+
+/// Finds what has to be drawn again.
+/// Sets the damage of `new_list` to the areas in which it draws something
+/// different from `old_list`. If `pending` is set, then the damage of
+/// `old_list` was never drawn, so it gets added as well.
+void perse_DiffDrawList(perse_draw_list_t* old_list, perse_draw_list_t* new_list,
+	char pending) {
+	new_list->damage_count = 0;
+	
+	if (pending) {
+		if (old_list->damage_count < 0) {
+			new_list->damage_count = -1;
+			return;
+		}
+		
+		for (int i = 0; i < old_list->damage_count; i++) {
+			add_damage(new_list, old_list->damage[i]);
+		}
+	}
+	
+	perse_draw_command_t* old_command = old_list->command;
+	perse_draw_command_t* new_command = new_list->command;
+	
+	// most of the time only something in the middle changes
+	int start = 0;
+	int old_end = old_list->count;
+	int new_end = new_list->count;
+	
+	while (start < old_end && start < new_end &&
+		perse_IsDrawCommandMatching(&old_command[start], &new_command[start])) {
+		start++;
+	}
+	
+	while (old_end > start && new_end > start &&
+		perse_IsDrawCommandMatching(&old_command[old_end - 1], &new_command[new_end - 1])) {
+		old_end--;
+		new_end--;
+	}
+	
+	PERSE_STATS_COUNT(draw_commands_compared, start + old_list->count - old_end);
+	
+	int count = old_end - start;
+	if (!count) {
+		for (int i = start; i < new_end; i++) damage_command(new_list, &new_command[i]);
+		return;
+	}
+	
+	// old commands by hash. `slot` has the last one with each hash, which
+	// stays put, so that it can be probed past. `head` has the first one
+	// that can still be matched and the rest are chained after it, in order
+	int slots = 16;
+	while (slots < count * 2) slots *= 2;
+	
+	int* slot = malloc(sizeof(int) * slots);
+	int* head = malloc(sizeof(int) * slots);
+	int* chain = malloc(sizeof(int) * count);
+	char* matched = calloc(count, 1);
+	
+	for (int i = 0; i < slots; i++) slot[i] = -1;
+	
+	for (int i = count - 1; i >= 0; i--) {
+		unsigned hash = old_command[start + i].hash;
+		unsigned s = hash & (slots - 1);
+		while (slot[s] != -1 && old_command[start + slot[s]].hash != hash) {
+			s = (s + 1) & (slots - 1);
+		}
+		
+		if (slot[s] == -1) {
+			slot[s] = i;
+			chain[i] = -1;
+		} else {
+			chain[i] = head[s];
+		}
+		
+		head[s] = i;
+	}
+	
+	// each new command takes the first old one after the last match that is
+	// the same, so the matches keep their order
+	int last = -1;
+	for (int i = start; i < new_end; i++) {
+		PERSE_STATS_COUNT(draw_commands_compared, 1);
+		
+		unsigned hash = new_command[i].hash;
+		unsigned s = hash & (slots - 1);
+		while (slot[s] != -1 && old_command[start + slot[s]].hash != hash) {
+			s = (s + 1) & (slots - 1);
+		}
+		
+		if (slot[s] == -1) {
+			damage_command(new_list, &new_command[i]);
+			continue;
+		}
+		
+		// whatever is before the last match can't be matched anymore
+		while (head[s] != -1 && head[s] <= last) head[s] = chain[head[s]];
+		
+		int found = head[s];
+		while (found != -1 &&
+			!perse_IsDrawCommandMatching(&old_command[start + found], &new_command[i])) {
+			found = chain[found];
+		}
+		
+		if (found == -1) {
+			damage_command(new_list, &new_command[i]);
+			continue;
+		}
+		
+		matched[found] = 1;
+		last = found;
+	}
+	
+	for (int i = 0; i < count; i++) {
+		if (!matched[i]) damage_command(new_list, &old_command[start + i]);
+	}
+	
+	free(slot);
+	free(head);
+	free(chain);
+	free(matched);
+}
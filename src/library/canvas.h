@@ -0,0 +1,55 @@
+#ifndef PERSE_CANVAS_H
+#define PERSE_CANVAS_H
+
+#include "property.h"
+
+typedef enum {
+	PERSE_DRAW_LINE = 0,		//< from x, y to x + w, y + h
+	PERSE_DRAW_RECT,			//< outline, inside of the rectangle
+	PERSE_DRAW_FILL,			//< filled rectangle
+	PERSE_DRAW_TEXT,			//< text from the top left, cut off at the edges
+	PERSE_DRAW_IMAGE,			//< image file, scaled to the rectangle
+} perse_draw_type_t;
+
+typedef struct {
+	int x, y, w, h;
+} perse_draw_rect_t;
+
+typedef struct {
+	perse_draw_type_t type;
+	int x, y, w, h;
+	unsigned color;				//< 0xRRGGBB
+	char* text;					//< text, or path to the image
+	unsigned hash;				//< of all of the above, for diffing
+	struct perse_image* image;	//< decoded `text`, set by library
+} perse_draw_command_t;
+
+#define PERSE_DRAW_DAMAGE 16
+
+/// Commands that a canvas draws, in order, over its background.
+/// The `damage` is what has to be drawn again, in canvas coordinates, since
+/// the list that this one replaced. A `damage_count` of -1 means that all of
+/// the canvas has to be drawn.
+typedef struct perse_draw_list {
+	perse_draw_command_t* command;
+	int count;
+	int capacity;
+	
+	perse_draw_rect_t damage[PERSE_DRAW_DAMAGE];
+	int damage_count;
+} perse_draw_list_t;
+
+void perse_DrawLine(perse_draw_list_t*, int x1, int y1, int x2, int y2, unsigned color);
+void perse_DrawRect(perse_draw_list_t*, int x, int y, int w, int h, unsigned color);
+void perse_FillRect(perse_draw_list_t*, int x, int y, int w, int h, unsigned color);
+void perse_DrawText(perse_draw_list_t*, int x, int y, int w, int h, unsigned color, const char* text);
+void perse_DrawImage(perse_draw_list_t*, int x, int y, int w, int h, const char* path);
+
+perse_draw_rect_t perse_DrawBounds(const perse_draw_command_t*);
+int perse_IsDrawCommandMatching(const perse_draw_command_t*, const perse_draw_command_t*);
+
+void perse_DamageDrawList(perse_draw_list_t*, perse_draw_rect_t);
+void perse_DiffDrawList(perse_draw_list_t* old_list, perse_draw_list_t* new_list,
+	char pending);
+
+#endif // PERSE_CANVAS_H
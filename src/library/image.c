@@ -0,0 +1,579 @@
+#include "image.h"
+
+#include "perse.h"
+#include "backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+	IMAGES
+	
+	Image files are decoded on a background thread, so that mounting a
+	toolbar full of icons doesn't hold up the frame with reading, decoding and
+	scaling files.
+	
+	Decoded images are kept in a cache, keyed by the path and by the size that
+	the image was scaled to fit, since that is what gets drawn. Everything
+	that shows the same file at the same size shares the same image, and with
+	it the same pixels in the backend.
+	
+	perse_LoadImage() looks the image up, and if it isn't there, adds it in
+	the LOADING state and queues it up for the decoding thread. Once the
+	thread is done with it, it puts it on the finished list and wakes up the
+	backend, in case it is waiting for events. The image only becomes READY
+	or FAILED in perse_FinishImages(), on the UI thread, so that the backend
+	never sees it change while it is drawing. The widgets that were waiting
+	for it then get applied again, see perse_UpdateImages() in layout.c.
+	At exit the thread finishes the image it is on and gets joined.
+	
+	The cache has a budget of decoded bytes. Whenever it is over it, images
+	that no property refers to get thrown out, least recently used first.
+	Images that are in use never are, so if everything is on screen, the
+	cache can go over the budget.
+	
+	Uncompressed 24 and 32 bit BMP and binary PPM and PAM files are decoded
+	here. Anything else needs a decoder set with perse_SetImageDecoder(),
+	which gets tried first.
+*/
+
+#define IMAGE_BUCKETS 256				// has to be a power of two
+#define IMAGE_CACHE_LIMIT (32 << 20)	// default budget, in bytes
+#define IMAGE_FILE_LIMIT (64 << 20)		// bigger files aren't read
+
+static perse_image_t* buckets[IMAGE_BUCKETS];
+
+static perse_image_t* newest = NULL;
+static perse_image_t* oldest = NULL;
+
+static size_t cache_bytes = 0;
+static size_t cache_limit = IMAGE_CACHE_LIMIT;
+
+static perse_image_decoder_t decoder = NULL;
+
+// everything below is shared with the decoding thread
+static perse_image_t* job_head = NULL;
+static perse_image_t* job_tail = NULL;
+static perse_image_t* finished = NULL;
+
+enum {
+	DECODER_STOPPED,
+	DECODER_RUNNING,
+	DECODER_SYNCHRONOUS,	// couldn't start a thread, images get decoded right away
+};
+
+static int decoder_state = DECODER_STOPPED;
+static int decoder_stopping = 0;
+
+#ifdef _WIN32
+static CRITICAL_SECTION lock;
+static CONDITION_VARIABLE work;
+static HANDLE thread;
+
+static void lock_jobs() { EnterCriticalSection(&lock); }
+static void unlock_jobs() { LeaveCriticalSection(&lock); }
+static void wait_for_jobs() { SleepConditionVariableCS(&work, &lock, INFINITE); }
+static void signal_jobs() { WakeConditionVariable(&work); }
+#else
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_t thread;
+
+static void lock_jobs() { pthread_mutex_lock(&lock); }
+static void unlock_jobs() { pthread_mutex_unlock(&lock); }
+static void wait_for_jobs() { pthread_cond_wait(&work, &lock); }
+static void signal_jobs() { pthread_cond_signal(&work); }
+#endif
+
+/*
+	DECODING
+*/
+
+static unsigned char* read_file(const char* path, size_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return NULL;
+	
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	
+	if (length <= 0 || length > IMAGE_FILE_LIMIT) {
+		fclose(file);
+		return NULL;
+	}
+	
+	unsigned char* data = malloc(length);
+	if (!data) {
+		fclose(file);
+		return NULL;
+	}
+	
+	// a file that got shorter since it was measured is as good as broken
+	*size = fread(data, 1, length, file);
+	fclose(file);
+	
+	if (*size != (size_t)length) {
+		free(data);
+		return NULL;
+	}
+	
+	return data;
+}
+
+static unsigned read_u16(const unsigned char* p) {
+	return p[0] | p[1] << 8;
+}
+
+static unsigned read_u32(const unsigned char* p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (unsigned)p[3] << 24;
+}
+
+// uncompressed, or with the usual BGRA bitfields, rows bottom up unless the
+// height is negative
+static unsigned char* decode_bmp(const unsigned char* data, size_t size, int* width, int* height) {
+	if (size < 54 || data[0] != 'B' || data[1] != 'M') return NULL;
+	
+	size_t offset = read_u32(data + 10);
+	int w = (int)read_u32(data + 18);
+	int h = (int)read_u32(data + 22);
+	int bits = read_u16(data + 28);
+	unsigned compression = read_u32(data + 30);
+	
+	if ((bits != 24 && bits != 32) || (compression != 0 && compression != 3)) return NULL;
+	
+	char top_down = h < 0;
+	if (top_down) h = -h;
+	if (w <= 0 || h <= 0 || w > 16384 || h > 16384) return NULL;
+	
+	size_t stride = ((size_t)w * bits / 8 + 3) & ~(size_t)3;
+	if (offset > size || stride * h > size - offset) return NULL;
+	
+	unsigned char* pixels = malloc((size_t)w * h * 4);
+	
+	// 32 bit files often leave the alpha at zero, which means opaque
+	char alpha = 0;
+	
+	for (int y = 0; y < h; y++) {
+		const unsigned char* src = data + offset + stride * (top_down ? y : h - 1 - y);
+		unsigned char* dst = pixels + (size_t)y * w * 4;
+		
+		for (int x = 0; x < w; x++, src += bits / 8, dst += 4) {
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = bits == 32 ? src[3] : 255;
+			alpha |= dst[3];
+		}
+	}
+	
+	if (bits == 32 && !alpha) {
+		for (size_t i = 0; i < (size_t)w * h; i++) pixels[i * 4 + 3] = 255;
+	}
+	
+	*width = w;
+	*height = h;
+	return pixels;
+}
+
+// reads a number from a netpbm header, skipping whitespace and comments
+static int netpbm_number(const unsigned char* data, size_t size, size_t* at) {
+	for (;;) {
+		while (*at < size && (data[*at] == ' ' || data[*at] == '\t' ||
+			data[*at] == '\r' || data[*at] == '\n')) (*at)++;
+		if (*at >= size || data[*at] != '#') break;
+		while (*at < size && data[*at] != '\n') (*at)++;
+	}
+	
+	int number = -1;
+	while (*at < size && data[*at] >= '0' && data[*at] <= '9' && number < 100000) {
+		number = (number < 0 ? 0 : number * 10) + data[(*at)++] - '0';
+	}
+	return number;
+}
+
+// the value after `key` in a PAM header, which is one key and value per line
+static int pam_field(const unsigned char* data, size_t end, const char* key) {
+	size_t length = strlen(key);
+	for (size_t at = 3; at + length < end; at++) {
+		if (data[at - 1] != '\n' || memcmp(data + at, key, length) != 0) continue;
+		
+		at += length;
+		return netpbm_number(data, end, &at);
+	}
+	return -1;
+}
+
+// binary PPM, or PAM with RGB or RGB_ALPHA tuples, 8 bits per channel
+static unsigned char* decode_netpbm(const unsigned char* data, size_t size, int* width, int* height) {
+	if (size < 3 || data[0] != 'P' || (data[1] != '6' && data[1] != '7')) return NULL;
+	
+	int w, h, depth, max;
+	size_t at = 2;
+	
+	if (data[1] == '6') {
+		w = netpbm_number(data, size, &at);
+		h = netpbm_number(data, size, &at);
+		max = netpbm_number(data, size, &at);
+		depth = 3;
+		at++;	// a single whitespace character before the pixels
+	} else {
+		const char* end = "ENDHDR\n";
+		while (at + 7 <= size && memcmp(data + at, end, 7) != 0) at++;
+		if (at + 7 > size) return NULL;
+		
+		w = pam_field(data, at, "WIDTH");
+		h = pam_field(data, at, "HEIGHT");
+		depth = pam_field(data, at, "DEPTH");
+		max = pam_field(data, at, "MAXVAL");
+		at += 7;
+	}
+	
+	if (w <= 0 || h <= 0 || w > 16384 || h > 16384 || max != 255) return NULL;
+	if (depth != 3 && depth != 4) return NULL;
+	if (at > size || (size_t)w * h * depth > size - at) return NULL;
+	
+	unsigned char* pixels = malloc((size_t)w * h * 4);
+	const unsigned char* src = data + at;
+	
+	for (size_t i = 0; i < (size_t)w * h; i++, src += depth) {
+		pixels[i * 4 + 0] = src[0];
+		pixels[i * 4 + 1] = src[1];
+		pixels[i * 4 + 2] = src[2];
+		pixels[i * 4 + 3] = depth == 4 ? src[3] : 255;
+	}
+	
+	*width = w;
+	*height = h;
+	return pixels;
+}
+
+// each pixel gets the average of the source pixels that it covers, weighed
+// by their alpha, so that transparent pixels don't darken the edges
+static unsigned char* scale(const unsigned char* src, int src_w, int src_h, int w, int h) {
+	unsigned char* pixels = malloc((size_t)w * h * 4);
+	
+	for (int y = 0; y < h; y++) {
+		int top = (int)((long long)y * src_h / h);
+		int bottom = (int)((long long)(y + 1) * src_h / h);
+		if (bottom <= top) bottom = top + 1;
+		
+		for (int x = 0; x < w; x++) {
+			int left = (int)((long long)x * src_w / w);
+			int right = (int)((long long)(x + 1) * src_w / w);
+			if (right <= left) right = left + 1;
+			
+			unsigned long long r = 0, g = 0, b = 0, a = 0, count = 0;
+			for (int sy = top; sy < bottom; sy++) {
+				const unsigned char* s = src + ((size_t)sy * src_w + left) * 4;
+				for (int sx = left; sx < right; sx++, s += 4) {
+					r += s[0] * s[3];
+					g += s[1] * s[3];
+					b += s[2] * s[3];
+					a += s[3];
+					count++;
+				}
+			}
+			
+			unsigned char* d = pixels + ((size_t)y * w + x) * 4;
+			d[0] = a ? r / a : 0;
+			d[1] = a ? g / a : 0;
+			d[2] = a ? b / a : 0;
+			d[3] = a / count;
+		}
+	}
+	
+	return pixels;
+}
+
+// fills in everything but the state, which is left to perse_FinishImages()
+static void decode(perse_image_t* image) {
+	int w = 0, h = 0;
+	unsigned char* pixels = decoder ? decoder(image->path, &w, &h) : NULL;
+	
+	if (!pixels) {
+		size_t size = 0;
+		unsigned char* data = read_file(image->path, &size);
+		if (data) {
+			pixels = decode_bmp(data, size, &w, &h);
+			if (!pixels) pixels = decode_netpbm(data, size, &w, &h);
+			free(data);
+		}
+	}
+	
+	if (!pixels || w <= 0 || h <= 0) {
+		free(pixels);
+		image->failed = 1;
+		return;
+	}
+	
+	// keeps the aspect ratio, the smaller side decides
+	int fit_w = image->fit_w;
+	int fit_h = (int)((long long)h * fit_w / w);
+	if (fit_h > image->fit_h) {
+		fit_h = image->fit_h;
+		fit_w = (int)((long long)w * fit_h / h);
+	}
+	if (fit_w < 1) fit_w = 1;
+	if (fit_h < 1) fit_h = 1;
+	
+	if (fit_w != w || fit_h != h) {
+		unsigned char* scaled = scale(pixels, w, h, fit_w, fit_h);
+		free(pixels);
+		pixels = scaled;
+	}
+	
+	image->pixels = pixels;
+	image->width = fit_w;
+	image->height = fit_h;
+	image->bytes += (size_t)fit_w * fit_h * 4;
+}
+
+static void finish(perse_image_t* image) {
+	lock_jobs();
+	image->next_job = finished;
+	finished = image;
+	int stopping = decoder_stopping;
+	unlock_jobs();
+	
+	// the backend might be gone already at exit
+	if (!stopping) perse_BackendWake();
+}
+
+// images that are still queued when the thread stops stay LOADING
+static void decode_jobs() {
+	for (;;) {
+		lock_jobs();
+		while (!job_head && !decoder_stopping) wait_for_jobs();
+		
+		if (decoder_stopping) {
+			unlock_jobs();
+			return;
+		}
+		
+		perse_image_t* image = job_head;
+		job_head = image->next_job;
+		if (!job_head) job_tail = NULL;
+		unlock_jobs();
+		
+		decode(image);
+		finish(image);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI decoder_thread(LPVOID param) {
+	(void)param;
+	decode_jobs();
+	return 0;
+}
+#else
+static void* decoder_thread(void* param) {
+	(void)param;
+	decode_jobs();
+	return NULL;
+}
+#endif
+
+// lets the image that is being decoded finish, then joins the thread
+static void stop_decoder() {
+	if (decoder_state != DECODER_RUNNING) return;
+	
+	lock_jobs();
+	decoder_stopping = 1;
+	signal_jobs();
+	unlock_jobs();
+	
+#ifdef _WIN32
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+
+	decoder_state = DECODER_SYNCHRONOUS;
+}
+
+// the decoding thread gets started by the first image
+static void start_decoder() {
+#ifdef _WIN32
+	InitializeCriticalSection(&lock);
+	InitializeConditionVariable(&work);
+	
+	thread = CreateThread(NULL, 0, decoder_thread, NULL, 0, NULL);
+	int started = thread != NULL;
+#else
+	int started = pthread_create(&thread, NULL, decoder_thread, NULL) == 0;
+#endif
+
+	if (started) {
+		atexit(stop_decoder);
+	} else {
+		PERSE_WARNING(PERSE_LOG_GENERAL, "no thread for decoding images, they will hold up frames\n");
+	}
+	
+	decoder_state = started ? DECODER_RUNNING : DECODER_SYNCHRONOUS;
+}
+
+static void queue_decode(perse_image_t* image) {
+	if (decoder_state == DECODER_STOPPED) start_decoder();
+	
+	if (decoder_state == DECODER_SYNCHRONOUS) {
+		decode(image);
+		finish(image);
+		return;
+	}
+	
+	lock_jobs();
+	image->next_job = NULL;
+	if (job_tail) {
+		job_tail->next_job = image;
+	} else {
+		job_head = image;
+	}
+	job_tail = image;
+	signal_jobs();
+	unlock_jobs();
+}
+
+/*
+	CACHE
+*/
+
+static unsigned hash_key(const char* path, int width, int height) {
+	// FNV-1a, same as everywhere else
+	unsigned hash = 2166136261u;
+	for (const char* c = path; *c; c++) {
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+	hash = (hash ^ (unsigned)width) * 16777619u;
+	hash = (hash ^ (unsigned)height) * 16777619u;
+	return hash;
+}
+
+static void unlink_lru(perse_image_t* image) {
+	if (image->newer) image->newer->older = image->older; else newest = image->older;
+	if (image->older) image->older->newer = image->newer; else oldest = image->newer;
+	image->newer = image->older = NULL;
+}
+
+static void link_lru(perse_image_t* image) {
+	image->older = newest;
+	image->newer = NULL;
+	if (newest) newest->newer = image; else oldest = image;
+	newest = image;
+}
+
+static void remove_image(perse_image_t* image) {
+	perse_image_t** it = &buckets[image->hash & (IMAGE_BUCKETS - 1)];
+	while (*it != image) it = &(*it)->next_in_bucket;
+	*it = image->next_in_bucket;
+	
+	unlink_lru(image);
+	cache_bytes -= image->bytes;
+	
+	if (image->system && image->destroy_system) image->destroy_system(image->system);
+	
+	free(image->pixels);
+	free(image->path);
+	free(image);
+}
+
+// throws out whatever isn't in use until the cache fits its budget
+static void trim() {
+	perse_image_t* image = oldest;
+	while (image && cache_bytes > cache_limit) {
+		perse_image_t* newer = image->newer;
+		if (!image->references && image->state != PERSE_IMAGE_LOADING) remove_image(image);
+		image = newer;
+	}
+}
+
+/// Finds a decoded image.
+/// Looks up the image file at `path`, scaled down or up to fit inside of
+/// `width` and `height`, keeping its aspect ratio. If it isn't in the cache,
+/// it gets queued up for decoding and is returned in the LOADING state. The
+/// caller has to increment its `references` for as long as it is used.
+/// @return Shared image.
+perse_image_t* perse_LoadImage(const char* path, int width, int height) {
+	if (width < 1) width = 1;
+	if (height < 1) height = 1;
+	
+	unsigned hash = hash_key(path, width, height);
+	perse_image_t** bucket = &buckets[hash & (IMAGE_BUCKETS - 1)];
+	
+	for (perse_image_t* image = *bucket; image; image = image->next_in_bucket) {
+		if (image->hash != hash || image->fit_w != width || image->fit_h != height ||
+			strcmp(image->path, path) != 0) continue;
+		
+		unlink_lru(image);
+		link_lru(image);
+		return image;
+	}
+	
+	perse_image_t* image = calloc(1, sizeof(perse_image_t));
+	image->path = malloc(strlen(path) + 1);
+	strcpy(image->path, path);
+	image->fit_w = width;
+	image->fit_h = height;
+	image->hash = hash;
+	image->bytes = sizeof(perse_image_t) + strlen(path) + 1;
+	
+	image->next_in_bucket = *bucket;
+	*bucket = image;
+	link_lru(image);
+	cache_bytes += image->bytes;
+	
+	queue_decode(image);
+	
+	return image;
+}
+
+/// Marks images that were decoded since the last call as done.
+/// They become READY, or FAILED if they couldn't be decoded.
+/// @return Number of images that are done.
+int perse_FinishImages() {
+	if (decoder_state == DECODER_STOPPED) return 0;
+	
+	lock_jobs();
+	perse_image_t* image = finished;
+	finished = NULL;
+	unlock_jobs();
+	
+	int count = 0;
+	for (; image; image = image->next_job, count++) {
+		image->state = image->failed ? PERSE_IMAGE_FAILED : PERSE_IMAGE_READY;
+		cache_bytes += (size_t)image->width * image->height * 4;
+		
+		if (image->failed) {
+			PERSE_WARNING(PERSE_LOG_GENERAL, "can't decode image %s\n", image->path);
+		}
+	}
+	
+	if (count) trim();
+	
+	return count;
+}
+
+/// Sets the budget of the image cache.
+/// Decoded images that nothing uses get thrown out once the cache holds more
+/// than `bytes`, oldest first. Defaults to 32 MB.
+void perse_SetImageCacheLimit(size_t bytes) {
+	cache_limit = bytes;
+	trim();
+}
+
+/// Sets a decoder for image files.
+/// It gets tried before the built-in BMP, PPM and PAM decoders, on the
+/// decoding thread, so it has to be safe to call from there. Set it before
+/// any images are loaded.
+void perse_SetImageDecoder(perse_image_decoder_t image_decoder) {
+	decoder = image_decoder;
+}
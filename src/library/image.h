@@ -0,0 +1,57 @@
+#ifndef PERSE_IMAGE_H
+#define PERSE_IMAGE_H
+
+#include "property.h"
+
+#include <stddef.h>
+
+typedef enum {
+	PERSE_IMAGE_LOADING = 0,	//< still being decoded, draw a placeholder
+	PERSE_IMAGE_READY,			//< `pixels` can be drawn
+	PERSE_IMAGE_FAILED,			//< couldn't be decoded, stays a placeholder
+} perse_image_state_t;
+
+// image buttons leave this much space around their image, on each side
+#define PERSE_IMAGE_BUTTON_PADDING 4
+
+/// Decoded image, scaled to fit a size.
+/// Shared by everything that shows the same file at the same size. Only
+/// `state` can be looked at before it is READY, the rest is being written by
+/// the decoding thread until then. A backend can keep its own copy of the
+/// pixels in `system`, which gets freed with `destroy_system` when the image
+/// is thrown out of the cache.
+struct perse_image {
+	int state;						//< perse_image_state_t
+	int width, height;				//< what it was scaled to
+	unsigned char* pixels;			//< RGBA, row by row, not premultiplied
+	
+	void* system;					//< for the backend
+	void (*destroy_system)(void*);
+	
+	int references;					//< properties that point to it
+	
+	// the rest belongs to the cache, see image.c
+	char* path;
+	int fit_w, fit_h;				//< size it was asked to fit, part of the key
+	unsigned hash;
+	size_t bytes;
+	char failed;
+	
+	struct perse_image* next_in_bucket;
+	struct perse_image* newer;		//< least recently used order
+	struct perse_image* older;
+	struct perse_image* next_job;	//< decoding queue, then finished list
+};
+
+/// Decodes an image file into RGBA pixels, allocated with malloc().
+/// Called on the decoding thread, so it can't touch any widgets.
+/// @return Pixels, or NULL if it can't decode the file.
+typedef unsigned char* (*perse_image_decoder_t)(const char* path, int* width, int* height);
+
+perse_image_t* perse_LoadImage(const char* path, int width, int height);
+int perse_FinishImages();
+
+void perse_SetImageCacheLimit(size_t bytes);
+void perse_SetImageDecoder(perse_image_decoder_t decoder);
+
+#endif // PERSE_IMAGE_H
@@ -2,6 +2,10 @@
 
 #include "perse.h"
 #include "backend.h"
+#include "stats.h"
+#include "record.h"
+#include "canvas.h"
+#include "image.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -30,16 +34,80 @@
 	We start at the root and recursively calculate the position of each child
 	widget in its parent.
 	
+	MORE THAN ONE WINDOW
+	
+	The root can also be an APPLICATION, which isn't shown anywhere and only
+	holds top-level windows. Each of those windows gets laid out on its own,
+	and only if something in it has changed since the last layout, so that a
+	change in one window leaves the others alone. The apply list already only
+	has what changed, and resizing is done per window, see perse_ResizeLayout().
+	
 */
 
-/// Merges widget trees.
-/// The `dst` tree should be the tree that already has layout calculated for it
-/// and changes applied to it, but any two trees should work.
-/// The `src` tree will be completely destroyed.
-void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
+/*
+	APPLY LIST
+	
+	perse_ApplyChanges() doesn't walk the tree. Instead, perse_MergeTree() and
+	the layout passes put every widget whose properties or geometry changed on
+	the apply list, and only those widgets are visited, parents before their
+	children.
+	
+	Widgets that are not yet `mounted` in the backend, either because they are
+	new or because they were culled, get applied together with everything
+	below them. So do scroll panels and tab groups, since what is shown in them
+	depends on more than their own geometry. Everything else is applied one
+	widget at a time.
+*/
+
+typedef struct {
+	perse_widget_t* widget;
+	int depth;
+} apply_entry_t;
+
+static struct {
+	int count;
+	int capacity;
+	apply_entry_t* entry;
+} apply_list;
+
+static void queue_apply(perse_widget_t* widget) {
+	if (widget->queued) return;
+	widget->queued = 1;
+	
+	if (apply_list.count == apply_list.capacity) {
+		apply_list.capacity = apply_list.capacity ? apply_list.capacity * 2 : 64;
+		apply_list.entry = realloc(apply_list.entry,
+			sizeof(apply_entry_t) * apply_list.capacity);
+	}
+	
+	widget->queued_at = apply_list.count;
+	apply_list.entry[apply_list.count++].widget = widget;
+}
+
+// for widgets that get destroyed before they are applied. the last entry
+// takes its place, so that destroying a whole tree doesn't search the list
+// for each widget
+static void unqueue_apply(perse_widget_t* widget) {
+	perse_widget_t* last = apply_list.entry[--apply_list.count].widget;
+	apply_list.entry[widget->queued_at].widget = last;
+	last->queued_at = widget->queued_at;
+	
+	widget->queued = 0;
+}
+
+// callbacks can't change the size of anything, so a widget that only got
+// new callbacks keeps its measurements. this matters for trees loaded from a
+// snapshot, which get all of their callbacks during the first merge. neither
+// can what a canvas draws, see canvas.c
+static char affects_layout(perse_property_t* property) {
+	return property->type != PERSE_TYPE_CALLBACK &&
+		property->type != PERSE_TYPE_DRAW_LIST;
+}
+
+static void merge(perse_widget_t* dst, perse_widget_t* src) {
 	// assume that types of dst and src are the same
 	if (dst->type != src->type) {
-		perse_Log("FATAL ERROR: DIFFING TYPE MISMATCH\n");
+		PERSE_FATAL(PERSE_LOG_LAYOUT, "diffing type mismatch\n");
 		abort();
 	}
 	
@@ -56,8 +124,22 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 				continue;
 			}
 			
+			PERSE_STATS_COUNT(properties_compared, 1);
+			
 			if (!perse_IsPropertyMatching(dst_prop, src_prop)) {
-				perse_CopyPropertyValue(dst_prop, src_prop);
+				PERSE_STATS_COUNT(properties_copied, 1);
+				
+				// the backend only needs to redraw what is different
+				if (dst_prop->type == PERSE_TYPE_DRAW_LIST &&
+					src_prop->type == PERSE_TYPE_DRAW_LIST) {
+					perse_DiffDrawList(dst_prop->draw_list, src_prop->draw_list,
+						dst_prop->changed);
+				}
+				
+				// src is destroyed right after, so its value can be taken
+				perse_MovePropertyValue(dst_prop, src_prop);
+				if (affects_layout(dst_prop)) dst->changed = 1;
+				queue_apply(dst);
 			}
 			
 			perse_RemoveProperty(src, src_prop);
@@ -75,10 +157,14 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 	while (prop) {
 		perse_property_t* next = prop->next;
 		
+		PERSE_STATS_COUNT(properties_copied, 1);
+		
 		perse_RemoveProperty(src, prop);
 		perse_AddProperty(dst, prop);
 		
 		prop->changed = 1;
+		if (affects_layout(prop)) dst->changed = 1;
+		queue_apply(dst);
 		
 		prop = next;
 	}
@@ -91,15 +177,34 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 		dst->changed = 1;
 	}
 	
-	// move user pointer
-	if (dst->destroy) {
-		dst->destroy(dst->user);
+	// if the user data of both widgets is of the same kind, the frontend can
+	// update the old one from the new one and keep it, otherwise the old one
+	// gets thrown away and replaced by the new one
+	if (dst->user && src->user && dst->merge_user
+		&& dst->merge_user == src->merge_user) {
+		dst->merge_user(dst->user, src->user);
+	} else {
+		if (dst->destroy) {
+			dst->destroy(dst->user);
+		}
+		dst->user = src->user;
+		dst->destroy = src->destroy;
+		dst->merge_user = src->merge_user;
+		
+		src->user = NULL;
+		src->destroy = NULL;
+		src->merge_user = NULL;
 	}
-	dst->user = src->user;
-	dst->destroy = src->destroy;
 	
-	src->user = NULL;
-	src->destroy = NULL;
+	// the user's pointer to the new widget has to point to the one that stays.
+	// if the old one had a different pointer, that one is let go
+	if (src->ref) {
+		if (dst->ref && dst->ref != src->ref) *dst->ref = NULL;
+		
+		dst->ref = src->ref;
+		*dst->ref = dst;
+		src->ref = NULL;
+	}
 	
 	// compare children
 	perse_widget_t* dst_widg = dst->child;
@@ -117,7 +222,7 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 				
 				// merge if type matches
 				if (src_widg->type == dst_widg->type) {
-					perse_MergeTree(dst_widg, src_widg);
+					merge(dst_widg, src_widg);
 					
 					goto next;
 				}
@@ -125,10 +230,11 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 				// otherwise replace
 				perse_widget_t* next = dst_widg->next;
 				
-				perse_BackendDestroyWidget(dst_widg);
+				if (dst_widg->system) perse_BackendDestroyWidget(dst_widg);
 				
 				perse_SetParent(dst_widg, NULL);
 				perse_SetParent(src_widg, dst);
+				queue_apply(src_widg);
 				
 				perse_DestroyWidget(dst_widg);
 				
@@ -143,7 +249,7 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 		if (src_widg) {
 			// merge if type matches
 			if (src_widg->type == dst_widg->type) {
-				perse_MergeTree(dst_widg, src_widg);
+				merge(dst_widg, src_widg);
 				
 				goto next;
 			}
@@ -151,10 +257,12 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 			// otherwise replace
 			perse_widget_t* next = dst_widg->next;
 			
-			perse_BackendDestroyWidget(dst_widg);
+			// culled widgets aren't in the backend
+			if (dst_widg->system) perse_BackendDestroyWidget(dst_widg);
 			
 			perse_SetParent(src_widg, NULL);
 			perse_Substitute(dst_widg, src_widg);
+			queue_apply(src_widg);
 			
 			perse_DestroyWidget(dst_widg);
 			
@@ -166,6 +274,7 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 		perse_widget_t* next = dst_widg->next;
 		
 		perse_DestroyWidget(dst_widg);
+		dst->changed = 1;
 		
 		dst_widg = next;
 		
@@ -182,260 +291,2009 @@ void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
 	while (src_widg) {
 		perse_widget_t* next = src_widg->next;
 		perse_AddChild(dst, src_widg);
+		queue_apply(src_widg);
 		src_widg = next;
 	}
 	
+	// if anything below has changed, then so has the layout of this widget.
+	// new widgets start out as changed, so they get caught here too
+	for (perse_widget_t* w = dst->child; w; w = w->next) {
+		if (w->changed) dst->changed = 1;
+	}
+	
 	// src widget is now childless, time to kill it
 	perse_DestroyWidget(src);
 }
 
-// this function calculates `want` size for widgets. basically for each widget
-// we recursively find what are the minimum/maximum sizes for its child widgets
-// and add them together
-static void calculate_want(perse_widget_t* widget) {
-	
-	// for leaves we just copy constraint into want
-	if (!widget->child) {
-		memcpy(&widget->want_size, &widget->constraint_size,
-				sizeof(widget->want_size));
-		return;
+/// Merges widget trees.
+/// The `dst` tree should be the tree that already has layout calculated for it
+/// and changes applied to it, but any two trees should work.
+/// The `src` tree will be completely destroyed.
+void perse_MergeTree(perse_widget_t* dst, perse_widget_t* src) {
+	PERSE_STATS_BEGIN(PERSE_PHASE_MERGE);
+	merge(dst, src);
+	PERSE_STATS_END(PERSE_PHASE_MERGE);
+}
+
+// finds an integer property, or returns `fallback` if the widget has none
+static int property_integer(perse_widget_t* widget, perse_name_t name,
+							int fallback) {
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (p->name == name && p->type == PERSE_TYPE_INTEGER) return p->integer;
 	}
+	return fallback;
+}
+
+/*
+	BOX DISTRIBUTION
 	
-	// for other widgets, calculate their want first
-	for (perse_widget_t* c = widget->child; c; c = c->next) {
-		calculate_want(c);
+	Each child of a horizontal/vertical layout gets `stretch * t` pixels along
+	the layout axis, clamped to its min/max want, and we look for the `t` at
+	which all of the children add up to the size of the layout.
+	
+	The total is a piecewise linear function of `t` that bends only at the
+	points where a child starts growing past its min (`min / stretch`) or stops
+	growing at its max (`max / stretch`). So we sort these thresholds once and
+	sweep over them, keeping a running total, until we find the segment that
+	contains the layout size. This is O(n log n) instead of rescanning all of
+	the children each time one of them hits a constraint.
+	
+	Children with a stretch of 0 never grow past their minimum.
+*/
+
+typedef struct {
+	double threshold;		//< value of `t` at which the event happens
+	int child;				//< index into the child array
+	char saturate;			//< 0 if child starts growing, 1 if it stops
+} box_event_t;
+
+typedef struct {
+	int min, max, stretch;	//< inputs, max is -1 if unbounded
+	int size;				//< output
+} box_child_t;
+
+// scratch space, reused between layout calls so that we don't malloc() for
+// every layout widget on every frame
+static box_child_t* box_children = NULL;
+static box_event_t* box_events = NULL;
+static int box_capacity = 0;
+
+static void reserve_box(int count) {
+	if (count <= box_capacity) return;
+	
+	box_capacity = count * 2;
+	box_children = realloc(box_children, sizeof(box_child_t) * box_capacity);
+	box_events = realloc(box_events, sizeof(box_event_t) * box_capacity * 2);
+}
+
+static int compare_box_events(const void* a, const void* b) {
+	const box_event_t* e1 = a;
+	const box_event_t* e2 = b;
+	
+	if (e1->threshold < e2->threshold) return -1;
+	if (e1->threshold > e2->threshold) return 1;
+	
+	// start growing before stopping, so that min == max children work out
+	return e1->saturate - e2->saturate;
+}
+
+// fills out `size` for the first `count` entries of `box_children` so that
+// they add up to `space`, or as close as their constraints allow
+static void solve_box(int count, int space) {
+	
+	// collect thresholds. `fixed` is the sum of sizes that do not depend on
+	// `t` and `slope` is the sum of growing stretches
+	int events = 0;
+	long long fixed = 0;
+	
+	for (int i = 0; i < count; i++) {
+		box_child_t* c = &box_children[i];
+		
+		if (c->min < 0) c->min = 0;
+		if (c->max != -1 && c->max < c->min) c->max = c->min;
+		if (c->stretch < 0) c->stretch = 0;
+		
+		fixed += c->min;
+		
+		if (!c->stretch || c->min == c->max) continue;
+		
+		box_events[events++] = (box_event_t){
+			.threshold = (double)c->min / c->stretch,
+			.child = i,
+			.saturate = 0
+		};
+		
+		if (c->max == -1) continue;
+		
+		box_events[events++] = (box_event_t){
+			.threshold = (double)c->max / c->stretch,
+			.child = i,
+			.saturate = 1
+		};
 	}
 	
-	// otherwise we calculate the want size
-	switch (widget->type) {
-		case PERSE_WIDGET_HORIZONTAL_LAYOUT: {
-			// min height -> largest child min height
-			// min width -> sum of child min width
-			int largest_min = -1;
-			int width_sum = 0;
+	qsort(box_events, events, sizeof(box_event_t), compare_box_events);
 	
-			for (perse_widget_t* c = widget->child; c; c = c->next) {
-				if (c->constraint_size.min.h > largest_min) {
-					largest_min = c->constraint_size.min.h;
-				}
-				if (c->constraint_size.min.w > 0) {
-					width_sum += c->constraint_size.min.w;
-				}
-			}
-			
-			widget->want_size.min.h = largest_min;
-			widget->want_size.min.w = width_sum;
-			
-			widget->want_size.max.h = widget->constraint_size.max.h;
-			widget->want_size.max.w = widget->constraint_size.max.w;
-			
-		} break;
+	// sweep until we find the `t` that fills out the layout
+	long long slope = 0;
+	double t = 0.0;
+	char solved = fixed >= space;
+	
+	for (int i = 0; i < events && !solved; i++) {
+		box_event_t* e = &box_events[i];
+		box_child_t* c = &box_children[e->child];
 		
-		case PERSE_WIDGET_VERTICAL_LAYOUT: {
-			// min width -> largest child min width
-			// min height -> sum of child min height
-			int largest_min = -1;
-			int height_sum = 0;
-			
-			for (perse_widget_t* c = widget->child; c; c = c->next) {
-				if (c->constraint_size.min.w > largest_min) {
-					largest_min = c->constraint_size.min.w;
-				}
-				if (c->constraint_size.min.h > 0) {
-					height_sum += c->constraint_size.min.h;
-				}
-			}
-			
-			widget->want_size.min.w = largest_min;
-			widget->want_size.min.h = height_sum;
-			
-			widget->want_size.max.w = widget->constraint_size.max.w;
-			widget->want_size.max.h = widget->constraint_size.max.h;
-		} break;
+		if (slope && fixed + slope * e->threshold >= space) break;
 		
-		// TODO: implement
-		case PERSE_WIDGET_GRID_LAYOUT:
-		case PERSE_WIDGET_FLOW_LAYOUT:
-		case PERSE_WIDGET_SPLITTER_LAYOUT:
-		case PERSE_WIDGET_FLEX_LAYOUT:
+		t = e->threshold;
 		
-		// child widgets irrelevant; copy contraint into want
-		case PERSE_WIDGET_ITEM:
-		case PERSE_WIDGET_LIST_BOX:
-			memcpy(&widget->want_size, &widget->constraint_size,
-				sizeof(widget->want_size));
-		break;
+		if (e->saturate) {
+			slope -= c->stretch;
+			fixed += c->max;
+		} else {
+			slope += c->stretch;
+			fixed -= c->min;
+		}
+	}
+	
+	if (!solved && slope) {
+		t = (double)(space - fixed) / slope;
+	}
+	
+	// assign sizes. clamped children get their min/max, growing children get
+	// rounded so that their running total stays exact and no pixels are lost
+	double total = 0.0;
+	long long assigned = 0;
+	
+	for (int i = 0; i < count; i++) {
+		box_child_t* c = &box_children[i];
 		
-		// window just stretches its child to be same size as it is
-		case PERSE_WIDGET_WINDOW:
-			for (perse_widget_t* c = widget->child; c; c = c->next) {
-				c->want_size.min.w = widget->current_size.w;
-				c->want_size.min.h = widget->current_size.h;
-				
-				c->want_size.max.w = widget->current_size.w;
-				c->want_size.max.h = widget->current_size.h;
-			}
-		break;
+		double size = (double)c->stretch * t;
 		
-		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
-		default: {
-			int min_width = -1;
-			int min_height = -1;
-			
-			for (perse_widget_t* c = widget->child; c; c = c->next) {
-				if (c->constraint_size.min.w > min_width) {
-					min_width = c->constraint_size.min.w;
-				}
-				if (c->constraint_size.min.h > min_height) {
-					min_height = c->constraint_size.min.h;
-				}
-			}
-			
-			widget->want_size.min.w = min_width;
-			widget->want_size.min.h = min_height;
-			
-			widget->want_size.max.w = widget->constraint_size.max.w;
-			widget->want_size.max.h = widget->constraint_size.max.h;
+		if (size <= c->min) {
+			c->size = c->min;
+		} else if (c->max != -1 && size >= c->max) {
+			c->size = c->max;
+		} else {
+			total += size;
+			c->size = (int)((long long)(total + 0.5) - assigned);
+			assigned += c->size;
 		}
 	}
 }
 
-static void calculate_size(perse_widget_t* widget) {
+// sizes the children of a box layout along its axis
+static void distribute(perse_widget_t* widget, char horizontal) {
+	int count = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) count++;
 	
-	// this will only apply to root
-	if (!widget->current_size.w || !widget->current_size.h) {
-		widget->current_size.w = widget->constraint_size.min.w;
-		widget->current_size.h = widget->constraint_size.min.h;
+	reserve_box(count);
+	
+	int index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		box_child_t* c = &box_children[index];
+		
+		c->min = horizontal ? w->want_size.min.w : w->want_size.min.h;
+		c->max = horizontal ? w->want_size.max.w : w->want_size.max.h;
+		c->stretch = property_integer(w, PERSE_NAME_STRETCH, 1);
 	}
 	
-	if (!widget->child) return;
+	solve_box(count, horizontal ? widget->current_size.w : widget->current_size.h);
 	
-	// for each child, calculate their SIZE based on their WANT
-	switch (widget->type) {
-		case PERSE_WIDGET_HORIZONTAL_LAYOUT: {
-			
-			// mark all as unprocessed
-			for (perse_widget_t* w = widget->child; w; w = w->next) w->current_size.w = -1;
-			
-			for (;;) {
+	index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		if (horizontal) {
+			w->current_size.w = box_children[index].size;
+		} else {
+			w->current_size.h = box_children[index].size;
+		}
+	}
+}
+
+/*
+	GRID LAYOUT
 	
-				// divide free space equally among the widgets
-				int widgets_left = 0;
-				int used_width = 0;
-				for (perse_widget_t* w = widget->child; w; w = w->next) {
-					if (w->current_size.w == -1) {
-						widgets_left++;
-					} else {
-						used_width += w->current_size.w;
-					}
-				}
-				
-				if (!widgets_left) break;
-				
-				int width_left = widget->current_size.w - used_width;
-				int avg_width = width_left / widgets_left;
-				
-				// check if any constraint violated
-				char violated = 0;
-				for (perse_widget_t* w = widget->child; w; w = w->next) {
-					if (w->current_size.w != -1) {
-						continue;
-					} else if (w->want_size.max.w != -1 && w->want_size.max.w < avg_width) {
-						w->current_size.w = w->want_size.max.w;
-						violated = 1;
-					} else if (w->want_size.max.w != -1 && w->want_size.min.w > avg_width) {
-						w->current_size.w = w->want_size.min.w;
-						violated = 1;
-					}
-				}
+	Rows and columns are set with the ROWS and COLUMNS string properties on the
+	grid, for example "120 auto 1fr 2fr":
+	
+	- a number is a fixed track of that many pixels
+	- `auto` is as large as the largest widget inside of it
+	- `fr` tracks share the space that is left over, proportionally to their
+	  number (`fr` alone is the same as `1fr`), but never shrink below their
+	  contents, same as `auto`
+	
+	Children are placed with ROW/COLUMN and ROW_SPAN/COLUMN_SPAN properties.
+	Cells that point past the declared tracks get implicit `auto` tracks.
+	
+	The grid keeps a cache of its tracks in `widget->layout`. Each track
+	remembers the minimum size of its contents and each cell remembers the
+	widget, placement and want size that it had during the last layout. When a
+	cell changes, only the tracks that it covered before and covers now are
+	marked dirty and get their content size recomputed. The final track sizes
+	are only redistributed when the content sizes or the grid size change.
+*/
 
-				if (violated) continue;
-				
-				// assign average size to remaining widgets
-				for (perse_widget_t* w = widget->child; w; w = w->next) {
-					if (w->current_size.w < 0) {
-						w->current_size.w = avg_width;
-					}
-				}
-				
-				break;
-			}
-			
-			// set the heights
-			for (perse_widget_t* w = widget->child; w; w = w->next) {
-				if (w->want_size.min.h < widget->current_size.h) {
-					w->current_size.h = w->want_size.min.h;
-				} else {
-					w->current_size.h = widget->current_size.h;
-				}
-			}
-			
-		} break;
+typedef enum {
+	GRID_TRACK_FIXED,
+	GRID_TRACK_AUTO,
+	GRID_TRACK_FRACTION
+} grid_track_kind_t;
+
+typedef struct {
+	grid_track_kind_t kind;
+	int value;				//< pixels for fixed, weight for fraction
+	
+	int content;			//< largest min want of widgets in the track
+	char dirty;				//< `content` needs to be recalculated
+	
+	int size;				//< resolved size
+	int offset;				//< resolved position
+} grid_track_t;
+
+typedef struct {
+	perse_widget_t* widget;
+	int row, column;
+	int row_span, column_span;
+	perse_size_t want;
+} grid_cell_t;
+
+typedef struct {
+	int count, declared;	//< all tracks and tracks from the spec string
+	grid_track_t* track;
+	char* spec;				//< copy of the spec string
+	
+	int space;				//< size that the tracks were resolved for
+	char resolve;			//< tracks need to be resolved again
+} grid_axis_t;
+
+typedef struct {
+	grid_axis_t columns;
+	grid_axis_t rows;
+	
+	int cell_count;
+	int cell_capacity;
+	grid_cell_t* cell;
+} grid_cache_t;
+
+// finds a string property, or returns NULL if the widget has none
+static const char* property_string(perse_widget_t* widget, perse_name_t name) {
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (p->name == name && p->type == PERSE_TYPE_STRING) return p->string;
+	}
+	return NULL;
+}
+
+// makes sure that the axis has at least `count` tracks
+static void grid_reserve(grid_axis_t* axis, int count) {
+	if (count <= axis->count) return;
+	
+	axis->track = realloc(axis->track, sizeof(grid_track_t) * count);
+	
+	for (int i = axis->count; i < count; i++) {
+		axis->track[i] = (grid_track_t){
+			.kind = GRID_TRACK_AUTO,
+			.dirty = 1
+		};
+	}
+	
+	axis->count = count;
+	axis->resolve = 1;
+}
+
+// re-parses the track spec, if it has changed since last layout
+static void grid_parse(grid_axis_t* axis, const char* spec) {
+	if (!spec) spec = "";
+	if (axis->spec && strcmp(axis->spec, spec) == 0) return;
+	
+	free(axis->spec);
+	axis->spec = malloc(strlen(spec) + 1);
+	strcpy(axis->spec, spec);
+	
+	axis->count = 0;
+	axis->declared = 0;
+	
+	const char* token = spec;
+	while (*token) {
+		while (*token == ' ' || *token == ',') token++;
+		if (!*token) break;
 		
-		case PERSE_WIDGET_VERTICAL_LAYOUT: {
-			
-			// mark all as unprocessed
-			for (perse_widget_t* w = widget->child; w; w = w->next) w->current_size.h = -1;
-			
-			for (;;) {
+		const char* end = token;
+		while (*end && *end != ' ' && *end != ',') end++;
+		
+		grid_reserve(axis, axis->declared + 1);
+		grid_track_t* track = &axis->track[axis->declared++];
+		
+		char* number_end;
+		long number = strtol(token, &number_end, 10);
+		
+		if (end - token == 4 && strncmp(token, "auto", 4) == 0) {
+			track->kind = GRID_TRACK_AUTO;
+		} else if (end - number_end == 2 && strncmp(number_end, "fr", 2) == 0) {
+			track->kind = GRID_TRACK_FRACTION;
+			track->value = number_end == token ? 1 : (int)number;
+		} else if (number_end == end && number_end != token) {
+			track->kind = GRID_TRACK_FIXED;
+			track->value = (int)number;
+		} else {
+			PERSE_WARNING(PERSE_LOG_LAYOUT, "GRID_LAYOUT track '%.*s' not recognized\n",
+				(int)(end - token), token);
+			track->kind = GRID_TRACK_AUTO;
+		}
+		
+		token = end;
+	}
 	
-				// divide free space equally among the widgets
-				int widgets_left = 0;
-				int used_height = 0;
-				for (perse_widget_t* w = widget->child; w; w = w->next) {
-					if (w->current_size.h == -1) {
-						widgets_left++;
-					} else {
-						used_height += w->current_size.h;
-					}
-				}
-				
-				if (!widgets_left) break;
-				
-				int height_left = widget->current_size.h - used_height;
-				int avg_height = height_left / widgets_left;
-				
-				// check if any constraint violated
-				char violated = 0;
-				for (perse_widget_t* w = widget->child; w; w = w->next) {
-					if (w->current_size.h != -1) {
-						continue;
-					} else if (w->want_size.max.h != -1 && w->want_size.max.h < avg_height) {
-						w->current_size.h = w->want_size.max.h;
-						violated = 1;
-					} else if (w->want_size.max.h != -1 && w->want_size.min.h > avg_height) {
-						w->current_size.h = w->want_size.min.h;
-						violated = 1;
-					}
-				}
+	for (int i = 0; i < axis->count; i++) axis->track[i].dirty = 1;
+	axis->resolve = 1;
+}
 
-				if (violated) continue;
-				
-				// assign average size to remaining widgets
-				for (perse_widget_t* w = widget->child; w; w = w->next) {
-					if (w->current_size.h < 0) {
-						w->current_size.h = avg_height;
-					}
-				}
-				
-				break;
+// marks tracks covered by a span as dirty
+static void grid_mark(grid_axis_t* axis, int first, int span) {
+	for (int i = first; i < first + span && i < axis->count; i++) {
+		axis->track[i].dirty = 1;
+	}
+}
+
+// recalculates content sizes of dirty tracks on one axis
+static void grid_measure(grid_cache_t* grid, grid_axis_t* axis, char horizontal) {
+	
+	// spanning cells spread over all of their tracks, so if one of them is
+	// dirty, all of them need to be recalculated
+	for (char spread = 1; spread;) {
+		spread = 0;
+		for (int i = 0; i < grid->cell_count; i++) {
+			grid_cell_t* cell = &grid->cell[i];
+			int first = horizontal ? cell->column : cell->row;
+			int span = horizontal ? cell->column_span : cell->row_span;
+			
+			if (span < 2) continue;
+			
+			char any = 0, all = 1;
+			for (int t = first; t < first + span; t++) {
+				any |= axis->track[t].dirty;
+				all &= axis->track[t].dirty;
 			}
 			
-			// set the widths
-			for (perse_widget_t* w = widget->child; w; w = w->next) {
-				if (w->want_size.min.w < widget->current_size.w) {
-					w->current_size.w = w->want_size.min.w;
-				} else {
-					w->current_size.w = widget->current_size.w;
-				}
+			if (any && !all) {
+				grid_mark(axis, first, span);
+				spread = 1;
 			}
-		} break;
-		
-		// TODO: implement
-		case PERSE_WIDGET_GRID_LAYOUT:
+		}
+	}
+	
+	char any_dirty = 0;
+	for (int t = 0; t < axis->count; t++) {
+		if (!axis->track[t].dirty) continue;
+		axis->track[t].content = 0;
+		any_dirty = 1;
+	}
+	
+	if (!any_dirty) return;
+	
+	// single track cells first
+	for (int i = 0; i < grid->cell_count; i++) {
+		grid_cell_t* cell = &grid->cell[i];
+		int first = horizontal ? cell->column : cell->row;
+		int span = horizontal ? cell->column_span : cell->row_span;
+		int want = horizontal ? cell->want.w : cell->want.h;
+		
+		if (span != 1 || !axis->track[first].dirty) continue;
+		
+		if (want > axis->track[first].content) {
+			axis->track[first].content = want;
+		}
+	}
+	
+	// then spanning cells put whatever doesn't fit into the last non-fixed
+	// track that they cover
+	for (int i = 0; i < grid->cell_count; i++) {
+		grid_cell_t* cell = &grid->cell[i];
+		int first = horizontal ? cell->column : cell->row;
+		int span = horizontal ? cell->column_span : cell->row_span;
+		int want = horizontal ? cell->want.w : cell->want.h;
+		
+		if (span < 2 || !axis->track[first].dirty) continue;
+		
+		int covered = 0;
+		int flexible = -1;
+		for (int t = first; t < first + span; t++) {
+			grid_track_t* track = &axis->track[t];
+			if (track->kind == GRID_TRACK_FIXED) {
+				covered += track->value;
+			} else {
+				covered += track->content;
+				flexible = t;
+			}
+		}
+		
+		if (flexible != -1 && covered < want) {
+			axis->track[flexible].content += want - covered;
+		}
+	}
+	
+	for (int t = 0; t < axis->count; t++) axis->track[t].dirty = 0;
+	
+	axis->resolve = 1;
+}
+
+// minimum size of the whole axis
+static int grid_minimum(grid_axis_t* axis) {
+	int sum = 0;
+	for (int t = 0; t < axis->count; t++) {
+		grid_track_t* track = &axis->track[t];
+		sum += track->kind == GRID_TRACK_FIXED ? track->value : track->content;
+	}
+	return sum;
+}
+
+// gives sizes and offsets to the tracks of one axis
+static void grid_resolve(grid_axis_t* axis, int space) {
+	if (!axis->resolve && axis->space == space) return;
+	
+	reserve_box(axis->count);
+	
+	for (int t = 0; t < axis->count; t++) {
+		grid_track_t* track = &axis->track[t];
+		box_child_t* c = &box_children[t];
+		
+		switch (track->kind) {
+			case GRID_TRACK_FIXED:
+				c->min = c->max = track->value;
+				c->stretch = 0;
+				break;
+			case GRID_TRACK_AUTO:
+				c->min = c->max = track->content;
+				c->stretch = 0;
+				break;
+			case GRID_TRACK_FRACTION:
+				c->min = track->content;
+				c->max = -1;
+				c->stretch = track->value;
+				break;
+		}
+	}
+	
+	solve_box(axis->count, space);
+	
+	int offset = 0;
+	for (int t = 0; t < axis->count; t++) {
+		axis->track[t].size = box_children[t].size;
+		axis->track[t].offset = offset;
+		offset += box_children[t].size;
+	}
+	
+	axis->space = space;
+	axis->resolve = 0;
+}
+
+static void grid_want(perse_widget_t* widget) {
+	grid_cache_t* grid = widget->layout;
+	if (!grid) {
+		grid = calloc(1, sizeof(grid_cache_t));
+		widget->layout = grid;
+	}
+	
+	grid_parse(&grid->columns, property_string(widget, PERSE_NAME_COLUMNS));
+	grid_parse(&grid->rows, property_string(widget, PERSE_NAME_ROWS));
+	
+	int count = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) count++;
+	
+	if (count > grid->cell_capacity) {
+		grid->cell_capacity = count * 2;
+		grid->cell = realloc(grid->cell, sizeof(grid_cell_t) * grid->cell_capacity);
+	}
+	
+	// cells that went away leave their tracks dirty
+	for (int i = count; i < grid->cell_count; i++) {
+		grid_cell_t* cell = &grid->cell[i];
+		grid_mark(&grid->columns, cell->column, cell->column_span);
+		grid_mark(&grid->rows, cell->row, cell->row_span);
+	}
+	
+	// find out which of the cells have changed since last time
+	int index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		grid_cell_t cell = {
+			.widget = w,
+			.row = property_integer(w, PERSE_NAME_ROW, 0),
+			.column = property_integer(w, PERSE_NAME_COLUMN, 0),
+			.row_span = property_integer(w, PERSE_NAME_ROW_SPAN, 1),
+			.column_span = property_integer(w, PERSE_NAME_COLUMN_SPAN, 1),
+			.want = w->want_size.min
+		};
+		
+		if (cell.row < 0) cell.row = 0;
+		if (cell.column < 0) cell.column = 0;
+		if (cell.row_span < 1) cell.row_span = 1;
+		if (cell.column_span < 1) cell.column_span = 1;
+		if (cell.want.w < 0) cell.want.w = 0;
+		if (cell.want.h < 0) cell.want.h = 0;
+		
+		grid_reserve(&grid->columns, cell.column + cell.column_span);
+		grid_reserve(&grid->rows, cell.row + cell.row_span);
+		
+		grid_cell_t* old = &grid->cell[index];
+		if (index < grid->cell_count && memcmp(old, &cell, sizeof(cell)) == 0) {
+			continue;
+		}
+		
+		if (index < grid->cell_count) {
+			grid_mark(&grid->columns, old->column, old->column_span);
+			grid_mark(&grid->rows, old->row, old->row_span);
+		}
+		
+		grid_mark(&grid->columns, cell.column, cell.column_span);
+		grid_mark(&grid->rows, cell.row, cell.row_span);
+		
+		*old = cell;
+	}
+	
+	grid->cell_count = count;
+	
+	grid_measure(grid, &grid->columns, 1);
+	grid_measure(grid, &grid->rows, 0);
+	
+	widget->want_size.min.w = grid_minimum(&grid->columns);
+	widget->want_size.min.h = grid_minimum(&grid->rows);
+	
+	if (widget->constraint_size.min.w > widget->want_size.min.w) {
+		widget->want_size.min.w = widget->constraint_size.min.w;
+	}
+	if (widget->constraint_size.min.h > widget->want_size.min.h) {
+		widget->want_size.min.h = widget->constraint_size.min.h;
+	}
+	
+	widget->want_size.max.w = widget->constraint_size.max.w;
+	widget->want_size.max.h = widget->constraint_size.max.h;
+}
+
+static void grid_size(perse_widget_t* widget) {
+	grid_cache_t* grid = widget->layout;
+	
+	grid_resolve(&grid->columns, widget->current_size.w);
+	grid_resolve(&grid->rows, widget->current_size.h);
+	
+	for (int i = 0; i < grid->cell_count; i++) {
+		grid_cell_t* cell = &grid->cell[i];
+		perse_widget_t* w = cell->widget;
+		
+		grid_track_t* column = &grid->columns.track[cell->column];
+		grid_track_t* row = &grid->rows.track[cell->row];
+		grid_track_t* last_column = column + cell->column_span - 1;
+		grid_track_t* last_row = row + cell->row_span - 1;
+		
+		w->current_size.w = last_column->offset + last_column->size - column->offset;
+		w->current_size.h = last_row->offset + last_row->size - row->offset;
+		
+		if (w->want_size.max.w != -1 && w->current_size.w > w->want_size.max.w) {
+			w->current_size.w = w->want_size.max.w;
+		}
+		if (w->want_size.max.h != -1 && w->current_size.h > w->want_size.max.h) {
+			w->current_size.h = w->want_size.max.h;
+		}
+	}
+}
+
+static void grid_position(perse_widget_t* widget) {
+	grid_cache_t* grid = widget->layout;
+	
+	for (int i = 0; i < grid->cell_count; i++) {
+		grid_cell_t* cell = &grid->cell[i];
+		perse_widget_t* w = cell->widget;
+		
+		grid_track_t* column = &grid->columns.track[cell->column];
+		grid_track_t* row = &grid->rows.track[cell->row];
+		grid_track_t* last_column = column + cell->column_span - 1;
+		grid_track_t* last_row = row + cell->row_span - 1;
+		
+		int width = last_column->offset + last_column->size - column->offset;
+		int height = last_row->offset + last_row->size - row->offset;
+		
+		// widgets that are smaller than their cell get centered
+		w->position.x = column->offset + (width - w->current_size.w) / 2;
+		w->position.y = row->offset + (height - w->current_size.h) / 2;
+	}
+}
+
+static void grid_destroy(grid_cache_t* grid) {
+	free(grid->columns.track);
+	free(grid->columns.spec);
+	free(grid->rows.track);
+	free(grid->rows.spec);
+	free(grid->cell);
+	free(grid);
+}
+
+/*
+	FLOW LAYOUT
+	
+	Children are placed left to right and wrapped onto a new line when the next
+	one doesn't fit into the width of the layout. Lines are top aligned.
+	
+	The line breaks are cached in `widget->layout`, along with the widget and
+	size of every item. During want calculation we find the first item that
+	differs from the cache, and during size calculation we keep every line that
+	ends before that item and would still break at the same place with the new
+	width. Only the lines after that get broken and positioned again, so adding
+	an item at the end doesn't touch the lines before it and a resize only
+	reflows from the first line whose break actually moved.
+	
+	How tall the layout wants to be depends on the width that it gets, which
+	isn't known until the size pass. The want pass uses the width from the
+	last layout. If the size pass then gives it a width that breaks into a
+	different height, the layout asks for a second pass, see
+	perse_CalculateLayout(), which uses the new width.
+*/
+
+typedef struct {
+	perse_widget_t* widget;
+	perse_size_t size;
+} flow_item_t;
+
+typedef struct {
+	int first, end;			//< items in the line, [first, end)
+	int width;				//< sum of item widths
+	int height;				//< height of the tallest item
+	int offset;				//< vertical position of the line
+} flow_line_t;
+
+typedef struct {
+	int item_count;
+	int item_capacity;
+	flow_item_t* item;
+	
+	int line_count;
+	int line_capacity;
+	flow_line_t* line;
+	
+	int width;				//< width that the lines were broken for
+	int dirty_from;			//< first item that changed since the last break
+	
+	char reflow;			//< height came out different than the want
+	perse_widget_t* next_reflow;
+} flow_cache_t;
+
+// flow layouts that need a second pass, see perse_CalculateLayout()
+static perse_widget_t* flow_reflow = NULL;
+
+// size that a flow item gets, same rules as absolute layout
+static perse_size_t flow_item_size(perse_widget_t* w) {
+	const int default_size = 32;
+	perse_size_t size;
+	
+	if (w->want_size.min.w > 0) {
+		size.w = w->want_size.min.w;
+	} else if (w->want_size.max.w > 0) {
+		size.w = w->want_size.max.w;
+	} else {
+		size.w = default_size;
+	}
+	
+	if (w->want_size.min.h > 0) {
+		size.h = w->want_size.min.h;
+	} else if (w->want_size.max.h > 0) {
+		size.h = w->want_size.max.h;
+	} else {
+		size.h = default_size;
+	}
+	
+	return size;
+}
+
+// finds how tall the cached items would be, broken into lines for a width
+static int flow_height(flow_cache_t* flow, int width) {
+	int height = 0;
+	int line_width = 0;
+	int line_height = 0;
+	
+	for (int i = 0; i < flow->item_count; i++) {
+		perse_size_t size = flow->item[i].size;
+		
+		if (line_width && line_width + size.w > width) {
+			height += line_height;
+			line_width = 0;
+			line_height = 0;
+		}
+		
+		line_width += size.w;
+		if (size.h > line_height) line_height = size.h;
+	}
+	
+	return height + line_height;
+}
+
+static void flow_want(perse_widget_t* widget) {
+	flow_cache_t* flow = widget->layout;
+	if (!flow) {
+		flow = calloc(1, sizeof(flow_cache_t));
+		widget->layout = flow;
+	}
+	
+	int count = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) count++;
+	
+	if (count > flow->item_capacity) {
+		flow->item_capacity = count * 2;
+		flow->item = realloc(flow->item, sizeof(flow_item_t) * flow->item_capacity);
+	}
+	
+	int dirty_from = count < flow->item_count ? count : flow->item_count;
+	if (flow->dirty_from < dirty_from) dirty_from = flow->dirty_from;
+	
+	int widest = 0;
+	int tallest = 0;
+	
+	int index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		flow_item_t item = {
+			.widget = w,
+			.size = flow_item_size(w)
+		};
+		
+		if (item.size.w > widest) widest = item.size.w;
+		if (item.size.h > tallest) tallest = item.size.h;
+		
+		flow_item_t* old = &flow->item[index];
+		if (index >= flow->item_count || old->widget != item.widget ||
+			old->size.w != item.size.w || old->size.h != item.size.h) {
+			if (index < dirty_from) dirty_from = index;
+			*old = item;
+		}
+	}
+	
+	flow->item_count = count;
+	flow->dirty_from = dirty_from;
+	
+	// the widest item must fit. line breaks depend on the width, so before
+	// the first layout all that we know is that there is at least one line
+	widget->want_size.min.w = widest;
+	widget->want_size.min.h = flow->width ? flow_height(flow, flow->width) : tallest;
+	
+	if (widget->constraint_size.min.w > widget->want_size.min.w) {
+		widget->want_size.min.w = widget->constraint_size.min.w;
+	}
+	if (widget->constraint_size.min.h > widget->want_size.min.h) {
+		widget->want_size.min.h = widget->constraint_size.min.h;
+	}
+	
+	widget->want_size.max.w = widget->constraint_size.max.w;
+	widget->want_size.max.h = widget->constraint_size.max.h;
+}
+
+// checks if a cached line would still be broken the same way
+static char flow_line_valid(flow_cache_t* flow, flow_line_t* line, int width) {
+	if (line->end > flow->dirty_from) return 0;
+	if (line->end == flow->dirty_from && line->end != flow->item_count) return 0;
+	
+	// a single item always gets a line to itself, even if it doesn't fit
+	if (line->width > width && line->end - line->first > 1) return 0;
+	
+	if (line->end == flow->item_count) return 1;
+	
+	return line->width + flow->item[line->end].size.w > width;
+}
+
+static void flow_size(perse_widget_t* widget) {
+	flow_cache_t* flow = widget->layout;
+	int width = widget->current_size.w;
+	
+	// find the first line that needs to be broken again
+	int keep = 0;
+	while (keep < flow->line_count && flow_line_valid(flow, &flow->line[keep], width)) {
+		keep++;
+	}
+	
+	if (keep == flow->line_count && flow->width == width &&
+		flow->dirty_from == flow->item_count) {
+		return;
+	}
+	
+	int first = 0;
+	int offset = 0;
+	if (keep) {
+		flow_line_t* last = &flow->line[keep - 1];
+		first = last->end;
+		offset = last->offset + last->height;
+	}
+	
+	flow->line_count = keep;
+	
+	// break the rest of the items into lines
+	while (first < flow->item_count) {
+		if (flow->line_count == flow->line_capacity) {
+			flow->line_capacity = flow->line_capacity ? flow->line_capacity * 2 : 16;
+			flow->line = realloc(flow->line, sizeof(flow_line_t) * flow->line_capacity);
+		}
+		
+		flow_line_t* line = &flow->line[flow->line_count++];
+		line->first = first;
+		line->offset = offset;
+		line->width = 0;
+		line->height = 0;
+		
+		int end = first;
+		while (end < flow->item_count) {
+			flow_item_t* item = &flow->item[end];
+			
+			if (end != first && line->width + item->size.w > width) break;
+			
+			item->widget->current_size = item->size;
+			item->widget->position.x = line->width;
+			item->widget->position.y = offset;
+			
+			line->width += item->size.w;
+			if (item->size.h > line->height) line->height = item->size.h;
+			
+			end++;
+		}
+		
+		line->end = end;
+		
+		first = end;
+		offset += line->height;
+	}
+	
+	flow->width = width;
+	flow->dirty_from = flow->item_count;
+	
+	// the parent was told the height for the old width
+	int height = offset;
+	if (height < widget->constraint_size.min.h) height = widget->constraint_size.min.h;
+	
+	if (height != widget->want_size.min.h && !flow->reflow) {
+		flow->reflow = 1;
+		flow->next_reflow = flow_reflow;
+		flow_reflow = widget;
+	}
+}
+
+static void flow_destroy(flow_cache_t* flow) {
+	free(flow->item);
+	free(flow->line);
+	free(flow);
+}
+
+/*
+	SPLITTER LAYOUT
+	
+	Children are panes, placed next to each other (or on top of each other, if
+	the VERTICAL property is set) with a divider between each of them. The
+	backend is responsible for the dividers and calls the ON_DRAG callback with
+	the pane before the divider and the new position of the divider.
+	
+	The share of the space that each pane gets is kept in `widget->layout`, so
+	that it survives re-renders without the user having to store it. The
+	shares start out proportional to the STRETCH of the panes and get reset if
+	the number of panes changes.
+	
+	A drag is handled by perse_SplitterDrag(), which resizes only the two panes
+	next to the divider, re-calculates their subtrees and applies them straight
+	to the backend, without going through the whole tree.
+*/
+
+#define SPLITTER_DIVIDER 4
+
+typedef struct {
+	int count;
+	double* share;			//< fraction of the space for each pane
+} splitter_cache_t;
+
+static char splitter_vertical(perse_widget_t* widget) {
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (p->name == PERSE_NAME_VERTICAL && p->type == PERSE_TYPE_BOOLEAN) {
+			return p->boolean;
+		}
+	}
+	return 0;
+}
+
+static void splitter_want(perse_widget_t* widget) {
+	splitter_cache_t* splitter = widget->layout;
+	if (!splitter) {
+		splitter = calloc(1, sizeof(splitter_cache_t));
+		widget->layout = splitter;
+	}
+	
+	char vertical = splitter_vertical(widget);
+	
+	int count = 0;
+	int stretch_sum = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		int stretch = property_integer(w, PERSE_NAME_STRETCH, 1);
+		stretch_sum += stretch > 0 ? stretch : 0;
+		count++;
+	}
+	
+	// panes were added or removed, so start over
+	if (count != splitter->count) {
+		splitter->share = realloc(splitter->share, sizeof(double) * count);
+		splitter->count = count;
+		
+		int index = 0;
+		for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+			int stretch = property_integer(w, PERSE_NAME_STRETCH, 1);
+			if (stretch < 0) stretch = 0;
+			splitter->share[index] = stretch_sum ? (double)stretch / stretch_sum
+			                                     : 1.0 / count;
+		}
+	}
+	
+	int along = (count - 1) * SPLITTER_DIVIDER;
+	int across = -1;
+	
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		int min_along = vertical ? c->want_size.min.h : c->want_size.min.w;
+		int min_across = vertical ? c->want_size.min.w : c->want_size.min.h;
+		
+		if (min_along > 0) along += min_along;
+		if (min_across > across) across = min_across;
+	}
+	
+	widget->want_size.min.w = vertical ? across : along;
+	widget->want_size.min.h = vertical ? along : across;
+	
+	widget->want_size.max.w = widget->constraint_size.max.w;
+	widget->want_size.max.h = widget->constraint_size.max.h;
+}
+
+static void splitter_size(perse_widget_t* widget) {
+	splitter_cache_t* splitter = widget->layout;
+	char vertical = splitter_vertical(widget);
+	
+	reserve_box(splitter->count);
+	
+	// shares become stretches, and the box solver takes care of the mins
+	int index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		box_child_t* c = &box_children[index];
+		
+		c->min = vertical ? w->want_size.min.h : w->want_size.min.w;
+		c->max = vertical ? w->want_size.max.h : w->want_size.max.w;
+		c->stretch = (int)(splitter->share[index] * 1000000.0 + 0.5);
+	}
+	
+	int space = vertical ? widget->current_size.h : widget->current_size.w;
+	space -= (splitter->count - 1) * SPLITTER_DIVIDER;
+	
+	solve_box(splitter->count, space);
+	
+	index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		if (vertical) {
+			w->current_size.w = widget->current_size.w;
+			w->current_size.h = box_children[index].size;
+		} else {
+			w->current_size.w = box_children[index].size;
+			w->current_size.h = widget->current_size.h;
+		}
+	}
+}
+
+static void splitter_position(perse_widget_t* widget) {
+	char vertical = splitter_vertical(widget);
+	
+	int offset = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		w->position.x = vertical ? 0 : offset;
+		w->position.y = vertical ? offset : 0;
+		
+		offset += vertical ? w->current_size.h : w->current_size.w;
+		offset += SPLITTER_DIVIDER;
+	}
+}
+
+static void splitter_destroy(splitter_cache_t* splitter) {
+	free(splitter->share);
+	free(splitter);
+}
+
+/*
+	FLEX LAYOUT
+	
+	Items go along the main axis, left to right, or top to bottom if VERTICAL
+	is set. Each item starts out at its BASIS, or at its natural size if it has
+	none. Space that is left over is handed out in proportion to STRETCH (which
+	defaults to 0 here, unlike in box layouts) and missing space is taken away
+	in proportion to SHRINK times the basis. With WRAP set, the items are first
+	broken into lines and each line is resolved on its own. JUSTIFY places the
+	items along the main axis, ALIGN places them inside of their line.
+	
+	The growing and shrinking is piecewise linear, same as in box layouts, so it
+	is solved with the same kind of threshold sweep.
+	
+	The height of an item can depend on its width, e.g. a wrapping flex or flow
+	layout gets taller when it gets narrower, so items are asked for their size
+	with measure(). A flex layout measures each item at least twice and is then
+	itself measured by its parent, so nested flex layouts would descend into
+	the tree an exponential number of times. To avoid that, every widget keeps
+	the results of its last few measure() calls in `widget->measure`, keyed by
+	the space that was offered to it. The cache is thrown away during want
+	calculation, if the widget has `changed`. perse_MergeTree() marks every
+	ancestor of a changed widget as changed too, so a cached result can never
+	depend on something that has been changed.
+*/
+
+typedef struct {
+	perse_widget_t* widget;
+	int base;				//< flex basis, clamped to min/max
+	int min, max;			//< along the main axis, max is -1 if unbounded
+	int grow, shrink;
+	int main, cross;		//< resolved size
+} flex_item_t;
+
+// item scratch space is kept per flex layout, since measuring an item can
+// lay out a nested flex layout in the middle of laying out this one
+typedef struct {
+	int capacity;
+	flex_item_t* item;
+} flex_cache_t;
+
+static perse_size_t measure(perse_widget_t* widget, perse_size_t available);
+
+static char property_boolean(perse_widget_t* widget, perse_name_t name) {
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (p->name == name && p->type == PERSE_TYPE_BOOLEAN) return p->boolean;
+	}
+	return 0;
+}
+
+// resolves the main sizes of `count` items so that they add up to `space`
+static void flex_solve(flex_item_t* item, int count, int space) {
+	long long total = 0;
+	for (int i = 0; i < count; i++) total += item[i].base;
+	
+	char growing = total < space;
+	
+	// each item moves away from its base at `rate` until it hits its min or
+	// max. the sweep is over the points where items hit them
+	int events = 0;
+	long long fixed = 0;
+	long long slope = 0;
+	
+	reserve_box(count);
+	
+	for (int i = 0; i < count; i++) {
+		flex_item_t* it = &item[i];
+		
+		long long rate = growing ? it->grow : (long long)it->shrink * it->base;
+		int limit = growing ? it->max : it->min;
+		
+		fixed += it->base;
+		if (rate <= 0 || limit == it->base) continue;
+		
+		slope += rate;
+		
+		if (limit == -1) continue;
+		
+		box_events[events++] = (box_event_t){
+			.threshold = (double)(growing ? limit - it->base : it->base - limit) / rate,
+			.child = i,
+			.saturate = 1
+		};
+	}
+	
+	qsort(box_events, events, sizeof(box_event_t), compare_box_events);
+	
+	long long missing = growing ? space - fixed : fixed - space;
+	long long gained = 0;
+	double t = 0.0;
+	
+	for (int i = 0; i < events; i++) {
+		box_event_t* e = &box_events[i];
+		if (gained + slope * (e->threshold - t) >= missing) break;
+		
+		gained += slope * (e->threshold - t);
+		t = e->threshold;
+		
+		flex_item_t* it = &item[e->child];
+		slope -= growing ? it->grow : (long long)it->shrink * it->base;
+	}
+	
+	if (slope > 0) t += (double)(missing - gained) / slope;
+	
+	// apply, with the same exact rounding as in the box layouts
+	double moved = 0.0;
+	long long assigned = 0;
+	
+	for (int i = 0; i < count; i++) {
+		flex_item_t* it = &item[i];
+		long long rate = growing ? it->grow : (long long)it->shrink * it->base;
+		
+		it->main = it->base;
+		if (rate <= 0) continue;
+		
+		double delta = rate * t;
+		int limit = growing ? it->max : it->min;
+		
+		if (limit != -1 && delta >= (growing ? limit - it->base : it->base - limit)) {
+			it->main = limit;
+			continue;
+		}
+		
+		moved += delta;
+		int step = (int)((long long)(moved + 0.5) - assigned);
+		assigned += step;
+		
+		it->main = growing ? it->base + step : it->base - step;
+	}
+}
+
+// lays out a flex layout inside of `space`, which can be -1 along either axis
+// if it is unbounded. returns the size of the content. if `commit` is set,
+// sizes and positions of the items are set, otherwise it just measures
+static perse_size_t flex_run(perse_widget_t* widget, perse_size_t space,
+							 char commit) {
+	flex_cache_t* flex = widget->layout;
+	if (!flex) {
+		flex = calloc(1, sizeof(flex_cache_t));
+		widget->layout = flex;
+	}
+	
+	char vertical = property_boolean(widget, PERSE_NAME_VERTICAL);
+	char wrap = property_boolean(widget, PERSE_NAME_WRAP);
+	int justify = property_integer(widget, PERSE_NAME_JUSTIFY, PERSE_ALIGN_START);
+	int align = property_integer(widget, PERSE_NAME_ALIGN, PERSE_ALIGN_STRETCH);
+	
+	int main_space = vertical ? space.h : space.w;
+	int cross_space = vertical ? space.w : space.h;
+	
+	int count = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) count++;
+	
+	if (count > flex->capacity) {
+		flex->capacity = count * 2;
+		flex->item = realloc(flex->item, sizeof(flex_item_t) * flex->capacity);
+	}
+	
+	// find the basis of each of the items
+	int index = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next, index++) {
+		flex_item_t* it = &flex->item[index];
+		
+		it->widget = w;
+		it->min = vertical ? w->want_size.min.h : w->want_size.min.w;
+		it->max = vertical ? w->want_size.max.h : w->want_size.max.w;
+		it->grow = property_integer(w, PERSE_NAME_STRETCH, 0);
+		it->shrink = property_integer(w, PERSE_NAME_SHRINK, 1);
+		
+		if (it->min < 0) it->min = 0;
+		if (it->max < 0) it->max = -1;
+		if (it->max != -1 && it->max < it->min) it->max = it->min;
+		
+		// heights can depend on widths, but not the other way around, so in
+		// rows the natural size is measured with unbounded space. that way the
+		// same question gets asked no matter where this layout is measured from
+		int basis = property_integer(w, PERSE_NAME_BASIS, -1);
+		if (basis < 0) {
+			perse_size_t natural = vertical ? measure(w, (perse_size_t){cross_space, -1})
+			                                : measure(w, (perse_size_t){-1, -1});
+			basis = vertical ? natural.h : natural.w;
+		}
+		
+		if (basis < it->min) basis = it->min;
+		if (it->max != -1 && basis > it->max) basis = it->max;
+		
+		it->base = basis;
+	}
+	
+	perse_size_t content = {0, 0};
+	int line_offset = 0;
+	
+	int first = 0;
+	while (first < count) {
+		
+		// find where the line ends
+		int end = first;
+		long long line_base = 0;
+		while (end < count) {
+			int base = flex->item[end].base;
+			if (wrap && main_space >= 0 && end != first && line_base + base > main_space) break;
+			line_base += base;
+			end++;
+		}
+		
+		flex_item_t* line = &flex->item[first];
+		int line_count = end - first;
+		
+		if (main_space >= 0) {
+			flex_solve(line, line_count, main_space);
+		} else {
+			for (int i = 0; i < line_count; i++) line[i].main = line[i].base;
+		}
+		
+		// now that the main sizes are known, we can find out the cross sizes
+		int line_main = 0;
+		int line_cross = 0;
+		for (int i = 0; i < line_count; i++) {
+			flex_item_t* it = &line[i];
+			perse_widget_t* w = it->widget;
+			
+			perse_size_t size = vertical ? measure(w, (perse_size_t){-1, it->main})
+			                             : measure(w, (perse_size_t){it->main, -1});
+			it->cross = vertical ? size.w : size.h;
+			
+			line_main += it->main;
+			if (it->cross > line_cross) line_cross = it->cross;
+		}
+		
+		// a single line takes up all of the layout
+		if (!wrap && cross_space >= 0) line_cross = cross_space;
+		
+		if (commit) {
+			int free = main_space >= 0 ? main_space - line_main : 0;
+			if (free < 0) free = 0;
+			
+			double offset = 0.0;
+			double gap = 0.0;
+			switch (justify) {
+				case PERSE_ALIGN_CENTER: offset = free / 2.0; break;
+				case PERSE_ALIGN_END: offset = free; break;
+				case PERSE_ALIGN_SPACE_BETWEEN:
+					if (line_count > 1) gap = (double)free / (line_count - 1);
+					break;
+				case PERSE_ALIGN_SPACE_AROUND:
+					gap = (double)free / line_count;
+					offset = gap / 2.0;
+					break;
+			}
+			
+			for (int i = 0; i < line_count; i++) {
+				flex_item_t* it = &line[i];
+				perse_widget_t* w = it->widget;
+				
+				int max_cross = vertical ? w->want_size.max.w : w->want_size.max.h;
+				
+				int cross = it->cross;
+				if (align == PERSE_ALIGN_STRETCH) {
+					cross = line_cross;
+					if (max_cross > 0 && cross > max_cross) cross = max_cross;
+				}
+				
+				int cross_offset = 0;
+				if (align == PERSE_ALIGN_CENTER) cross_offset = (line_cross - cross) / 2;
+				if (align == PERSE_ALIGN_END) cross_offset = line_cross - cross;
+				
+				int main_offset = (int)(offset + 0.5);
+				
+				if (vertical) {
+					w->current_size.w = cross;
+					w->current_size.h = it->main;
+					w->position.x = line_offset + cross_offset;
+					w->position.y = main_offset;
+				} else {
+					w->current_size.w = it->main;
+					w->current_size.h = cross;
+					w->position.x = main_offset;
+					w->position.y = line_offset + cross_offset;
+				}
+				
+				offset += it->main + gap;
+			}
+		}
+		
+		if (vertical) {
+			if (line_main > content.h) content.h = line_main;
+			content.w += line_cross;
+		} else {
+			if (line_main > content.w) content.w = line_main;
+			content.h += line_cross;
+		}
+		
+		line_offset += line_cross;
+		first = end;
+	}
+	
+	return content;
+}
+
+static void flex_want(perse_widget_t* widget) {
+	char vertical = property_boolean(widget, PERSE_NAME_VERTICAL);
+	char wrap = property_boolean(widget, PERSE_NAME_WRAP);
+	
+	// without wrapping every item has to fit on the line, with wrapping only
+	// the largest one does
+	int main = 0;
+	int cross = -1;
+	
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		int min_main = vertical ? c->want_size.min.h : c->want_size.min.w;
+		int min_cross = vertical ? c->want_size.min.w : c->want_size.min.h;
+		
+		if (min_main > 0) {
+			if (!wrap) main += min_main;
+			else if (min_main > main) main = min_main;
+		}
+		if (min_cross > cross) cross = min_cross;
+	}
+	
+	widget->want_size.min.w = vertical ? cross : main;
+	widget->want_size.min.h = vertical ? main : cross;
+	
+	if (widget->constraint_size.min.w > widget->want_size.min.w) {
+		widget->want_size.min.w = widget->constraint_size.min.w;
+	}
+	if (widget->constraint_size.min.h > widget->want_size.min.h) {
+		widget->want_size.min.h = widget->constraint_size.min.h;
+	}
+	
+	widget->want_size.max.w = widget->constraint_size.max.w;
+	widget->want_size.max.h = widget->constraint_size.max.h;
+}
+
+static void flex_destroy(flex_cache_t* flex) {
+	free(flex->item);
+	free(flex);
+}
+
+// finds how big a flow layout would be with a given width
+static perse_size_t flow_measure(perse_widget_t* widget, int width) {
+	perse_size_t content = {0, 0};
+	int line_width = 0;
+	int line_height = 0;
+	
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		perse_size_t size = flow_item_size(w);
+		
+		if (width >= 0 && line_width && line_width + size.w > width) {
+			content.h += line_height;
+			line_width = 0;
+			line_height = 0;
+		}
+		
+		line_width += size.w;
+		if (size.h > line_height) line_height = size.h;
+		if (line_width > content.w) content.w = line_width;
+	}
+	
+	content.h += line_height;
+	
+	return content;
+}
+
+// finds how big a widget would like to be, if it was offered `available`
+// space, which can be -1 along either axis if it is unbounded
+static perse_size_t measure(perse_widget_t* widget, perse_size_t available) {
+	int cached = widget->measure_count < PERSE_MEASURE_SLOTS ?
+	             widget->measure_count : PERSE_MEASURE_SLOTS;
+	
+	for (int i = 0; i < cached; i++) {
+		perse_measure_t* m = &widget->measure[i];
+		if (m->available.w == available.w && m->available.h == available.h) {
+			return m->result;
+		}
+	}
+	
+	perse_size_t result;
+	perse_size_t least = widget->want_size.min;
+	switch (widget->type) {
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			result = flex_run(widget, available, 0);
+			break;
+		case PERSE_WIDGET_FLOW_LAYOUT:
+			result = flow_measure(widget, available.w);
+			
+			// its want height is for the width from the last layout
+			least.h = widget->constraint_size.min.h;
+			break;
+		default:
+			// everything else has the same size no matter how much space
+			result = flow_item_size(widget);
+	}
+	
+	if (result.w < least.w) result.w = least.w;
+	if (result.h < least.h) result.h = least.h;
+	
+	perse_measure_t* m = &widget->measure[widget->measure_count % PERSE_MEASURE_SLOTS];
+	m->available = available;
+	m->result = result;
+	widget->measure_count++;
+	
+	return result;
+}
+
+/*
+	SCROLL PANEL
+	
+	Children are stacked top to bottom, each as tall as it would like to be at
+	the width of the panel, and together they make up the content of the panel.
+	The panel itself is as big as the layout makes it and shows only a part of
+	the content, starting from the offset in SCROLL_X and SCROLL_Y.
+	
+	The library keeps SCROLL_X, SCROLL_Y, SCROLL_WIDTH and SCROLL_HEIGHT up to
+	date on the panel, so that the backend can set up its scroll bars. When the
+	user scrolls, the backend calls the ON_SCROLL callback with a SCROLL_X or
+	SCROLL_Y property, which should be perse_ScrollPanelScroll(). It moves the
+	content without going through the frontend.
+	
+	Positions inside of a scroll panel are relative to the panel, not the
+	window. Only the widgets that overlap the panel, plus a margin of half of
+	the panel on each side, are created in the backend. The rest are `culled`
+	during perse_ApplyChanges() and get created when they are scrolled to, so
+	mounting a long form costs as much as mounting the visible part of it.
+*/
+
+typedef struct {
+	int left, top, right, bottom;
+} cull_rect_t;
+
+// sets an integer property that is kept up to date by the library
+static void set_property_integer(perse_widget_t* widget, perse_name_t name,
+								 int value) {
+	perse_property_t* p = widget->property;
+	while (p && !(p->name == name && p->type == PERSE_TYPE_INTEGER)) p = p->next;
+	
+	if (!p) {
+		p = perse_CreatePropertyInteger(value);
+		p->name = name;
+		p->changed = 1;
+		perse_AddProperty(widget, p);
+		queue_apply(widget);
+		return;
+	}
+	
+	if (p->integer != value) {
+		p->integer = value;
+		p->changed = 1;
+		queue_apply(widget);
+	}
+}
+
+// keeps the offset inside of the content
+static void scroll_clamp(perse_widget_t* widget) {
+	int max_x = property_integer(widget, PERSE_NAME_SCROLL_WIDTH, 0) - widget->current_size.w;
+	int max_y = property_integer(widget, PERSE_NAME_SCROLL_HEIGHT, 0) - widget->current_size.h;
+	
+	int x = property_integer(widget, PERSE_NAME_SCROLL_X, 0);
+	int y = property_integer(widget, PERSE_NAME_SCROLL_Y, 0);
+	
+	if (x > max_x) x = max_x;
+	if (y > max_y) y = max_y;
+	if (x < 0) x = 0;
+	if (y < 0) y = 0;
+	
+	set_property_integer(widget, PERSE_NAME_SCROLL_X, x);
+	set_property_integer(widget, PERSE_NAME_SCROLL_Y, y);
+}
+
+static void scroll_size(perse_widget_t* widget) {
+	int width = widget->current_size.w;
+	
+	// content can be wider than the panel, but not narrower
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		if (w->want_size.min.w > width) width = w->want_size.min.w;
+	}
+	
+	int height = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		w->current_size.w = width;
+		if (w->want_size.max.w > 0 && w->want_size.max.w < width) {
+			w->current_size.w = w->want_size.max.w;
+		}
+		
+		w->current_size.h = measure(w, (perse_size_t){w->current_size.w, -1}).h;
+		height += w->current_size.h;
+	}
+	
+	set_property_integer(widget, PERSE_NAME_SCROLL_WIDTH, width);
+	set_property_integer(widget, PERSE_NAME_SCROLL_HEIGHT, height);
+	
+	scroll_clamp(widget);
+}
+
+static void scroll_position(perse_widget_t* widget) {
+	int x = property_integer(widget, PERSE_NAME_SCROLL_X, 0);
+	int y = property_integer(widget, PERSE_NAME_SCROLL_Y, 0);
+	
+	int offset = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		w->position.x = -x;
+		w->position.y = offset - y;
+		offset += w->current_size.h;
+	}
+}
+
+// finds the part of a scroll panel that needs to be in the backend, in the
+// coordinates of its children
+static cull_rect_t scroll_view(perse_widget_t* widget) {
+	int margin_x = widget->current_size.w / 2;
+	int margin_y = widget->current_size.h / 2;
+	
+	return (cull_rect_t){
+		.left = -margin_x,
+		.top = -margin_y,
+		.right = widget->current_size.w + margin_x,
+		.bottom = widget->current_size.h + margin_y
+	};
+}
+
+// finds the view of the closest scroll panel that a widget is in
+static const cull_rect_t* find_view(perse_widget_t* widget, cull_rect_t* view) {
+	for (perse_widget_t* w = widget->parent; w; w = w->parent) {
+		if (w->type != PERSE_WIDGET_SCROLL_PANEL) continue;
+		*view = scroll_view(w);
+		return view;
+	}
+	return NULL;
+}
+
+/*
+	TAB GROUP
+	
+	Tab panels fill the tab group, except for the tab headers on top and a thin
+	border around them. Only the panel in SELECTED is shown. The other panels
+	are skipped by every layout pass and by perse_ApplyChanges(), so a panel's
+	children don't get laid out or created in the backend until the panel is
+	first shown.
+	
+	When the user picks a tab, the backend calls the ON_SELECT callback with a
+	SELECTED property, which should be perse_TabGroupSelect(). It lays out and
+	applies the newly selected panel. If UNMOUNT_AFTER is set on the group,
+	panels that haven't been shown for that many tab switches get their
+	children taken out of the backend again.
+*/
+
+#define TAB_HEADER 24
+#define TAB_BORDER 4
+
+typedef struct {
+	int switches;			//< number of times that the selected tab changed
+	int count;
+	int* visited;			//< value of `switches` when each panel was shown
+} tab_cache_t;
+
+static tab_cache_t* tab_cache(perse_widget_t* widget) {
+	tab_cache_t* tabs = widget->layout;
+	if (!tabs) {
+		tabs = calloc(1, sizeof(tab_cache_t));
+		widget->layout = tabs;
+	}
+	
+	int count = 0;
+	for (perse_widget_t* w = widget->child; w; w = w->next) count++;
+	
+	if (count > tabs->count) {
+		tabs->visited = realloc(tabs->visited, sizeof(int) * count);
+		for (int i = tabs->count; i < count; i++) {
+			tabs->visited[i] = tabs->switches;
+		}
+	}
+	tabs->count = count;
+	
+	return tabs;
+}
+
+// checks if a widget is a tab panel that isn't being shown
+static char tab_hidden(perse_widget_t* widget) {
+	if (widget->type != PERSE_WIDGET_TAB_PANEL || !widget->parent) return 0;
+	if (widget->parent->type != PERSE_WIDGET_TAB_GROUP) return 0;
+	
+	int selected = property_integer(widget->parent, PERSE_NAME_SELECTED, 0);
+	
+	int index = 0;
+	for (perse_widget_t* w = widget->parent->child; w != widget; w = w->next) {
+		index++;
+	}
+	
+	return index != selected;
+}
+
+static void tab_size(perse_widget_t* widget) {
+	tab_cache_t* tabs = tab_cache(widget);
+	
+	int selected = property_integer(widget, PERSE_NAME_SELECTED, 0);
+	if (selected >= tabs->count) selected = tabs->count - 1;
+	if (selected < 0) selected = 0;
+	set_property_integer(widget, PERSE_NAME_SELECTED, selected);
+	
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		w->current_size.w = widget->current_size.w - 2 * TAB_BORDER;
+		w->current_size.h = widget->current_size.h - TAB_HEADER - TAB_BORDER;
+		
+		if (w->current_size.w < 0) w->current_size.w = 0;
+		if (w->current_size.h < 0) w->current_size.h = 0;
+	}
+}
+
+static void tab_position(perse_widget_t* widget) {
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		w->position.x = TAB_BORDER;
+		w->position.y = TAB_HEADER;
+	}
+}
+
+static void tab_destroy(tab_cache_t* tabs) {
+	free(tabs->visited);
+	free(tabs);
+}
+
+/*
+	INTRINSIC SIZE
+	
+	Leaf widgets that don't have a size set get one from their content. The
+	backend measures how big a widget would need to be to fit its TEXT in the
+	font that it uses for that type of widget. Backends that can't do that
+	return -1, in which case the widget gets the default size, as before.
+	
+	Measurements are cached by widget type, which decides the font, and by the
+	hash of the text, so that widgets with the same text are measured once.
+	The cache is only looked at when a widget has changed, otherwise the
+	`intrinsic` size from the last frame is used.
+	
+	Text that keeps changing, like a clock or a counter, would fill the cache
+	with strings that are never shown again, so it holds at most
+	TEXT_CACHE_LIMIT entries. Each entry remembers the layout in which it was
+	last used, and when the cache is full, entries that weren't used in the
+	last two layouts get thrown out.
+	
+	Text boxes are as tall as a line of their font and as wide as the layout
+	makes them. What has been typed into them doesn't change their size, so
+	they aren't measured again for every key.
+	
+	perse_ClearMeasureCache() also bumps `measure_epoch`, and widgets that
+	were last measured in an older epoch are treated as changed.
+*/
+
+#define TEXT_CACHE_LIMIT 4096
+
+typedef struct {
+	perse_widget_type_t type;		//< PERSE_WIDGET_INVALID if slot is empty
+	unsigned long long hash;
+	int length;
+	perse_size_t size;
+	unsigned used;					//< layout that it was last used in
+} text_measure_t;
+
+static struct {
+	int count;
+	int capacity;
+	text_measure_t* entry;
+	
+	unsigned layout;				//< counts layouts, for `used`
+} text_cache;
+
+static unsigned measure_epoch = 0;
+
+// widgets that the backend can size from their text
+static char measurable(perse_widget_type_t type) {
+	switch (type) {
+		case PERSE_WIDGET_ARROW_BUTTON:
+		case PERSE_WIDGET_TEXT_BUTTON:
+		case PERSE_WIDGET_COMBO_BOX:
+		case PERSE_WIDGET_CHECK_BOX:
+		case PERSE_WIDGET_RADIO_BUTTON:
+		case PERSE_WIDGET_TEXT_BOX:
+		case PERSE_WIDGET_LABEL:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// FNV-1a, also returns the length of the string
+static unsigned long long text_hash(const char* text, int* length) {
+	unsigned long long hash = 14695981039346656037ull;
+	const char* c = text;
+	
+	for (; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 1099511628211ull;
+	}
+	
+	*length = c - text;
+	return hash;
+}
+
+static text_measure_t* text_slot(text_measure_t* entry, int capacity,
+	perse_widget_type_t type, unsigned long long hash, int length) {
+	unsigned long long i = (hash ^ (unsigned long long)type * 0x9E3779B97F4A7C15ull);
+	
+	for (;; i++) {
+		text_measure_t* e = &entry[i & (capacity - 1)];
+		
+		if (e->type == PERSE_WIDGET_INVALID) return e;
+		if (e->type == type && e->hash == hash && e->length == length) return e;
+	}
+}
+
+// moves the entries that were used in the last `age` layouts into a new table
+static void text_cache_rehash(int capacity, unsigned age) {
+	text_measure_t* entry = calloc(capacity, sizeof(text_measure_t));
+	int count = 0;
+	
+	for (int i = 0; i < text_cache.capacity; i++) {
+		text_measure_t* e = &text_cache.entry[i];
+		if (e->type == PERSE_WIDGET_INVALID) continue;
+		if (text_cache.layout - e->used > age) continue;
+		
+		*text_slot(entry, capacity, e->type, e->hash, e->length) = *e;
+		count++;
+	}
+	
+	free(text_cache.entry);
+	text_cache.entry = entry;
+	text_cache.capacity = capacity;
+	text_cache.count = count;
+}
+
+// makes room for one more entry, keeping the table at most three quarters full
+static void text_cache_reserve() {
+	if (4 * (text_cache.count + 1) <= 3 * text_cache.capacity) return;
+	
+	if (text_cache.capacity < TEXT_CACHE_LIMIT) {
+		text_cache_rehash(text_cache.capacity ? text_cache.capacity * 2 : 256, ~0u);
+		return;
+	}
+	
+	// only keep what is on the screen. if that is still most of the table,
+	// start over, so that the sweeps don't happen on every measurement
+	text_cache_rehash(text_cache.capacity, 1);
+	if (2 * text_cache.count > text_cache.capacity) {
+		text_cache_rehash(text_cache.capacity, 0);
+	}
+	if (2 * text_cache.count > text_cache.capacity) {
+		memset(text_cache.entry, 0, sizeof(text_measure_t) * text_cache.capacity);
+		text_cache.count = 0;
+	}
+}
+
+static perse_size_t intrinsic_size(perse_widget_t* widget) {
+	// text boxes get the same entry no matter what is typed into them
+	const char* text = "";
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (widget->type == PERSE_WIDGET_TEXT_BOX) break;
+		if (p->name == PERSE_NAME_TEXT && p->type == PERSE_TYPE_STRING) {
+			text = p->string;
+		}
+	}
+	
+	int length;
+	unsigned long long hash = text_hash(text, &length);
+	
+	text_cache_reserve();
+	
+	text_measure_t* e = text_slot(text_cache.entry, text_cache.capacity,
+		widget->type, hash, length);
+	
+	if (e->type == PERSE_WIDGET_INVALID) {
+		e->type = widget->type;
+		e->hash = hash;
+		e->length = length;
+		e->size = perse_BackendMeasure(widget);
+		
+		// only the height comes from the font, see above
+		if (widget->type == PERSE_WIDGET_TEXT_BOX) e->size.w = -1;
+		
+		text_cache.count++;
+	}
+	
+	e->used = text_cache.layout;
+	
+	return e->size;
+}
+
+// fills in the want of a leaf where it has no constraint
+static void intrinsic_want(perse_widget_t* widget, char changed) {
+	if (changed) widget->intrinsic = intrinsic_size(widget);
+	
+	perse_range_t* want = &widget->want_size;
+	
+	if (want->min.w <= 0 && widget->intrinsic.w > 0) {
+		want->min.w = widget->intrinsic.w;
+		if (want->max.w > 0 && want->min.w > want->max.w) {
+			want->min.w = want->max.w;
+		}
+	}
+	
+	if (want->min.h <= 0 && widget->intrinsic.h > 0) {
+		want->min.h = widget->intrinsic.h;
+		if (want->max.h > 0 && want->min.h > want->max.h) {
+			want->min.h = want->max.h;
+		}
+	}
+}
+
+// window just stretches its child to be same size as it is
+static void window_want(perse_widget_t* widget) {
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		c->want_size.min.w = widget->current_size.w;
+		c->want_size.min.h = widget->current_size.h;
+		
+		c->want_size.max.w = widget->current_size.w;
+		c->want_size.max.h = widget->current_size.h;
+	}
+}
+
+// this function calculates `want` size for widgets. basically for each widget
+// we recursively find what are the minimum/maximum sizes for its child widgets
+// and add them together
+static void calculate_want(perse_widget_t* widget) {
+	
+	// hidden tabs get calculated when they are shown
+	if (tab_hidden(widget)) return;
+	
+	// measurements are only good for as long as nothing changes
+	char changed = widget->changed || widget->measure_epoch != measure_epoch;
+	if (changed) {
+		widget->measure_count = 0;
+		widget->changed = 0;
+		widget->measure_epoch = measure_epoch;
+	}
+	
+	// for leaves we just copy constraint into want, and what isn't
+	// constrained gets taken from the content
+	if (!widget->child) {
+		memcpy(&widget->want_size, &widget->constraint_size,
+				sizeof(widget->want_size));
+		if (measurable(widget->type)) intrinsic_want(widget, changed);
+		return;
+	}
+	
+	// for other widgets, calculate their want first
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		calculate_want(c);
+	}
+	
+	// otherwise we calculate the want size
+	switch (widget->type) {
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT: {
+			// min height -> largest child min height
+			// min width -> sum of child min width
+			int largest_min = -1;
+			int width_sum = 0;
+	
+			for (perse_widget_t* c = widget->child; c; c = c->next) {
+				if (c->want_size.min.h > largest_min) {
+					largest_min = c->want_size.min.h;
+				}
+				if (c->want_size.min.w > 0) {
+					width_sum += c->want_size.min.w;
+				}
+			}
+			
+			widget->want_size.min.h = largest_min;
+			widget->want_size.min.w = width_sum;
+			
+			widget->want_size.max.h = widget->constraint_size.max.h;
+			widget->want_size.max.w = widget->constraint_size.max.w;
+			
+		} break;
+		
+		case PERSE_WIDGET_VERTICAL_LAYOUT: {
+			// min width -> largest child min width
+			// min height -> sum of child min height
+			int largest_min = -1;
+			int height_sum = 0;
+			
+			for (perse_widget_t* c = widget->child; c; c = c->next) {
+				if (c->want_size.min.w > largest_min) {
+					largest_min = c->want_size.min.w;
+				}
+				if (c->want_size.min.h > 0) {
+					height_sum += c->want_size.min.h;
+				}
+			}
+			
+			widget->want_size.min.w = largest_min;
+			widget->want_size.min.h = height_sum;
+			
+			widget->want_size.max.w = widget->constraint_size.max.w;
+			widget->want_size.max.h = widget->constraint_size.max.h;
+		} break;
+		
+		case PERSE_WIDGET_GRID_LAYOUT:
+			grid_want(widget);
+			break;
+		
+		case PERSE_WIDGET_FLOW_LAYOUT:
+			flow_want(widget);
+			break;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			splitter_want(widget);
+			break;
+		
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			flex_want(widget);
+			break;
+		
+		// child widgets irrelevant; copy contraint into want
+		case PERSE_WIDGET_ITEM:
+		case PERSE_WIDGET_LIST_BOX:
+		case PERSE_WIDGET_SCROLL_PANEL:
+			memcpy(&widget->want_size, &widget->constraint_size,
+				sizeof(widget->want_size));
+		break;
+		
+		case PERSE_WIDGET_WINDOW:
+			window_want(widget);
+		break;
+		
+		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
+		default: {
+			int min_width = -1;
+			int min_height = -1;
+			
+			for (perse_widget_t* c = widget->child; c; c = c->next) {
+				if (c->constraint_size.min.w > min_width) {
+					min_width = c->constraint_size.min.w;
+				}
+				if (c->constraint_size.min.h > min_height) {
+					min_height = c->constraint_size.min.h;
+				}
+			}
+			
+			widget->want_size.min.w = min_width;
+			widget->want_size.min.h = min_height;
+			
+			widget->want_size.max.w = widget->constraint_size.max.w;
+			widget->want_size.max.h = widget->constraint_size.max.h;
+		}
+	}
+}
+
+static void calculate_size(perse_widget_t* widget) {
+	
+	// this will only apply to root
+	if (!widget->parent && (!widget->current_size.w || !widget->current_size.h)) {
+		widget->current_size.w = widget->constraint_size.min.w;
+		widget->current_size.h = widget->constraint_size.min.h;
+	}
+	
+	if (!widget->child || tab_hidden(widget)) return;
+	
+	// for each child, calculate their SIZE based on their WANT
+	switch (widget->type) {
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT: {
+			distribute(widget, 1);
+			
+			// set the heights
+			for (perse_widget_t* w = widget->child; w; w = w->next) {
+				if (w->want_size.min.h < widget->current_size.h) {
+					w->current_size.h = w->want_size.min.h;
+				} else {
+					w->current_size.h = widget->current_size.h;
+				}
+			}
+			
+		} break;
+		
+		case PERSE_WIDGET_VERTICAL_LAYOUT: {
+			distribute(widget, 0);
+			
+			// set the widths
+			for (perse_widget_t* w = widget->child; w; w = w->next) {
+				if (w->want_size.min.w < widget->current_size.w) {
+					w->current_size.w = w->want_size.min.w;
+				} else {
+					w->current_size.w = widget->current_size.w;
+				}
+			}
+		} break;
+		
+		case PERSE_WIDGET_GRID_LAYOUT:
+			grid_size(widget);
+			break;
+		
 		case PERSE_WIDGET_FLOW_LAYOUT:
+			flow_size(widget);
+			break;
+		
 		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			splitter_size(widget);
+			break;
+		
 		case PERSE_WIDGET_FLEX_LAYOUT:
+			flex_run(widget, widget->current_size, 1);
+			break;
+		
+		case PERSE_WIDGET_SCROLL_PANEL:
+			scroll_size(widget);
+			break;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			tab_size(widget);
+			break;
 		
 		// do not process; child layout irrelevant
 		case PERSE_WIDGET_ITEM:
@@ -460,6 +2318,8 @@ static void calculate_size(perse_widget_t* widget) {
 					w->current_size.w = w->constraint_size.min.w;
 				} else if (w->constraint_size.max.w > 0) {
 					w->current_size.w = w->constraint_size.max.w;
+				} else if (w->want_size.min.w > 0) {
+					w->current_size.w = w->want_size.min.w;
 				} else {
 					w->current_size.w = default_size;
 				}
@@ -468,6 +2328,8 @@ static void calculate_size(perse_widget_t* widget) {
 					w->current_size.h = w->constraint_size.min.h;
 				} else if (w->constraint_size.max.h > 0) {
 					w->current_size.h = w->constraint_size.max.h;
+				} else if (w->want_size.min.h > 0) {
+					w->current_size.h = w->want_size.min.h;
 				} else {
 					w->current_size.h = default_size;
 				}
@@ -475,100 +2337,560 @@ static void calculate_size(perse_widget_t* widget) {
 		}
 	}
 	
-	for (perse_widget_t* w = widget->child; w; w = w->next) {
-		calculate_size(w);
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		calculate_size(w);
+	}
+}
+
+static void calculate_position(perse_widget_t* widget) {
+	
+	// by now the parent has given the widget its size and position. below
+	// something that isn't in the backend, the widget gets applied together
+	// with it anyway
+	char parent_mounted = !widget->parent || widget->parent->mounted;
+	if (parent_mounted && (widget->actual_size.w != widget->current_size.w ||
+		widget->actual_size.h != widget->current_size.h ||
+		widget->actual_pos.x != widget->absolute.x ||
+		widget->actual_pos.y != widget->absolute.y)) {
+		queue_apply(widget);
+	}
+	
+	// child position is determined by their parent, if reached leaf, return
+	if (!widget->child || tab_hidden(widget)) return;
+
+	// for each child, calculate their SIZE based on their WANT
+	switch (widget->type) {
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT: {
+			int current_w = 0;
+			for (perse_widget_t* w = widget->child; w; w = w->next) {
+				int offset = widget->current_size.h - w->current_size.h;
+
+				if (offset != 0 && offset/2 > 0) {
+					w->position.y = offset/2;
+				}
+				
+				w->position.x = current_w;
+				current_w += w->current_size.w;
+			}
+		} break;
+		
+		case PERSE_WIDGET_VERTICAL_LAYOUT: {
+			int current_h = 0;
+			for (perse_widget_t* w = widget->child; w; w = w->next) {
+				int offset = widget->current_size.w - w->current_size.w;
+
+				if (offset != 0 && offset/2 > 0) {
+					w->position.x = offset/2;
+				}
+				
+				w->position.y = current_h;
+				current_h += w->current_size.h;
+			}
+		} break;
+		
+		case PERSE_WIDGET_GRID_LAYOUT:
+			grid_position(widget);
+			break;
+		
+		case PERSE_WIDGET_FLOW_LAYOUT:
+			// positions are set when breaking lines
+			break;
+		
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			// positions are set when resolving lines
+			break;
+		
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			splitter_position(widget);
+			break;
+		
+		case PERSE_WIDGET_SCROLL_PANEL:
+			scroll_position(widget);
+			break;
+		
+		case PERSE_WIDGET_TAB_GROUP:
+			tab_position(widget);
+			break;
+		
+		// do not process; child layout irrelevant
+		case PERSE_WIDGET_ITEM:
+		case PERSE_WIDGET_LIST_BOX:
+		case PERSE_WIDGET_TEXT_BOX:
+		return;
+		
+		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
+		default:
+			// absolute layout - position remains as was set
+			break;
+	}
+	
+	// then calculate absolute position
+	switch (widget->type) {
+		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
+		case PERSE_WIDGET_HORIZONTAL_LAYOUT:
+		case PERSE_WIDGET_VERTICAL_LAYOUT:
+		case PERSE_WIDGET_GRID_LAYOUT:
+		case PERSE_WIDGET_FLOW_LAYOUT:
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+		case PERSE_WIDGET_FLEX_LAYOUT:
+		case PERSE_WIDGET_TAB_GROUP:
+			for (perse_widget_t* w = widget->child; w; w = w->next) {
+				w->absolute.x = widget->absolute.x + w->position.x;
+				w->absolute.y = widget->absolute.y + w->position.y;
+			}
+			break;
+		default:
+			for (perse_widget_t* w = widget->child; w; w = w->next) {
+				w->absolute.x = w->position.x;
+				w->absolute.y = w->position.y;
+			}	
+	}
+	
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		calculate_position(w);
+	}
+}
+
+// gives flow layouts that came out a different height than they wanted one
+// more pass, along with everything in `widget`, see FLOW LAYOUT
+static void reflow(perse_widget_t* widget) {
+	if (!flow_reflow) return;
+	
+	while (flow_reflow) {
+		perse_widget_t* w = flow_reflow;
+		flow_cache_t* flow = w->layout;
+		flow_reflow = flow->next_reflow;
+		flow->reflow = 0;
+		
+		// measurements up the tree were made with the old height
+		for (; w && w != widget->parent; w = w->parent) w->changed = 1;
+	}
+	
+	calculate_want(widget);
+	calculate_size(widget);
+	calculate_position(widget);
+	
+	// anything that still doesn't fit waits for the next layout, so that a
+	// flow can't keep flipping between two widths
+	while (flow_reflow) {
+		flow_cache_t* flow = flow_reflow->layout;
+		flow_reflow = flow->next_reflow;
+		flow->reflow = 0;
+	}
+}
+
+// windows that nothing has changed in keep the layout that they have
+static void application_layout(perse_widget_t* widget) {
+	widget->changed = 0;
+	
+	for (perse_widget_t* w = widget->child; w; w = w->next) {
+		if (!w->changed) continue;
+		
+		// same as for a root window, see calculate_size()
+		if (!w->current_size.w || !w->current_size.h) {
+			w->current_size.w = w->constraint_size.min.w;
+			w->current_size.h = w->constraint_size.min.h;
+		}
+		
+		// positioned on the screen, like any other top-level window
+		w->absolute = w->position;
+		
+		calculate_want(w);
+		calculate_size(w);
+		calculate_position(w);
+		reflow(w);
+	}
+}
+
+/// Calculates widget layout.
+/// Calculates the layout of widget and its child widgets. For an
+/// APPLICATION, only the windows that have changed get laid out.
+void perse_CalculateLayout(perse_widget_t* widget) {
+	PERSE_STATS_BEGIN(PERSE_PHASE_LAYOUT);
+	
+	text_cache.layout++;
+	
+	if (widget->type == PERSE_WIDGET_APPLICATION) {
+		application_layout(widget);
+	} else {
+		calculate_want(widget);
+		calculate_size(widget);
+		calculate_position(widget);
+		reflow(widget);
+	}
+	
+	PERSE_STATS_END(PERSE_PHASE_LAYOUT);
+}
+
+/// Calculates widget layout after a resize.
+/// Same as perse_CalculateLayout(), but keeps the want sizes from the last
+/// time that it was called, since those are calculated from the bottom up and
+/// don't depend on the size of the window. Only use this if nothing but the
+/// size of `widget` has changed since the last perse_CalculateLayout().
+void perse_ResizeLayout(perse_widget_t* widget) {
+	PERSE_STATS_BEGIN(PERSE_PHASE_LAYOUT);
+	
+	// the only want that depends on the window size is its child's
+	if (widget->type == PERSE_WIDGET_WINDOW) {
+		window_want(widget);
+	}
+	
+	calculate_size(widget);
+	calculate_position(widget);
+	
+	// a flow that got a different width can change the wants after all
+	reflow(widget);
+	
+	PERSE_STATS_END(PERSE_PHASE_LAYOUT);
+}
+
+/*
+	DIRECT UPDATES
+	
+	Some values change too often to build and merge the whole tree for each
+	change, like the progress of a download or a counter in the status bar.
+	Those can be set on the widget in the tree directly, with
+	perse_UpdateProperty() and perse_UpdateGeometry(). The widget goes on the
+	apply list, same as after a merge, and the layout only needs to be
+	calculated again if the new value can move or resize something. For text,
+	that is only if it measures differently than the old text.
+	
+	The frontend finds these widgets through their `ref`, see merge(). The
+	next merge still overwrites anything that was set this way, if the new
+	tree has a value for it.
+*/
+
+// properties that are read by the layout passes
+static char layout_property(perse_name_t name) {
+	switch (name) {
+		case PERSE_NAME_STRETCH:
+		case PERSE_NAME_SHRINK:
+		case PERSE_NAME_BASIS:
+		case PERSE_NAME_ROWS:
+		case PERSE_NAME_COLUMNS:
+		case PERSE_NAME_ROW:
+		case PERSE_NAME_COLUMN:
+		case PERSE_NAME_ROW_SPAN:
+		case PERSE_NAME_COLUMN_SPAN:
+		case PERSE_NAME_VERTICAL:
+		case PERSE_NAME_WRAP:
+		case PERSE_NAME_JUSTIFY:
+		case PERSE_NAME_ALIGN:
+		case PERSE_NAME_SCROLL_X:
+		case PERSE_NAME_SCROLL_Y:
+		case PERSE_NAME_SELECTED:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// checks if the new value of a property could move or resize anything
+static char changes_geometry(perse_widget_t* widget, perse_property_t* property) {
+	if (property->name != PERSE_NAME_TEXT) return layout_property(property->name);
+	if (!measurable(widget->type)) return 0;
+	
+	// hasn't been measured yet, so there is nothing to compare to
+	if (widget->changed) return 1;
+	
+	perse_size_t size = intrinsic_size(widget);
+	return size.w != widget->intrinsic.w || size.h != widget->intrinsic.h;
+}
+
+// the cached layout of everything above has to be calculated again
+static void mark_changed(perse_widget_t* widget) {
+	for (perse_widget_t* w = widget; w; w = w->parent) {
+		w->changed = 1;
+	}
+}
+
+/// Sets a property of a widget in the tree.
+/// Takes over `value`, which replaces the property of the widget that has the
+/// same name, or gets added if there isn't one. If the value is different,
+/// the widget is put on the apply list.
+/// @return 1 if perse_CalculateLayout() has to be called before
+/// perse_ApplyChanges(), 0 if only the latter.
+int perse_UpdateProperty(perse_widget_t* widget, perse_property_t* value) {
+	perse_property_t* p = widget->property;
+	while (p && p->name != value->name) p = p->next;
+	
+	if (p && perse_IsPropertyMatching(p, value)) {
+		perse_DestroyProperty(value);
+		return 0;
+	}
+	
+	if (p) {
+		if (p->type == PERSE_TYPE_DRAW_LIST && value->type == PERSE_TYPE_DRAW_LIST) {
+			perse_DiffDrawList(p->draw_list, value->draw_list, p->changed);
+		}
+		
+		perse_MovePropertyValue(p, value);
+		perse_DestroyProperty(value);
+	} else {
+		p = value;
+		p->changed = 1;
+		perse_AddProperty(widget, p);
+	}
+	
+	queue_apply(widget);
+	
+	if (!changes_geometry(widget, p)) return 0;
+	
+	mark_changed(widget);
+	return 1;
+}
+
+/// Sets the constraints and the position of a widget in the tree.
+/// The new size and position only get to the backend after the layout is
+/// calculated again, which puts the widget on the apply list.
+/// @return 1 if perse_CalculateLayout() has to be called, 0 if nothing changed.
+int perse_UpdateGeometry(perse_widget_t* widget, perse_range_t constraint,
+						 perse_position_t position) {
+	if (memcmp(&widget->constraint_size, &constraint, sizeof(constraint)) == 0 &&
+		memcmp(&widget->position, &position, sizeof(position)) == 0) return 0;
+	
+	widget->constraint_size = constraint;
+	widget->position = position;
+	
+	mark_changed(widget);
+	return 1;
+}
+
+/*
+	IMAGES
+	
+	Image widgets, image buttons and the images in canvases only have the
+	path to the image file. Right before they get applied, the path is looked
+	up in the image cache, at the size that the widget got from the layout,
+	and the image is put in the PERSE_NAME_BITMAP property of the widget,
+	which is what the backend draws. Canvases keep theirs in the draw
+	commands. See image.c.
+	
+	Images that are still being decoded get drawn as placeholders and the
+	widget goes on the loading list. Each time that the backend comes back
+	from perse_BackendProcessEvents(), perse_UpdateImages() finishes whatever
+	got decoded in the meantime and puts the widgets that have all of their
+	images on the apply list, so that they get drawn again, without the
+	layout or the rest of the tree being touched.
+*/
+
+static struct {
+	int count;
+	int capacity;
+	perse_widget_t** widget;
+} loading_list;
+
+static void add_loading(perse_widget_t* widget) {
+	if (widget->loading) return;
+	widget->loading = 1;
+	
+	if (loading_list.count == loading_list.capacity) {
+		loading_list.capacity = loading_list.capacity ? loading_list.capacity * 2 : 16;
+		loading_list.widget = realloc(loading_list.widget,
+			sizeof(perse_widget_t*) * loading_list.capacity);
 	}
+	
+	widget->loading_at = loading_list.count;
+	loading_list.widget[loading_list.count++] = widget;
 }
 
-static void calculate_position(perse_widget_t* widget) {
+// same as unqueue_apply()
+static void remove_loading(perse_widget_t* widget) {
+	perse_widget_t* last = loading_list.widget[--loading_list.count];
+	loading_list.widget[widget->loading_at] = last;
+	last->loading_at = widget->loading_at;
 	
-	// child position is determined by their parent, if reached leaf, return
-	if (!widget->child) return;
+	widget->loading = 0;
+}
 
-	// for each child, calculate their SIZE based on their WANT
-	switch (widget->type) {
-		case PERSE_WIDGET_HORIZONTAL_LAYOUT: {
-			int current_w = 0;
-			for (perse_widget_t* w = widget->child; w; w = w->next) {
-				int offset = widget->current_size.h - w->current_size.h;
+static perse_property_t* find_property(perse_widget_t* widget, perse_name_t name,
+									   perse_type_t type) {
+	perse_property_t* p = widget->property;
+	while (p && !(p->name == name && p->type == type)) p = p->next;
+	return p;
+}
 
-				if (offset != 0 && offset/2 > 0) {
-					w->position.y = offset/2;
-				}
-				
-				w->position.x = current_w;
-				current_w += w->current_size.w;
-			}
-		} break;
-		
-		case PERSE_WIDGET_VERTICAL_LAYOUT: {
-			int current_h = 0;
-			for (perse_widget_t* w = widget->child; w; w = w->next) {
-				int offset = widget->current_size.w - w->current_size.w;
+// sets the bitmap of an image widget or an image button, unless it already
+// has the right one. returns 1 if it isn't decoded yet
+static char load_bitmap(perse_widget_t* widget) {
+	perse_property_t* path = find_property(widget, PERSE_NAME_IMAGE, PERSE_TYPE_STRING);
+	perse_property_t* bitmap = find_property(widget, PERSE_NAME_BITMAP, PERSE_TYPE_IMAGE);
+	
+	if (!path) {
+		if (bitmap) {
+			perse_RemoveProperty(widget, bitmap);
+			perse_DestroyProperty(bitmap);
+		}
+		return 0;
+	}
+	
+	int padding = widget->type == PERSE_WIDGET_IMAGE_BUTTON ?
+		PERSE_IMAGE_BUTTON_PADDING * 2 : 0;
+	
+	perse_image_t* image = perse_LoadImage(path->string,
+		widget->current_size.w - padding, widget->current_size.h - padding);
+	
+	if (!bitmap) {
+		bitmap = perse_CreatePropertyImage(NULL);
+		bitmap->name = PERSE_NAME_BITMAP;
+		perse_AddProperty(widget, bitmap);
+	}
+	
+	if (bitmap->image != image) {
+		perse_property_t value = {.type = PERSE_TYPE_IMAGE, .image = image};
+		perse_CopyPropertyValue(bitmap, &value);
+	}
+	
+	return image->state == PERSE_IMAGE_LOADING;
+}
 
-				if (offset != 0 && offset/2 > 0) {
-					w->position.x = offset/2;
-				}
-				
-				w->position.y = current_h;
-				current_h += w->current_size.h;
-			}
-		} break;
-		
-		// TODO: implement
-		case PERSE_WIDGET_GRID_LAYOUT:
-		case PERSE_WIDGET_FLOW_LAYOUT:
-		case PERSE_WIDGET_SPLITTER_LAYOUT:
-		case PERSE_WIDGET_FLEX_LAYOUT:
+// finds the images of the draw commands of a canvas that don't have one yet.
+// returns 1 if any of them aren't decoded yet
+static char load_draw_images(perse_widget_t* widget) {
+	perse_property_t* draw = find_property(widget, PERSE_NAME_DRAW, PERSE_TYPE_DRAW_LIST);
+	if (!draw) return 0;
+	
+	char loading = 0;
+	for (int i = 0; i < draw->draw_list->count; i++) {
+		perse_draw_command_t* c = &draw->draw_list->command[i];
+		if (c->type != PERSE_DRAW_IMAGE) continue;
 		
-		// do not process; child layout irrelevant
-		case PERSE_WIDGET_ITEM:
-		case PERSE_WIDGET_LIST_BOX:
-		case PERSE_WIDGET_TEXT_BOX:
-		return;
+		if (!c->image) {
+			c->image = perse_LoadImage(c->text, c->w, c->h);
+			c->image->references++;
+		}
 		
-		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
-		default:
-			// absolute layout - position remains as was set
-			break;
+		if (c->image->state == PERSE_IMAGE_LOADING) loading = 1;
 	}
 	
-	// then calculate absolute position
+	return loading;
+}
+
+static void load_images(perse_widget_t* widget) {
+	char loading;
+	
 	switch (widget->type) {
-		case PERSE_WIDGET_ABSOLUTE_LAYOUT:
-		case PERSE_WIDGET_HORIZONTAL_LAYOUT:
-		case PERSE_WIDGET_VERTICAL_LAYOUT:
-		case PERSE_WIDGET_GRID_LAYOUT:
-		case PERSE_WIDGET_FLOW_LAYOUT:
-		case PERSE_WIDGET_SPLITTER_LAYOUT:
-		case PERSE_WIDGET_FLEX_LAYOUT:
-			for (perse_widget_t* w = widget->child; w; w = w->next) {
-				w->absolute.x = widget->absolute.x + w->position.x;
-				w->absolute.y = widget->absolute.y + w->position.y;
-			}
+		case PERSE_WIDGET_IMAGE:
+		case PERSE_WIDGET_IMAGE_BUTTON:
+			loading = load_bitmap(widget);
+			break;
+		case PERSE_WIDGET_CANVAS:
+			loading = load_draw_images(widget);
 			break;
 		default:
-			for (perse_widget_t* w = widget->child; w; w = w->next) {
-				w->absolute.x = w->position.x;
-				w->absolute.y = w->position.y;
-			}	
+			return;
+	}
+	
+	if (loading) {
+		add_loading(widget);
+	} else if (widget->loading) {
+		remove_loading(widget);
+	}
+}
+
+// checks if all of the images of a widget are decoded. canvases only get the
+// commands with images that were still loading drawn again
+static char images_done(perse_widget_t* widget) {
+	if (widget->type != PERSE_WIDGET_CANVAS) {
+		perse_property_t* bitmap = find_property(widget, PERSE_NAME_BITMAP, PERSE_TYPE_IMAGE);
+		if (!bitmap) return 1;
+		if (bitmap->image->state == PERSE_IMAGE_LOADING) return 0;
+		
+		bitmap->changed = 1;
+		return 1;
+	}
+	
+	perse_property_t* draw = find_property(widget, PERSE_NAME_DRAW, PERSE_TYPE_DRAW_LIST);
+	if (!draw) return 1;
+	
+	perse_draw_list_t* list = draw->draw_list;
+	for (int i = 0; i < list->count; i++) {
+		perse_image_t* image = list->command[i].image;
+		if (image && image->state == PERSE_IMAGE_LOADING) return 0;
+	}
+	
+	// whatever damage the list had was already drawn, unless it wasn't applied
+	if (!draw->changed) list->damage_count = 0;
+	
+	for (int i = 0; i < list->count; i++) {
+		if (list->command[i].type != PERSE_DRAW_IMAGE) continue;
+		perse_DamageDrawList(list, perse_DrawBounds(&list->command[i]));
+	}
+	
+	draw->changed = 1;
+	return 1;
+}
+
+/// Shows images that have finished decoding.
+/// Should be called after perse_BackendProcessEvents(), since that is what
+/// gets woken up when an image is decoded. The widgets that were waiting for
+/// images get put on the apply list, so perse_ApplyChanges() has to be called
+/// if this returns 1. Nothing is put on it otherwise.
+/// @return 1 if anything has to be applied, 0 if not.
+int perse_UpdateImages() {
+	// images of widgets that are already gone get finished too
+	if (!perse_FinishImages() || !loading_list.count) return 0;
+	
+	char queued = 0;
+	for (int i = loading_list.count - 1; i >= 0; i--) {
+		perse_widget_t* widget = loading_list.widget[i];
+		if (!images_done(widget)) continue;
+		
+		remove_loading(widget);
+		queue_apply(widget);
+		queued = 1;
 	}
 	
+	return queued;
+}
+
+// takes a widget that is out of view out of the backend, along with all of
+// its children. properties are marked as changed, so that they get sent again
+// when it comes back into view
+static void release(perse_widget_t* widget) {
+	if (!widget->mounted) return;
+	widget->mounted = 0;
+	
 	for (perse_widget_t* w = widget->child; w; w = w->next) {
-		calculate_position(w);
+		release(w);
+	}
+	
+	if (widget->system) {
+		perse_BackendDestroyWidget(widget);
+	}
+	
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		p->changed = 1;
 	}
 }
 
-/// Calculates widget layout.
-/// Calculates the layout of widget and its child widgets.
-void perse_CalculateLayout(perse_widget_t* widget) {
-	calculate_want(widget);
-	calculate_size(widget);
-	calculate_position(widget);
+// takes a widget that is out of view out of the backend. its geometry is
+// kept as if it was applied, so that it only gets put on the apply list
+// again when it moves, instead of after every layout
+static void cull(perse_widget_t* widget) {
+	release(widget);
+	
+	widget->actual_size = widget->current_size;
+	widget->actual_pos = widget->absolute;
+}
+
+// checks if the widget is out of the `view` of its scroll panel
+static char culled(perse_widget_t* widget, const cull_rect_t* view) {
+	return view && (widget->absolute.x >= view->right ||
+		widget->absolute.y >= view->bottom ||
+		widget->absolute.x + widget->current_size.w <= view->left ||
+		widget->absolute.y + widget->current_size.h <= view->top);
 }
 
-static void apply_changes(perse_widget_t* widget, char recalc_pos) {
-	char update_size = 0;
+// applies changes of only the widget itself. returns 1 if it was moved or
+// resized
+static char apply_widget(perse_widget_t* widget, char recalc_pos) {
+	widget->mounted = 1;
+	
+	// nothing to create, its windows are top-level in the backend
+	if (widget->type == PERSE_WIDGET_APPLICATION) return 0;
+	
+	load_images(widget);
 	
 	if (widget->actual_size.w != widget->current_size.w) {
 		widget->actual_size.w = widget->current_size.w;
@@ -603,14 +2925,330 @@ static void apply_changes(perse_widget_t* widget, char recalc_pos) {
 		p->changed = 0;
 	}
 	
+	return recalc_pos;
+}
+
+// applies changes of the widget and everything below it. returns 1 if the
+// widget was moved or resized. `view` is the part of the closest scroll panel
+// that needs to be in the backend, if there is one
+static char apply_changes(perse_widget_t* widget, char recalc_pos,
+						  const cull_rect_t* view) {
+	if (culled(widget, view)) {
+		cull(widget);
+		return 0;
+	}
+	
+	recalc_pos = apply_widget(widget, recalc_pos);
+	
+	// hidden tabs keep whatever they have in the backend, but don't get updated
+	if (tab_hidden(widget)) return recalc_pos;
+	
+	cull_rect_t scroll;
+	if (widget->type == PERSE_WIDGET_SCROLL_PANEL) {
+		scroll = scroll_view(widget);
+		view = &scroll;
+	}
+	
+	char child_moved = 0;
 	for (perse_widget_t* w = widget->child; w; w = w->next) {
-		apply_changes(w, recalc_pos);
+		child_moved |= apply_changes(w, recalc_pos, view);
+	}
+	
+	// splitter dividers follow the panes, so the backend needs to know
+	if (widget->type == PERSE_WIDGET_SPLITTER_LAYOUT && child_moved &&
+		!recalc_pos && widget->system) {
+		perse_BackendSetSizePos(widget);
+	}
+	
+	return recalc_pos;
+}
+
+// widgets below something that isn't in the backend, or below a hidden tab,
+// get applied together with whatever is above them
+static char apply_skipped(perse_widget_t* widget, int* depth) {
+	*depth = 0;
+	for (perse_widget_t* w = widget->parent; w; w = w->parent) {
+		if (!w->mounted || tab_hidden(w)) return 1;
+		(*depth)++;
+	}
+	return 0;
+}
+
+static int apply_entry_compare(const void* a, const void* b) {
+	return ((const apply_entry_t*)a)->depth - ((const apply_entry_t*)b)->depth;
+}
+
+// goes through the apply list, parents first
+static void apply_queued() {
+	for (int i = 0; i < apply_list.count; i++) {
+		apply_entry_t* e = &apply_list.entry[i];
+		e->widget->queued = 0;
+		
+		// parent not in the backend yet, will be applied when it is
+		if (apply_skipped(e->widget, &e->depth)) e->widget = NULL;
+	}
+	
+	qsort(apply_list.entry, apply_list.count, sizeof(apply_entry_t),
+		apply_entry_compare);
+	
+	// panes that were moved mostly have the same splitter
+	perse_widget_t* splitter = NULL;
+	
+	for (int i = 0; i < apply_list.count; i++) {
+		perse_widget_t* widget = apply_list.entry[i].widget;
+		if (!widget) continue;
+		
+		// something earlier in the list could have culled a parent
+		int depth;
+		if (apply_skipped(widget, &depth)) continue;
+		
+		cull_rect_t view;
+		const cull_rect_t* culling = find_view(widget, &view);
+		
+		if (!widget->mounted || widget->type == PERSE_WIDGET_SCROLL_PANEL ||
+			widget->type == PERSE_WIDGET_TAB_GROUP) {
+			apply_changes(widget, 0, culling);
+			continue;
+		}
+		
+		if (culled(widget, culling)) {
+			cull(widget);
+			continue;
+		}
+		
+		if (!apply_widget(widget, 0)) continue;
+		
+		perse_widget_t* parent = widget->parent;
+		if (parent && parent != splitter && parent->system &&
+			parent->type == PERSE_WIDGET_SPLITTER_LAYOUT) {
+			perse_BackendSetSizePos(parent);
+			splitter = parent;
+		}
 	}
+	
+	apply_list.count = 0;
 }
 
 /// Applies changes.
 /// Forwards the changes created by perse_MergeTree() and 
-/// perse_CalculateLayout() to backend.
+/// perse_CalculateLayout() to backend. Only the widgets that changed are
+/// visited, except for the first time, when the whole tree gets created.
 void perse_ApplyChanges(perse_widget_t* widget) {
-	apply_changes(widget, 0);
-}
\ No newline at end of file
+	PERSE_STATS_BEGIN(PERSE_PHASE_APPLY);
+	
+	if (!widget->mounted) {
+		cull_rect_t view;
+		apply_changes(widget, 0, find_view(widget, &view));
+	}
+	
+	apply_queued();
+	
+	PERSE_STATS_END(PERSE_PHASE_APPLY);
+}
+
+/// Drags a splitter divider.
+/// Meant to be set as the ON_DRAG callback of a splitter layout. The backend
+/// should call it with the pane that is before the divider and an integer
+/// property, containing the new position of the divider, relative to the
+/// splitter. Only the panes on both sides of the divider are re-calculated and
+/// applied to the backend.
+void perse_SplitterDrag(perse_widget_t* pane, perse_property_t* position) {
+	perse_widget_t* widget = pane->parent;
+	perse_widget_t* next = pane->next;
+	
+	if (!widget || widget->type != PERSE_WIDGET_SPLITTER_LAYOUT || !next) {
+		PERSE_ERROR(PERSE_LOG_LAYOUT,
+			"perse_SplitterDrag() needs a pane that is followed by another\n");
+		return;
+	}
+	
+	if (!position || position->type != PERSE_TYPE_INTEGER) {
+		PERSE_ERROR(PERSE_LOG_LAYOUT, "perse_SplitterDrag() needs an integer position\n");
+		return;
+	}
+	
+	perse_RecordEvent(pane, position);
+	
+	splitter_cache_t* splitter = widget->layout;
+	if (!splitter) return;
+	
+	char vertical = splitter_vertical(widget);
+	
+	int start = vertical ? pane->position.y : pane->position.x;
+	int total = vertical ? pane->current_size.h + next->current_size.h
+	                     : pane->current_size.w + next->current_size.w;
+	
+	int min = vertical ? pane->want_size.min.h : pane->want_size.min.w;
+	int max = vertical ? pane->want_size.max.h : pane->want_size.max.w;
+	int next_min = vertical ? next->want_size.min.h : next->want_size.min.w;
+	int next_max = vertical ? next->want_size.max.h : next->want_size.max.w;
+	
+	if (min < 0) min = 0;
+	if (next_min < 0) next_min = 0;
+	
+	// clamp so that neither of the panes goes out of its constraints
+	int size = position->integer - start;
+	if (max != -1 && size > max) size = max;
+	if (next_max != -1 && total - size > next_max) size = total - next_max;
+	if (size > total - next_min) size = total - next_min;
+	if (size < min) size = min;
+	if (size > total) size = total;
+	
+	int old_size = vertical ? pane->current_size.h : pane->current_size.w;
+	if (size == old_size) return;
+	
+	// move the share over between the two panes
+	int index = 0;
+	for (perse_widget_t* w = widget->child; w != pane; w = w->next) index++;
+	
+	double shared = splitter->share[index] + splitter->share[index + 1];
+	splitter->share[index] = shared * size / total;
+	splitter->share[index + 1] = shared - splitter->share[index];
+	
+	if (vertical) {
+		pane->current_size.h = size;
+		next->current_size.h = total - size;
+		next->position.y = start + size + SPLITTER_DIVIDER;
+	} else {
+		pane->current_size.w = size;
+		next->current_size.w = total - size;
+		next->position.x = start + size + SPLITTER_DIVIDER;
+	}
+	
+	next->absolute.x = widget->absolute.x + next->position.x;
+	next->absolute.y = widget->absolute.y + next->position.y;
+	
+	calculate_size(pane);
+	calculate_size(next);
+	calculate_position(pane);
+	calculate_position(next);
+	reflow(widget);
+	
+	apply_queued();
+}
+
+/// Scrolls a scroll panel.
+/// Meant to be set as the ON_SCROLL callback of a scroll panel. The backend
+/// should call it with the panel and either a SCROLL_X or a SCROLL_Y integer
+/// property, containing the new offset of the content. The content is moved
+/// and widgets that came into view are created in the backend, without having
+/// to re-render the tree.
+void perse_ScrollPanelScroll(perse_widget_t* widget, perse_property_t* offset) {
+	if (widget->type != PERSE_WIDGET_SCROLL_PANEL) {
+		PERSE_ERROR(PERSE_LOG_LAYOUT, "perse_ScrollPanelScroll() needs a scroll panel\n");
+		return;
+	}
+	
+	if (!offset || offset->type != PERSE_TYPE_INTEGER ||
+		(offset->name != PERSE_NAME_SCROLL_X && offset->name != PERSE_NAME_SCROLL_Y)) {
+		PERSE_ERROR(PERSE_LOG_LAYOUT,
+			"perse_ScrollPanelScroll() needs an integer SCROLL_X or SCROLL_Y\n");
+		return;
+	}
+	
+	perse_RecordEvent(widget, offset);
+	
+	set_property_integer(widget, offset->name, offset->integer);
+	scroll_clamp(widget);
+	
+	// sizes don't change, only positions
+	calculate_position(widget);
+	
+	apply_queued();
+}
+
+/// Selects a tab.
+/// Meant to be set as the ON_SELECT callback of a tab group. The backend
+/// should call it with the tab group and a SELECTED integer property,
+/// containing the index of the tab that the user picked. The panel gets laid
+/// out and created in the backend, if it hasn't been already, and panels that
+/// haven't been shown in UNMOUNT_AFTER tab switches are taken out of it.
+void perse_TabGroupSelect(perse_widget_t* widget, perse_property_t* selected) {
+	if (widget->type != PERSE_WIDGET_TAB_GROUP) {
+		PERSE_ERROR(PERSE_LOG_LAYOUT, "perse_TabGroupSelect() needs a tab group\n");
+		return;
+	}
+	
+	if (!selected || selected->type != PERSE_TYPE_INTEGER) {
+		PERSE_ERROR(PERSE_LOG_LAYOUT,
+			"perse_TabGroupSelect() needs an integer SELECTED\n");
+		return;
+	}
+	
+	perse_RecordEvent(widget, selected);
+	
+	tab_cache_t* tabs = tab_cache(widget);
+	if (selected->integer < 0 || selected->integer >= tabs->count) return;
+	if (selected->integer == property_integer(widget, PERSE_NAME_SELECTED, 0)) return;
+	
+	set_property_integer(widget, PERSE_NAME_SELECTED, selected->integer);
+	
+	tabs->switches++;
+	tabs->visited[selected->integer] = tabs->switches;
+	
+	int unmount_after = property_integer(widget, PERSE_NAME_UNMOUNT_AFTER, 0);
+	
+	int index = 0;
+	for (perse_widget_t* panel = widget->child; panel; panel = panel->next, index++) {
+		if (index == selected->integer) {
+			calculate_want(panel);
+			calculate_size(panel);
+			calculate_position(panel);
+			reflow(panel);
+			continue;
+		}
+		
+		if (unmount_after <= 0) continue;
+		if (tabs->switches - tabs->visited[index] < unmount_after) continue;
+		
+		for (perse_widget_t* w = panel->child; w; w = w->next) {
+			release(w);
+		}
+	}
+	
+	apply_queued();
+}
+
+/// Forgets all text measurements.
+/// Should be called if the backend starts measuring differently, for example
+/// when the fonts change or the window moves to a display with another DPI.
+/// Every widget gets measured again in the next perse_CalculateLayout().
+void perse_ClearMeasureCache() {
+	free(text_cache.entry);
+	memset(&text_cache, 0, sizeof(text_cache));
+	
+	measure_epoch++;
+}
+
+/// Destroys layout cache.
+/// Frees whatever the layout calculation has stored in the `layout` pointer
+/// of the widget and takes it off of the apply and loading lists. Called when
+/// the widget is destroyed.
+void perse_DestroyLayoutCache(perse_widget_t* widget) {
+	if (widget->queued) unqueue_apply(widget);
+	if (widget->loading) remove_loading(widget);
+	
+	if (!widget->layout) return;
+	
+	switch (widget->type) {
+		case PERSE_WIDGET_GRID_LAYOUT:
+			grid_destroy(widget->layout);
+			break;
+		case PERSE_WIDGET_FLOW_LAYOUT:
+			flow_destroy(widget->layout);
+			break;
+		case PERSE_WIDGET_SPLITTER_LAYOUT:
+			splitter_destroy(widget->layout);
+			break;
+		case PERSE_WIDGET_FLEX_LAYOUT:
+			flex_destroy(widget->layout);
+			break;
+		case PERSE_WIDGET_TAB_GROUP:
+			tab_destroy(widget->layout);
+			break;
+		default:
+			free(widget->layout);
+	}
+	
+	widget->layout = NULL;
+}
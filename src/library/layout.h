@@ -5,6 +5,20 @@
 
 void perse_MergeTree(perse_widget_t*, perse_widget_t*);
 void perse_CalculateLayout(perse_widget_t*);
+void perse_ResizeLayout(perse_widget_t*);
 void perse_ApplyChanges(perse_widget_t*);
 
+int perse_UpdateProperty(perse_widget_t*, perse_property_t*);
+int perse_UpdateGeometry(perse_widget_t*, perse_range_t, perse_position_t);
+
+int perse_UpdateImages();
+
+void perse_SplitterDrag(perse_widget_t*, perse_property_t*);
+void perse_ScrollPanelScroll(perse_widget_t*, perse_property_t*);
+void perse_TabGroupSelect(perse_widget_t*, perse_property_t*);
+
+void perse_ClearMeasureCache();
+
+void perse_DestroyLayoutCache(perse_widget_t*);
+
 #endif // PERSE_LAYOUT_H
\ No newline at end of file
@@ -2,30 +2,404 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 
-void perse_DefaultLogger(const char* fmt, va_list args) {
-    vprintf(fmt, args);
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+	LOGGING
+	
+	Logging must not slow down whatever it is that is being logged, since it
+	gets called from event handlers and is left on in release builds.
+	
+	Messages below PERSE_LOG_LEVEL, or in categories that are not in
+	PERSE_LOG_CATEGORIES, are removed at compile time by the PERSE_LOG()
+	macros. The rest are checked against the filter that was set with
+	perse_SetLogFilter().
+	
+	A message that gets through is formatted right away, since its arguments
+	might not be around later, and is put into a ring buffer. Putting it in
+	doesn't take any locks, so any thread can log. A background thread takes
+	messages out of the ring and hands them to the sink, which by default
+	prints them to standard output. If the ring is full, the message gets
+	dropped and counted, instead of waiting for the sink.
+	
+	When the ring is empty the background thread sleeps on a condition
+	variable. It sets a flag before it goes to sleep and looks at the ring
+	once more, and a message that gets put in checks the flag afterwards, so
+	only the message that finds the thread asleep takes the lock to wake it.
+	
+	FATAL messages are followed by perse_FlushLog(), which writes out
+	everything that is in the ring, so that they show up before the program
+	aborts. At exit the background thread is stopped and joined, and whatever
+	is left in the ring gets written out.
+*/
+
+#define LOG_SLOTS 512				// has to be a power of two
+#define LOG_MESSAGE 244				// longer messages get cut off
+
+// the ring only needs a few atomic operations on unsigned ints
+#ifdef _MSC_VER
+static unsigned atomic_get(volatile unsigned* p) {
+	return (unsigned)InterlockedCompareExchange((volatile LONG*)p, 0, 0);
+}
+
+static void atomic_set(volatile unsigned* p, unsigned value) {
+	InterlockedExchange((volatile LONG*)p, (LONG)value);
+}
+
+static unsigned atomic_swap(volatile unsigned* p, unsigned value) {
+	return (unsigned)InterlockedExchange((volatile LONG*)p, (LONG)value);
+}
+
+static int atomic_cas(volatile unsigned* p, unsigned expected, unsigned desired) {
+	return InterlockedCompareExchange((volatile LONG*)p, (LONG)desired,
+		(LONG)expected) == (LONG)expected;
+}
+
+static void atomic_increment(volatile unsigned* p) {
+	InterlockedIncrement((volatile LONG*)p);
+}
+
+static void atomic_fence() {
+	MemoryBarrier();
+}
+#else
+static unsigned atomic_get(volatile unsigned* p) {
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static void atomic_set(volatile unsigned* p, unsigned value) {
+	__atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static unsigned atomic_swap(volatile unsigned* p, unsigned value) {
+	return __atomic_exchange_n(p, value, __ATOMIC_ACQ_REL);
+}
+
+static int atomic_cas(volatile unsigned* p, unsigned expected, unsigned desired) {
+	return __atomic_compare_exchange_n(p, &expected, desired, 0,
+		__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static void atomic_increment(volatile unsigned* p) {
+	__atomic_fetch_add(p, 1, __ATOMIC_RELAXED);
+}
+
+static void atomic_fence() {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
+
+typedef struct {
+	// slot index subtracted from the turn, so that zeroed slots are ready
+	volatile unsigned turn;
+	
+	unsigned char level;
+	unsigned char category;
+	
+	char message[LOG_MESSAGE];
+} log_slot_t;
+
+static log_slot_t ring[LOG_SLOTS];
+
+static volatile unsigned ring_head = 0;		// next slot that gets written
+static volatile unsigned ring_tail = 0;		// next slot that gets read
+
+static volatile unsigned dropped = 0;
+static volatile unsigned draining = 0;
+
+enum {
+	SINK_STOPPED,
+	SINK_STARTING,
+	SINK_RUNNING,
+	SINK_SYNCHRONOUS,	// couldn't start a thread, messages get flushed
+};
+
+static volatile unsigned sink_state = SINK_STOPPED;
+
+static volatile unsigned sink_sleeping = 0;
+static volatile unsigned sink_stopping = 0;
+
+#ifdef _WIN32
+static CRITICAL_SECTION lock;
+static CONDITION_VARIABLE wake;
+static HANDLE thread;
+
+static void lock_sink() { EnterCriticalSection(&lock); }
+static void unlock_sink() { LeaveCriticalSection(&lock); }
+static void wait_for_messages() { SleepConditionVariableCS(&wake, &lock, INFINITE); }
+static void signal_messages() { WakeConditionVariable(&wake); }
+#else
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_t thread;
+
+static void lock_sink() { pthread_mutex_lock(&lock); }
+static void unlock_sink() { pthread_mutex_unlock(&lock); }
+static void wait_for_messages() { pthread_cond_wait(&wake, &lock); }
+static void signal_messages() { pthread_cond_signal(&wake); }
+#endif
+
+static const char* level_names[] = {
+	"debug",
+	"info",
+	"warning",
+	"error",
+	"fatal",
+};
+
+static void default_sink(int level, int category, const char* message) {
+	(void)category;
+	if (level >= PERSE_LOG_WARNING && level <= PERSE_LOG_FATAL) {
+		printf("%s: %s", level_names[level], message);
+	} else {
+		fputs(message, stdout);
+	}
+}
+
+static perse_log_sink_t sink = default_sink;
+
+static int filter_level = PERSE_LOG_LEVEL;
+static unsigned filter_categories = PERSE_LOG_CATEGORIES;
+
+static unsigned slot_turn(unsigned position) {
+	return atomic_get(&ring[position & (LOG_SLOTS - 1)].turn)
+		+ (position & (LOG_SLOTS - 1));
+}
+
+static void set_slot_turn(unsigned position, unsigned turn) {
+	atomic_set(&ring[position & (LOG_SLOTS - 1)].turn,
+		turn - (position & (LOG_SLOTS - 1)));
 }
 
-static void(*logger)(const char* fmt, ...) = perse_DefaultLogger;
+// takes everything out of the ring, only one thread can be doing this at once
+static int drain() {
+	if (!atomic_cas(&draining, 0, 1)) return 0;
+	
+	int count = 0;
+	
+	unsigned lost = atomic_swap(&dropped, 0);
+	if (lost) {
+		char message[64];
+		snprintf(message, sizeof(message), "%u log messages dropped\n", lost);
+		if (sink) sink(PERSE_LOG_WARNING, PERSE_LOG_GENERAL, message);
+	}
+	
+	unsigned tail = ring_tail;
+	for (;;) {
+		log_slot_t* slot = &ring[tail & (LOG_SLOTS - 1)];
+		
+		// the slot has a message once its writer has moved the turn past it
+		if (slot_turn(tail) != tail + 1) break;
+		
+		if (sink) sink(slot->level, slot->category, slot->message);
+		
+		set_slot_turn(tail, tail + LOG_SLOTS);
+		tail++;
+		count++;
+	}
+	
+	atomic_set(&ring_tail, tail);
+	
+	if (count) fflush(stdout);
+	
+	atomic_set(&draining, 0);
+	
+	return count;
+}
+
+static int ring_empty() {
+	unsigned tail = atomic_get(&ring_tail);
+	return slot_turn(tail) != tail + 1 && !atomic_get(&dropped);
+}
+
+// sleeps until a message gets put in, or the thread gets stopped
+static void sink_wait() {
+	lock_sink();
+	
+	atomic_set(&sink_sleeping, 1);
+	atomic_fence();
+	
+	// pairs with the fence in wake_sink(), either the writer sees the flag or
+	// we see the message
+	while (ring_empty() && !atomic_get(&sink_stopping)) wait_for_messages();
+	
+	atomic_set(&sink_sleeping, 0);
+	
+	unlock_sink();
+}
+
+static void wake_sink() {
+	atomic_fence();
+	
+	if (!atomic_get(&sink_sleeping)) return;
+	
+	lock_sink();
+	signal_messages();
+	unlock_sink();
+}
+
+static void sink_loop() {
+	while (!atomic_get(&sink_stopping)) {
+		if (!drain()) sink_wait();
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI sink_thread(LPVOID param) {
+	(void)param;
+	sink_loop();
+	return 0;
+}
+#else
+static void* sink_thread(void* param) {
+	(void)param;
+	sink_loop();
+	return NULL;
+}
+#endif
 
-/// Sets a custom logger.
-/// Can be set to NULL, in which case no logging will occur.
-void perse_SetLogger(void(*fn)(const char* fmt, ...)) {
-	logger = fn;
+// messages logged after this, from other exit handlers, get flushed right away
+static void stop_sink() {
+	if (atomic_get(&sink_state) == SINK_RUNNING) {
+		atomic_set(&sink_state, SINK_SYNCHRONOUS);
+		
+		lock_sink();
+		atomic_set(&sink_stopping, 1);
+		signal_messages();
+		unlock_sink();
+		
+#ifdef _WIN32
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+#else
+		pthread_join(thread, NULL);
+#endif
+	}
+	
+	perse_FlushLog();
+}
+
+// the sink thread gets started by the first message
+static void start_sink() {
+	if (!atomic_cas(&sink_state, SINK_STOPPED, SINK_STARTING)) return;
+	
+	atexit(stop_sink);
+
+#ifdef _WIN32
+	InitializeCriticalSection(&lock);
+	InitializeConditionVariable(&wake);
+	
+	thread = CreateThread(NULL, 0, sink_thread, NULL, 0, NULL);
+	int started = thread != NULL;
+#else
+	int started = pthread_create(&thread, NULL, sink_thread, NULL) == 0;
+#endif
+
+	atomic_set(&sink_state, started ? SINK_RUNNING : SINK_SYNCHRONOUS);
 }
 
-/// Logs to logger.
-/// The default logger will just forward parameters printf() and they will be
-/// printed out to standard output. This behavior can be changed by setting some
-/// other logging function by using perse_SetLogger().
+/// Logs a message.
+/// Formats the message and queues it up for the sink, without waiting for it
+/// to be written out, unless the level is PERSE_LOG_FATAL. This is what the
+/// PERSE_LOG() macros call, for messages that weren't compiled out.
+void perse_LogV(int level, int category, const char* fmt, va_list args) {
+	if (level < filter_level || !((filter_categories >> category) & 1)) return;
+	
+	if (atomic_get(&sink_state) != SINK_RUNNING) start_sink();
+	
+	unsigned position = atomic_get(&ring_head);
+	for (;;) {
+		int difference = (int)(slot_turn(position) - position);
+		
+		if (difference == 0) {
+			if (atomic_cas(&ring_head, position, position + 1)) break;
+			position = atomic_get(&ring_head);
+		} else if (difference < 0) {
+			// the sink hasn't caught up with this slot yet, so the ring is full
+			atomic_increment(&dropped);
+			return;
+		} else {
+			position = atomic_get(&ring_head);
+		}
+	}
+	
+	log_slot_t* slot = &ring[position & (LOG_SLOTS - 1)];
+	
+	slot->level = level;
+	slot->category = category;
+	vsnprintf(slot->message, LOG_MESSAGE, fmt, args);
+	
+	set_slot_turn(position, position + 1);
+	
+	if (level >= PERSE_LOG_FATAL || atomic_get(&sink_state) == SINK_SYNCHRONOUS) {
+		perse_FlushLog();
+	} else {
+		wake_sink();
+	}
+}
+
+/// Logs a message.
+/// Same as perse_LogV().
+void perse_LogMessage(int level, int category, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	
+	perse_LogV(level, category, fmt, args);
+	
+	va_end(args);
+}
+
+/// Logs an informational message.
+/// For code that doesn't have a level or a category for its messages, new
+/// code should use the PERSE_LOG() macros, which can be compiled out.
 void perse_Log(const char* fmt, ...) {
-	if (!logger) return;
+	va_list args;
+	va_start(args, fmt);
 	
-    va_list args;
-    va_start(args, fmt);
+	perse_LogV(PERSE_LOG_INFO, PERSE_LOG_GENERAL, fmt, args);
+	
+	va_end(args);
+}
+
+/// Sets a custom log sink.
+/// The sink gets called on the logging thread, with messages that have
+/// already been formatted. The default sink prints them to standard output.
+/// Can be set to NULL, in which case the messages are thrown away.
+void perse_SetLogger(perse_log_sink_t fn) {
+	sink = fn;
+}
+
+/// Sets which messages get logged.
+/// Messages below the level, or in a category whose bit is not set, are
+/// ignored. This can only filter out more messages than PERSE_LOG_LEVEL and
+/// PERSE_LOG_CATEGORIES, which were compiled out already.
+void perse_SetLogFilter(int level, unsigned categories) {
+	filter_level = level;
+	filter_categories = categories;
+}
 
-	logger(fmt, args);
+/// Writes out all queued messages.
+/// Waits until the messages that are in the queue at the time of the call
+/// have been handed to the sink.
+void perse_FlushLog() {
+	unsigned head = atomic_get(&ring_head);
 	
-    va_end(args);
+	// if the sink thread is draining, or a message is still being written,
+	// then we wait for them to finish
+	while ((int)(atomic_get(&ring_tail) - head) < 0) {
+		if (drain()) continue;
+#ifdef _WIN32
+		Sleep(0);
+#else
+		sched_yield();
+#endif
+	}
 }
@@ -1,7 +1,62 @@
 #ifndef PERSE_PERSE_H
 #define PERSE_PERSE_H
 
+#include <stdarg.h>
+
+// log levels, messages below PERSE_LOG_LEVEL don't get compiled in
+#define PERSE_LOG_DEBUG		0
+#define PERSE_LOG_INFO		1
+#define PERSE_LOG_WARNING	2
+#define PERSE_LOG_ERROR		3
+#define PERSE_LOG_FATAL		4	//< also waits until the message is written
+#define PERSE_LOG_NONE		5
+
+// log categories, each is a bit in PERSE_LOG_CATEGORIES
+#define PERSE_LOG_GENERAL	0
+#define PERSE_LOG_LAYOUT	1
+#define PERSE_LOG_BACKEND	2
+#define PERSE_LOG_RECORD	3
+#define PERSE_LOG_SNAPSHOT	4
+#define PERSE_LOG_STATS		5
+#define PERSE_LOG_FRONTEND	6
+
+#ifndef PERSE_LOG_LEVEL
+#define PERSE_LOG_LEVEL PERSE_LOG_INFO
+#endif
+
+#ifndef PERSE_LOG_CATEGORIES
+#define PERSE_LOG_CATEGORIES 0xFFFFFFFFu
+#endif
+
+#define PERSE_LOG_ENABLED(level, category) \
+	((level) >= PERSE_LOG_LEVEL && ((PERSE_LOG_CATEGORIES >> (category)) & 1))
+
+// the level and the category are constants, so for disabled messages the
+// compiler throws away the whole call, including the arguments
+#define PERSE_LOG(level, category, ...) \
+	do { \
+		if (PERSE_LOG_ENABLED(level, category)) \
+			perse_LogMessage(level, category, __VA_ARGS__); \
+	} while (0)
+
+#define PERSE_DEBUG(category, ...) PERSE_LOG(PERSE_LOG_DEBUG, category, __VA_ARGS__)
+#define PERSE_INFO(category, ...) PERSE_LOG(PERSE_LOG_INFO, category, __VA_ARGS__)
+#define PERSE_WARNING(category, ...) PERSE_LOG(PERSE_LOG_WARNING, category, __VA_ARGS__)
+#define PERSE_ERROR(category, ...) PERSE_LOG(PERSE_LOG_ERROR, category, __VA_ARGS__)
+#define PERSE_FATAL(category, ...) PERSE_LOG(PERSE_LOG_FATAL, category, __VA_ARGS__)
+
+/// Logging function that is handed to the backend.
+typedef void (*perse_log_t)(int level, int category, const char* fmt, va_list args);
+
+/// Receives formatted log messages, on the logging thread.
+typedef void (*perse_log_sink_t)(int level, int category, const char* message);
+
+void perse_LogMessage(int level, int category, const char* fmt, ...);
+void perse_LogV(int level, int category, const char* fmt, va_list args);
 void perse_Log(const char* fmt, ...);
-void perse_SetLogger(void(*fn)(const char* fmt, ...));
 
-#endif // PERSE_PERSE_H
\ No newline at end of file
+void perse_SetLogger(perse_log_sink_t fn);
+void perse_SetLogFilter(int level, unsigned categories);
+void perse_FlushLog();
+
+#endif // PERSE_PERSE_H
@@ -2,6 +2,8 @@
 #include <string.h>
 
 #include "property.h"
+#include "canvas.h"
+#include "image.h"
 
 /*
 	BASIC EXPLANATION OF PROPERTIES
@@ -28,6 +30,7 @@ static void clean_property(perse_property_t* property) {
 			free(property->string);
 			break;
 		case PERSE_TYPE_STRING_ARRAY:
+			for (char** s = property->string_array; *s; s++) free(*s);
 			free(property->string_array);
 			break;
 		case PERSE_TYPE_CALLBACK_ARRAY:
@@ -36,6 +39,21 @@ static void clean_property(perse_property_t* property) {
 		case PERSE_TYPE_POINTER_ARRAY:
 			free(property->pointer_array);
 			break;
+		case PERSE_TYPE_DRAW_LIST:
+			if (!property->draw_list) break;
+			for (int i = 0; i < property->draw_list->count; i++) {
+				free(property->draw_list->command[i].text);
+				if (property->draw_list->command[i].image) {
+					property->draw_list->command[i].image->references--;
+				}
+			}
+			free(property->draw_list->command);
+			free(property->draw_list);
+			break;
+		case PERSE_TYPE_IMAGE:
+			// images belong to the cache, it throws them out once unused
+			if (property->image) property->image->references--;
+			break;
 		default:
 			break;
 	}
@@ -94,6 +112,28 @@ perse_property_t* perse_CreatePropertyString(const char* string) {
 	return property;
 }
 
+/// Creates a new string array property.
+/// The array and all of the strings in it will be copied.
+/// Destroy using perse_DestroyProperty().
+/// @param strings Null-terminated array of null-terminated strings.
+/// @return Pointer to new string array property.
+perse_property_t* perse_CreatePropertyStringArray(const char* const* strings) {
+	perse_property_t* property = perse_AllocateProperty();
+	
+	int count = 0;
+	while (strings[count]) count++;
+	
+	property->type = PERSE_TYPE_STRING_ARRAY;
+	property->string_array = calloc(count + 1, sizeof(char*));
+	
+	for (int i = 0; i < count; i++) {
+		property->string_array[i] = malloc(strlen(strings[i]) + 1);
+		strcpy(property->string_array[i], strings[i]);
+	}
+	
+	return property;
+}
+
 /// Creates a new callback property.
 /// @param cb Callback function pointer to be copied into the new property.
 /// @return Pointer to new callback property.
@@ -106,6 +146,32 @@ perse_property_t* perse_CreatePropertyCallback(void (*cb)(perse_widget_t*, struc
 	return property;
 }
 
+/// Creates a new draw list property.
+/// The list starts out empty, see canvas.h for adding commands to it.
+/// @return Pointer to new draw list property.
+perse_property_t* perse_CreatePropertyDrawList() {
+	perse_property_t* property = perse_AllocateProperty();
+	
+	property->type = PERSE_TYPE_DRAW_LIST;
+	property->draw_list = calloc(1, sizeof(perse_draw_list_t));
+	property->draw_list->damage_count = -1;
+	
+	return property;
+}
+
+/// Creates a new image property.
+/// Takes over one reference to `image`, which is given back when the property
+/// is destroyed. See perse_LoadImage().
+/// @return Pointer to new image property.
+perse_property_t* perse_CreatePropertyImage(perse_image_t* image) {
+	perse_property_t* property = perse_AllocateProperty();
+	
+	property->type = PERSE_TYPE_IMAGE;
+	property->image = image;
+	
+	return property;
+}
+
 /// Copies the property value.
 /// Copies the property value from `src` into `dst`. The `dst` property is
 /// marked as `changed`. Whatever value `dst` contains is destroyed. All void*
@@ -126,7 +192,7 @@ void perse_CopyPropertyValue(perse_property_t* dst, perse_property_t* src) {
 			break;
 		case PERSE_TYPE_STRING_ARRAY: {
 			int string_count = 0;
-			for (char** s = src->string_array; s; s++) string_count++;
+			for (char** s = src->string_array; *s; s++) string_count++;
 			string_count++;
 			dst->string_array = calloc(1, sizeof(char*) * string_count);
 			for (char** s = src->string_array, **d = dst->string_array; *s;
@@ -159,6 +225,24 @@ void perse_CopyPropertyValue(perse_property_t* dst, perse_property_t* src) {
 				**d = dst->pointer_array; *s;
 					s++, d++) *d = *s;
 			} break;
+		case PERSE_TYPE_DRAW_LIST: {
+			perse_draw_list_t* list = malloc(sizeof(perse_draw_list_t));
+			*list = *src->draw_list;
+			list->command = malloc(sizeof(perse_draw_command_t) * (list->count + 1));
+			list->capacity = list->count + 1;
+			for (int i = 0; i < list->count; i++) {
+				list->command[i] = src->draw_list->command[i];
+				if (list->command[i].image) list->command[i].image->references++;
+				if (!list->command[i].text) continue;
+				list->command[i].text = malloc(strlen(src->draw_list->command[i].text) + 1);
+				strcpy(list->command[i].text, src->draw_list->command[i].text);
+			}
+			dst->draw_list = list;
+			} break;
+		case PERSE_TYPE_IMAGE:
+			dst->image = src->image;
+			if (dst->image) dst->image->references++;
+			break;
 		default:
 			break;
 	}
@@ -167,6 +251,56 @@ void perse_CopyPropertyValue(perse_property_t* dst, perse_property_t* src) {
 	dst->changed = 1;
 }
 
+/// Moves the property value.
+/// Same as perse_CopyPropertyValue(), except that whatever `src` points to is
+/// handed over to `dst` instead of being copied, and `src` is left with no
+/// value. Used by merges, where `src` is destroyed right afterwards.
+void perse_MovePropertyValue(perse_property_t* dst, perse_property_t* src) {
+	clean_property(dst);
+	
+	perse_property_t* next = dst->next;
+	perse_name_t name = dst->name;
+	
+	*dst = *src;
+	
+	dst->next = next;
+	dst->name = name;
+	dst->changed = 1;
+	
+	src->type = PERSE_TYPE_INVALID;
+}
+
+/// Finds the area of the canvas that a drawing command covers.
+/// Lines cover their end points as well, images and text only what is inside
+/// of their rectangle.
+perse_draw_rect_t perse_DrawBounds(const perse_draw_command_t* command) {
+	perse_draw_rect_t r = {command->x, command->y, command->w, command->h};
+	
+	if (command->type == PERSE_DRAW_LINE) {
+		if (r.w < 0) {
+			r.x += r.w;
+			r.w = -r.w;
+		}
+		if (r.h < 0) {
+			r.y += r.h;
+			r.h = -r.h;
+		}
+		r.w++;
+		r.h++;
+	}
+	
+	return r;
+}
+
+/// Compares two canvas drawing commands.
+/// @return 1 if matches, 0 if doesn't
+int perse_IsDrawCommandMatching(const perse_draw_command_t* c1, const perse_draw_command_t* c2) {
+	if (c1->hash != c2->hash || c1->type != c2->type || c1->color != c2->color) return 0;
+	if (c1->x != c2->x || c1->y != c2->y || c1->w != c2->w || c1->h != c2->h) return 0;
+	if (!c1->text || !c2->text) return c1->text == c2->text;
+	return strcmp(c1->text, c2->text) == 0;
+}
+
 /// Compares the values of two properties.
 /// Always returns 0 for void* and void** types (pointer & pointer array), since
 /// a proper comparison cannot be performed.
@@ -182,12 +316,13 @@ int perse_IsPropertyMatching(perse_property_t* p1, perse_property_t* p2) {
 			return p1->boolean == p2->boolean;
 		case PERSE_TYPE_STRING:
 			return strcmp(p1->string, p2->string) == 0;
-		case PERSE_TYPE_STRING_ARRAY:
-			for (char** str1 = p1->string_array, **str2 = p2->string_array; 
-				*str1 && *str2; str1++, str2++) {
-					if (strcmp(*str1, *str2) != 0) return 0;
-				}
-			return 1;
+		case PERSE_TYPE_STRING_ARRAY: {
+			char** str1 = p1->string_array, **str2 = p2->string_array;
+			for (; *str1 && *str2; str1++, str2++) {
+				if (strcmp(*str1, *str2) != 0) return 0;
+			}
+			return !*str1 && !*str2;	// same length
+			}
 		case PERSE_TYPE_CALLBACK:
 			return p1->callback == p2->callback;
 		case PERSE_TYPE_CALLBACK_ARRAY:
@@ -200,6 +335,16 @@ int perse_IsPropertyMatching(perse_property_t* p1, perse_property_t* p2) {
 			return 0;
 		case PERSE_TYPE_POINTER_ARRAY:	// ditto
 			return 0;
+		case PERSE_TYPE_DRAW_LIST: {
+			perse_draw_list_t* l1 = p1->draw_list, *l2 = p2->draw_list;
+			if (l1->count != l2->count) return 0;
+			for (int i = 0; i < l1->count; i++) {
+				if (!perse_IsDrawCommandMatching(&l1->command[i], &l2->command[i])) return 0;
+			}
+			return 1;
+			}
+		case PERSE_TYPE_IMAGE:
+			return p1->image == p2->image;
 		default:
 			return 0;
 	}
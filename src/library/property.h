@@ -11,6 +11,8 @@ typedef enum {
 	PERSE_TYPE_CALLBACK_ARRAY = 6,	//< null-terminated function pointer array
 	PERSE_TYPE_POINTER = 7,			//< same as C void* type
 	PERSE_TYPE_POINTER_ARRAY = 8,	//< null-terminated void* array
+	PERSE_TYPE_DRAW_LIST = 9,		//< canvas drawing commands, see canvas.h
+	PERSE_TYPE_IMAGE = 10,			//< decoded image, see image.h
 } perse_type_t;
 
 typedef enum {
@@ -27,9 +29,61 @@ typedef enum {
 	PERSE_NAME_ON_SUBMIT,
 	PERSE_NAME_ON_CHANGE,
 	PERSE_NAME_ON_RESIZE,
+	PERSE_NAME_ON_DRAG,
+	PERSE_NAME_ON_SCROLL,
+	PERSE_NAME_ON_SELECT,
+	
+	PERSE_NAME_STRETCH,		//< share of free space in box layouts (default 1)
+							//< and flex layouts (default 0)
+	
+	PERSE_NAME_ROWS,		//< grid row tracks, e.g. "auto 1fr 24"
+	PERSE_NAME_COLUMNS,		//< grid column tracks
+	PERSE_NAME_ROW,			//< row of a widget in a grid
+	PERSE_NAME_COLUMN,		//< column of a widget in a grid
+	PERSE_NAME_ROW_SPAN,	//< number of rows a widget covers (default 1)
+	PERSE_NAME_COLUMN_SPAN,	//< number of columns a widget covers (default 1)
+	
+	PERSE_NAME_VERTICAL,	//< splitter panes and flex items go top to bottom
+	
+	PERSE_NAME_SHRINK,		//< flex item share of missing space (default 1)
+	PERSE_NAME_BASIS,		//< flex item starting size along the main axis
+	PERSE_NAME_WRAP,		//< flex items break into several lines
+	PERSE_NAME_JUSTIFY,		//< flex main axis placement, perse_align_t
+	PERSE_NAME_ALIGN,		//< flex cross axis placement, perse_align_t
+	
+	PERSE_NAME_SCROLL_X,		//< scroll panel content offset, set by library
+	PERSE_NAME_SCROLL_Y,		//< ditto
+	PERSE_NAME_SCROLL_WIDTH,	//< scroll panel content size, set by library
+	PERSE_NAME_SCROLL_HEIGHT,	//< ditto
+	
+	PERSE_NAME_SELECTED,		//< shown tab panel index, kept by library
+	PERSE_NAME_UNMOUNT_AFTER,	//< tab switches until a hidden tab is unmounted
+	
+	PERSE_NAME_HINT,			//< placeholder text of an empty text box
+	PERSE_NAME_READ_ONLY,		//< text can be selected, but not edited
+	PERSE_NAME_VALUE,			//< checked state of check boxes and radio buttons
+	PERSE_NAME_INDEX,			//< value of a radio button in its group
+	PERSE_NAME_GROUP,			//< radio buttons with the same group exclude
+	PERSE_NAME_DIRECTION,		//< where an arrow button points
+	PERSE_NAME_IMAGE,			//< path to an image file
+	PERSE_NAME_ITEMS,			//< choices of a combo box, string array
+	PERSE_NAME_DRAW,			//< what a canvas shows, draw list
+	PERSE_NAME_BITMAP,			//< decoded PERSE_NAME_IMAGE, set by library
+	PERSE_NAME_ON_CLOSE,		//< top-level window closed by the user
 } perse_name_t;
 
+typedef enum {
+	PERSE_ALIGN_START = 0,
+	PERSE_ALIGN_CENTER,
+	PERSE_ALIGN_END,
+	PERSE_ALIGN_STRETCH,		//< cross axis only
+	PERSE_ALIGN_SPACE_BETWEEN,	//< main axis only
+	PERSE_ALIGN_SPACE_AROUND,	//< main axis only
+} perse_align_t;
+
 typedef struct perse_widget perse_widget_t;
+typedef struct perse_draw_list perse_draw_list_t;
+typedef struct perse_image perse_image_t;
 
 typedef struct perse_property {
 	perse_name_t name;
@@ -46,6 +100,8 @@ typedef struct perse_property {
 		void (**callback_array)(perse_widget_t*, struct perse_property*);
 		void* pointer;
 		void** pointer_array;
+		perse_draw_list_t* draw_list;
+		perse_image_t* image;
 	};
 	
 	struct perse_property* next;
@@ -57,11 +113,14 @@ void perse_DestroyProperty(perse_property_t*);
 perse_property_t* perse_CreatePropertyInteger(int);
 perse_property_t* perse_CreatePropertyBoolean(char);
 perse_property_t* perse_CreatePropertyString(const char*);
+perse_property_t* perse_CreatePropertyStringArray(const char* const*);
 
 perse_property_t* perse_CreatePropertyCallback(void (*)(perse_widget_t*, struct perse_property*));
+perse_property_t* perse_CreatePropertyDrawList();
+perse_property_t* perse_CreatePropertyImage(perse_image_t*);
 
-// actually we should have also MovePropertyValue and use that during merges
 void perse_CopyPropertyValue(perse_property_t*, perse_property_t*);
+void perse_MovePropertyValue(perse_property_t*, perse_property_t*);
 int perse_IsPropertyMatching(perse_property_t*, perse_property_t*);
 
 #endif // PERSE_PROPERTY_H
\ No newline at end of file
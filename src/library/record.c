@@ -0,0 +1,749 @@
+#include "record.h"
+
+#include "perse.h"
+#include "backend.h"
+#include "canvas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*
+	RECORDING AND REPLAY
+
+	While recording, every call that the library makes to the backend is
+	written to a log file, along with the events that the backend sends back.
+	The log can then be replayed into any backend, without the application
+	that produced it, which makes it possible to benchmark a backend or the
+	library with the exact same workload every time.
+
+	Recording works by putting recording functions in front of the backend
+	function pointers, so nothing else in the library has to know about it.
+	Events are recorded by callbacks calling perse_RecordEvent() and widgets
+	getting destroyed call perse_RecordForget().
+
+	Widgets are given numeric IDs when they are first created in the backend,
+	starting from 1. An ID of 0 means no widget.
+
+	LOG FORMAT
+
+	The log starts with the 8 byte "PERSEREC" magic and a version byte. After
+	that follow records, each of which starts with an op byte and the time in
+	microseconds since the previous record. All integers are LEB128 varints,
+	signed ones are zigzag encoded.
+
+	CREATE			id, parent id, index in parent, type, geometry, property
+					count, properties
+	DESTROY			id
+	SET_PROPERTY	id, property
+	SET_SIZE_POS	id, geometry
+	EVENT			id, property
+	FREE			id, widget was deallocated by the library
+
+	Geometry is the x and y of `actual_pos` and w and h of `current_size`. A
+	property is its name, a type byte and a value. Strings are a length and
+	the bytes, string arrays a count and strings. Draw lists are a count and
+	commands, each a type byte, x, y, w, h, color and a string. Callbacks and
+	pointers have no value, since they make no sense outside of the recorded
+	process.
+
+	During replay, callbacks are set to a function that does nothing, and
+	events are only kept as markers in the timing.
+*/
+
+#define RECORD_VERSION 1
+
+// widget IDs are handed out one after another, so a log with anything
+// higher than this is damaged
+#define MAX_REPLAY_ID (1u << 30)
+
+enum {
+	OP_CREATE = 1,
+	OP_DESTROY,
+	OP_SET_PROPERTY,
+	OP_SET_SIZE_POS,
+	OP_EVENT,
+	OP_FREE,
+};
+
+// monotonic time in microseconds
+static unsigned long long now() {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	return counter.QuadPart * 1000000ull / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+#endif
+}
+
+static void sleep_for(unsigned long long microseconds) {
+#ifdef _WIN32
+	Sleep((DWORD)(microseconds / 1000));
+#else
+	struct timespec ts;
+	ts.tv_sec = microseconds / 1000000;
+	ts.tv_nsec = (microseconds % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/*
+	RECORDING
+*/
+
+typedef struct {
+	perse_widget_t* widget;			//< NULL if slot is empty
+	unsigned id;
+} id_entry_t;
+
+static struct {
+	int count;
+	int capacity;
+	id_entry_t* entry;
+
+	unsigned next;
+} ids;
+
+static FILE* log_file = NULL;
+static unsigned long long last_time;
+
+#ifndef PERSE_STATIC_BACKEND
+static void (*next_create_widget)(perse_widget_t*);
+static void (*next_destroy_widget)(perse_widget_t*);
+static void (*next_set_property)(perse_widget_t*, perse_property_t*);
+static void (*next_set_size_pos)(perse_widget_t*);
+#endif
+
+static id_entry_t* id_slot(id_entry_t* entry, int capacity, perse_widget_t* widget) {
+	unsigned long long i = ((unsigned long long)widget >> 4) * 0x9E3779B97F4A7C15ull;
+
+	for (;; i++) {
+		id_entry_t* e = &entry[i & (capacity - 1)];
+		if (!e->widget || e->widget == widget) return e;
+	}
+}
+
+static unsigned id_of(perse_widget_t* widget) {
+	if (!widget || !ids.capacity) return 0;
+	return id_slot(ids.entry, ids.capacity, widget)->id;
+}
+
+#ifndef PERSE_STATIC_BACKEND
+// only recorded creates give out ids
+static unsigned id_assign(perse_widget_t* widget) {
+	if (4 * (ids.count + 1) > 3 * ids.capacity) {
+		int capacity = ids.capacity ? ids.capacity * 2 : 256;
+		id_entry_t* entry = calloc(capacity, sizeof(id_entry_t));
+
+		for (int i = 0; i < ids.capacity; i++) {
+			if (!ids.entry[i].widget) continue;
+			*id_slot(entry, capacity, ids.entry[i].widget) = ids.entry[i];
+		}
+
+		free(ids.entry);
+		ids.entry = entry;
+		ids.capacity = capacity;
+	}
+
+	id_entry_t* e = id_slot(ids.entry, ids.capacity, widget);
+	if (!e->widget) {
+		e->widget = widget;
+		e->id = ++ids.next;
+		ids.count++;
+	}
+
+	return e->id;
+}
+#endif
+
+static void id_remove(perse_widget_t* widget) {
+	if (!ids.capacity) return;
+
+	id_entry_t* e = id_slot(ids.entry, ids.capacity, widget);
+	if (!e->widget) return;
+
+	// shift back the entries after it, so that lookups don't stop early
+	int hole = e - ids.entry;
+	int mask = ids.capacity - 1;
+	for (int i = (hole + 1) & mask; ids.entry[i].widget; i = (i + 1) & mask) {
+		id_entry_t* moved = &ids.entry[i];
+		int home = (((unsigned long long)moved->widget >> 4) * 0x9E3779B97F4A7C15ull) & mask;
+
+		// only move entries that would not be found past the hole
+		if (((i - home) & mask) < ((i - hole) & mask)) continue;
+
+		ids.entry[hole] = *moved;
+		hole = i;
+	}
+
+	ids.entry[hole].widget = NULL;
+	ids.entry[hole].id = 0;
+	ids.count--;
+}
+
+static void write_varint(unsigned long long value) {
+	while (value >= 0x80) {
+		fputc((int)(value & 0x7F) | 0x80, log_file);
+		value >>= 7;
+	}
+	fputc((int)value, log_file);
+}
+
+static void write_signed(long long value) {
+	write_varint(((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+static void write_string(const char* string) {
+	size_t length = strlen(string);
+	write_varint(length);
+	fwrite(string, 1, length, log_file);
+}
+
+static void write_op(int op) {
+	unsigned long long time = now();
+
+	fputc(op, log_file);
+	write_varint(time - last_time);
+
+	last_time = time;
+}
+
+#ifndef PERSE_STATIC_BACKEND
+static void write_geometry(perse_widget_t* widget) {
+	write_signed(widget->actual_pos.x);
+	write_signed(widget->actual_pos.y);
+	write_signed(widget->current_size.w);
+	write_signed(widget->current_size.h);
+}
+#endif
+
+static void write_property(perse_property_t* p) {
+	write_varint(p->name);
+	fputc(p->type, log_file);
+
+	switch (p->type) {
+		case PERSE_TYPE_INTEGER:
+			write_signed(p->integer);
+			break;
+		case PERSE_TYPE_BOOLEAN:
+			fputc(p->boolean, log_file);
+			break;
+		case PERSE_TYPE_STRING:
+			write_string(p->string ? p->string : "");
+			break;
+		case PERSE_TYPE_STRING_ARRAY: {
+			int count = 0;
+			for (char** s = p->string_array; s && *s; s++) count++;
+			write_varint(count);
+			for (int i = 0; i < count; i++) write_string(p->string_array[i]);
+		} break;
+		case PERSE_TYPE_DRAW_LIST:
+			write_varint(p->draw_list->count);
+			for (int i = 0; i < p->draw_list->count; i++) {
+				perse_draw_command_t* c = &p->draw_list->command[i];
+				fputc(c->type, log_file);
+				write_signed(c->x);
+				write_signed(c->y);
+				write_signed(c->w);
+				write_signed(c->h);
+				write_varint(c->color);
+				write_string(c->text ? c->text : "");
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+#ifndef PERSE_STATIC_BACKEND
+// when the backend is linked statically, the library calls it directly and
+// there is nothing to put these in front of
+static void record_create_widget(perse_widget_t* widget) {
+	int index = 0;
+	if (widget->parent) {
+		for (perse_widget_t* w = widget->parent->child; w != widget; w = w->next) {
+			index++;
+		}
+	}
+
+	int count = 0;
+	for (perse_property_t* p = widget->property; p; p = p->next) count++;
+
+	write_op(OP_CREATE);
+	write_varint(id_assign(widget));
+	write_varint(id_of(widget->parent));
+	write_varint(index);
+	write_varint(widget->type);
+	write_geometry(widget);
+	write_varint(count);
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		write_property(p);
+	}
+
+	next_create_widget(widget);
+}
+
+static void record_destroy_widget(perse_widget_t* widget) {
+	write_op(OP_DESTROY);
+	write_varint(id_of(widget));
+
+	next_destroy_widget(widget);
+}
+
+static void record_set_property(perse_widget_t* widget, perse_property_t* p) {
+	write_op(OP_SET_PROPERTY);
+	write_varint(id_of(widget));
+	write_property(p);
+
+	next_set_property(widget, p);
+}
+
+static void record_set_size_pos(perse_widget_t* widget) {
+	write_op(OP_SET_SIZE_POS);
+	write_varint(id_of(widget));
+	write_geometry(widget);
+
+	next_set_size_pos(widget);
+}
+#endif
+
+/// Starts recording backend calls.
+/// Everything that gets sent to the backend from now on, until
+/// perse_StopRecording() is called, is written to the file at `path`. Should
+/// be called after perse_LoadBackend().
+/// @return 1 if the file could be opened, 0 otherwise.
+int perse_StartRecording(const char* path) {
+#ifdef PERSE_STATIC_BACKEND
+	(void)path;
+	PERSE_ERROR(PERSE_LOG_RECORD,
+		"perse_StartRecording() needs a backend that is loaded at runtime\n");
+	return 0;
+#else
+	perse_StopRecording();
+
+	log_file = fopen(path, "wb");
+	if (!log_file) {
+		PERSE_ERROR(PERSE_LOG_RECORD, "perse_StartRecording() could not open %s\n", path);
+		return 0;
+	}
+
+	fwrite("PERSEREC", 1, 8, log_file);
+	fputc(RECORD_VERSION, log_file);
+
+	last_time = now();
+
+	next_create_widget = perse_BackendCreateWidget;
+	next_destroy_widget = perse_BackendDestroyWidget;
+	next_set_property = perse_BackendSetProperty;
+	next_set_size_pos = perse_BackendSetSizePos;
+
+	perse_BackendCreateWidget = record_create_widget;
+	perse_BackendDestroyWidget = record_destroy_widget;
+	perse_BackendSetProperty = record_set_property;
+	perse_BackendSetSizePos = record_set_size_pos;
+
+	return 1;
+#endif
+}
+
+/// Stops recording backend calls.
+void perse_StopRecording() {
+	if (!log_file) return;
+
+#ifndef PERSE_STATIC_BACKEND
+	perse_BackendCreateWidget = next_create_widget;
+	perse_BackendDestroyWidget = next_destroy_widget;
+	perse_BackendSetProperty = next_set_property;
+	perse_BackendSetSizePos = next_set_size_pos;
+#endif
+
+	fclose(log_file);
+	log_file = NULL;
+
+	free(ids.entry);
+	memset(&ids, 0, sizeof(ids));
+}
+
+/// Records an event.
+/// Should be called by callbacks that the backend calls, with the same
+/// arguments that the callback received.
+void perse_RecordEvent(perse_widget_t* widget, perse_property_t* p) {
+	if (!log_file) return;
+
+	// some events, like window resizes, come without a property
+	perse_property_t none = {0};	// PERSE_NAME_INVALID, PERSE_TYPE_INVALID
+
+	write_op(OP_EVENT);
+	write_varint(id_of(widget));
+	write_property(p ? p : &none);
+}
+
+/// Forgets a widget.
+/// Called when a widget is deallocated, so that its ID doesn't get reused by
+/// another widget that ends up at the same address.
+void perse_RecordForget(perse_widget_t* widget) {
+	if (!log_file) return;
+
+	unsigned id = id_of(widget);
+	if (!id) return;
+
+	write_op(OP_FREE);
+	write_varint(id);
+
+	id_remove(widget);
+}
+
+/*
+	REPLAY
+*/
+
+typedef struct {
+	FILE* file;
+	char failed;
+} reader_t;
+
+static int read_byte(reader_t* r) {
+	int c = fgetc(r->file);
+	if (c == EOF) r->failed = 1;
+	return c;
+}
+
+static unsigned long long read_varint(reader_t* r) {
+	unsigned long long value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = read_byte(r);
+		if (r->failed) return 0;
+
+		value |= (unsigned long long)(c & 0x7F) << shift;
+		if (!(c & 0x80)) return value;
+	}
+
+	r->failed = 1;
+	return 0;
+}
+
+static long long read_signed(reader_t* r) {
+	unsigned long long value = read_varint(r);
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+static char* read_string(reader_t* r) {
+	unsigned long long length = read_varint(r);
+	if (r->failed || length > (1 << 24)) {
+		r->failed = 1;
+		return NULL;
+	}
+
+	char* string = malloc(length + 1);
+	if (fread(string, 1, length, r->file) != length) r->failed = 1;
+	string[length] = '\0';
+
+	return string;
+}
+
+static void read_geometry(reader_t* r, perse_widget_t* widget) {
+	widget->actual_pos.x = widget->absolute.x = read_signed(r);
+	widget->actual_pos.y = widget->absolute.y = read_signed(r);
+	widget->current_size.w = widget->actual_size.w = read_signed(r);
+	widget->current_size.h = widget->actual_size.h = read_signed(r);
+}
+
+static void replay_callback(perse_widget_t* widget, perse_property_t* p) {
+	(void)widget;
+	(void)p;
+}
+
+static perse_property_t* read_property(reader_t* r) {
+	perse_property_t* p = perse_AllocateProperty();
+	p->name = read_varint(r);
+	p->type = read_byte(r);
+	p->changed = 1;
+
+	switch (p->type) {
+		case PERSE_TYPE_INTEGER:
+			p->integer = read_signed(r);
+			break;
+		case PERSE_TYPE_BOOLEAN:
+			p->boolean = read_byte(r);
+			break;
+		case PERSE_TYPE_STRING:
+			p->string = read_string(r);
+			if (!p->string) p->string = calloc(1, 1);
+			break;
+		case PERSE_TYPE_STRING_ARRAY: {
+			unsigned long long count = read_varint(r);
+			if (count > (1 << 20)) {
+				r->failed = 1;
+				count = 0;
+			}
+			p->string_array = calloc(count + 1, sizeof(char*));
+			for (unsigned long long i = 0; i < count && !r->failed; i++) {
+				p->string_array[i] = read_string(r);
+			}
+		} break;
+		case PERSE_TYPE_CALLBACK:
+			p->callback = replay_callback;
+			break;
+		case PERSE_TYPE_CALLBACK_ARRAY:
+			p->callback_array = calloc(1, sizeof(*p->callback_array));
+			break;
+		case PERSE_TYPE_POINTER_ARRAY:
+			p->pointer_array = calloc(1, sizeof(void*));
+			break;
+		case PERSE_TYPE_DRAW_LIST: {
+			unsigned long long count = read_varint(r);
+			if (count > (1 << 20)) {
+				r->failed = 1;
+				count = 0;
+			}
+			p->draw_list = calloc(1, sizeof(perse_draw_list_t));
+			p->draw_list->damage_count = -1;
+			for (unsigned long long i = 0; i < count && !r->failed; i++) {
+				int type = read_byte(r);
+				int x = read_signed(r);
+				int y = read_signed(r);
+				int w = read_signed(r);
+				int h = read_signed(r);
+				unsigned color = read_varint(r);
+				char* text = read_string(r);
+				switch (type) {
+					case PERSE_DRAW_LINE: perse_DrawLine(p->draw_list, x, y, x + w, y + h, color); break;
+					case PERSE_DRAW_RECT: perse_DrawRect(p->draw_list, x, y, w, h, color); break;
+					case PERSE_DRAW_FILL: perse_FillRect(p->draw_list, x, y, w, h, color); break;
+					case PERSE_DRAW_TEXT: perse_DrawText(p->draw_list, x, y, w, h, color, text); break;
+					case PERSE_DRAW_IMAGE: perse_DrawImage(p->draw_list, x, y, w, h, text); break;
+					default: r->failed = 1; break;
+				}
+				free(text);
+			}
+		} break;
+		default:
+			break;
+	}
+
+	return p;
+}
+
+typedef struct {
+	int capacity;
+	perse_widget_t** widget;		//< by ID
+} replay_t;
+
+static perse_widget_t** replay_slot(replay_t* replay, unsigned long long id) {
+	if (id >= (unsigned long long)replay->capacity) {
+		int capacity = replay->capacity ? replay->capacity : 256;
+		while ((unsigned long long)capacity <= id) capacity *= 2;
+
+		replay->widget = realloc(replay->widget, sizeof(perse_widget_t*) * capacity);
+		memset(replay->widget + replay->capacity, 0,
+			sizeof(perse_widget_t*) * (capacity - replay->capacity));
+		replay->capacity = capacity;
+	}
+
+	return &replay->widget[id];
+}
+
+// finds a widget that was created earlier in the log, without growing the
+// table for IDs that were never created
+static perse_widget_t* replay_find(reader_t* r, replay_t* replay, unsigned long long id) {
+	if (r->failed || id > MAX_REPLAY_ID) {
+		r->failed = 1;
+		return NULL;
+	}
+
+	return id < (unsigned long long)replay->capacity ? replay->widget[id] : NULL;
+}
+
+// puts a widget in its parent. siblings that were never created in the
+// backend don't exist here, so `index` can only be followed so far
+static void replay_insert(perse_widget_t* parent, perse_widget_t* widget,
+						  int index) {
+	perse_widget_t** link = &parent->child;
+	for (int i = 0; *link && i < index; i++) link = &(*link)->next;
+
+	widget->next = *link;
+	widget->parent = parent;
+	*link = widget;
+}
+
+static void replay_create(reader_t* r, replay_t* replay) {
+	unsigned long long id = read_varint(r);
+	unsigned long long parent = read_varint(r);
+	int index = read_varint(r);
+	int type = read_varint(r);
+	if (r->failed || !id || id > MAX_REPLAY_ID) {
+		r->failed = 1;
+		return;
+	}
+
+	perse_widget_t** slot = replay_slot(replay, id);
+	perse_widget_t* widget = *slot;
+
+	if (!widget) {
+		widget = perse_AllocateWidget();
+		widget->type = type;
+		*slot = widget;
+
+		perse_widget_t* parent_widget = replay_find(r, replay, parent);
+		if (parent_widget) replay_insert(parent_widget, widget, index);
+	}
+
+	read_geometry(r, widget);
+
+	// same as in the recorded process, only the new properties are there
+	for (perse_property_t* p = widget->property; p;) {
+		perse_property_t* next = p->next;
+		perse_DestroyProperty(p);
+		p = next;
+	}
+	widget->property = NULL;
+
+	unsigned long long count = read_varint(r);
+	for (unsigned long long i = 0; i < count && !r->failed; i++) {
+		perse_AddProperty(widget, read_property(r));
+	}
+
+	if (!r->failed) perse_BackendCreateWidget(widget);
+}
+
+static void replay_set_property(reader_t* r, replay_t* replay) {
+	perse_widget_t* widget = replay_find(r, replay, read_varint(r));
+	perse_property_t* p = read_property(r);
+
+	if (r->failed || !widget) {
+		perse_DestroyProperty(p);
+		return;
+	}
+
+	perse_property_t* existing = widget->property;
+	while (existing && existing->name != p->name) existing = existing->next;
+
+	if (existing) {
+		perse_CopyPropertyValue(existing, p);
+		perse_DestroyProperty(p);
+		p = existing;
+	} else {
+		perse_AddProperty(widget, p);
+	}
+
+	perse_BackendSetProperty(widget, p);
+	p->changed = 0;
+}
+
+static void replay_free(reader_t* r, replay_t* replay) {
+	unsigned long long id = read_varint(r);
+	if (!replay_find(r, replay, id)) return;
+
+	perse_widget_t** slot = &replay->widget[id];
+
+	if ((*slot)->parent) perse_SetParent(*slot, NULL);
+
+	// any children that are left were never freed in the recording
+	for (perse_widget_t* w = (*slot)->child; w; w = w->next) w->parent = NULL;
+	(*slot)->child = NULL;
+
+	perse_DestroyWidget(*slot);
+	*slot = NULL;
+}
+
+/// Replays a recording.
+/// Feeds the backend calls from a log written by perse_StartRecording() into
+/// the currently loaded backend. If `realtime` is set, the calls are spaced
+/// out the same as they were when recorded, otherwise they are made as fast
+/// as possible.
+/// @return Number of records replayed, or -1 if the log can't be read.
+int perse_Replay(const char* path, int realtime) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		PERSE_ERROR(PERSE_LOG_RECORD, "perse_Replay() could not open %s\n", path);
+		return -1;
+	}
+
+	char magic[8];
+	if (fread(magic, 1, 8, file) != 8 || memcmp(magic, "PERSEREC", 8) != 0 ||
+		fgetc(file) != RECORD_VERSION) {
+		PERSE_ERROR(PERSE_LOG_RECORD, "perse_Replay() %s is not a recording\n", path);
+		fclose(file);
+		return -1;
+	}
+
+	reader_t r = {file, 0};
+	replay_t replay = {0, NULL};
+
+	unsigned long long start = now();
+	unsigned long long elapsed = 0;
+	int records = 0;
+
+	for (;;) {
+		int op = fgetc(file);
+		if (op == EOF) break;
+
+		elapsed += read_varint(&r);
+		if (realtime) {
+			unsigned long long current = now() - start;
+			if (elapsed > current) sleep_for(elapsed - current);
+		}
+
+		switch (op) {
+			case OP_CREATE:
+				replay_create(&r, &replay);
+				break;
+			case OP_DESTROY: {
+				perse_widget_t* widget = replay_find(&r, &replay, read_varint(&r));
+				if (widget) perse_BackendDestroyWidget(widget);
+			} break;
+			case OP_SET_PROPERTY:
+				replay_set_property(&r, &replay);
+				break;
+			case OP_SET_SIZE_POS: {
+				perse_widget_t* widget = replay_find(&r, &replay, read_varint(&r));
+				perse_widget_t ignored;
+				read_geometry(&r, widget ? widget : &ignored);
+				if (widget && !r.failed) perse_BackendSetSizePos(widget);
+			} break;
+			case OP_EVENT:
+				read_varint(&r);
+				perse_DestroyProperty(read_property(&r));
+				break;
+			case OP_FREE:
+				replay_free(&r, &replay);
+				break;
+			default:
+				r.failed = 1;
+		}
+
+		if (r.failed) {
+			PERSE_ERROR(PERSE_LOG_RECORD,
+				"perse_Replay() %s is damaged after %i records\n", path, records);
+			break;
+		}
+
+		records++;
+	}
+
+	// whatever is left was still alive when the recording stopped. children
+	// always have higher IDs than their parents, so they go first
+	for (int i = replay.capacity - 1; i > 0; i--) {
+		if (replay.widget[i]) perse_DestroyWidget(replay.widget[i]);
+	}
+
+	free(replay.widget);
+	fclose(file);
+
+	return r.failed ? -1 : records;
+}
@@ -0,0 +1,14 @@
+#ifndef PERSE_RECORD_H
+#define PERSE_RECORD_H
+
+#include "widget.h"
+
+int perse_StartRecording(const char* path);
+void perse_StopRecording();
+
+void perse_RecordEvent(perse_widget_t*, perse_property_t*);
+void perse_RecordForget(perse_widget_t*);
+
+int perse_Replay(const char* path, int realtime);
+
+#endif // PERSE_RECORD_H
@@ -0,0 +1,487 @@
+#include "snapshot.h"
+
+#include "perse.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+	SNAPSHOTS
+	
+	A snapshot is a laid out widget tree, flattened into a single buffer, so
+	that the next time the application starts, the tree can be put into the
+	backend right away, without waiting for the frontend to build it and for
+	the layout to be calculated. The first real render then gets merged into
+	the tree that came from the snapshot, the same as any other frame, so only
+	what differs gets sent to the backend.
+	
+	The buffer contains no pointers, only indices and offsets, so it can be
+	read straight from a memory mapped file. It is laid out like this:
+	
+	header			magic, version, byte order mark, counts
+	widgets			snapshot_widget_t for each widget, parents before children
+	properties		snapshot_property_t, those of each widget next to each other
+	strings			null-terminated, property values point into here
+	
+	Along with the type, key and properties, a widget keeps its constraints,
+	want size, computed size and positions and intrinsic size, so that nothing
+	has to be measured again unless it changes. Widgets are loaded as not
+	`changed`.
+	
+	Callbacks and pointers are not saved, since they would be meaningless in
+	the next process. The frontend adds them back during the first merge.
+*/
+
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BOM 0x01020304
+
+typedef struct {
+	char magic[8];					//< "PERSESNP"
+	uint32_t version;
+	uint32_t bom;					//< reads as SNAPSHOT_BOM in same byte order
+	uint32_t widget_count;
+	uint32_t property_count;
+	uint32_t string_size;
+	uint32_t reserved;
+} snapshot_header_t;
+
+typedef struct {
+	int32_t type;
+	int32_t key;
+	
+	int32_t child;					//< index of first child, -1 if none
+	int32_t next;					//< index of next sibling, -1 if none
+	
+	int32_t property;				//< index of first property
+	int32_t property_count;
+	
+	perse_range_t constraint_size;
+	perse_range_t want_size;
+	perse_size_t current_size;
+	perse_size_t intrinsic;
+	perse_position_t position;
+	perse_position_t absolute;
+} snapshot_widget_t;
+
+typedef struct {
+	int32_t name;
+	int32_t type;
+	int32_t value;					//< integer, boolean or string offset
+	int32_t count;					//< number of strings in a string array
+} snapshot_property_t;
+
+typedef struct {
+	snapshot_widget_t* widget;
+	snapshot_property_t* property;
+	char* string;
+	
+	uint32_t widget_count;
+	uint32_t property_count;
+	uint32_t string_size;
+} snapshot_writer_t;
+
+static int saved(perse_property_t* p) {
+	switch (p->type) {
+		case PERSE_TYPE_INTEGER:
+		case PERSE_TYPE_BOOLEAN:
+		case PERSE_TYPE_STRING:
+		case PERSE_TYPE_STRING_ARRAY:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static size_t align4(size_t size) {
+	return (size + 3) & ~(size_t)3;
+}
+
+// first pass, counts everything so that the buffer can be allocated at once
+static void count(perse_widget_t* widget, snapshot_writer_t* w) {
+	w->widget_count++;
+	
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (!saved(p)) continue;
+		w->property_count++;
+		
+		if (p->type == PERSE_TYPE_STRING) {
+			w->string_size += strlen(p->string) + 1;
+		} else if (p->type == PERSE_TYPE_STRING_ARRAY) {
+			for (char** s = p->string_array; *s; s++) {
+				w->string_size += strlen(*s) + 1;
+			}
+		}
+	}
+	
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		count(c, w);
+	}
+}
+
+static int32_t write_string(snapshot_writer_t* w, const char* string) {
+	int32_t offset = w->string_size;
+	size_t length = strlen(string) + 1;
+	
+	memcpy(w->string + offset, string, length);
+	w->string_size += length;
+	
+	return offset;
+}
+
+// second pass, fills in the widget and its children. returns its index
+static int32_t write_widget(perse_widget_t* widget, snapshot_writer_t* w) {
+	int32_t index = w->widget_count++;
+	snapshot_widget_t* s = &w->widget[index];
+	
+	s->type = widget->type;
+	s->key = widget->key;
+	s->child = -1;
+	s->next = -1;
+	s->constraint_size = widget->constraint_size;
+	s->want_size = widget->want_size;
+	s->current_size = widget->current_size;
+	s->intrinsic = widget->intrinsic;
+	s->position = widget->position;
+	s->absolute = widget->absolute;
+	
+	s->property = w->property_count;
+	s->property_count = 0;
+	
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (!saved(p)) continue;
+		
+		snapshot_property_t* sp = &w->property[w->property_count++];
+		sp->name = p->name;
+		sp->type = p->type;
+		sp->value = 0;
+		sp->count = 0;
+		
+		switch (p->type) {
+			case PERSE_TYPE_INTEGER:
+				sp->value = p->integer;
+				break;
+			case PERSE_TYPE_BOOLEAN:
+				sp->value = p->boolean;
+				break;
+			case PERSE_TYPE_STRING:
+				sp->value = write_string(w, p->string);
+				break;
+			case PERSE_TYPE_STRING_ARRAY:
+				sp->value = w->string_size;
+				for (char** str = p->string_array; *str; str++) {
+					write_string(w, *str);
+					sp->count++;
+				}
+				break;
+			default:
+				break;
+		}
+		
+		s->property_count++;
+	}
+	
+	int32_t previous = -1;
+	for (perse_widget_t* c = widget->child; c; c = c->next) {
+		int32_t child = write_widget(c, w);
+		
+		if (previous == -1) {
+			s->child = child;
+		} else {
+			w->widget[previous].next = child;
+		}
+		
+		previous = child;
+	}
+	
+	return index;
+}
+
+/// Writes a snapshot of a laid out widget tree into a buffer.
+/// The tree should have been through perse_CalculateLayout(). The buffer
+/// can be written to a file and read back with perse_ReadSnapshot().
+/// @param size Set to the size of the buffer.
+/// @return Buffer that has to be freed with free().
+void* perse_WriteSnapshot(perse_widget_t* root, size_t* size) {
+	snapshot_writer_t w = {0};
+	count(root, &w);
+	
+	size_t widgets = sizeof(snapshot_header_t);
+	size_t properties = widgets + w.widget_count * sizeof(snapshot_widget_t);
+	size_t strings = properties + w.property_count * sizeof(snapshot_property_t);
+	size_t total = align4(strings + w.string_size);
+	
+	char* buffer = calloc(1, total);
+	if (!buffer) return NULL;
+	
+	snapshot_header_t* header = (snapshot_header_t*)buffer;
+	memcpy(header->magic, "PERSESNP", 8);
+	header->version = SNAPSHOT_VERSION;
+	header->bom = SNAPSHOT_BOM;
+	header->widget_count = w.widget_count;
+	header->property_count = w.property_count;
+	header->string_size = w.string_size;
+	
+	w.widget = (snapshot_widget_t*)(buffer + widgets);
+	w.property = (snapshot_property_t*)(buffer + properties);
+	w.string = buffer + strings;
+	w.widget_count = 0;
+	w.property_count = 0;
+	w.string_size = 0;
+	
+	write_widget(root, &w);
+	
+	*size = total;
+	return buffer;
+}
+
+typedef struct {
+	const snapshot_widget_t* widget;
+	const snapshot_property_t* property;
+	const char* string;
+	
+	uint32_t widget_count;
+	uint32_t property_count;
+	uint32_t string_size;
+	
+	uint32_t read;					//< widgets read so far
+} snapshot_reader_t;
+
+// checks that a string is in the buffer and terminated
+static const char* read_string(snapshot_reader_t* r, int32_t offset) {
+	if (offset < 0 || (uint32_t)offset >= r->string_size) return NULL;
+	if (!memchr(r->string + offset, 0, r->string_size - offset)) return NULL;
+	return r->string + offset;
+}
+
+static perse_property_t* read_property(snapshot_reader_t* r,
+                                       const snapshot_property_t* sp) {
+	perse_property_t* p = NULL;
+	
+	switch (sp->type) {
+		case PERSE_TYPE_INTEGER:
+			p = perse_CreatePropertyInteger(sp->value);
+			break;
+		case PERSE_TYPE_BOOLEAN:
+			p = perse_CreatePropertyBoolean(sp->value);
+			break;
+		case PERSE_TYPE_STRING: {
+			const char* string = read_string(r, sp->value);
+			if (!string) return NULL;
+			p = perse_CreatePropertyString(string);
+		} break;
+		case PERSE_TYPE_STRING_ARRAY: {
+			// each string takes up at least its terminator
+			if (sp->count < 0 || (uint32_t)sp->count > r->string_size) return NULL;
+			
+			const char** strings = calloc((size_t)sp->count + 1, sizeof(char*));
+			if (!strings) return NULL;
+			
+			int32_t offset = sp->value;
+			for (int32_t i = 0; i < sp->count; i++) {
+				strings[i] = read_string(r, offset);
+				if (!strings[i]) {
+					free(strings);
+					return NULL;
+				}
+				offset += strlen(strings[i]) + 1;
+			}
+			
+			p = perse_CreatePropertyStringArray(strings);
+			free(strings);
+		} break;
+		default:
+			return NULL;
+	}
+	
+	p->name = sp->name;
+	return p;
+}
+
+static perse_widget_t* read_widget(snapshot_reader_t* r, int32_t index) {
+	// indices always point forward, so a bad buffer can't make a loop
+	if (index < 0 || (uint32_t)index >= r->widget_count ||
+		(uint32_t)index < r->read) return NULL;
+	r->read = index + 1;
+	
+	const snapshot_widget_t* s = &r->widget[index];
+	
+	// the type goes to the layout and the backend, which switch on it.
+	// APPLICATION is the last one
+	if (s->type <= PERSE_WIDGET_INVALID || s->type > PERSE_WIDGET_APPLICATION) {
+		return NULL;
+	}
+	
+	if (s->property < 0 || s->property_count < 0 ||
+		(uint32_t)s->property + s->property_count > r->property_count) {
+		return NULL;
+	}
+	
+	perse_widget_t* widget = perse_AllocateWidget();
+	
+	widget->type = s->type;
+	widget->key = s->key;
+	widget->constraint_size = s->constraint_size;
+	widget->want_size = s->want_size;
+	widget->current_size = s->current_size;
+	widget->intrinsic = s->intrinsic;
+	widget->position = s->position;
+	widget->absolute = s->absolute;
+	
+	// properties get prepended, so go backwards to keep the order
+	for (int32_t i = s->property_count - 1; i >= 0; i--) {
+		perse_property_t* p = read_property(r, &r->property[s->property + i]);
+		if (!p) goto fail;
+		perse_AddProperty(widget, p);
+	}
+	
+	// children are linked up directly, since perse_AddChild() would walk the
+	// list for each one
+	perse_widget_t* last = NULL;
+	for (int32_t c = s->child; c != -1; c = r->widget[c].next) {
+		perse_widget_t* child = read_widget(r, c);
+		if (!child) goto fail;
+		
+		child->parent = widget;
+		if (last) {
+			last->next = child;
+		} else {
+			widget->child = child;
+		}
+		last = child;
+	}
+	
+	widget->changed = 0;
+	
+	return widget;
+	
+fail:
+	perse_DestroyWidget(widget);
+	return NULL;
+}
+
+/// Reads a widget tree from a snapshot.
+/// The tree comes out laid out and ready for perse_ApplyChanges(), after
+/// which it can be merged with perse_MergeTree() like any other. The buffer
+/// isn't needed after this returns.
+/// @return Root of the tree, or NULL if the buffer isn't a valid snapshot.
+perse_widget_t* perse_ReadSnapshot(const void* data, size_t size) {
+	const char* buffer = data;
+	const snapshot_header_t* header = data;
+	
+	if (size < sizeof(snapshot_header_t) ||
+		memcmp(header->magic, "PERSESNP", 8) != 0) {
+		PERSE_ERROR(PERSE_LOG_SNAPSHOT, "perse_ReadSnapshot() buffer isn't a snapshot\n");
+		return NULL;
+	}
+	
+	if (header->version != SNAPSHOT_VERSION || header->bom != SNAPSHOT_BOM) {
+		PERSE_ERROR(PERSE_LOG_SNAPSHOT,
+			"perse_ReadSnapshot() snapshot from a different version\n");
+		return NULL;
+	}
+	
+	size_t widgets = sizeof(snapshot_header_t);
+	size_t properties = widgets +
+		(size_t)header->widget_count * sizeof(snapshot_widget_t);
+	size_t strings = properties +
+		(size_t)header->property_count * sizeof(snapshot_property_t);
+	
+	if (!header->widget_count || strings + header->string_size > size) {
+		PERSE_ERROR(PERSE_LOG_SNAPSHOT, "perse_ReadSnapshot() snapshot is truncated\n");
+		return NULL;
+	}
+	
+	snapshot_reader_t r = {
+		.widget = (const snapshot_widget_t*)(buffer + widgets),
+		.property = (const snapshot_property_t*)(buffer + properties),
+		.string = buffer + strings,
+		.widget_count = header->widget_count,
+		.property_count = header->property_count,
+		.string_size = header->string_size,
+	};
+	
+	perse_widget_t* root = read_widget(&r, 0);
+	if (!root) PERSE_ERROR(PERSE_LOG_SNAPSHOT,
+		"perse_ReadSnapshot() snapshot is corrupt\n");
+	
+	return root;
+}
+
+/// Saves a snapshot of a laid out widget tree to a file.
+/// @return 1 if saved, 0 otherwise.
+int perse_SaveSnapshot(perse_widget_t* root, const char* path) {
+	size_t size;
+	void* buffer = perse_WriteSnapshot(root, &size);
+	if (!buffer) return 0;
+	
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		PERSE_ERROR(PERSE_LOG_SNAPSHOT, "perse_SaveSnapshot() could not open %s\n", path);
+		free(buffer);
+		return 0;
+	}
+	
+	size_t written = fwrite(buffer, 1, size, file);
+	fclose(file);
+	free(buffer);
+	
+	return written == size;
+}
+
+/// Loads a widget tree from a snapshot file.
+/// The file is memory mapped and read in place.
+/// @return Root of the tree, or NULL if there is no valid snapshot.
+perse_widget_t* perse_LoadSnapshot(const char* path) {
+	perse_widget_t* root = NULL;
+	
+#ifdef _WIN32
+	HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+	
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	
+	if (mapping) {
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data) {
+			root = perse_ReadSnapshot(data, (size_t)size.QuadPart);
+			UnmapViewOfFile(data);
+		}
+		CloseHandle(mapping);
+	}
+	
+	CloseHandle(file);
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0) return NULL;
+	
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0) {
+		void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			root = perse_ReadSnapshot(data, info.st_size);
+			munmap(data, info.st_size);
+		}
+	}
+	
+	close(file);
+#endif
+	
+	return root;
+}
@@ -0,0 +1,14 @@
+#ifndef PERSE_SNAPSHOT_H
+#define PERSE_SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "widget.h"
+
+void* perse_WriteSnapshot(perse_widget_t* root, size_t* size);
+perse_widget_t* perse_ReadSnapshot(const void* data, size_t size);
+
+int perse_SaveSnapshot(perse_widget_t* root, const char* path);
+perse_widget_t* perse_LoadSnapshot(const char* path);
+
+#endif // PERSE_SNAPSHOT_H
@@ -0,0 +1,174 @@
+#include "stats.h"
+
+#include "perse.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+	FRAME STATISTICS
+
+	When the library is compiled with PERSE_STATS defined, the time spent in
+	each phase of a frame and the amount of work done is counted. The frontend
+	marks the end of each frame with perse_EndFrame(), after which the counts
+	for the frame can be read with perse_GetFrameStats().
+
+	The same can also be written out as a Chrome trace, that can be opened in
+	chrome://tracing or Perfetto. Each phase becomes a span and the counters
+	for each frame are written as counter events.
+
+	Without PERSE_STATS, nothing is counted and all of the instrumentation in
+	the rest of the library compiles to nothing.
+*/
+
+#ifdef PERSE_STATS
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+perse_frame_stats_t perse_stats;
+
+static perse_frame_stats_t last_frame;
+static double phase_start[PERSE_PHASE_COUNT];
+
+static FILE* trace = NULL;
+static double trace_start = 0.0;
+static char trace_first = 1;
+
+static const char* phase_names[PERSE_PHASE_COUNT] = {
+	"build",
+	"merge",
+	"layout",
+	"apply",
+};
+
+// monotonic time in microseconds
+static double now() {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	return counter.QuadPart * 1000000.0 / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+#endif
+}
+
+static void trace_separator() {
+	if (!trace_first) fputs(",\n", trace);
+	trace_first = 0;
+}
+
+void perse_StatsBegin(perse_phase_t phase) {
+	phase_start[phase] = now();
+}
+
+void perse_StatsEnd(perse_phase_t phase) {
+	double end = now();
+	double duration = end - phase_start[phase];
+
+	perse_stats.time[phase] += duration / 1000.0;
+
+	if (!trace) return;
+
+	trace_separator();
+	fprintf(trace, "{\"name\":\"%s\",\"cat\":\"perse\",\"ph\":\"X\","
+		"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+		phase_names[phase], phase_start[phase] - trace_start, duration);
+}
+
+/// Ends a frame.
+/// The counts collected since the last call become available through
+/// perse_GetFrameStats() and get written to the trace, if one is started.
+void perse_EndFrame() {
+	perse_stats.frame = last_frame.frame + 1;
+	last_frame = perse_stats;
+
+	memset(&perse_stats, 0, sizeof(perse_stats));
+
+	if (!trace) return;
+
+	const perse_frame_stats_t* s = &last_frame;
+
+	trace_separator();
+	fprintf(trace, "{\"name\":\"widgets\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+		"\"args\":{\"allocated\":%d,\"destroyed\":%d}},\n",
+		now() - trace_start, s->widgets_allocated, s->widgets_destroyed);
+	fprintf(trace, "{\"name\":\"properties\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+		"\"args\":{\"compared\":%d,\"copied\":%d}},\n",
+		now() - trace_start, s->properties_compared, s->properties_copied);
+	fprintf(trace, "{\"name\":\"canvas\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+		"\"args\":{\"compared\":%d,\"changed\":%d}},\n",
+		now() - trace_start, s->draw_commands_compared, s->draw_commands_changed);
+	fprintf(trace, "{\"name\":\"backend\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+		"\"args\":{\"create\":%d,\"destroy\":%d,\"set_property\":%d,"
+		"\"set_size_pos\":%d,\"measure\":%d}}",
+		now() - trace_start, s->backend_create, s->backend_destroy,
+		s->backend_set_property, s->backend_set_size_pos, s->backend_measure);
+}
+
+/// Starts writing a Chrome trace.
+/// Every frame from now on will be written to the file at `path`, until
+/// perse_StopTrace() is called. If a trace is already being written, it is
+/// stopped first.
+/// @return 1 if the file could be opened, 0 otherwise.
+int perse_StartTrace(const char* path) {
+	perse_StopTrace();
+
+	trace = fopen(path, "w");
+	if (!trace) {
+		PERSE_ERROR(PERSE_LOG_STATS, "perse_StartTrace() could not open %s\n", path);
+		return 0;
+	}
+
+	trace_start = now();
+	trace_first = 1;
+
+	fputs("{\"traceEvents\":[\n", trace);
+
+	return 1;
+}
+
+/// Stops writing a Chrome trace.
+void perse_StopTrace() {
+	if (!trace) return;
+
+	fputs("\n]}\n", trace);
+	fclose(trace);
+
+	trace = NULL;
+}
+
+#else
+
+static perse_frame_stats_t last_frame;
+
+void perse_EndFrame() {}
+
+int perse_StartTrace(const char* path) {
+	(void)path;
+	PERSE_WARNING(PERSE_LOG_STATS,
+		"perse_StartTrace() needs the library built with PERSE_STATS\n");
+	return 0;
+}
+
+void perse_StopTrace() {}
+
+#endif // PERSE_STATS
+
+/// Returns counts for the last frame.
+/// If the library was compiled without PERSE_STATS, all of the counts will
+/// always be zero.
+const perse_frame_stats_t* perse_GetFrameStats() {
+	return &last_frame;
+}
@@ -0,0 +1,61 @@
+#ifndef PERSE_STATS_H
+#define PERSE_STATS_H
+
+typedef enum {
+	PERSE_PHASE_BUILD,		//< frontend building the new widget tree
+	PERSE_PHASE_MERGE,		//< perse_MergeTree()
+	PERSE_PHASE_LAYOUT,		//< perse_CalculateLayout(), perse_ResizeLayout()
+	PERSE_PHASE_APPLY,		//< perse_ApplyChanges()
+
+	PERSE_PHASE_COUNT
+} perse_phase_t;
+
+typedef struct {
+	unsigned long long frame;			//< number of the frame
+
+	double time[PERSE_PHASE_COUNT];		//< wall time of each phase, in ms
+
+	int widgets_allocated;
+	int widgets_destroyed;
+
+	int properties_compared;			//< by perse_MergeTree()
+	int properties_copied;				//< ditto, including new properties
+
+	int draw_commands_compared;			//< canvas commands, see canvas.c
+	int draw_commands_changed;			//< ditto, that have to be drawn again
+
+	int backend_create;					//< calls to perse_BackendCreateWidget()
+	int backend_destroy;				//< etc.
+	int backend_set_property;
+	int backend_set_size_pos;
+	int backend_measure;
+} perse_frame_stats_t;
+
+const perse_frame_stats_t* perse_GetFrameStats();
+void perse_EndFrame();
+
+int perse_StartTrace(const char* path);
+void perse_StopTrace();
+
+// instrumentation only gets compiled in if PERSE_STATS is defined, otherwise
+// the macros below do nothing and the functions above return empty stats
+#ifdef PERSE_STATS
+
+extern perse_frame_stats_t perse_stats;
+
+void perse_StatsBegin(perse_phase_t);
+void perse_StatsEnd(perse_phase_t);
+
+#define PERSE_STATS_BEGIN(phase) perse_StatsBegin(phase)
+#define PERSE_STATS_END(phase) perse_StatsEnd(phase)
+#define PERSE_STATS_COUNT(counter, n) (perse_stats.counter += (n))
+
+#else
+
+#define PERSE_STATS_BEGIN(phase) ((void)0)
+#define PERSE_STATS_END(phase) ((void)0)
+#define PERSE_STATS_COUNT(counter, n) ((void)0)
+
+#endif // PERSE_STATS
+
+#endif // PERSE_STATS_H
@@ -1,6 +1,9 @@
 #include "widget.h"
 
 #include "backend.h"
+#include "layout.h"
+#include "stats.h"
+#include "record.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +27,12 @@
 	widgets when merging them. The `destroy` callback is called with the `user`
 	pointer when a widget is destroyed and should be used to clean up memory
 	that the `user` pointer points to.
+	The `layout` pointer is used by the layout code to cache calculations
+	between frames. It stays with the widget when merging.
+	The `ref` pointer can point to a pointer that the user keeps to the widget.
+	When merging, it is moved to the widget that stays and the user's pointer
+	is updated, and when the widget is destroyed, the user's pointer is set to
+	NULL.
 	
 	Properties are stored in a linked list, first element pointed to by
 	`properties` pointer.
@@ -67,6 +76,8 @@ perse_widget_t* perse_AllocateWidget() {
 	widget->changed = 1;
 	widget->key = -1;
 	
+	PERSE_STATS_COUNT(widgets_allocated, 1);
+	
 	return widget;
 }
 
@@ -80,6 +91,9 @@ static void destroy_recursive(perse_widget_t* widget, char parent_persists) {
 		child = next;
 	}
 	
+	// the children are freed, so the backend mustn't go looking at them
+	widget->child = NULL;
+	
 	// some widget types need the parent pointer to be intact in order to be
 	// properly cleared out of the backend (like the win32 list items), so we
 	// destroy them here, before removing them from their parent
@@ -105,6 +119,16 @@ static void destroy_recursive(perse_widget_t* widget, char parent_persists) {
 		widget->destroy(widget->user);
 	}
 	
+	// the user can't use it anymore
+	if (widget->ref && *widget->ref == widget) {
+		*widget->ref = NULL;
+	}
+	
+	perse_DestroyLayoutCache(widget);
+	perse_RecordForget(widget);
+	
+	PERSE_STATS_COUNT(widgets_destroyed, 1);
+	
 	memset(widget, 0, sizeof(*widget));
 	free(widget);
 }
@@ -124,7 +148,10 @@ void perse_DestroyWidget(perse_widget_t* widget) {
 /// parent's children.
 /// If `parent` is set to NULL, the widget will become parentless.
 void perse_SetParent(perse_widget_t* widget, perse_widget_t* parent) {
-	if (widget->parent) {
+	if (widget->parent && widget->parent->child == widget) {
+		// first child, nothing to look for
+		widget->parent->child = widget->next;
+	} else if (widget->parent) {
 		// find sibling in parent's list before widget
 		perse_widget_t* sibling = widget->parent->child;
 		while (sibling && sibling->next != widget) sibling = sibling->next;
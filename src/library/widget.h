@@ -9,10 +9,10 @@ typedef enum {
 	PERSE_WIDGET_ABSOLUTE_LAYOUT,
 	PERSE_WIDGET_HORIZONTAL_LAYOUT,
 	PERSE_WIDGET_VERTICAL_LAYOUT,
-	PERSE_WIDGET_GRID_LAYOUT,		// TODO: decide what it should do exactly
-	PERSE_WIDGET_FLOW_LAYOUT,		// TODO: ditto
-	PERSE_WIDGET_SPLITTER_LAYOUT,	// TODO: ditto
-	PERSE_WIDGET_FLEX_LAYOUT,		// TODO: ditto
+	PERSE_WIDGET_GRID_LAYOUT,		//< rows and columns of tracks, see layout.c
+	PERSE_WIDGET_FLOW_LAYOUT,		//< wraps children into lines, see layout.c
+	PERSE_WIDGET_SPLITTER_LAYOUT,	//< panes with draggable dividers, see layout.c
+	PERSE_WIDGET_FLEX_LAYOUT,		//< flexbox style grow and shrink, see layout.c
 	
 	PERSE_WIDGET_WINDOW,
 	PERSE_WIDGET_MENU_BAR,
@@ -21,16 +21,16 @@ typedef enum {
 	PERSE_WIDGET_ITEM,				//< pseudowidget
 	
 	PERSE_WIDGET_TAB_PANEL,
-	PERSE_WIDGET_TAB_GROUP,
+	PERSE_WIDGET_TAB_GROUP,			//< see layout.c
 	
 	PERSE_WIDGET_PANEL,				// TODO: implement
 	
 	PERSE_WIDGET_GROUP_PANEL,		// TODO: implement. might be tricky
-	PERSE_WIDGET_SCROLL_PANEL,		// TODO: implement. might be a little tricky
+	PERSE_WIDGET_SCROLL_PANEL,		//< see layout.c
 	
 	PERSE_WIDGET_ARROW_BUTTON,		// TODO: implement
 	PERSE_WIDGET_TEXT_BUTTON,
-	PERSE_WIDGET_IMAGE_BUTTON,		// TODO: implement
+	PERSE_WIDGET_IMAGE_BUTTON,		//< see image.c
 	PERSE_WIDGET_COMBO_BOX,			// TODO: implement
 	
 	PERSE_WIDGET_CHECK_BOX,			// TODO: implement
@@ -45,13 +45,15 @@ typedef enum {
 	PERSE_WIDGET_DATE_PICKER,		// leave unimplemented, for now
 	PERSE_WIDGET_IP_ADDRESS_PICKER,	// ditto
 	
-	PERSE_WIDGET_IMAGE,			// TODO: implement
+	PERSE_WIDGET_IMAGE,			//< see image.c
 	PERSE_WIDGET_CANVAS,		// might actually be rolled into image, we'll see
 	
 	PERSE_WIDGET_PROGRESS_BAR,	// TODO: implement.
 	PERSE_WIDGET_PROPERTY_LIST,	// TODO: implement. will be EXTREMELY tricky 
 	
-	PERSE_WIDGET_TREE_VIEW		// TODO: implement. will be VERY tricky
+	PERSE_WIDGET_TREE_VIEW,		// TODO: implement. will be VERY tricky
+	
+	PERSE_WIDGET_APPLICATION	//< holds top-level windows, see layout.c
 } perse_widget_type_t;
 
 typedef struct {
@@ -66,6 +68,13 @@ typedef struct {
 	perse_size_t min, max;
 } perse_range_t;
 
+typedef struct {
+	perse_size_t available;			//< space offered by the parent, -1 if any
+	perse_size_t result;			//< size that the widget would take up
+} perse_measure_t;
+
+#define PERSE_MEASURE_SLOTS 4
+
 typedef struct perse_widget {
 	perse_widget_type_t type;		//< type of the widget
 	
@@ -73,6 +82,9 @@ typedef struct perse_widget {
 	void* data;						//< additional pointer for backend
 	void* user;						//< pointer for user (frontend) to set
 	void(*destroy)(void*);			//< destroy callback
+	void(*merge_user)(void*, void*);	//< updates user in place, see layout.c
+	void* layout;					//< layout cache, owned by the library
+	struct perse_widget** ref;		//< kept pointing at the widget, see layout.c
 	
 	int key;						//< optional layout key
 	
@@ -86,6 +98,16 @@ typedef struct perse_widget {
 	perse_position_t actual_pos;	//< actual position of the widget
 	
 	char changed;					//< if needs layout recalculation
+	char mounted;					//< is in backend, see layout.c
+	char queued;					//< is on the apply list, ditto
+	char loading;					//< waits for images, ditto
+	int queued_at;					//< index on the apply list, ditto
+	int loading_at;					//< index on the loading list, ditto
+	
+	perse_measure_t measure[PERSE_MEASURE_SLOTS];	//< see layout.c
+	int measure_count;				//< measurements since last change
+	perse_size_t intrinsic;			//< size of content, see layout.c
+	unsigned measure_epoch;			//< see perse_ClearMeasureCache()
 	
 	struct perse_widget* parent;	//< parent widget
 	struct perse_widget* child;		//< first child 
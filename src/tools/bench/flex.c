@@ -0,0 +1,96 @@
+#include "null.h"
+
+#include "../../library/layout.h"
+
+#include <stdio.h>
+
+/*
+	Lays out trees of nested flex layouts that wrap and alternate between rows
+	and columns, with 2^10 up to 2^18 leaves. Every item is asked for its
+	height at some width, which without the measure cache would go down the
+	whole subtree at every level, so the time per node should stay about the
+	same as the tree grows.
+	
+	The tree is destroyed before it is ever applied, so it is still on the
+	apply list, which is timed as well.
+*/
+
+static perse_widget_t* widget(perse_widget_type_t type, perse_widget_t* parent) {
+	perse_widget_t* widget = perse_AllocateWidget();
+	widget->type = type;
+	if (parent) perse_AddChild(parent, widget);
+	return widget;
+}
+
+static void flag(perse_widget_t* widget, perse_name_t name, int value) {
+	perse_property_t* p = perse_CreatePropertyBoolean(value);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static void integer(perse_widget_t* widget, perse_name_t name, int value) {
+	perse_property_t* p = perse_CreatePropertyInteger(value);
+	p->name = name;
+	perse_AddProperty(widget, p);
+}
+
+static void label(perse_widget_t* parent, int w, int h) {
+	perse_widget_t* label = widget(PERSE_WIDGET_LABEL, parent);
+	label->constraint_size.min.w = w;
+	label->constraint_size.min.h = h;
+}
+
+// two leaves at depth 0, twice as many for each level above that
+static perse_widget_t* nest(perse_widget_t* parent, int depth) {
+	perse_widget_t* flex = widget(PERSE_WIDGET_FLEX_LAYOUT, parent);
+	if (depth % 2) flag(flex, PERSE_NAME_VERTICAL, 1);
+	flag(flex, PERSE_NAME_WRAP, 1);
+	
+	if (!depth) {
+		label(flex, 10, 10);
+		label(flex, 20, 10);
+		return flex;
+	}
+	
+	integer(nest(flex, depth - 1), PERSE_NAME_STRETCH, 1);
+	nest(flex, depth - 1);
+	
+	return flex;
+}
+
+static int count(perse_widget_t* widget) {
+	int nodes = 1;
+	for (perse_widget_t* c = widget->child; c; c = c->next) nodes += count(c);
+	return nodes;
+}
+
+int main() {
+	bench_NullBackend();
+	
+	printf("%8s %8s %12s %12s %12s %12s\n", "leaves", "nodes", "first ms", "again ms",
+		"ns per node", "destroy ms");
+	
+	for (int depth = 9; depth <= 17; depth++) {
+		perse_widget_t* window = widget(PERSE_WIDGET_WINDOW, NULL);
+		window->constraint_size.min.w = window->constraint_size.max.w = 1000;
+		window->constraint_size.min.h = window->constraint_size.max.h = 1000;
+		nest(window, depth);
+		
+		int nodes = count(window);
+		
+		double start = bench_Milliseconds();
+		perse_CalculateLayout(window);
+		double first = bench_Milliseconds();
+		perse_CalculateLayout(window);
+		double again = bench_Milliseconds();
+		
+		perse_DestroyWidget(window);
+		double destroyed = bench_Milliseconds();
+		
+		printf("%8i %8i %12.2f %12.2f %12.1f %12.2f\n", 2 << depth, nodes,
+			first - start, again - first, (first - start) * 1000000.0 / nodes,
+			destroyed - again);
+	}
+	
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include "null.h"
+
+#include "../../frontend/cpp/perse.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/*
+	Renders a window with 10,000 buttons, each with a callback that captures
+	a little state, and counts the heap allocations in each Wait(). The first
+	render after the initial one fills the free lists. After that the builders
+	reuse the widgets and user data that the last frame freed, and callbacks
+	fit into their inline buffer, so whatever is left comes from the root
+	function itself: the vectors that Inside() and << make.
+*/
+
+static long allocations = 0;
+
+void* operator new(std::size_t size) {
+	allocations++;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+using namespace perse;
+
+static const int buttons = 10000;
+static int frame = 0;
+static int clicked = -1;
+
+static Widget Root() {
+	static std::vector<Widget> list;
+	list.clear();
+	
+	for (int i = 0; i < buttons; i++) {
+		list.push_back(Button({
+			.text = "button",
+			.onclick = [i](){ clicked = i + frame; }
+		}));
+	}
+	
+	return Window({.width = 640, .height = 480, .title = "merge"}) << Inside({
+		VerticalLayout({}) << list
+	});
+}
+
+int main() {
+	bench_NullBackend();
+	SetRoot(Root);
+	
+	Wait();
+	
+	std::printf("%6s %12s %12s %8s\n", "frame", "allocations", "ms", "creates");
+	
+	for (frame = 1; frame <= 5; frame++) {
+		long before = allocations;
+		int creates = bench_calls.create;
+		double start = bench_Milliseconds();
+		
+		Render();
+		Wait();
+		
+		std::printf("%6i %12li %12.2f %8i\n", frame, allocations - before,
+			bench_Milliseconds() - start, bench_calls.create - creates);
+	}
+	
+	return 0;
+}
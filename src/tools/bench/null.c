@@ -0,0 +1,71 @@
+#include "null.h"
+
+#include "../../library/backend.h"
+
+#include <string.h>
+#include <time.h>
+
+/*
+	Backend for the benchmarks, which only counts the calls. Text is measured
+	as 7 by 13 pixels per character, like a small fixed width font, so that
+	measuring costs about as much as a lookup in the backend would.
+*/
+
+#ifdef PERSE_STATIC_BACKEND
+#error "the benchmarks need the backend to be loaded at runtime"
+#endif
+
+bench_calls_t bench_calls;
+
+static void null_create_widget(perse_widget_t* widget) {
+	widget->system = (void*)1;
+	bench_calls.create++;
+}
+
+static void null_destroy_widget(perse_widget_t* widget) {
+	widget->system = NULL;
+	bench_calls.destroy++;
+}
+
+static void null_set_property(perse_widget_t* widget, perse_property_t* p) {
+	bench_calls.set_property++;
+}
+
+static void null_set_size_pos(perse_widget_t* widget) {
+	bench_calls.set_size_pos++;
+}
+
+static perse_size_t null_measure(perse_widget_t* widget) {
+	bench_calls.measure++;
+	
+	for (perse_property_t* p = widget->property; p; p = p->next) {
+		if (p->name != PERSE_NAME_TEXT || p->type != PERSE_TYPE_STRING) continue;
+		return (perse_size_t){(int)strlen(p->string) * 7, 13};
+	}
+	
+	return (perse_size_t){-1, -1};
+}
+
+static void null_process_events() {}
+
+static int null_should_quit() {
+	return 0;
+}
+
+void bench_NullBackend() {
+	perse_BackendCreateWidget = null_create_widget;
+	perse_BackendDestroyWidget = null_destroy_widget;
+	perse_BackendSetProperty = null_set_property;
+	perse_BackendSetSizePos = null_set_size_pos;
+	perse_BackendMeasure = null_measure;
+	
+	perse_BackendProcessEvents = null_process_events;
+	perse_BackendShouldQuit = null_should_quit;
+	
+	memset(&bench_calls, 0, sizeof(bench_calls));
+}
+
+// processor time, same as the replay tool
+double bench_Milliseconds() {
+	return clock() * 1000.0 / CLOCKS_PER_SEC;
+}
@@ -0,0 +1,28 @@
+#ifndef PERSE_BENCH_NULL_H
+#define PERSE_BENCH_NULL_H
+
+#include "../../library/widget.h"
+
+// calls into the backend, since the last bench_NullBackend()
+typedef struct {
+	int create;
+	int destroy;
+	int set_property;
+	int set_size_pos;
+	int measure;
+} bench_calls_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bench_calls_t bench_calls;
+
+void bench_NullBackend();
+double bench_Milliseconds();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PERSE_BENCH_NULL_H
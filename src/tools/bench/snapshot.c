@@ -0,0 +1,101 @@
+#include "null.h"
+
+#include "../../library/layout.h"
+#include "../../library/snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+	Saves a laid out window with 20,000 widgets to a snapshot in memory, then
+	times reading it back and mounting it in the backend. After that the same
+	tree is built again and merged into the loaded one, which is what the
+	first render does after a snapshot is loaded. Nothing in it has changed,
+	so that merge shouldn't create or measure anything.
+*/
+
+static const int rows = 5000;
+
+static perse_widget_t* widget(perse_widget_type_t type, perse_widget_t* parent,
+	const char* text) {
+	perse_widget_t* widget = perse_AllocateWidget();
+	widget->type = type;
+	
+	if (text) {
+		perse_property_t* p = perse_CreatePropertyString(text);
+		p->name = PERSE_NAME_TEXT;
+		perse_AddProperty(widget, p);
+	}
+	
+	if (parent) perse_AddChild(parent, widget);
+	return widget;
+}
+
+// each row is a layout with a label, a button and a text box
+static perse_widget_t* build() {
+	perse_widget_t* window = widget(PERSE_WIDGET_WINDOW, NULL, NULL);
+	window->constraint_size.min.w = window->constraint_size.max.w = 800;
+	window->constraint_size.min.h = window->constraint_size.max.h = 600;
+	
+	perse_widget_t* list = widget(PERSE_WIDGET_SCROLL_PANEL, window, NULL);
+	
+	char text[32];
+	for (int i = 0; i < rows; i++) {
+		perse_widget_t* row = widget(PERSE_WIDGET_HORIZONTAL_LAYOUT, list, NULL);
+		
+		snprintf(text, sizeof(text), "row %i", i);
+		widget(PERSE_WIDGET_LABEL, row, text);
+		widget(PERSE_WIDGET_TEXT_BUTTON, row, "edit");
+		widget(PERSE_WIDGET_TEXT_BOX, row, text);
+	}
+	
+	return window;
+}
+
+static int count(perse_widget_t* widget) {
+	int widgets = 1;
+	for (perse_widget_t* c = widget->child; c; c = c->next) widgets += count(c);
+	return widgets;
+}
+
+int main() {
+	bench_NullBackend();
+	
+	perse_widget_t* original = build();
+	perse_CalculateLayout(original);
+	
+	size_t size;
+	void* snapshot = perse_WriteSnapshot(original, &size);
+	
+	printf("%i widgets, %zu byte snapshot\n", count(original), size);
+	perse_DestroyWidget(original);
+	
+	bench_NullBackend();
+	double start = bench_Milliseconds();
+	
+	perse_widget_t* root = perse_ReadSnapshot(snapshot, size);
+	if (!root) {
+		printf("couldn't read the snapshot back\n");
+		return 1;
+	}
+	
+	double read = bench_Milliseconds();
+	perse_ApplyChanges(root);
+	double mounted = bench_Milliseconds();
+	
+	printf("read %.2f ms, mount %.2f ms, %i creates\n",
+		read - start, mounted - read, bench_calls.create);
+	
+	bench_NullBackend();
+	perse_MergeTree(root, build());
+	perse_CalculateLayout(root);
+	perse_ApplyChanges(root);
+	
+	printf("first render: %i creates, %i measures, %i sizes and positions\n",
+		bench_calls.create, bench_calls.measure, bench_calls.set_size_pos);
+	
+	perse_DestroyWidget(root);
+	free(snapshot);
+	
+	return 0;
+}
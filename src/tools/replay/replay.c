@@ -0,0 +1,90 @@
+#include "../../library/backend.h"
+#include "../../library/record.h"
+#include "../../library/perse.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+	Replays a recording made with perse_StartRecording() into a backend, for
+	benchmarking backends and the library against the same workload.
+	
+	By default the backend is loaded the same way as in an application. With
+	--null no backend is loaded and the calls are only counted, which works
+	headless and measures the replay itself.
+*/
+
+static int creates, destroys, set_properties, set_size_positions;
+
+#ifndef PERSE_STATIC_BACKEND
+
+static void null_create_widget(perse_widget_t* widget) {
+	widget->system = (void*)1;
+	creates++;
+}
+
+static void null_destroy_widget(perse_widget_t* widget) {
+	widget->system = NULL;
+	destroys++;
+}
+
+static void null_set_property(perse_widget_t* widget, perse_property_t* p) {
+	set_properties++;
+}
+
+static void null_set_size_pos(perse_widget_t* widget) {
+	set_size_positions++;
+}
+#endif
+
+int main(int argc, char** argv) {
+	const char* path = NULL;
+	int realtime = 0;
+	int null_backend = 0;
+	
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--realtime") == 0) {
+			realtime = 1;
+		} else if (strcmp(argv[i], "--null") == 0) {
+			null_backend = 1;
+		} else {
+			path = argv[i];
+		}
+	}
+	
+	if (!path) {
+		printf("usage: %s [--realtime] [--null] recording\n", argv[0]);
+		return 1;
+	}
+	
+	if (null_backend) {
+#ifdef PERSE_STATIC_BACKEND
+		printf("--null can't be used with a statically linked backend\n");
+		return 1;
+#else
+		perse_BackendCreateWidget = null_create_widget;
+		perse_BackendDestroyWidget = null_destroy_widget;
+		perse_BackendSetProperty = null_set_property;
+		perse_BackendSetSizePos = null_set_size_pos;
+#endif
+	} else {
+		perse_LoadBackend();
+	}
+	
+	clock_t start = clock();
+	int records = perse_Replay(path, realtime);
+	clock_t end = clock();
+	
+	if (records < 0) return 1;
+	
+	printf("%i records in %.3f ms\n", records,
+		(end - start) * 1000.0 / CLOCKS_PER_SEC);
+	
+	if (null_backend) {
+		printf("create %i, destroy %i, set property %i, set size pos %i\n",
+			creates, destroys, set_properties, set_size_positions);
+	}
+	
+	return 0;
+}